@@ -2,8 +2,11 @@
 #define COMMON_TYPES_H
 
 #include <string>
+#include <stdint.h>
 
 namespace MySweetHome {
+typedef ::uint64_t uint64_t;
+typedef ::int64_t int64_t;
 typedef unsigned int uint32_t;
 typedef unsigned short uint16_t;
 typedef unsigned char uint8_t;
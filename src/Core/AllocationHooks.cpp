@@ -0,0 +1,112 @@
+#include "AllocationTracker.h"
+#include <cstdlib>
+#include <new>
+
+#if __cplusplus >= 201103L
+#define ALLOCATION_THROW_BAD_ALLOC
+#define ALLOCATION_NO_THROW noexcept
+#else
+#define ALLOCATION_THROW_BAD_ALLOC throw(std::bad_alloc)
+#define ALLOCATION_NO_THROW throw()
+#endif
+
+namespace {
+struct AllocationHeader {
+    size_t size;
+    uint32_t tag;
+    uint32_t reserved;
+};
+
+const size_t HEADER_SIZE = (sizeof(AllocationHeader) + 15) & ~static_cast<size_t>(15);
+
+void* trackedAllocate(size_t size)
+{
+    if (size == 0) {
+        size = 1;
+    }
+    for (;;) {
+        void* raw = std::malloc(size + HEADER_SIZE);
+        if (raw) {
+            AllocationHeader* header = static_cast<AllocationHeader*>(raw);
+            header->size = size;
+            header->tag = MySweetHome::AllocationTracker::onAllocate(size);
+            header->reserved = 0;
+            return static_cast<char*>(raw) + HEADER_SIZE;
+        }
+        std::new_handler handler = std::set_new_handler(0);
+        std::set_new_handler(handler);
+        if (!handler) {
+            return 0;
+        }
+        handler();
+    }
+}
+
+void trackedFree(void* pointer)
+{
+    if (!pointer) {
+        return;
+    }
+    AllocationHeader* header = reinterpret_cast<AllocationHeader*>(static_cast<char*>(pointer) - HEADER_SIZE);
+    MySweetHome::AllocationTracker::onFree(header->tag, header->size);
+    std::free(header);
+}
+
+struct HookRegistration {
+    HookRegistration()
+    {
+        MySweetHome::AllocationTracker::setAvailable(true);
+    }
+};
+
+HookRegistration s_registration;
+
+}
+
+void* operator new(size_t size) ALLOCATION_THROW_BAD_ALLOC
+{
+    void* pointer = trackedAllocate(size);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](size_t size) ALLOCATION_THROW_BAD_ALLOC
+{
+    void* pointer = trackedAllocate(size);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) ALLOCATION_NO_THROW
+{
+    return trackedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) ALLOCATION_NO_THROW
+{
+    return trackedAllocate(size);
+}
+
+void operator delete(void* pointer) ALLOCATION_NO_THROW
+{
+    trackedFree(pointer);
+}
+
+void operator delete[](void* pointer) ALLOCATION_NO_THROW
+{
+    trackedFree(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) ALLOCATION_NO_THROW
+{
+    trackedFree(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) ALLOCATION_NO_THROW
+{
+    trackedFree(pointer);
+}
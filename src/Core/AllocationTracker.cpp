@@ -0,0 +1,381 @@
+#include "AllocationTracker.h"
+#include "ResourceUsage.h"
+#include <cstring>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#define ALLOCATION_THREAD_LOCAL __declspec(thread)
+#else
+#define ALLOCATION_THREAD_LOCAL __thread
+#endif
+
+namespace MySweetHome {
+namespace {
+struct TagSlot {
+    const char* subsystem;
+    const char* operation;
+    volatile uint64_t allocations;
+    volatile uint64_t frees;
+    volatile uint64_t allocatedBytes;
+    volatile uint64_t freedBytes;
+    volatile int64_t liveBytes;
+    volatile int64_t peakBytes;
+};
+
+TagSlot s_slots[MAX_ALLOCATION_TAGS] = { { "untagged", "", 0, 0, 0, 0, 0, 0 } };
+volatile uint32_t s_slotCount = 1;
+volatile int s_registerLock = 0;
+volatile int s_available = 0;
+volatile int s_enabled = 0;
+ALLOCATION_THREAD_LOCAL uint32_t t_tag = 0;
+ALLOCATION_THREAD_LOCAL uint64_t t_allocations = 0;
+ALLOCATION_THREAD_LOCAL uint64_t t_allocatedBytes = 0;
+
+inline void atomicAdd(volatile uint64_t* target, uint64_t delta)
+{
+#ifdef _WIN32
+    InterlockedExchangeAdd64(reinterpret_cast<volatile LONGLONG*>(target), static_cast<LONGLONG>(delta));
+#else
+    __sync_fetch_and_add(target, delta);
+#endif
+}
+
+inline int64_t atomicAddSigned(volatile int64_t* target, int64_t delta)
+{
+#ifdef _WIN32
+    return InterlockedExchangeAdd64(reinterpret_cast<volatile LONGLONG*>(target), delta) + delta;
+#else
+    return __sync_add_and_fetch(target, delta);
+#endif
+}
+
+inline void atomicMax(volatile int64_t* target, int64_t value)
+{
+    int64_t current = *target;
+    while (value > current) {
+#ifdef _WIN32
+        int64_t previous = InterlockedCompareExchange64(reinterpret_cast<volatile LONGLONG*>(target),
+                                                        value, current);
+#else
+        int64_t previous = __sync_val_compare_and_swap(target, current, value);
+#endif
+        if (previous == current) {
+            return;
+        }
+        current = previous;
+    }
+}
+
+inline void lockRegistry()
+{
+#ifdef _WIN32
+    while (InterlockedExchange(reinterpret_cast<volatile LONG*>(&s_registerLock), 1) != 0) {
+    }
+#else
+    while (__sync_lock_test_and_set(&s_registerLock, 1) != 0) {
+    }
+#endif
+}
+
+inline void unlockRegistry()
+{
+#ifdef _WIN32
+    InterlockedExchange(reinterpret_cast<volatile LONG*>(&s_registerLock), 0);
+#else
+    __sync_lock_release(&s_registerLock);
+#endif
+}
+
+inline bool sameText(const char* a, const char* b)
+{
+    return a == b || std::strcmp(a, b) == 0;
+}
+
+AllocationStats snapshotSlot(uint32_t index)
+{
+    const TagSlot& slot = s_slots[index];
+    AllocationStats stats;
+    stats.subsystem = slot.subsystem;
+    stats.operation = slot.operation;
+    stats.allocations = slot.allocations;
+    stats.frees = slot.frees;
+    stats.allocatedBytes = slot.allocatedBytes;
+    stats.freedBytes = slot.freedBytes;
+    stats.liveBytes = slot.liveBytes > 0 ? static_cast<uint64_t>(slot.liveBytes) : 0;
+    stats.peakBytes = slot.peakBytes > 0 ? static_cast<uint64_t>(slot.peakBytes) : 0;
+    return stats;
+}
+
+void appendStats(std::ostringstream& oss, const std::string& name, const AllocationStats& stats)
+{
+    oss << "  " << name << ": " << stats.allocations << " alloc, " << stats.frees << " free, "
+        << stats.allocatedBytes << " B, live " << stats.liveBytes << " B, peak " << stats.peakBytes << " B\n";
+}
+
+}
+
+AllocationStats::AllocationStats()
+    : allocations(0)
+    , frees(0)
+    , allocatedBytes(0)
+    , freedBytes(0)
+    , liveBytes(0)
+    , peakBytes(0)
+{
+}
+
+void AllocationStats::merge(const AllocationStats& other)
+{
+    allocations += other.allocations;
+    frees += other.frees;
+    allocatedBytes += other.allocatedBytes;
+    freedBytes += other.freedBytes;
+    liveBytes += other.liveBytes;
+    peakBytes += other.peakBytes;
+}
+
+bool AllocationTracker::isAvailable()
+{
+    return s_available != 0;
+}
+
+void AllocationTracker::setAvailable(bool available)
+{
+    s_available = available ? 1 : 0;
+}
+
+bool AllocationTracker::isEnabled()
+{
+    return s_enabled != 0;
+}
+
+void AllocationTracker::enable(bool enabled)
+{
+    s_enabled = enabled ? 1 : 0;
+}
+
+uint32_t AllocationTracker::onAllocate(size_t bytes)
+{
+    ++t_allocations;
+    t_allocatedBytes += bytes;
+    if (!s_enabled) {
+        return UNTRACKED_ALLOCATION;
+    }
+    uint32_t tag = t_tag;
+    TagSlot& slot = s_slots[tag];
+    atomicAdd(&slot.allocations, 1);
+    atomicAdd(&slot.allocatedBytes, bytes);
+    atomicMax(&slot.peakBytes, atomicAddSigned(&slot.liveBytes, static_cast<int64_t>(bytes)));
+    return tag;
+}
+
+void AllocationTracker::onFree(uint32_t tag, size_t bytes)
+{
+    if (tag >= MAX_ALLOCATION_TAGS) {
+        return;
+    }
+    TagSlot& slot = s_slots[tag];
+    atomicAdd(&slot.frees, 1);
+    atomicAdd(&slot.freedBytes, bytes);
+    atomicAddSigned(&slot.liveBytes, -static_cast<int64_t>(bytes));
+}
+
+uint32_t AllocationTracker::findOrRegisterTag(const char* subsystem, const char* operation)
+{
+    if (!subsystem) {
+        return 0;
+    }
+    if (!operation) {
+        operation = "";
+    }
+    uint32_t count = s_slotCount;
+    for (uint32_t i = 1; i < count; ++i) {
+        if (sameText(s_slots[i].subsystem, subsystem) && sameText(s_slots[i].operation, operation)) {
+            return i;
+        }
+    }
+    lockRegistry();
+    uint32_t tag = 0;
+    for (uint32_t i = 1; i < s_slotCount; ++i) {
+        if (sameText(s_slots[i].subsystem, subsystem) && sameText(s_slots[i].operation, operation)) {
+            tag = i;
+            break;
+        }
+    }
+    if (tag == 0 && s_slotCount < MAX_ALLOCATION_TAGS) {
+        tag = s_slotCount;
+        s_slots[tag].subsystem = subsystem;
+        s_slots[tag].operation = operation;
+#ifndef _WIN32
+        __sync_synchronize();
+#endif
+        s_slotCount = tag + 1;
+    }
+    unlockRegistry();
+    return tag;
+}
+
+uint32_t AllocationTracker::currentTag()
+{
+    return t_tag;
+}
+
+uint32_t AllocationTracker::exchangeTag(uint32_t tag)
+{
+    uint32_t previous = t_tag;
+    t_tag = tag;
+    return previous;
+}
+
+uint64_t AllocationTracker::threadAllocations()
+{
+    return t_allocations;
+}
+
+uint64_t AllocationTracker::threadAllocatedBytes()
+{
+    return t_allocatedBytes;
+}
+
+AllocationStats AllocationTracker::getTotals()
+{
+    AllocationStats totals;
+    uint32_t count = s_slotCount;
+    for (uint32_t i = 0; i < count; ++i) {
+        totals.merge(snapshotSlot(i));
+    }
+    totals.subsystem = "total";
+    return totals;
+}
+
+AllocationStats AllocationTracker::getSubsystem(const std::string& subsystem)
+{
+    AllocationStats stats;
+    uint32_t count = s_slotCount;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (subsystem == s_slots[i].subsystem) {
+            stats.merge(snapshotSlot(i));
+        }
+    }
+    stats.subsystem = subsystem;
+    return stats;
+}
+
+AllocationStats AllocationTracker::getOperation(const std::string& subsystem, const std::string& operation)
+{
+    uint32_t count = s_slotCount;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (subsystem == s_slots[i].subsystem && operation == s_slots[i].operation) {
+            return snapshotSlot(i);
+        }
+    }
+    AllocationStats stats;
+    stats.subsystem = subsystem;
+    stats.operation = operation;
+    return stats;
+}
+
+std::vector<AllocationStats> AllocationTracker::getOperations()
+{
+    std::vector<AllocationStats> result;
+    uint32_t count = s_slotCount;
+    for (uint32_t i = 0; i < count; ++i) {
+        result.push_back(snapshotSlot(i));
+    }
+    return result;
+}
+
+std::vector<AllocationStats> AllocationTracker::getSubsystems()
+{
+    std::vector<AllocationStats> result;
+    uint32_t count = s_slotCount;
+    for (uint32_t i = 0; i < count; ++i) {
+        AllocationStats slot = snapshotSlot(i);
+        size_t j = 0;
+        while (j < result.size() && result[j].subsystem != slot.subsystem) {
+            ++j;
+        }
+        if (j == result.size()) {
+            slot.operation = "";
+            result.push_back(slot);
+        } else {
+            result[j].merge(slot);
+        }
+    }
+    return result;
+}
+
+std::string AllocationTracker::report()
+{
+    std::vector<AllocationStats> subsystems = getSubsystems();
+    std::vector<AllocationStats> operations = getOperations();
+    std::ostringstream oss;
+    oss << "Allocation tracking: " << (isAvailable() ? (isEnabled() ? "enabled" : "disabled") : "not linked")
+        << ", RSS " << ResourceUsage::currentRssBytes() / 1024 << " KiB, peak RSS "
+        << ResourceUsage::peakRssBytes() / 1024 << " KiB\n";
+    oss << "Subsystems:\n";
+    for (size_t i = 0; i < subsystems.size(); ++i) {
+        appendStats(oss, subsystems[i].subsystem, subsystems[i]);
+    }
+    oss << "Operations:\n";
+    for (size_t i = 0; i < operations.size(); ++i) {
+        if (!operations[i].operation.empty() && operations[i].allocations > 0) {
+            appendStats(oss, operations[i].subsystem + "/" + operations[i].operation, operations[i]);
+        }
+    }
+    return oss.str();
+}
+
+void AllocationTracker::reset()
+{
+    uint32_t count = s_slotCount;
+    for (uint32_t i = 0; i < count; ++i) {
+        TagSlot& slot = s_slots[i];
+        slot.allocations = 0;
+        slot.frees = 0;
+        slot.allocatedBytes = 0;
+        slot.freedBytes = 0;
+        slot.liveBytes = 0;
+        slot.peakBytes = 0;
+    }
+}
+
+AllocationScope::AllocationScope(const char* subsystem, const char* operation)
+    : m_previous(AllocationTracker::exchangeTag(AllocationTracker::findOrRegisterTag(subsystem, operation)))
+{
+}
+
+AllocationScope::~AllocationScope()
+{
+    AllocationTracker::exchangeTag(m_previous);
+}
+
+AllocationMeter::AllocationMeter()
+    : m_startAllocations(AllocationTracker::threadAllocations())
+    , m_startBytes(AllocationTracker::threadAllocatedBytes())
+{
+}
+
+void AllocationMeter::restart()
+{
+    m_startAllocations = AllocationTracker::threadAllocations();
+    m_startBytes = AllocationTracker::threadAllocatedBytes();
+}
+
+uint64_t AllocationMeter::getAllocations() const
+{
+    return AllocationTracker::threadAllocations() - m_startAllocations;
+}
+
+uint64_t AllocationMeter::getBytes() const
+{
+    return AllocationTracker::threadAllocatedBytes() - m_startBytes;
+}
+
+bool AllocationMeter::withinBudget(uint64_t maxAllocations, uint64_t maxBytes) const
+{
+    return getAllocations() <= maxAllocations && getBytes() <= maxBytes;
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef ALLOCATION_TRACKER_H
+#define ALLOCATION_TRACKER_H
+
+#include <string>
+#include <vector>
+#include "common_types.h"
+
+namespace MySweetHome {
+const size_t MAX_ALLOCATION_TAGS = 128;
+const uint32_t UNTRACKED_ALLOCATION = 0xFFFFFFFFu;
+struct AllocationStats {
+    std::string subsystem;
+    std::string operation;
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t allocatedBytes;
+    uint64_t freedBytes;
+    uint64_t liveBytes;
+    uint64_t peakBytes;
+
+    AllocationStats();
+    void merge(const AllocationStats& other);
+};
+class AllocationTracker {
+public:
+    static bool isAvailable();
+    static void setAvailable(bool available);
+    static bool isEnabled();
+    static void enable(bool enabled);
+    static uint32_t onAllocate(size_t bytes);
+    static void onFree(uint32_t tag, size_t bytes);
+    static uint32_t findOrRegisterTag(const char* subsystem, const char* operation);
+    static uint32_t currentTag();
+    static uint32_t exchangeTag(uint32_t tag);
+    static uint64_t threadAllocations();
+    static uint64_t threadAllocatedBytes();
+    static AllocationStats getTotals();
+    static AllocationStats getSubsystem(const std::string& subsystem);
+    static AllocationStats getOperation(const std::string& subsystem, const std::string& operation);
+    static std::vector<AllocationStats> getOperations();
+    static std::vector<AllocationStats> getSubsystems();
+    static std::string report();
+    static void reset();
+
+private:
+    AllocationTracker();
+};
+class AllocationScope {
+public:
+    explicit AllocationScope(const char* subsystem, const char* operation = "");
+    ~AllocationScope();
+
+private:
+    AllocationScope(const AllocationScope&);
+    AllocationScope& operator=(const AllocationScope&);
+
+    uint32_t m_previous;
+};
+class AllocationMeter {
+public:
+    AllocationMeter();
+    void restart();
+    uint64_t getAllocations() const;
+    uint64_t getBytes() const;
+    bool withinBudget(uint64_t maxAllocations, uint64_t maxBytes = ~static_cast<uint64_t>(0)) const;
+
+private:
+    uint64_t m_startAllocations;
+    uint64_t m_startBytes;
+};
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+#include "Atomic.h"
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <malloc.h>
+#endif
+
+namespace MySweetHome {
+AtomicCounter::AtomicCounter(long value)
+    : m_value(value)
+{
+}
+
+AtomicCounter::~AtomicCounter()
+{
+}
+
+long AtomicCounter::increment()
+{
+#ifdef _WIN32
+    return InterlockedIncrement(&m_value);
+#else
+    return __sync_add_and_fetch(&m_value, 1);
+#endif
+}
+
+long AtomicCounter::decrement()
+{
+#ifdef _WIN32
+    return InterlockedDecrement(&m_value);
+#else
+    return __sync_sub_and_fetch(&m_value, 1);
+#endif
+}
+
+long AtomicCounter::add(long delta)
+{
+#ifdef _WIN32
+    return InterlockedExchangeAdd(&m_value, delta) + delta;
+#else
+    return __sync_add_and_fetch(&m_value, delta);
+#endif
+}
+
+long AtomicCounter::get() const
+{
+#ifdef _WIN32
+    return InterlockedCompareExchange(const_cast<volatile long*>(&m_value), 0, 0);
+#else
+    return __sync_add_and_fetch(const_cast<volatile long*>(&m_value), 0);
+#endif
+}
+
+void AtomicCounter::set(long value)
+{
+#ifdef _WIN32
+    InterlockedExchange(&m_value, value);
+#else
+    __sync_lock_test_and_set(&m_value, value);
+    __sync_synchronize();
+#endif
+}
+
+void* alignedAllocate(size_t size, size_t alignment)
+{
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    void* pointer = 0;
+    if (posix_memalign(&pointer, alignment, size) != 0) {
+        return 0;
+    }
+    return pointer;
+#endif
+}
+
+void alignedFree(void* pointer)
+{
+#ifdef _WIN32
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+}
@@ -0,0 +1,28 @@
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+#include "common_types.h"
+
+namespace MySweetHome {
+class AtomicCounter {
+public:
+    explicit AtomicCounter(long value = 0);
+    ~AtomicCounter();
+    long increment();
+    long decrement();
+    long add(long delta);
+    long get() const;
+    void set(long value);
+
+private:
+    AtomicCounter(const AtomicCounter&);
+    AtomicCounter& operator=(const AtomicCounter&);
+
+    volatile long m_value;
+};
+void* alignedAllocate(size_t size, size_t alignment);
+void alignedFree(void* pointer);
+
+}
+
+#endif
@@ -0,0 +1,185 @@
+#include "Clock.h"
+#include "MonotonicTime.h"
+#include <sstream>
+
+namespace MySweetHome {
+namespace {
+IClock* g_clock = 0;
+}
+
+uint64_t IClock::nowMillis() const
+{
+    return nowMicros() / 1000ULL;
+}
+
+void IClock::sleepMillis(uint64_t millis)
+{
+    sleepMicros(millis * 1000ULL);
+}
+
+void IClock::sleepSeconds(uint64_t seconds)
+{
+    sleepMicros(seconds * 1000000ULL);
+}
+
+RealClock::RealClock()
+{
+}
+
+RealClock::~RealClock()
+{
+}
+
+uint64_t RealClock::nowMicros() const
+{
+    return monotonicMicros();
+}
+
+time_t RealClock::wallTime() const
+{
+    return time(0);
+}
+
+void RealClock::sleepMicros(uint64_t micros)
+{
+    MySweetHome::sleepMicros(micros);
+}
+
+std::string RealClock::getClockName() const
+{
+    return "Real";
+}
+
+ManualClock::ManualClock(uint64_t startMicros, time_t wallStart)
+    : m_startMicros(startMicros)
+    , m_nowMicros(startMicros)
+    , m_wallStart(wallStart)
+    , m_sleepCount(0)
+    , m_sleptMicros(0)
+{
+}
+
+ManualClock::~ManualClock()
+{
+}
+
+uint64_t ManualClock::nowMicros() const
+{
+    ScopedLock lock(m_mutex);
+    return m_nowMicros;
+}
+
+time_t ManualClock::wallTime() const
+{
+    ScopedLock lock(m_mutex);
+    return m_wallStart + static_cast<time_t>((m_nowMicros - m_startMicros) / 1000000ULL);
+}
+
+void ManualClock::sleepMicros(uint64_t micros)
+{
+    ScopedLock lock(m_mutex);
+    m_nowMicros += micros;
+    ++m_sleepCount;
+    m_sleptMicros += micros;
+}
+
+std::string ManualClock::getClockName() const
+{
+    return "Manual";
+}
+
+void ManualClock::advanceMicros(uint64_t micros)
+{
+    ScopedLock lock(m_mutex);
+    m_nowMicros += micros;
+}
+
+void ManualClock::advanceMillis(uint64_t millis)
+{
+    advanceMicros(millis * 1000ULL);
+}
+
+void ManualClock::advanceSeconds(uint64_t seconds)
+{
+    advanceMicros(seconds * 1000000ULL);
+}
+
+void ManualClock::setMicros(uint64_t micros)
+{
+    ScopedLock lock(m_mutex);
+    if (micros > m_nowMicros) {
+        m_nowMicros = micros;
+    }
+}
+
+uint64_t ManualClock::getSleepCount() const
+{
+    ScopedLock lock(m_mutex);
+    return m_sleepCount;
+}
+
+uint64_t ManualClock::getSleptMicros() const
+{
+    ScopedLock lock(m_mutex);
+    return m_sleptMicros;
+}
+
+AcceleratedClock::AcceleratedClock(double factor)
+    : m_factor(factor > 0.0 ? factor : 1.0)
+    , m_realStart(monotonicMicros())
+    , m_wallStart(time(0))
+{
+}
+
+AcceleratedClock::~AcceleratedClock()
+{
+}
+
+uint64_t AcceleratedClock::nowMicros() const
+{
+    uint64_t elapsed = monotonicMicros() - m_realStart;
+    return m_realStart + static_cast<uint64_t>(elapsed * m_factor);
+}
+
+time_t AcceleratedClock::wallTime() const
+{
+    return m_wallStart + static_cast<time_t>((nowMicros() - m_realStart) / 1000000ULL);
+}
+
+void AcceleratedClock::sleepMicros(uint64_t micros)
+{
+    MySweetHome::sleepMicros(static_cast<uint64_t>(micros / m_factor));
+}
+
+std::string AcceleratedClock::getClockName() const
+{
+    std::ostringstream oss;
+    oss << "Accelerated x" << m_factor;
+    return oss.str();
+}
+
+double AcceleratedClock::getFactor() const
+{
+    return m_factor;
+}
+
+IClock& ClockProvider::getClock()
+{
+    if (g_clock) {
+        return *g_clock;
+    }
+    return getRealClock();
+}
+
+void ClockProvider::setClock(IClock* clock)
+{
+    g_clock = clock;
+}
+
+RealClock& ClockProvider::getRealClock()
+{
+    static RealClock realClock;
+    return realClock;
+}
+
+}
@@ -0,0 +1,79 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <ctime>
+#include "common_types.h"
+#include "Mutex.h"
+
+namespace MySweetHome {
+class IClock {
+public:
+    virtual ~IClock() {}
+    virtual uint64_t nowMicros() const = 0;
+    virtual time_t wallTime() const = 0;
+    virtual void sleepMicros(uint64_t micros) = 0;
+    virtual std::string getClockName() const = 0;
+    uint64_t nowMillis() const;
+    void sleepMillis(uint64_t millis);
+    void sleepSeconds(uint64_t seconds);
+};
+class RealClock : public IClock {
+public:
+    RealClock();
+    virtual ~RealClock();
+    virtual uint64_t nowMicros() const;
+    virtual time_t wallTime() const;
+    virtual void sleepMicros(uint64_t micros);
+    virtual std::string getClockName() const;
+};
+class ManualClock : public IClock {
+public:
+    explicit ManualClock(uint64_t startMicros = 0, time_t wallStart = 0);
+    virtual ~ManualClock();
+    virtual uint64_t nowMicros() const;
+    virtual time_t wallTime() const;
+    virtual void sleepMicros(uint64_t micros);
+    virtual std::string getClockName() const;
+    void advanceMicros(uint64_t micros);
+    void advanceMillis(uint64_t millis);
+    void advanceSeconds(uint64_t seconds);
+    void setMicros(uint64_t micros);
+    uint64_t getSleepCount() const;
+    uint64_t getSleptMicros() const;
+
+private:
+    mutable Mutex m_mutex;
+    uint64_t m_startMicros;
+    uint64_t m_nowMicros;
+    time_t m_wallStart;
+    uint64_t m_sleepCount;
+    uint64_t m_sleptMicros;
+};
+class AcceleratedClock : public IClock {
+public:
+    explicit AcceleratedClock(double factor);
+    virtual ~AcceleratedClock();
+    virtual uint64_t nowMicros() const;
+    virtual time_t wallTime() const;
+    virtual void sleepMicros(uint64_t micros);
+    virtual std::string getClockName() const;
+    double getFactor() const;
+
+private:
+    double m_factor;
+    uint64_t m_realStart;
+    time_t m_wallStart;
+};
+class ClockProvider {
+public:
+    static IClock& getClock();
+    static void setClock(IClock* clock);
+    static RealClock& getRealClock();
+
+private:
+    ClockProvider();
+};
+
+}
+
+#endif
@@ -0,0 +1,573 @@
+#include "ConnectionManager.h"
+#include "GatewayTransport.h"
+#include "Logger.h"
+#include <sstream>
+
+namespace MySweetHome {
+std::string circuitStateToString(CircuitState state)
+{
+    switch (state) {
+        case CIRCUIT_CLOSED:    return "Closed";
+        case CIRCUIT_OPEN:      return "Open";
+        case CIRCUIT_HALF_OPEN: return "HalfOpen";
+        default:                return "Unknown";
+    }
+}
+BackoffPolicy::BackoffPolicy(int baseDelayMs, int maxDelayMs)
+    : m_baseDelayMs(baseDelayMs > 0 ? baseDelayMs : 0)
+    , m_maxDelayMs(maxDelayMs > baseDelayMs ? maxDelayMs : baseDelayMs)
+{
+}
+
+BackoffPolicy::~BackoffPolicy()
+{
+}
+
+int BackoffPolicy::nextDelay(int attempt, Random& random) const
+{
+    if (m_baseDelayMs <= 0) {
+        return 0;
+    }
+
+    int cap = m_baseDelayMs;
+    for (int i = 0; i < attempt && cap < m_maxDelayMs; ++i) {
+        cap *= 2;
+    }
+    if (cap > m_maxDelayMs) {
+        cap = m_maxDelayMs;
+    }
+    int half = cap / 2;
+    return half + random.nextInt(0, cap - half);
+}
+
+int BackoffPolicy::getBaseDelay() const
+{
+    return m_baseDelayMs;
+}
+
+int BackoffPolicy::getMaxDelay() const
+{
+    return m_maxDelayMs;
+}
+CircuitBreaker::CircuitBreaker(int failureThreshold, int openDurationMs)
+    : m_state(CIRCUIT_CLOSED)
+    , m_failureThreshold(1)
+    , m_openDurationMs(0)
+    , m_consecutiveFailures(0)
+    , m_openCount(0)
+    , m_openedAt(0)
+    , m_trialInFlight(false)
+{
+    configure(failureThreshold, openDurationMs);
+}
+
+CircuitBreaker::~CircuitBreaker()
+{
+}
+
+bool CircuitBreaker::allowRequest(uint64_t nowMs)
+{
+    switch (m_state) {
+        case CIRCUIT_CLOSED:
+            return true;
+        case CIRCUIT_OPEN:
+            if (nowMs < m_openedAt + static_cast<uint64_t>(m_openDurationMs)) {
+                return false;
+            }
+            m_state = CIRCUIT_HALF_OPEN;
+            m_trialInFlight = true;
+            return true;
+        case CIRCUIT_HALF_OPEN:
+            if (m_trialInFlight) {
+                return false;
+            }
+            m_trialInFlight = true;
+            return true;
+    }
+    return false;
+}
+
+void CircuitBreaker::recordSuccess()
+{
+    m_state = CIRCUIT_CLOSED;
+    m_consecutiveFailures = 0;
+    m_trialInFlight = false;
+}
+
+void CircuitBreaker::recordFailure(uint64_t nowMs)
+{
+    ++m_consecutiveFailures;
+    m_trialInFlight = false;
+    if (m_state == CIRCUIT_HALF_OPEN ||
+        (m_state == CIRCUIT_CLOSED && m_consecutiveFailures >= m_failureThreshold)) {
+        m_state = CIRCUIT_OPEN;
+        m_openedAt = nowMs;
+        ++m_openCount;
+    }
+}
+
+void CircuitBreaker::configure(int failureThreshold, int openDurationMs)
+{
+    m_failureThreshold = failureThreshold > 0 ? failureThreshold : 1;
+    m_openDurationMs = openDurationMs >= 0 ? openDurationMs : 0;
+}
+
+CircuitState CircuitBreaker::getState() const
+{
+    return m_state;
+}
+
+int CircuitBreaker::getConsecutiveFailures() const
+{
+    return m_consecutiveFailures;
+}
+
+int CircuitBreaker::getOpenCount() const
+{
+    return m_openCount;
+}
+ConnectionMetrics::ConnectionMetrics()
+    : circuitState(CIRCUIT_CLOSED)
+    , openConnections(0)
+    , leasedDevices(0)
+    , connectAttempts(0)
+    , connectFailures(0)
+    , reconnects(0)
+    , drops(0)
+    , rejectedByCircuit(0)
+    , rejectedByBackoff(0)
+    , circuitOpens(0)
+    , consecutiveFailures(0)
+    , nextRetryAt(0)
+{
+}
+ConnectionManager::EndpointPool::EndpointPool()
+    : failedAttempts(0)
+    , nextAttemptAt(0)
+{
+}
+
+ConnectionManager& ConnectionManager::getInstance()
+{
+    static ConnectionManager instance;
+    return instance;
+}
+
+ConnectionManager::ConnectionManager(IGatewayTransport* transport)
+    : m_transport(transport)
+    , m_loopback(new LoopbackTransport())
+    , m_random(0x5EEDULL)
+    , m_failureThreshold(5)
+    , m_openDurationMs(10000)
+    , m_maxConnectionsPerEndpoint(4)
+    , m_maxLeasesPerConnection(16)
+    , m_clock(0)
+{
+}
+
+ConnectionManager::~ConnectionManager()
+{
+    closeAll();
+    for (std::map<std::string, EndpointPool*>::iterator it = m_pools.begin();
+         it != m_pools.end(); ++it) {
+        delete it->second;
+    }
+    m_pools.clear();
+    delete m_loopback;
+}
+
+void ConnectionManager::setTransport(IGatewayTransport* transport)
+{
+    closeAll();
+    ScopedLock lock(m_mutex);
+    m_transport = transport;
+}
+
+IGatewayTransport* ConnectionManager::getTransport() const
+{
+    ScopedLock lock(m_mutex);
+    return m_transport ? m_transport : m_loopback;
+}
+
+void ConnectionManager::setBackoffPolicy(const BackoffPolicy& policy)
+{
+    ScopedLock lock(m_mutex);
+    m_backoff = policy;
+}
+
+void ConnectionManager::setCircuitBreakerSettings(int failureThreshold, int openDurationMs)
+{
+    ScopedLock lock(m_mutex);
+    m_failureThreshold = failureThreshold;
+    m_openDurationMs = openDurationMs;
+    for (std::map<std::string, EndpointPool*>::iterator it = m_pools.begin();
+         it != m_pools.end(); ++it) {
+        it->second->breaker.configure(failureThreshold, openDurationMs);
+    }
+}
+
+void ConnectionManager::setMaxConnectionsPerEndpoint(int count)
+{
+    if (count > 0) {
+        ScopedLock lock(m_mutex);
+        m_maxConnectionsPerEndpoint = count;
+    }
+}
+
+void ConnectionManager::setMaxLeasesPerConnection(int count)
+{
+    if (count > 0) {
+        ScopedLock lock(m_mutex);
+        m_maxLeasesPerConnection = count;
+    }
+}
+
+void ConnectionManager::setRandomSeed(uint64_t seed)
+{
+    ScopedLock lock(m_mutex);
+    m_random.seed(seed);
+}
+
+void ConnectionManager::setClock(IClock* clock)
+{
+    ScopedLock lock(m_mutex);
+    m_clock = clock;
+}
+
+int ConnectionManager::acquire(const std::string& endpoint, int timeoutMs)
+{
+    bool opened = false;
+    return acquireLease(endpoint, timeoutMs, opened);
+}
+
+void ConnectionManager::release(const std::string& endpoint, int handle)
+{
+    ScopedLock lock(m_mutex);
+    std::map<std::string, EndpointPool*>::iterator it = m_pools.find(endpoint);
+    if (it == m_pools.end()) {
+        return;
+    }
+
+    std::vector<PooledConnection>& connections = it->second->connections;
+    for (size_t i = 0; i < connections.size(); ++i) {
+        if (connections[i].handle == handle && connections[i].leases > 0) {
+            --connections[i].leases;
+            break;
+        }
+    }
+}
+
+bool ConnectionManager::send(const std::string& endpoint, int& handle,
+                             const std::string& command, int timeoutMs)
+{
+    IGatewayTransport* transport = getTransport();
+    if (handle > 0 && transport->send(handle, command, timeoutMs)) {
+        ScopedLock lock(m_mutex);
+        poolFor(endpoint).breaker.recordSuccess();
+        return true;
+    }
+
+    {
+        // Every lease holder on a dropped connection ends up here; only the
+        // one that actually removes the handle counts it as a failure.
+        ScopedLock lock(m_mutex);
+        EndpointPool& pool = poolFor(endpoint);
+        if (handle > 0 && removeConnection(pool, handle)) {
+            ++pool.counters.drops;
+            pool.breaker.recordFailure(currentTimeMillis());
+        }
+    }
+    Logger::getInstance().warning("Connection dropped, reconnecting: " + endpoint);
+
+    bool opened = false;
+    handle = acquireLease(endpoint, timeoutMs, opened);
+    if (handle <= 0) {
+        handle = 0;
+        return false;
+    }
+
+    bool sent = transport->send(handle, command, timeoutMs);
+    ScopedLock lock(m_mutex);
+    EndpointPool& pool = poolFor(endpoint);
+    if (opened) {
+        ++pool.counters.reconnects;
+    }
+    if (sent) {
+        pool.breaker.recordSuccess();
+    } else {
+        if (removeConnection(pool, handle)) {
+            ++pool.counters.drops;
+            pool.breaker.recordFailure(currentTimeMillis());
+        }
+        handle = 0;
+    }
+    return sent;
+}
+
+bool ConnectionManager::probe(const std::string& endpoint, int timeoutMs)
+{
+    if (endpoint.empty()) {
+        return false;
+    }
+
+    IGatewayTransport* transport = 0;
+    {
+        ScopedLock lock(m_mutex);
+        EndpointPool& pool = poolFor(endpoint);
+        if (!pool.breaker.allowRequest(currentTimeMillis())) {
+            ++pool.counters.rejectedByCircuit;
+            return false;
+        }
+        transport = m_transport ? m_transport : m_loopback;
+    }
+
+    bool reachable = transport->probe(endpoint, timeoutMs);
+
+    ScopedLock lock(m_mutex);
+    EndpointPool& pool = poolFor(endpoint);
+    if (reachable) {
+        pool.breaker.recordSuccess();
+    } else {
+        pool.breaker.recordFailure(currentTimeMillis());
+    }
+    return reachable;
+}
+
+void ConnectionManager::closeAll()
+{
+    ScopedLock lock(m_mutex);
+    IGatewayTransport* transport = m_transport ? m_transport : m_loopback;
+    for (std::map<std::string, EndpointPool*>::iterator it = m_pools.begin();
+         it != m_pools.end(); ++it) {
+        std::vector<PooledConnection>& connections = it->second->connections;
+        for (size_t i = 0; i < connections.size(); ++i) {
+            transport->close(connections[i].handle);
+        }
+        connections.clear();
+    }
+}
+
+CircuitState ConnectionManager::getCircuitState(const std::string& endpoint) const
+{
+    ScopedLock lock(m_mutex);
+    std::map<std::string, EndpointPool*>::const_iterator it = m_pools.find(endpoint);
+    if (it == m_pools.end()) {
+        return CIRCUIT_CLOSED;
+    }
+    return it->second->breaker.getState();
+}
+
+ConnectionMetrics ConnectionManager::getMetrics(const std::string& endpoint) const
+{
+    ScopedLock lock(m_mutex);
+    std::map<std::string, EndpointPool*>::const_iterator it = m_pools.find(endpoint);
+    if (it == m_pools.end()) {
+        return ConnectionMetrics();
+    }
+    return snapshot(*it->second);
+}
+
+ConnectionMetrics ConnectionManager::getTotalMetrics() const
+{
+    ScopedLock lock(m_mutex);
+    ConnectionMetrics total;
+    for (std::map<std::string, EndpointPool*>::const_iterator it = m_pools.begin();
+         it != m_pools.end(); ++it) {
+        ConnectionMetrics m = snapshot(*it->second);
+        total.openConnections += m.openConnections;
+        total.leasedDevices += m.leasedDevices;
+        total.connectAttempts += m.connectAttempts;
+        total.connectFailures += m.connectFailures;
+        total.reconnects += m.reconnects;
+        total.drops += m.drops;
+        total.rejectedByCircuit += m.rejectedByCircuit;
+        total.rejectedByBackoff += m.rejectedByBackoff;
+        total.circuitOpens += m.circuitOpens;
+        total.consecutiveFailures += m.consecutiveFailures;
+        if (m.circuitState != CIRCUIT_CLOSED) {
+            total.circuitState = m.circuitState;
+        }
+    }
+    return total;
+}
+
+std::vector<std::string> ConnectionManager::getEndpoints() const
+{
+    ScopedLock lock(m_mutex);
+    std::vector<std::string> result;
+    for (std::map<std::string, EndpointPool*>::const_iterator it = m_pools.begin();
+         it != m_pools.end(); ++it) {
+        result.push_back(it->first);
+    }
+    return result;
+}
+
+std::string ConnectionManager::getMetricsReport() const
+{
+    std::vector<std::string> endpoints = getEndpoints();
+    std::ostringstream oss;
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        ConnectionMetrics m = getMetrics(endpoints[i]);
+        oss << endpoints[i]
+            << " | Circuit: " << circuitStateToString(m.circuitState)
+            << " | Open: " << m.openConnections
+            << " | Leased: " << m.leasedDevices
+            << " | Attempts: " << m.connectAttempts
+            << " | Failures: " << m.connectFailures
+            << " | Drops: " << m.drops
+            << " | Reconnects: " << m.reconnects
+            << " | Rejected: " << (m.rejectedByCircuit + m.rejectedByBackoff)
+            << "\n";
+    }
+    return oss.str();
+}
+
+ConnectionManager::EndpointPool& ConnectionManager::poolFor(const std::string& endpoint)
+{
+    std::map<std::string, EndpointPool*>::iterator it = m_pools.find(endpoint);
+    if (it != m_pools.end()) {
+        return *it->second;
+    }
+
+    EndpointPool* pool = new EndpointPool();
+    pool->breaker.configure(m_failureThreshold, m_openDurationMs);
+    m_pools[endpoint] = pool;
+    return *pool;
+}
+
+bool ConnectionManager::passesGates(EndpointPool& pool, uint64_t now)
+{
+    if (now < pool.nextAttemptAt) {
+        ++pool.counters.rejectedByBackoff;
+        return false;
+    }
+    if (!pool.breaker.allowRequest(now)) {
+        ++pool.counters.rejectedByCircuit;
+        return false;
+    }
+    return true;
+}
+
+int ConnectionManager::acquireLease(const std::string& endpoint, int timeoutMs, bool& opened)
+{
+    opened = false;
+    if (endpoint.empty()) {
+        return 0;
+    }
+
+    {
+        ScopedLock lock(m_mutex);
+        EndpointPool& pool = poolFor(endpoint);
+        PooledConnection* best = leastLeased(pool);
+        bool poolFull = static_cast<int>(pool.connections.size()) >= m_maxConnectionsPerEndpoint;
+        if (best && (best->leases < m_maxLeasesPerConnection || poolFull)) {
+            ++best->leases;
+            return best->handle;
+        }
+        if (!passesGates(pool, currentTimeMillis())) {
+            if (best) {
+                ++best->leases;
+                return best->handle;
+            }
+            return 0;
+        }
+    }
+
+    int handle = openConnection(endpoint, timeoutMs);
+    if (handle > 0) {
+        ScopedLock lock(m_mutex);
+        EndpointPool& pool = poolFor(endpoint);
+        if (static_cast<int>(pool.connections.size()) >= m_maxConnectionsPerEndpoint) {
+            PooledConnection* best = leastLeased(pool);
+            (m_transport ? m_transport : m_loopback)->close(handle);
+            if (!best) {
+                return 0;
+            }
+            ++best->leases;
+            return best->handle;
+        }
+        PooledConnection connection;
+        connection.handle = handle;
+        connection.leases = 1;
+        pool.connections.push_back(connection);
+        opened = true;
+    }
+    return handle;
+}
+
+ConnectionManager::PooledConnection* ConnectionManager::leastLeased(EndpointPool& pool)
+{
+    PooledConnection* best = 0;
+    for (size_t i = 0; i < pool.connections.size(); ++i) {
+        if (!best || pool.connections[i].leases < best->leases) {
+            best = &pool.connections[i];
+        }
+    }
+    return best;
+}
+
+int ConnectionManager::openConnection(const std::string& endpoint, int timeoutMs)
+{
+    IGatewayTransport* transport = getTransport();
+    int handle = transport->open(endpoint, timeoutMs);
+
+    ScopedLock lock(m_mutex);
+    EndpointPool& pool = poolFor(endpoint);
+    ++pool.counters.connectAttempts;
+    if (handle > 0) {
+        pool.breaker.recordSuccess();
+        pool.failedAttempts = 0;
+        pool.nextAttemptAt = 0;
+        return handle;
+    }
+
+    uint64_t now = currentTimeMillis();
+    int opensBefore = pool.breaker.getOpenCount();
+    ++pool.counters.connectFailures;
+    pool.breaker.recordFailure(now);
+    pool.nextAttemptAt = now + static_cast<uint64_t>(
+        m_backoff.nextDelay(pool.failedAttempts, m_random));
+    ++pool.failedAttempts;
+
+    if (pool.breaker.getOpenCount() != opensBefore) {
+        Logger::getInstance().error("Circuit opened for endpoint: " + endpoint);
+    } else {
+        Logger::getInstance().warning("Connection attempt failed: " + endpoint);
+    }
+    return 0;
+}
+
+bool ConnectionManager::removeConnection(EndpointPool& pool, int handle)
+{
+    for (std::vector<PooledConnection>::iterator it = pool.connections.begin();
+         it != pool.connections.end(); ++it) {
+        if (it->handle == handle) {
+            (m_transport ? m_transport : m_loopback)->close(handle);
+            pool.connections.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+ConnectionMetrics ConnectionManager::snapshot(const EndpointPool& pool) const
+{
+    ConnectionMetrics m = pool.counters;
+    m.circuitState = pool.breaker.getState();
+    m.circuitOpens = pool.breaker.getOpenCount();
+    m.consecutiveFailures = pool.breaker.getConsecutiveFailures();
+    m.nextRetryAt = pool.nextAttemptAt;
+    m.openConnections = static_cast<int>(pool.connections.size());
+    m.leasedDevices = 0;
+    for (size_t i = 0; i < pool.connections.size(); ++i) {
+        m.leasedDevices += pool.connections[i].leases;
+    }
+    return m;
+}
+
+uint64_t ConnectionManager::currentTimeMillis() const
+{
+    return m_clock ? m_clock->nowMillis() : ClockProvider::getClock().nowMillis();
+}
+
+}
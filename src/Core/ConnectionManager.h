@@ -0,0 +1,139 @@
+#ifndef CONNECTION_MANAGER_H
+#define CONNECTION_MANAGER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include "common_types.h"
+#include "Mutex.h"
+#include "Random.h"
+#include "Clock.h"
+
+namespace MySweetHome {
+
+class IGatewayTransport;
+class LoopbackTransport;
+enum CircuitState {
+    CIRCUIT_CLOSED,
+    CIRCUIT_OPEN,
+    CIRCUIT_HALF_OPEN
+};
+std::string circuitStateToString(CircuitState state);
+class BackoffPolicy {
+public:
+    BackoffPolicy(int baseDelayMs = 100, int maxDelayMs = 30000);
+    ~BackoffPolicy();
+    int nextDelay(int attempt, Random& random) const;
+    int getBaseDelay() const;
+    int getMaxDelay() const;
+
+private:
+    int m_baseDelayMs;
+    int m_maxDelayMs;
+};
+class CircuitBreaker {
+public:
+    CircuitBreaker(int failureThreshold = 5, int openDurationMs = 10000);
+    ~CircuitBreaker();
+    bool allowRequest(uint64_t nowMs);
+    void recordSuccess();
+    void recordFailure(uint64_t nowMs);
+    void configure(int failureThreshold, int openDurationMs);
+    CircuitState getState() const;
+    int getConsecutiveFailures() const;
+    int getOpenCount() const;
+
+private:
+    CircuitState m_state;
+    int m_failureThreshold;
+    int m_openDurationMs;
+    int m_consecutiveFailures;
+    int m_openCount;
+    uint64_t m_openedAt;
+    bool m_trialInFlight;
+};
+struct ConnectionMetrics {
+    CircuitState circuitState;
+    int openConnections;
+    int leasedDevices;
+    int connectAttempts;
+    int connectFailures;
+    int reconnects;
+    int drops;
+    int rejectedByCircuit;
+    int rejectedByBackoff;
+    int circuitOpens;
+    int consecutiveFailures;
+    uint64_t nextRetryAt;
+
+    ConnectionMetrics();
+};
+class ConnectionManager {
+public:
+    static ConnectionManager& getInstance();
+
+    ConnectionManager(IGatewayTransport* transport = 0);
+    ~ConnectionManager();
+    void setTransport(IGatewayTransport* transport);
+    IGatewayTransport* getTransport() const;
+    void setBackoffPolicy(const BackoffPolicy& policy);
+    void setCircuitBreakerSettings(int failureThreshold, int openDurationMs);
+    void setMaxConnectionsPerEndpoint(int count);
+    void setMaxLeasesPerConnection(int count);
+    void setRandomSeed(uint64_t seed);
+    void setClock(IClock* clock);
+    int acquire(const std::string& endpoint, int timeoutMs);
+    void release(const std::string& endpoint, int handle);
+    bool send(const std::string& endpoint, int& handle,
+              const std::string& command, int timeoutMs);
+    bool probe(const std::string& endpoint, int timeoutMs);
+    void closeAll();
+    CircuitState getCircuitState(const std::string& endpoint) const;
+    ConnectionMetrics getMetrics(const std::string& endpoint) const;
+    ConnectionMetrics getTotalMetrics() const;
+    std::vector<std::string> getEndpoints() const;
+    std::string getMetricsReport() const;
+
+private:
+    struct PooledConnection {
+        int handle;
+        int leases;
+    };
+    struct EndpointPool {
+        std::vector<PooledConnection> connections;
+        CircuitBreaker breaker;
+        int failedAttempts;
+        uint64_t nextAttemptAt;
+        ConnectionMetrics counters;
+
+        EndpointPool();
+    };
+
+    ConnectionManager(const ConnectionManager&);
+    ConnectionManager& operator=(const ConnectionManager&);
+
+    EndpointPool& poolFor(const std::string& endpoint);
+    bool passesGates(EndpointPool& pool, uint64_t now);
+    PooledConnection* leastLeased(EndpointPool& pool);
+    int acquireLease(const std::string& endpoint, int timeoutMs, bool& opened);
+    int openConnection(const std::string& endpoint, int timeoutMs);
+    bool removeConnection(EndpointPool& pool, int handle);
+    ConnectionMetrics snapshot(const EndpointPool& pool) const;
+    uint64_t currentTimeMillis() const;
+
+    mutable Mutex m_mutex;
+    IGatewayTransport* m_transport;
+    LoopbackTransport* m_loopback;
+    BackoffPolicy m_backoff;
+    Random m_random;
+    std::map<std::string, EndpointPool*> m_pools;
+    int m_failureThreshold;
+    int m_openDurationMs;
+    int m_maxConnectionsPerEndpoint;
+    int m_maxLeasesPerConnection;
+    IClock* m_clock;
+};
+
+}
+
+#endif
@@ -0,0 +1,313 @@
+#include "CronExpression.h"
+#include <cstdlib>
+#include <cctype>
+#include <sstream>
+#include <vector>
+
+namespace MySweetHome {
+namespace {
+const char* const MONTH_NAMES[] = { "JAN", "FEB", "MAR", "APR", "MAY", "JUN",
+                                    "JUL", "AUG", "SEP", "OCT", "NOV", "DEC", 0 };
+const char* const WEEKDAY_NAMES[] = { "SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT", 0 };
+const int64_t SECONDS_PER_DAY = 86400;
+const int64_t SEARCH_LIMIT_SECONDS = 5LL * 366LL * SECONDS_PER_DAY;
+
+int64_t floorDiv(int64_t value, int64_t divisor)
+{
+    int64_t quotient = value / divisor;
+    if ((value % divisor != 0) && ((value < 0) != (divisor < 0))) {
+        --quotient;
+    }
+    return quotient;
+}
+
+bool parseValue(const std::string& text, int minValue, const char* const* names, int& value)
+{
+    if (text.empty()) {
+        return false;
+    }
+    if (std::isdigit(static_cast<unsigned char>(text[0]))) {
+        char* end = 0;
+        long parsed = std::strtol(text.c_str(), &end, 10);
+        if (*end != '\0') {
+            return false;
+        }
+        value = static_cast<int>(parsed);
+        return true;
+    }
+    if (!names) {
+        return false;
+    }
+    std::string upper;
+    for (size_t i = 0; i < text.size(); ++i) {
+        upper += static_cast<char>(std::toupper(static_cast<unsigned char>(text[i])));
+    }
+    for (int i = 0; names[i]; ++i) {
+        if (upper == names[i]) {
+            value = i + minValue;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::string> split(const std::string& text, char separator)
+{
+    std::vector<std::string> parts;
+    std::string current;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == separator) {
+            parts.push_back(current);
+            current.clear();
+        } else {
+            current += text[i];
+        }
+    }
+    parts.push_back(current);
+    return parts;
+}
+
+}
+
+CivilTime::CivilTime()
+    : year(1970)
+    , month(1)
+    , day(1)
+    , hour(0)
+    , minute(0)
+    , second(0)
+    , weekday(4)
+{
+}
+
+int64_t daysFromCivil(int year, int month, int day)
+{
+    int64_t y = year - (month <= 2 ? 1 : 0);
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yearOfEra = y - era * 400;
+    int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+CivilTime civilFromSeconds(int64_t seconds)
+{
+    CivilTime civil;
+    int64_t days = floorDiv(seconds, SECONDS_PER_DAY);
+    int64_t rest = seconds - days * SECONDS_PER_DAY;
+    civil.hour = static_cast<int>(rest / 3600);
+    civil.minute = static_cast<int>((rest % 3600) / 60);
+    civil.second = static_cast<int>(rest % 60);
+    int64_t weekday = (days + 4) % 7;
+    civil.weekday = static_cast<int>(weekday < 0 ? weekday + 7 : weekday);
+
+    int64_t z = days + 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int64_t dayOfEra = z - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t mp = (5 * dayOfYear + 2) / 153;
+    civil.day = static_cast<int>(dayOfYear - (153 * mp + 2) / 5 + 1);
+    civil.month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    civil.year = static_cast<int>(yearOfEra + era * 400 + (civil.month <= 2 ? 1 : 0));
+    return civil;
+}
+
+int64_t secondsFromCivil(int year, int month, int day, int hour, int minute, int second)
+{
+    return daysFromCivil(year, month, day) * SECONDS_PER_DAY + hour * 3600 + minute * 60 + second;
+}
+
+CronExpression::CronExpression()
+    : m_valid(false)
+    , m_minutes(0)
+    , m_hours(0)
+    , m_days(0)
+    , m_months(0)
+    , m_weekdays(0)
+    , m_dayRestricted(false)
+    , m_weekdayRestricted(false)
+{
+}
+
+CronExpression::CronExpression(const std::string& expression)
+    : m_valid(false)
+    , m_minutes(0)
+    , m_hours(0)
+    , m_days(0)
+    , m_months(0)
+    , m_weekdays(0)
+    , m_dayRestricted(false)
+    , m_weekdayRestricted(false)
+{
+    parse(expression);
+}
+
+bool CronExpression::parse(const std::string& expression)
+{
+    m_expression = expression;
+    m_error.clear();
+    m_valid = false;
+
+    std::string text = expression;
+    if (text == "@yearly" || text == "@annually") {
+        text = "0 0 1 1 *";
+    } else if (text == "@monthly") {
+        text = "0 0 1 * *";
+    } else if (text == "@weekly") {
+        text = "0 0 * * 0";
+    } else if (text == "@daily" || text == "@midnight") {
+        text = "0 0 * * *";
+    } else if (text == "@hourly") {
+        text = "0 * * * *";
+    }
+
+    std::istringstream stream(text);
+    std::vector<std::string> fields;
+    std::string field;
+    while (stream >> field) {
+        fields.push_back(field);
+    }
+    if (fields.size() != 5) {
+        m_error = "expected 5 fields: minute hour day month weekday";
+        return false;
+    }
+    bool ignored = false;
+    if (!parseField(fields[0], 0, 59, 0, m_minutes, ignored) ||
+        !parseField(fields[1], 0, 23, 0, m_hours, ignored) ||
+        !parseField(fields[2], 1, 31, 0, m_days, m_dayRestricted) ||
+        !parseField(fields[3], 1, 12, MONTH_NAMES, m_months, ignored) ||
+        !parseField(fields[4], 0, 7, WEEKDAY_NAMES, m_weekdays, m_weekdayRestricted)) {
+        return false;
+    }
+    if (m_weekdays & (1ULL << 7)) {
+        m_weekdays = (m_weekdays | 1ULL) & ~(1ULL << 7);
+    }
+    m_valid = true;
+    return true;
+}
+
+bool CronExpression::isValid() const
+{
+    return m_valid;
+}
+
+const std::string& CronExpression::getExpression() const
+{
+    return m_expression;
+}
+
+const std::string& CronExpression::getError() const
+{
+    return m_error;
+}
+
+bool CronExpression::matches(int64_t localSeconds) const
+{
+    if (!m_valid) {
+        return false;
+    }
+    CivilTime civil = civilFromSeconds(localSeconds);
+    return matchesDay(civil) && (m_hours & (1ULL << civil.hour)) && (m_minutes & (1ULL << civil.minute));
+}
+
+bool CronExpression::next(int64_t afterLocalSeconds, int64_t& result) const
+{
+    if (!m_valid) {
+        return false;
+    }
+    int64_t t = floorDiv(afterLocalSeconds, 60) * 60 + 60;
+    int64_t limit = afterLocalSeconds + SEARCH_LIMIT_SECONDS;
+    while (t <= limit) {
+        CivilTime civil = civilFromSeconds(t);
+        if (!(m_months & (1ULL << civil.month))) {
+            t = civil.month == 12 ? secondsFromCivil(civil.year + 1, 1, 1)
+                                  : secondsFromCivil(civil.year, civil.month + 1, 1);
+            continue;
+        }
+        if (!matchesDay(civil)) {
+            t = secondsFromCivil(civil.year, civil.month, civil.day) + SECONDS_PER_DAY;
+            continue;
+        }
+        int64_t hourStart = t - civil.minute * 60;
+        if (!(m_hours & (1ULL << civil.hour))) {
+            t = hourStart + 3600;
+            continue;
+        }
+        for (int minute = civil.minute; minute < 60; ++minute) {
+            if (m_minutes & (1ULL << minute)) {
+                result = hourStart + minute * 60;
+                return true;
+            }
+        }
+        t = hourStart + 3600;
+    }
+    return false;
+}
+
+bool CronExpression::parseField(const std::string& field, int minValue, int maxValue, const char* const* names,
+                                uint64_t& mask, bool& restricted)
+{
+    mask = 0;
+    restricted = !field.empty() && field[0] != '*';
+    std::vector<std::string> items = split(field, ',');
+    for (size_t i = 0; i < items.size(); ++i) {
+        std::string item = items[i];
+        int step = 1;
+        size_t slash = item.find('/');
+        if (slash != std::string::npos) {
+            if (!parseValue(item.substr(slash + 1), 0, 0, step) || step <= 0) {
+                m_error = "invalid step in '" + field + "'";
+                return false;
+            }
+            item = item.substr(0, slash);
+        }
+        int low = minValue;
+        int high = maxValue;
+        if (item != "*") {
+            size_t dash = item.find('-');
+            if (dash != std::string::npos) {
+                if (!parseValue(item.substr(0, dash), minValue, names, low) ||
+                    !parseValue(item.substr(dash + 1), minValue, names, high)) {
+                    m_error = "invalid range in '" + field + "'";
+                    return false;
+                }
+            } else {
+                if (!parseValue(item, minValue, names, low)) {
+                    m_error = "invalid value in '" + field + "'";
+                    return false;
+                }
+                high = slash != std::string::npos ? maxValue : low;
+            }
+        }
+        if (low < minValue || high > maxValue || low > high) {
+            m_error = "value out of range in '" + field + "'";
+            return false;
+        }
+        for (int value = low; value <= high; value += step) {
+            mask |= 1ULL << value;
+        }
+    }
+    return true;
+}
+
+bool CronExpression::matchesDay(const CivilTime& civil) const
+{
+    if (!(m_months & (1ULL << civil.month))) {
+        return false;
+    }
+    bool dayMatch = (m_days & (1ULL << civil.day)) != 0;
+    bool weekdayMatch = (m_weekdays & (1ULL << civil.weekday)) != 0;
+    if (m_dayRestricted && m_weekdayRestricted) {
+        return dayMatch || weekdayMatch;
+    }
+    if (m_dayRestricted) {
+        return dayMatch;
+    }
+    if (m_weekdayRestricted) {
+        return weekdayMatch;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,53 @@
+#ifndef CRON_EXPRESSION_H
+#define CRON_EXPRESSION_H
+
+#include <string>
+#include <ctime>
+#include "common_types.h"
+
+namespace MySweetHome {
+struct CivilTime {
+    int year;
+    int month;
+    int day;
+    int hour;
+    int minute;
+    int second;
+    int weekday;
+
+    CivilTime();
+};
+int64_t daysFromCivil(int year, int month, int day);
+CivilTime civilFromSeconds(int64_t seconds);
+int64_t secondsFromCivil(int year, int month, int day, int hour = 0, int minute = 0, int second = 0);
+class CronExpression {
+public:
+    CronExpression();
+    explicit CronExpression(const std::string& expression);
+    bool parse(const std::string& expression);
+    bool isValid() const;
+    const std::string& getExpression() const;
+    const std::string& getError() const;
+    bool matches(int64_t localSeconds) const;
+    bool next(int64_t afterLocalSeconds, int64_t& result) const;
+
+private:
+    bool parseField(const std::string& field, int minValue, int maxValue, const char* const* names,
+                    uint64_t& mask, bool& restricted);
+    bool matchesDay(const CivilTime& civil) const;
+
+    std::string m_expression;
+    std::string m_error;
+    bool m_valid;
+    uint64_t m_minutes;
+    uint64_t m_hours;
+    uint64_t m_days;
+    uint64_t m_months;
+    uint64_t m_weekdays;
+    bool m_dayRestricted;
+    bool m_weekdayRestricted;
+};
+
+}
+
+#endif
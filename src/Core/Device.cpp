@@ -1,7 +1,37 @@
 #include "Device.h"
+#include "Metrics.h"
 #include <sstream>
 
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
 namespace MySweetHome {
+namespace {
+volatile uint64_t s_versionClock = 0;
+const int DEVICE_TYPE_COUNT = DEVICE_SOUND_SYSTEM + 1;
+MetricCounter* s_operationCounters[DEVICE_TYPE_COUNT][2];
+
+MetricCounter& operationCounter(DeviceType type, bool turnOn)
+{
+    MetricCounter*& slot = s_operationCounters[type][turnOn ? 1 : 0];
+    if (!slot) {
+        slot = &MetricsRegistry::getInstance().counter("msh_device_operations_total", "Device power operations",
+            MetricLabels("type", MetricsRegistry::deviceTypeLabel(type)).add("operation", turnOn ? "on" : "off"));
+    }
+    return *slot;
+}
+
+uint64_t nextVersion()
+{
+#ifdef _WIN32
+    return static_cast<uint64_t>(InterlockedIncrement64(reinterpret_cast<volatile LONGLONG*>(&s_versionClock)));
+#else
+    return __sync_add_and_fetch(&s_versionClock, 1);
+#endif
+}
+
+}
 
 Device::Device(uint32_t id, const std::string& name, DeviceType type, const std::string& location)
     : m_id(id)
@@ -10,6 +40,7 @@ Device::Device(uint32_t id, const std::string& name, DeviceType type, const std:
     , m_status(STATUS_OFF)
     , m_location(location)
     , m_isActive(true)
+    , m_version(nextVersion())
 {
 }
 
@@ -18,12 +49,16 @@ Device::~Device()
 }
 
 void Device::turnOn() {
+    markModified();
+    operationCounter(m_type, true).increment();
     if (m_isActive) {
         m_status = STATUS_ON;
     }
 }
 
 void Device::turnOff() {
+    markModified();
+    operationCounter(m_type, false).increment();
     if (!isCritical()) {
         m_status = STATUS_OFF;
     }
@@ -62,18 +97,22 @@ bool Device::isActive() const {
 }
 
 void Device::setId(uint32_t id) {
+    markModified();
     m_id = id;
 }
 
 void Device::setName(const std::string& name) {
+    markModified();
     m_name = name;
 }
 
 void Device::setLocation(const std::string& location) {
+    markModified();
     m_location = location;
 }
 
 void Device::setActive(bool active) {
+    markModified();
     m_isActive = active;
     if (!active) {
         m_status = STATUS_INACTIVE;
@@ -84,6 +123,10 @@ bool Device::isOn() const {
     return m_status == STATUS_ON;
 }
 
+uint64_t Device::getVersion() const {
+    return m_version;
+}
+
 std::string Device::getStatusString() const {
     switch (m_status) {
         case STATUS_ON:       return "On";
@@ -109,8 +152,13 @@ bool Device::isCritical() const {
 }
 
 void Device::setStatus(DeviceStatus status) {
+    markModified();
     m_status = status;
 }
+
+void Device::markModified() {
+    m_version = nextVersion();
+}
 void Device::addObserver(IObserver* observer) {
     if (observer) {
         m_observers.push_back(observer);
@@ -134,6 +182,7 @@ void Device::notifyObservers(const std::string& event, const std::string& messag
 }
 
 void Device::simulateFailure() {
+    markModified();
     m_status = STATUS_ERROR;
     m_isActive = false;
     notifyObservers("DEVICE_FAILURE", m_name + " failure detected");
@@ -27,6 +27,7 @@ public:
     void setLocation(const std::string& location);
     void setActive(bool active);
     bool isOn() const;
+    virtual uint64_t getVersion() const;
     virtual std::string getStatusString() const;
     virtual std::string getInfo() const;
     virtual bool isCritical() const;
@@ -37,6 +38,7 @@ public:
 
 protected:
     void setStatus(DeviceStatus status);
+    void markModified();
 
 private:
     uint32_t m_id;
@@ -45,6 +47,7 @@ private:
     DeviceStatus m_status;
     std::string m_location;
     bool m_isActive;
+    uint64_t m_version;
     std::vector<IObserver*> m_observers;
 };
 
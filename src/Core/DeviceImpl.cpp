@@ -1,7 +1,8 @@
 #include "DeviceImpl.h"
+#include "ConnectionManager.h"
 #include "Logger.h"
+#include "Tracer.h"
 #include <sstream>
-#include <cstdlib>
 
 namespace MySweetHome {
 HardwareDeviceImpl::HardwareDeviceImpl()
@@ -20,6 +21,7 @@ HardwareDeviceImpl::~HardwareDeviceImpl()
 
 void HardwareDeviceImpl::powerOn()
 {
+    TraceSpan span("HardwareDeviceImpl::powerOn", "impl");
     if (!m_connected) {
         Logger::getInstance().warning("Hardware not connected, cannot power on");
         return;
@@ -31,6 +33,7 @@ void HardwareDeviceImpl::powerOn()
 
 void HardwareDeviceImpl::powerOff()
 {
+    TraceSpan span("HardwareDeviceImpl::powerOff", "impl");
     if (!m_connected) {
         return;
     }
@@ -69,6 +72,7 @@ bool HardwareDeviceImpl::isConnected() const
 
 bool HardwareDeviceImpl::connect()
 {
+    TraceSpan span("HardwareDeviceImpl::connect", "impl");
     if (m_connected) {
         return true;
     }
@@ -123,12 +127,29 @@ void HardwareDeviceImpl::shutdownHardware()
         powerOff();
     }
 }
-SimulatedDeviceImpl::SimulatedDeviceImpl()
+namespace {
+Mutex g_seedMutex;
+uint64_t g_nextDefaultSeed = 1;
+
+uint64_t nextDefaultSeed()
+{
+    ScopedLock lock(g_seedMutex);
+    return g_nextDefaultSeed++;
+}
+}
+
+SimulatedDeviceImpl::SimulatedDeviceImpl(uint64_t seed)
     : m_powered(false)
     , m_connected(false)
     , m_simulatedDelay(0)
     , m_failureRate(0.0f)
     , m_simulatedFailure(false)
+    , m_realDelay(true)
+    , m_random(seed != 0 ? seed : nextDefaultSeed())
+    , m_latencyModel(LatencyModel::fixed(0.0))
+    , m_virtualDelayMicros(0)
+    , m_lastDelayMs(0.0)
+    , m_clock(0)
 {
 }
 
@@ -138,6 +159,7 @@ SimulatedDeviceImpl::~SimulatedDeviceImpl()
 
 void SimulatedDeviceImpl::powerOn()
 {
+    TraceSpan span("SimulatedDeviceImpl::powerOn", "impl");
     simulateDelay();
 
     if (shouldFail()) {
@@ -151,6 +173,7 @@ void SimulatedDeviceImpl::powerOn()
 
 void SimulatedDeviceImpl::powerOff()
 {
+    TraceSpan span("SimulatedDeviceImpl::powerOff", "impl");
     simulateDelay();
 
     if (shouldFail()) {
@@ -183,8 +206,8 @@ std::string SimulatedDeviceImpl::getImplType() const
 std::string SimulatedDeviceImpl::getImplInfo() const
 {
     std::ostringstream oss;
-    oss << "Simulated Implementation [Delay: " << m_simulatedDelay
-        << "ms, FailRate: " << (m_failureRate * 100) << "%]";
+    oss << "Simulated Implementation [Delay: " << getLatencyModel().describe()
+        << ", FailRate: " << (m_failureRate * 100) << "%]";
     return oss.str();
 }
 
@@ -195,6 +218,7 @@ bool SimulatedDeviceImpl::isConnected() const
 
 bool SimulatedDeviceImpl::connect()
 {
+    TraceSpan span("SimulatedDeviceImpl::connect", "impl");
     simulateDelay();
     m_connected = true;
     m_simulatedFailure = false;
@@ -213,6 +237,7 @@ void SimulatedDeviceImpl::setSimulatedDelay(int milliseconds)
 {
     if (milliseconds >= 0) {
         m_simulatedDelay = milliseconds;
+        setLatencyModel(LatencyModel::fixed(static_cast<double>(milliseconds)));
     }
 }
 
@@ -221,10 +246,25 @@ int SimulatedDeviceImpl::getSimulatedDelay() const
     return m_simulatedDelay;
 }
 
+void SimulatedDeviceImpl::setLatencyModel(const LatencyModel& model)
+{
+    ScopedLock lock(m_randomMutex);
+    m_latencyModel = model;
+    m_simulatedDelay = static_cast<int>(model.getNominalMillis() + 0.5);
+}
+
+LatencyModel SimulatedDeviceImpl::getLatencyModel() const
+{
+    ScopedLock lock(m_randomMutex);
+    return m_latencyModel;
+}
+
 void SimulatedDeviceImpl::setFailureRate(float rate)
 {
     if (rate >= 0.0f && rate <= 1.0f) {
+        ScopedLock lock(m_randomMutex);
         m_failureRate = rate;
+        m_failureModel.setBaseFailureRate(rate);
     }
 }
 
@@ -233,6 +273,59 @@ float SimulatedDeviceImpl::getFailureRate() const
     return m_failureRate;
 }
 
+void SimulatedDeviceImpl::setFailureBursts(double enterProbability, double exitProbability,
+                                           double burstFailureRate)
+{
+    ScopedLock lock(m_randomMutex);
+    m_failureModel.setBurst(enterProbability, exitProbability, burstFailureRate);
+}
+
+bool SimulatedDeviceImpl::isInFailureBurst() const
+{
+    ScopedLock lock(m_randomMutex);
+    return m_failureModel.isInBurst();
+}
+
+void SimulatedDeviceImpl::setSeed(uint64_t seed)
+{
+    ScopedLock lock(m_randomMutex);
+    m_random.seed(seed);
+    m_failureModel.reset();
+}
+
+uint64_t SimulatedDeviceImpl::getSeed() const
+{
+    ScopedLock lock(m_randomMutex);
+    return m_random.getSeed();
+}
+
+void SimulatedDeviceImpl::setRealDelay(bool enable)
+{
+    m_realDelay = enable;
+}
+
+bool SimulatedDeviceImpl::isRealDelay() const
+{
+    return m_realDelay;
+}
+
+void SimulatedDeviceImpl::setClock(IClock* clock)
+{
+    m_clock = clock;
+}
+
+uint64_t SimulatedDeviceImpl::getVirtualDelayMicros() const
+{
+    ScopedLock lock(m_randomMutex);
+    return m_virtualDelayMicros;
+}
+
+double SimulatedDeviceImpl::getLastDelayMillis() const
+{
+    ScopedLock lock(m_randomMutex);
+    return m_lastDelayMs;
+}
+
 void SimulatedDeviceImpl::simulateFailure()
 {
     m_simulatedFailure = true;
@@ -240,7 +333,18 @@ void SimulatedDeviceImpl::simulateFailure()
 
 void SimulatedDeviceImpl::simulateDelay() const
 {
-    if (m_simulatedDelay > 0) {
+    uint64_t micros = 0;
+    {
+        ScopedLock lock(m_randomMutex);
+        m_lastDelayMs = m_latencyModel.sampleMillis(m_random);
+        micros = static_cast<uint64_t>(m_lastDelayMs * 1000.0);
+        if (!m_realDelay) {
+            m_virtualDelayMicros += micros;
+        }
+    }
+    if (m_realDelay) {
+        IClock& clock = m_clock ? *m_clock : ClockProvider::getClock();
+        clock.sleepMicros(micros);
     }
 }
 
@@ -250,18 +354,16 @@ bool SimulatedDeviceImpl::shouldFail() const
         return true;
     }
 
-    if (m_failureRate > 0.0f) {
-        float random = static_cast<float>(std::rand()) / static_cast<float>(RAND_MAX);
-        return random < m_failureRate;
-    }
-
-    return false;
+    ScopedLock lock(m_randomMutex);
+    return m_failureModel.nextFailure(m_random);
 }
 NetworkDeviceImpl::NetworkDeviceImpl(const std::string& endpoint)
     : m_endpoint(endpoint)
     , m_timeout(5000)
     , m_powered(false)
     , m_connected(false)
+    , m_connectionHandle(0)
+    , m_connectionManager(0)
 {
 }
 
@@ -319,7 +421,9 @@ std::string NetworkDeviceImpl::getImplInfo() const
 {
     std::ostringstream oss;
     oss << "Network Implementation [Endpoint: " << m_endpoint
-        << ", Timeout: " << m_timeout << "ms]";
+        << ", Timeout: " << m_timeout << "ms"
+        << ", Circuit: " << circuitStateToString(getConnectionManager()->getCircuitState(m_endpoint))
+        << "]";
     return oss.str();
 }
 
@@ -330,11 +434,15 @@ bool NetworkDeviceImpl::isConnected() const
 
 bool NetworkDeviceImpl::connect()
 {
+    if (m_connected) {
+        return true;
+    }
     if (m_endpoint.empty()) {
         Logger::getInstance().error("No endpoint configured for network device");
         return false;
     }
-    if (ping()) {
+    m_connectionHandle = getConnectionManager()->acquire(m_endpoint, m_timeout);
+    if (m_connectionHandle > 0) {
         m_connected = true;
         Logger::getInstance().info("Network device connected: " + m_endpoint);
         return true;
@@ -346,7 +454,13 @@ bool NetworkDeviceImpl::connect()
 
 void NetworkDeviceImpl::disconnect()
 {
-    sendCommand("DISCONNECT");
+    if (m_connected) {
+        sendCommand("DISCONNECT");
+    }
+    if (m_connectionHandle > 0) {
+        getConnectionManager()->release(m_endpoint, m_connectionHandle);
+        m_connectionHandle = 0;
+    }
     m_connected = false;
     m_powered = false;
     Logger::getInstance().info("Network device disconnected: " + m_endpoint);
@@ -354,6 +468,9 @@ void NetworkDeviceImpl::disconnect()
 
 void NetworkDeviceImpl::setEndpoint(const std::string& endpoint)
 {
+    if (endpoint != m_endpoint && m_connected) {
+        disconnect();
+    }
     m_endpoint = endpoint;
 }
 
@@ -376,13 +493,33 @@ int NetworkDeviceImpl::getTimeout() const
 
 bool NetworkDeviceImpl::ping() const
 {
-    return !m_endpoint.empty();
+    return getConnectionManager()->probe(m_endpoint, m_timeout);
+}
+
+void NetworkDeviceImpl::setConnectionManager(ConnectionManager* manager)
+{
+    if (manager != m_connectionManager && m_connected) {
+        disconnect();
+    }
+    m_connectionManager = manager;
+}
+
+ConnectionManager* NetworkDeviceImpl::getConnectionManager() const
+{
+    return m_connectionManager ? m_connectionManager : &ConnectionManager::getInstance();
 }
 
 bool NetworkDeviceImpl::sendCommand(const std::string& command)
 {
     Logger::getInstance().debug("Sending command to " + m_endpoint + ": " + command);
-    return true;
+    if (getConnectionManager()->send(m_endpoint, m_connectionHandle, command, m_timeout)) {
+        return true;
+    }
+
+    m_connected = false;
+    m_connectionHandle = 0;
+    Logger::getInstance().error("Lost connection to network device: " + m_endpoint);
+    return false;
 }
 
 std::string NetworkDeviceImpl::receiveResponse()
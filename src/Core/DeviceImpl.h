@@ -2,9 +2,15 @@
 #define DEVICE_IMPL_H
 
 #include "IDeviceImpl.h"
+#include "Mutex.h"
+#include "Random.h"
+#include "SimulationModels.h"
+#include "Clock.h"
 #include <string>
 
 namespace MySweetHome {
+
+class ConnectionManager;
 enum HardwareStatus {
     HW_STATUS_OK = 0,
     HW_STATUS_ERROR = 1,
@@ -40,7 +46,7 @@ private:
 };
 class SimulatedDeviceImpl : public IDeviceImpl {
 public:
-    SimulatedDeviceImpl();
+    explicit SimulatedDeviceImpl(uint64_t seed = 0);
     virtual ~SimulatedDeviceImpl();
     virtual void powerOn();
     virtual void powerOff();
@@ -53,16 +59,39 @@ public:
     virtual void disconnect();
     void setSimulatedDelay(int milliseconds);
     int getSimulatedDelay() const;
+    void setLatencyModel(const LatencyModel& model);
+    LatencyModel getLatencyModel() const;
     void setFailureRate(float rate);
     float getFailureRate() const;
+    void setFailureBursts(double enterProbability, double exitProbability,
+                          double burstFailureRate);
+    bool isInFailureBurst() const;
+    void setSeed(uint64_t seed);
+    uint64_t getSeed() const;
+    void setRealDelay(bool enable);
+    bool isRealDelay() const;
+    void setClock(IClock* clock);
+    uint64_t getVirtualDelayMicros() const;
+    double getLastDelayMillis() const;
     void simulateFailure();
 
 private:
+    SimulatedDeviceImpl(const SimulatedDeviceImpl&);
+    SimulatedDeviceImpl& operator=(const SimulatedDeviceImpl&);
+
     bool m_powered;
     bool m_connected;
     int m_simulatedDelay;
     float m_failureRate;
     bool m_simulatedFailure;
+    bool m_realDelay;
+    mutable Mutex m_randomMutex;
+    mutable Random m_random;
+    LatencyModel m_latencyModel;
+    mutable FailureBurstModel m_failureModel;
+    mutable uint64_t m_virtualDelayMicros;
+    mutable double m_lastDelayMs;
+    IClock* m_clock;
 
     void simulateDelay() const;
     bool shouldFail() const;
@@ -85,12 +114,16 @@ public:
     void setTimeout(int milliseconds);
     int getTimeout() const;
     bool ping() const;
+    void setConnectionManager(ConnectionManager* manager);
+    ConnectionManager* getConnectionManager() const;
 
 private:
     std::string m_endpoint;
     int m_timeout;
     bool m_powered;
     bool m_connected;
+    int m_connectionHandle;
+    ConnectionManager* m_connectionManager;
 
     bool sendCommand(const std::string& command);
     std::string receiveResponse();
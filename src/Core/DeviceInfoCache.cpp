@@ -0,0 +1,99 @@
+#include "DeviceInfoCache.h"
+
+namespace MySweetHome {
+DeviceInfoCache::DeviceInfoCache()
+    : m_renders(0)
+    , m_hits(0)
+{
+    m_empty.version = 0;
+}
+
+DeviceInfoCache::~DeviceInfoCache()
+{
+}
+
+DeviceInfoCache::Entry& DeviceInfoCache::lookup(const Device* device, bool& rendered)
+{
+    rendered = false;
+    if (!device) {
+        return m_empty;
+    }
+    uint64_t version = device->getVersion();
+    std::map<const Device*, Entry>::iterator it = m_entries.lower_bound(device);
+    if (it == m_entries.end() || it->first != device) {
+        Entry entry;
+        entry.version = 0;
+        it = m_entries.insert(it, std::make_pair(device, entry));
+    }
+    Entry& entry = it->second;
+    if (entry.version != version) {
+        entry.info = device->getInfo();
+        entry.status = device->getStatusString();
+        entry.version = version;
+        rendered = true;
+        ++m_renders;
+    } else {
+        ++m_hits;
+    }
+    return entry;
+}
+
+const std::string& DeviceInfoCache::getInfo(const Device* device)
+{
+    bool rendered;
+    return lookup(device, rendered).info;
+}
+
+const std::string& DeviceInfoCache::getStatusString(const Device* device)
+{
+    bool rendered;
+    return lookup(device, rendered).status;
+}
+
+bool DeviceInfoCache::refresh(const Device* device)
+{
+    bool rendered;
+    lookup(device, rendered);
+    return rendered;
+}
+
+size_t DeviceInfoCache::refreshAll(const std::vector<Device*>& devices, std::vector<size_t>* changed)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < devices.size(); ++i) {
+        if (refresh(devices[i])) {
+            ++count;
+            if (changed) {
+                changed->push_back(i);
+            }
+        }
+    }
+    return count;
+}
+
+void DeviceInfoCache::forget(const Device* device)
+{
+    m_entries.erase(device);
+}
+
+void DeviceInfoCache::clear()
+{
+    m_entries.clear();
+}
+
+size_t DeviceInfoCache::size() const
+{
+    return m_entries.size();
+}
+
+uint64_t DeviceInfoCache::getRenderCount() const
+{
+    return m_renders;
+}
+
+uint64_t DeviceInfoCache::getHitCount() const
+{
+    return m_hits;
+}
+
+}
@@ -0,0 +1,43 @@
+#ifndef DEVICE_INFO_CACHE_H
+#define DEVICE_INFO_CACHE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include "Device.h"
+
+namespace MySweetHome {
+class DeviceInfoCache {
+public:
+    DeviceInfoCache();
+    ~DeviceInfoCache();
+    const std::string& getInfo(const Device* device);
+    const std::string& getStatusString(const Device* device);
+    bool refresh(const Device* device);
+    size_t refreshAll(const std::vector<Device*>& devices, std::vector<size_t>* changed = 0);
+    void forget(const Device* device);
+    void clear();
+    size_t size() const;
+    uint64_t getRenderCount() const;
+    uint64_t getHitCount() const;
+
+private:
+    struct Entry {
+        uint64_t version;
+        std::string info;
+        std::string status;
+    };
+
+    DeviceInfoCache(const DeviceInfoCache&);
+    DeviceInfoCache& operator=(const DeviceInfoCache&);
+    Entry& lookup(const Device* device, bool& rendered);
+
+    std::map<const Device*, Entry> m_entries;
+    Entry m_empty;
+    uint64_t m_renders;
+    uint64_t m_hits;
+};
+
+}
+
+#endif
@@ -0,0 +1,224 @@
+#include "DeviceLatency.h"
+#include "Device.h"
+#include <algorithm>
+#include <sstream>
+
+namespace MySweetHome {
+namespace {
+bool slowerFirst(const std::pair<uint64_t, DeviceLatencySummary>& a,
+                 const std::pair<uint64_t, DeviceLatencySummary>& b)
+{
+    if (a.first != b.first) {
+        return a.first > b.first;
+    }
+    return a.second.deviceId < b.second.deviceId;
+}
+
+}
+
+std::string deviceOperationToString(DeviceOperation operation)
+{
+    switch (operation) {
+        case DEVICE_OP_TURN_ON:    return "turn_on";
+        case DEVICE_OP_TURN_OFF:   return "turn_off";
+        case DEVICE_OP_GET_INFO:   return "get_info";
+        case DEVICE_OP_GET_STATUS: return "get_status";
+        case DEVICE_OP_ALL:        return "all";
+    }
+    return "unknown";
+}
+
+DeviceLatencySummary::DeviceLatencySummary()
+    : deviceId(0)
+    , type(DEVICE_LIGHT)
+    , operations(0)
+    , meanNanos(0)
+    , p50Nanos(0)
+    , p99Nanos(0)
+    , maxNanos(0)
+{
+}
+
+DeviceLatencyRecord::DeviceLatencyRecord(uint32_t deviceId, const std::string& name,
+                                         const std::string& location, DeviceType type)
+    : m_deviceId(deviceId)
+    , m_name(name)
+    , m_location(location)
+    , m_type(type)
+    , m_attachments(0)
+{
+    MetricsRegistry& metrics = MetricsRegistry::getInstance();
+    for (int operation = 0; operation < DEVICE_OP_ALL; ++operation) {
+        m_histograms[operation] = new LatencyHistogram(1);
+        m_houseWide[operation] = &metrics.histogram("msh_device_operation_nanos",
+            "Device operation latency through instrumenting proxies",
+            MetricLabels("type", MetricsRegistry::deviceTypeLabel(type))
+                .add("operation", deviceOperationToString(static_cast<DeviceOperation>(operation))));
+    }
+}
+
+DeviceLatencyRecord::~DeviceLatencyRecord()
+{
+    for (int operation = 0; operation < DEVICE_OP_ALL; ++operation) {
+        delete m_histograms[operation];
+    }
+}
+
+void DeviceLatencyRecord::record(DeviceOperation operation, uint64_t nanos)
+{
+    m_histograms[operation]->record(nanos);
+    m_houseWide[operation]->record(nanos);
+}
+
+HistogramSnapshot DeviceLatencyRecord::snapshot(DeviceOperation operation) const
+{
+    if (operation != DEVICE_OP_ALL) {
+        return m_histograms[operation]->snapshot();
+    }
+    HistogramSnapshot merged;
+    for (int i = 0; i < DEVICE_OP_ALL; ++i) {
+        merged.merge(m_histograms[i]->snapshot());
+    }
+    return merged;
+}
+
+DeviceLatencySummary DeviceLatencyRecord::summarize(DeviceOperation operation) const
+{
+    HistogramSnapshot data = snapshot(operation);
+    DeviceLatencySummary summary;
+    summary.deviceId = m_deviceId;
+    summary.name = m_name;
+    summary.location = m_location;
+    summary.type = m_type;
+    summary.operations = data.count;
+    summary.meanNanos = static_cast<uint64_t>(data.mean());
+    summary.p50Nanos = data.percentile(0.5);
+    summary.p99Nanos = data.percentile(0.99);
+    summary.maxNanos = data.max;
+    return summary;
+}
+
+uint32_t DeviceLatencyRecord::getDeviceId() const
+{
+    return m_deviceId;
+}
+
+void DeviceLatencyRecord::reset()
+{
+    for (int operation = 0; operation < DEVICE_OP_ALL; ++operation) {
+        m_histograms[operation]->reset();
+    }
+}
+
+DeviceLatencyTracker& DeviceLatencyTracker::getInstance()
+{
+    static DeviceLatencyTracker instance;
+    return instance;
+}
+
+DeviceLatencyTracker::DeviceLatencyTracker()
+{
+}
+
+DeviceLatencyTracker::~DeviceLatencyTracker()
+{
+    for (std::map<uint32_t, DeviceLatencyRecord*>::iterator it = m_records.begin(); it != m_records.end(); ++it) {
+        delete it->second;
+    }
+}
+
+DeviceLatencyRecord* DeviceLatencyTracker::attach(const Device* device)
+{
+    if (!device) {
+        return 0;
+    }
+    ScopedLock lock(m_mutex);
+    std::map<uint32_t, DeviceLatencyRecord*>::iterator it = m_records.find(device->getId());
+    if (it != m_records.end()) {
+        ++it->second->m_attachments;
+        return it->second;
+    }
+    DeviceLatencyRecord* record = new DeviceLatencyRecord(device->getId(), device->getName(),
+                                                          device->getLocation(), device->getType());
+    record->m_attachments = 1;
+    m_records[device->getId()] = record;
+    return record;
+}
+
+bool DeviceLatencyTracker::detach(uint32_t deviceId)
+{
+    ScopedLock lock(m_mutex);
+    std::map<uint32_t, DeviceLatencyRecord*>::iterator it = m_records.find(deviceId);
+    if (it == m_records.end()) {
+        return false;
+    }
+    if (--it->second->m_attachments == 0) {
+        delete it->second;
+        m_records.erase(it);
+    }
+    return true;
+}
+
+DeviceLatencyRecord* DeviceLatencyTracker::getRecord(uint32_t deviceId) const
+{
+    ScopedLock lock(m_mutex);
+    std::map<uint32_t, DeviceLatencyRecord*>::const_iterator it = m_records.find(deviceId);
+    return it != m_records.end() ? it->second : 0;
+}
+
+size_t DeviceLatencyTracker::getDeviceCount() const
+{
+    ScopedLock lock(m_mutex);
+    return m_records.size();
+}
+
+std::vector<DeviceLatencySummary> DeviceLatencyTracker::getSlowest(size_t count, DeviceOperation operation,
+                                                                   double percentile) const
+{
+    std::vector<std::pair<uint64_t, DeviceLatencySummary> > ranked;
+    {
+        ScopedLock lock(m_mutex);
+        ranked.reserve(m_records.size());
+        for (std::map<uint32_t, DeviceLatencyRecord*>::const_iterator it = m_records.begin();
+             it != m_records.end(); ++it) {
+            HistogramSnapshot data = it->second->snapshot(operation);
+            if (data.count == 0) {
+                continue;
+            }
+            ranked.push_back(std::make_pair(data.percentile(percentile), it->second->summarize(operation)));
+        }
+    }
+    size_t top = std::min(count, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + top, ranked.end(), slowerFirst);
+    std::vector<DeviceLatencySummary> result;
+    for (size_t i = 0; i < top; ++i) {
+        result.push_back(ranked[i].second);
+    }
+    return result;
+}
+
+std::string DeviceLatencyTracker::formatSlowest(size_t count, DeviceOperation operation) const
+{
+    std::vector<DeviceLatencySummary> slowest = getSlowest(count, operation);
+    std::ostringstream oss;
+    oss << "Slowest devices (" << deviceOperationToString(operation) << ")";
+    for (size_t i = 0; i < slowest.size(); ++i) {
+        const DeviceLatencySummary& summary = slowest[i];
+        oss << "\n  " << (i + 1) << ". #" << summary.deviceId << " " << summary.name
+            << " [" << summary.location << "] ops=" << summary.operations
+            << " p50=" << summary.p50Nanos / 1000 << "us"
+            << " p99=" << summary.p99Nanos / 1000 << "us"
+            << " max=" << summary.maxNanos / 1000 << "us";
+    }
+    return oss.str();
+}
+
+void DeviceLatencyTracker::reset()
+{
+    ScopedLock lock(m_mutex);
+    for (std::map<uint32_t, DeviceLatencyRecord*>::iterator it = m_records.begin(); it != m_records.end(); ++it) {
+        it->second->reset();
+    }
+}
+
+}
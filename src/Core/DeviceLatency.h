@@ -0,0 +1,82 @@
+#ifndef DEVICE_LATENCY_H
+#define DEVICE_LATENCY_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include "common_types.h"
+#include "Mutex.h"
+#include "Metrics.h"
+
+namespace MySweetHome {
+
+class Device;
+enum DeviceOperation {
+    DEVICE_OP_TURN_ON,
+    DEVICE_OP_TURN_OFF,
+    DEVICE_OP_GET_INFO,
+    DEVICE_OP_GET_STATUS,
+    DEVICE_OP_ALL
+};
+std::string deviceOperationToString(DeviceOperation operation);
+struct DeviceLatencySummary {
+    uint32_t deviceId;
+    std::string name;
+    std::string location;
+    DeviceType type;
+    uint64_t operations;
+    uint64_t meanNanos;
+    uint64_t p50Nanos;
+    uint64_t p99Nanos;
+    uint64_t maxNanos;
+
+    DeviceLatencySummary();
+};
+class DeviceLatencyRecord {
+public:
+    DeviceLatencyRecord(uint32_t deviceId, const std::string& name, const std::string& location, DeviceType type);
+    ~DeviceLatencyRecord();
+    void record(DeviceOperation operation, uint64_t nanos);
+    HistogramSnapshot snapshot(DeviceOperation operation) const;
+    DeviceLatencySummary summarize(DeviceOperation operation) const;
+    uint32_t getDeviceId() const;
+    void reset();
+
+private:
+    friend class DeviceLatencyTracker;
+    DeviceLatencyRecord(const DeviceLatencyRecord&);
+    DeviceLatencyRecord& operator=(const DeviceLatencyRecord&);
+
+    uint32_t m_deviceId;
+    std::string m_name;
+    std::string m_location;
+    DeviceType m_type;
+    LatencyHistogram* m_histograms[DEVICE_OP_ALL];
+    LatencyHistogram* m_houseWide[DEVICE_OP_ALL];
+    size_t m_attachments;
+};
+class DeviceLatencyTracker {
+public:
+    static DeviceLatencyTracker& getInstance();
+    DeviceLatencyTracker();
+    ~DeviceLatencyTracker();
+    DeviceLatencyRecord* attach(const Device* device);
+    bool detach(uint32_t deviceId);
+    DeviceLatencyRecord* getRecord(uint32_t deviceId) const;
+    size_t getDeviceCount() const;
+    std::vector<DeviceLatencySummary> getSlowest(size_t count, DeviceOperation operation = DEVICE_OP_ALL,
+                                                 double percentile = 0.99) const;
+    std::string formatSlowest(size_t count, DeviceOperation operation = DEVICE_OP_ALL) const;
+    void reset();
+
+private:
+    DeviceLatencyTracker(const DeviceLatencyTracker&);
+    DeviceLatencyTracker& operator=(const DeviceLatencyTracker&);
+
+    std::map<uint32_t, DeviceLatencyRecord*> m_records;
+    mutable Mutex m_mutex;
+};
+
+}
+
+#endif
@@ -2,6 +2,8 @@
 #include "Logger.h"
 #include "Light.h"
 #include "Camera.h"
+#include "MonotonicTime.h"
+#include "Tracer.h"
 #include <sstream>
 
 namespace MySweetHome {
@@ -22,6 +24,7 @@ DeviceProxy::~DeviceProxy()
 
 void DeviceProxy::turnOn()
 {
+    TraceSpan span("DeviceProxy::turnOn", "proxy", getId());
     if (!m_realDevice) return;
 
     if (checkAccess("turnOn")) {
@@ -35,6 +38,7 @@ void DeviceProxy::turnOn()
 
 void DeviceProxy::turnOff()
 {
+    TraceSpan span("DeviceProxy::turnOff", "proxy", getId());
     if (!m_realDevice) return;
 
     if (m_realDevice->isCritical() && m_accessLevel < ACCESS_ADMIN) {
@@ -82,6 +86,14 @@ bool DeviceProxy::isCritical() const
     return m_realDevice->isCritical();
 }
 
+uint64_t DeviceProxy::getVersion() const
+{
+    uint64_t own = Device::getVersion();
+    if (!m_realDevice) return own;
+    uint64_t real = m_realDevice->getVersion();
+    return real > own ? real : own;
+}
+
 void DeviceProxy::setAccessLevel(AccessLevel level)
 {
     m_accessLevel = level;
@@ -247,6 +259,14 @@ bool LazyDeviceProxy::isCritical() const
            m_pendingType == DEVICE_ALARM;
 }
 
+uint64_t LazyDeviceProxy::getVersion() const
+{
+    uint64_t own = Device::getVersion();
+    if (!m_realDevice) return own;
+    uint64_t real = m_realDevice->getVersion();
+    return real > own ? real : own;
+}
+
 bool LazyDeviceProxy::isInitialized() const
 {
     return m_realDevice != 0;
@@ -262,6 +282,7 @@ void LazyDeviceProxy::ensureInitialized()
     if (!m_realDevice) {
         Logger::getInstance().debug("Lazy loading device: " + m_pendingName);
         m_realDevice = createRealDevice();
+        markModified();
     }
 }
 
@@ -330,7 +351,13 @@ CachingDeviceProxy::CachingDeviceProxy(Device* realDevice)
     : DeviceProxy(realDevice)
     , m_infoCacheValid(false)
     , m_statusCacheValid(false)
-    , m_cacheDuration(60)
+    , m_infoVersion(0)
+    , m_statusVersion(0)
+    , m_infoCachedAt(0)
+    , m_statusCachedAt(0)
+    , m_rebuilds(0)
+    , m_cacheDuration(0)
+    , m_clock(0)
 {
 }
 
@@ -338,20 +365,40 @@ CachingDeviceProxy::~CachingDeviceProxy()
 {
 }
 
+IClock& CachingDeviceProxy::clock() const
+{
+    return m_clock ? *m_clock : ClockProvider::getClock();
+}
+
+bool CachingDeviceProxy::isFresh(bool valid, uint64_t version, uint64_t cachedAt) const
+{
+    if (!valid || version != getVersion()) {
+        return false;
+    }
+    return m_cacheDuration == 0 ||
+           clock().nowMillis() - cachedAt < static_cast<uint64_t>(m_cacheDuration) * 1000ULL;
+}
+
 std::string CachingDeviceProxy::getInfo() const
 {
-    if (!m_infoCacheValid && m_realDevice) {
+    if (!isFresh(m_infoCacheValid, m_infoVersion, m_infoCachedAt) && m_realDevice) {
+        m_infoVersion = getVersion();
         m_cachedInfo = m_realDevice->getInfo();
         m_infoCacheValid = true;
+        m_infoCachedAt = m_cacheDuration ? clock().nowMillis() : 0;
+        ++m_rebuilds;
     }
     return "[Cached] " + m_cachedInfo;
 }
 
 std::string CachingDeviceProxy::getStatusString() const
 {
-    if (!m_statusCacheValid && m_realDevice) {
+    if (!isFresh(m_statusCacheValid, m_statusVersion, m_statusCachedAt) && m_realDevice) {
+        m_statusVersion = getVersion();
         m_cachedStatus = m_realDevice->getStatusString();
         m_statusCacheValid = true;
+        m_statusCachedAt = m_cacheDuration ? clock().nowMillis() : 0;
+        ++m_rebuilds;
     }
     return m_cachedStatus;
 }
@@ -364,10 +411,106 @@ void CachingDeviceProxy::invalidateCache()
 
 void CachingDeviceProxy::setCacheDuration(int seconds)
 {
-    if (seconds > 0) {
+    if (seconds >= 0) {
         m_cacheDuration = seconds;
+        invalidateCache();
+    }
+}
+
+int CachingDeviceProxy::getCacheDuration() const
+{
+    return m_cacheDuration;
+}
+
+void CachingDeviceProxy::setClock(IClock* clock)
+{
+    m_clock = clock;
+    invalidateCache();
+}
+
+uint64_t CachingDeviceProxy::getRebuildCount() const
+{
+    return m_rebuilds;
+}
+InstrumentingDeviceProxy::InstrumentingDeviceProxy(Device* realDevice, DeviceLatencyTracker* tracker)
+    : DeviceProxy(realDevice)
+    , m_tracker(tracker ? tracker : &DeviceLatencyTracker::getInstance())
+    , m_record(0)
+    , m_clock(0)
+{
+    m_loggingEnabled = false;
+    m_record = m_tracker->attach(realDevice);
+}
+
+InstrumentingDeviceProxy::~InstrumentingDeviceProxy()
+{
+    if (m_record) {
+        m_tracker->detach(m_record->getDeviceId());
     }
 }
+
+void InstrumentingDeviceProxy::turnOn()
+{
+    uint64_t start = nowNanos();
+    DeviceProxy::turnOn();
+    if (m_record) {
+        m_record->record(DEVICE_OP_TURN_ON, nowNanos() - start);
+    }
+}
+
+void InstrumentingDeviceProxy::turnOff()
+{
+    uint64_t start = nowNanos();
+    DeviceProxy::turnOff();
+    if (m_record) {
+        m_record->record(DEVICE_OP_TURN_OFF, nowNanos() - start);
+    }
+}
+
+Device* InstrumentingDeviceProxy::clone() const
+{
+    if (!m_realDevice) return 0;
+
+    InstrumentingDeviceProxy* clonedProxy = new InstrumentingDeviceProxy(m_realDevice->clone(), m_tracker);
+    clonedProxy->m_accessLevel = m_accessLevel;
+    clonedProxy->m_clock = m_clock;
+    return clonedProxy;
+}
+
+std::string InstrumentingDeviceProxy::getInfo() const
+{
+    uint64_t start = nowNanos();
+    std::string info = DeviceProxy::getInfo();
+    if (m_record) {
+        m_record->record(DEVICE_OP_GET_INFO, nowNanos() - start);
+    }
+    return info;
+}
+
+std::string InstrumentingDeviceProxy::getStatusString() const
+{
+    uint64_t start = nowNanos();
+    std::string status = DeviceProxy::getStatusString();
+    if (m_record) {
+        m_record->record(DEVICE_OP_GET_STATUS, nowNanos() - start);
+    }
+    return status;
+}
+
+DeviceLatencyRecord* InstrumentingDeviceProxy::getLatencyRecord() const
+{
+    return m_record;
+}
+
+void InstrumentingDeviceProxy::setClock(IClock* clock)
+{
+    m_clock = clock;
+}
+
+uint64_t InstrumentingDeviceProxy::nowNanos() const
+{
+    return m_clock ? m_clock->nowMicros() * 1000ULL : monotonicNanos();
+}
 DeviceProxy* DeviceProxyFactory::createProxy(Device* device, ProxyType type)
 {
     if (!device) return 0;
@@ -381,6 +524,8 @@ DeviceProxy* DeviceProxyFactory::createProxy(Device* device, ProxyType type)
             return new LoggingDeviceProxy(device);
         case PROXY_CACHING:
             return new CachingDeviceProxy(device);
+        case PROXY_INSTRUMENTING:
+            return new InstrumentingDeviceProxy(device);
         default:
             return new DeviceProxy(device);
     }
@@ -2,6 +2,8 @@
 #define DEVICE_PROXY_H
 
 #include "Device.h"
+#include "Clock.h"
+#include "DeviceLatency.h"
 #include <string>
 
 namespace MySweetHome {
@@ -20,6 +22,7 @@ public:
     virtual std::string getInfo() const;
     virtual std::string getStatusString() const;
     virtual bool isCritical() const;
+    virtual uint64_t getVersion() const;
     void setAccessLevel(AccessLevel level);
     AccessLevel getAccessLevel() const;
     bool checkAccess(const std::string& operation) const;
@@ -59,6 +62,7 @@ public:
     virtual std::string getInfo() const;
     virtual std::string getStatusString() const;
     virtual bool isCritical() const;
+    virtual uint64_t getVersion() const;
     bool isInitialized() const;
     void forceInitialize();
 
@@ -95,13 +99,44 @@ public:
     virtual std::string getStatusString() const;
     void invalidateCache();
     void setCacheDuration(int seconds);
+    int getCacheDuration() const;
+    void setClock(IClock* clock);
+    uint64_t getRebuildCount() const;
 
 private:
+    IClock& clock() const;
+    bool isFresh(bool valid, uint64_t version, uint64_t cachedAt) const;
+
     mutable std::string m_cachedInfo;
     mutable std::string m_cachedStatus;
     mutable bool m_infoCacheValid;
     mutable bool m_statusCacheValid;
+    mutable uint64_t m_infoVersion;
+    mutable uint64_t m_statusVersion;
+    mutable uint64_t m_infoCachedAt;
+    mutable uint64_t m_statusCachedAt;
+    mutable uint64_t m_rebuilds;
     int m_cacheDuration;
+    IClock* m_clock;
+};
+class InstrumentingDeviceProxy : public DeviceProxy {
+public:
+    InstrumentingDeviceProxy(Device* realDevice, DeviceLatencyTracker* tracker = 0);
+    virtual ~InstrumentingDeviceProxy();
+    virtual void turnOn();
+    virtual void turnOff();
+    virtual Device* clone() const;
+    virtual std::string getInfo() const;
+    virtual std::string getStatusString() const;
+    DeviceLatencyRecord* getLatencyRecord() const;
+    void setClock(IClock* clock);
+
+private:
+    uint64_t nowNanos() const;
+
+    DeviceLatencyTracker* m_tracker;
+    DeviceLatencyRecord* m_record;
+    IClock* m_clock;
 };
 class DeviceProxyFactory {
 public:
@@ -109,7 +144,8 @@ public:
         PROXY_PROTECTION,
         PROXY_CRITICAL,
         PROXY_LOGGING,
-        PROXY_CACHING
+        PROXY_CACHING,
+        PROXY_INSTRUMENTING
     };
     static DeviceProxy* createProxy(Device* device, ProxyType type);
     static DeviceProxy* createAutoProxy(Device* device);
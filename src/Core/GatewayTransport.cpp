@@ -0,0 +1,231 @@
+#include "GatewayTransport.h"
+#include "Logger.h"
+
+namespace MySweetHome {
+LoopbackTransport::LoopbackTransport()
+    : m_nextHandle(1)
+{
+}
+
+LoopbackTransport::~LoopbackTransport()
+{
+}
+
+int LoopbackTransport::open(const std::string& endpoint, int timeoutMs)
+{
+    (void)timeoutMs;
+    if (endpoint.empty()) {
+        return 0;
+    }
+    ScopedLock lock(m_mutex);
+    return m_nextHandle++;
+}
+
+void LoopbackTransport::close(int handle)
+{
+    (void)handle;
+}
+
+bool LoopbackTransport::send(int handle, const std::string& command, int timeoutMs)
+{
+    (void)command;
+    (void)timeoutMs;
+    return handle > 0;
+}
+
+bool LoopbackTransport::probe(const std::string& endpoint, int timeoutMs)
+{
+    (void)timeoutMs;
+    return !endpoint.empty();
+}
+
+std::string LoopbackTransport::getTransportName() const
+{
+    return "Loopback";
+}
+EndpointProfile::EndpointProfile()
+    : online(true)
+    , dropRate(0.0f)
+    , latencyMs(1)
+    , jitterMs(0)
+{
+}
+GatewayEmulator::GatewayEmulator(uint64_t seed)
+    : m_random(seed)
+    , m_nextHandle(1)
+    , m_lastLatency(0)
+    , m_totalLatency(0)
+{
+}
+
+GatewayEmulator::~GatewayEmulator()
+{
+}
+
+int GatewayEmulator::open(const std::string& endpoint, int timeoutMs)
+{
+    if (endpoint.empty()) {
+        return 0;
+    }
+
+    ScopedLock lock(m_mutex);
+    ++m_openAttempts[endpoint];
+    EndpointProfile& profile = profileFor(endpoint);
+    if (!simulateExchange(profile, timeoutMs)) {
+        return 0;
+    }
+
+    int handle = m_nextHandle++;
+    m_connections[handle] = endpoint;
+    return handle;
+}
+
+void GatewayEmulator::close(int handle)
+{
+    ScopedLock lock(m_mutex);
+    m_connections.erase(handle);
+}
+
+bool GatewayEmulator::send(int handle, const std::string& command, int timeoutMs)
+{
+    (void)command;
+    ScopedLock lock(m_mutex);
+    std::map<int, std::string>::iterator it = m_connections.find(handle);
+    if (it == m_connections.end()) {
+        return false;
+    }
+
+    EndpointProfile& profile = profileFor(it->second);
+    if (!simulateExchange(profile, timeoutMs)) {
+        m_connections.erase(it);
+        return false;
+    }
+    return true;
+}
+
+bool GatewayEmulator::probe(const std::string& endpoint, int timeoutMs)
+{
+    if (endpoint.empty()) {
+        return false;
+    }
+    ScopedLock lock(m_mutex);
+    return simulateExchange(profileFor(endpoint), timeoutMs);
+}
+
+std::string GatewayEmulator::getTransportName() const
+{
+    return "Emulator";
+}
+
+void GatewayEmulator::setEndpointOnline(const std::string& endpoint, bool online)
+{
+    ScopedLock lock(m_mutex);
+    profileFor(endpoint).online = online;
+    if (!online) {
+        Logger::getInstance().debug("Emulated gateway offline: " + endpoint);
+    }
+}
+
+void GatewayEmulator::setDropRate(const std::string& endpoint, float rate)
+{
+    if (rate < 0.0f || rate > 1.0f) {
+        return;
+    }
+    ScopedLock lock(m_mutex);
+    profileFor(endpoint).dropRate = rate;
+}
+
+void GatewayEmulator::setLatency(const std::string& endpoint, int latencyMs, int jitterMs)
+{
+    ScopedLock lock(m_mutex);
+    EndpointProfile& profile = profileFor(endpoint);
+    profile.latencyMs = latencyMs > 0 ? latencyMs : 0;
+    profile.jitterMs = jitterMs > 0 ? jitterMs : 0;
+}
+
+void GatewayEmulator::setDefaultProfile(const EndpointProfile& profile)
+{
+    ScopedLock lock(m_mutex);
+    m_defaultProfile = profile;
+}
+
+void GatewayEmulator::dropConnection(int handle)
+{
+    ScopedLock lock(m_mutex);
+    m_connections.erase(handle);
+}
+
+void GatewayEmulator::dropAllConnections(const std::string& endpoint)
+{
+    ScopedLock lock(m_mutex);
+    std::map<int, std::string>::iterator it = m_connections.begin();
+    while (it != m_connections.end()) {
+        if (it->second == endpoint) {
+            m_connections.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+int GatewayEmulator::getOpenAttempts(const std::string& endpoint) const
+{
+    ScopedLock lock(m_mutex);
+    std::map<std::string, int>::const_iterator it = m_openAttempts.find(endpoint);
+    return it != m_openAttempts.end() ? it->second : 0;
+}
+
+int GatewayEmulator::getOpenConnectionCount(const std::string& endpoint) const
+{
+    ScopedLock lock(m_mutex);
+    int count = 0;
+    for (std::map<int, std::string>::const_iterator it = m_connections.begin();
+         it != m_connections.end(); ++it) {
+        if (it->second == endpoint) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+int GatewayEmulator::getLastLatency() const
+{
+    ScopedLock lock(m_mutex);
+    return m_lastLatency;
+}
+
+uint64_t GatewayEmulator::getTotalLatency() const
+{
+    ScopedLock lock(m_mutex);
+    return m_totalLatency;
+}
+
+EndpointProfile& GatewayEmulator::profileFor(const std::string& endpoint)
+{
+    std::map<std::string, EndpointProfile>::iterator it = m_profiles.find(endpoint);
+    if (it == m_profiles.end()) {
+        it = m_profiles.insert(std::make_pair(endpoint, m_defaultProfile)).first;
+    }
+    return it->second;
+}
+
+bool GatewayEmulator::simulateExchange(EndpointProfile& profile, int timeoutMs)
+{
+    if (!profile.online) {
+        return false;
+    }
+
+    int latency = profile.latencyMs;
+    if (profile.jitterMs > 0) {
+        latency += m_random.nextInt(0, profile.jitterMs);
+    }
+    m_lastLatency = latency;
+    m_totalLatency += static_cast<uint64_t>(latency);
+    if (timeoutMs > 0 && latency > timeoutMs) {
+        return false;
+    }
+
+    return !m_random.nextBool(profile.dropRate);
+}
+
+}
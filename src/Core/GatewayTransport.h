@@ -0,0 +1,79 @@
+#ifndef GATEWAY_TRANSPORT_H
+#define GATEWAY_TRANSPORT_H
+
+#include <string>
+#include <map>
+#include "common_types.h"
+#include "Mutex.h"
+#include "Random.h"
+
+namespace MySweetHome {
+class IGatewayTransport {
+public:
+    virtual ~IGatewayTransport() {}
+    virtual int open(const std::string& endpoint, int timeoutMs) = 0;
+    virtual void close(int handle) = 0;
+    virtual bool send(int handle, const std::string& command, int timeoutMs) = 0;
+    virtual bool probe(const std::string& endpoint, int timeoutMs) = 0;
+    virtual std::string getTransportName() const = 0;
+};
+class LoopbackTransport : public IGatewayTransport {
+public:
+    LoopbackTransport();
+    virtual ~LoopbackTransport();
+    virtual int open(const std::string& endpoint, int timeoutMs);
+    virtual void close(int handle);
+    virtual bool send(int handle, const std::string& command, int timeoutMs);
+    virtual bool probe(const std::string& endpoint, int timeoutMs);
+    virtual std::string getTransportName() const;
+
+private:
+    Mutex m_mutex;
+    int m_nextHandle;
+};
+struct EndpointProfile {
+    bool online;
+    float dropRate;
+    int latencyMs;
+    int jitterMs;
+
+    EndpointProfile();
+};
+class GatewayEmulator : public IGatewayTransport {
+public:
+    GatewayEmulator(uint64_t seed = 1);
+    virtual ~GatewayEmulator();
+    virtual int open(const std::string& endpoint, int timeoutMs);
+    virtual void close(int handle);
+    virtual bool send(int handle, const std::string& command, int timeoutMs);
+    virtual bool probe(const std::string& endpoint, int timeoutMs);
+    virtual std::string getTransportName() const;
+    void setEndpointOnline(const std::string& endpoint, bool online);
+    void setDropRate(const std::string& endpoint, float rate);
+    void setLatency(const std::string& endpoint, int latencyMs, int jitterMs = 0);
+    void setDefaultProfile(const EndpointProfile& profile);
+    void dropConnection(int handle);
+    void dropAllConnections(const std::string& endpoint);
+    int getOpenAttempts(const std::string& endpoint) const;
+    int getOpenConnectionCount(const std::string& endpoint) const;
+    int getLastLatency() const;
+    uint64_t getTotalLatency() const;
+
+private:
+    EndpointProfile& profileFor(const std::string& endpoint);
+    bool simulateExchange(EndpointProfile& profile, int timeoutMs);
+
+    mutable Mutex m_mutex;
+    Random m_random;
+    EndpointProfile m_defaultProfile;
+    std::map<std::string, EndpointProfile> m_profiles;
+    std::map<int, std::string> m_connections;
+    std::map<std::string, int> m_openAttempts;
+    int m_nextHandle;
+    int m_lastLatency;
+    uint64_t m_totalLatency;
+};
+
+}
+
+#endif
@@ -0,0 +1,404 @@
+#include "HealthMonitor.h"
+#include "DeviceImpl.h"
+#include "Device.h"
+#include "Thread.h"
+#include "MonotonicTime.h"
+#include "Logger.h"
+#include <sstream>
+
+namespace MySweetHome {
+namespace {
+const size_t PING_CHUNK_SIZE = 64;
+const int MAX_MISS_COUNT = 255;
+}
+
+std::string healthStatusToString(HealthStatus status)
+{
+    switch (status) {
+        case HEALTH_UNKNOWN:  return "Unknown";
+        case HEALTH_OK:       return "OK";
+        case HEALTH_DEGRADED: return "Degraded";
+        case HEALTH_FAILED:   return "Failed";
+        default:              return "?";
+    }
+}
+HealthSweepStats::HealthSweepStats()
+    : probed(0)
+    , healthy(0)
+    , degraded(0)
+    , failed(0)
+    , newlyFailed(0)
+    , recovered(0)
+    , durationMicros(0)
+{
+}
+class HealthMonitor::PingWorker : public IRunnable {
+public:
+    PingWorker(HealthMonitor* monitor)
+        : m_monitor(monitor)
+    {
+    }
+
+    virtual void run()
+    {
+        size_t begin = 0;
+        size_t end = 0;
+        while (m_monitor->takeNetworkChunk(begin, end)) {
+            m_monitor->runPingChunk(begin, end);
+        }
+    }
+
+private:
+    HealthMonitor* m_monitor;
+};
+HealthMonitor::HealthMonitor()
+    : m_nextNetworkIndex(0)
+    , m_sweepIntervalMs(10000)
+    , m_maxMisses(3)
+    , m_concurrency(8)
+    , m_lastSweepAt(0)
+    , m_hasSwept(false)
+    , m_clock(0)
+{
+}
+
+HealthMonitor::~HealthMonitor()
+{
+}
+
+int HealthMonitor::registerImpl(IDeviceImpl* impl, Device* device)
+{
+    if (!impl) {
+        return -1;
+    }
+
+    int existing = findSlot(impl);
+    if (existing >= 0) {
+        m_devices[static_cast<size_t>(existing)] = device;
+        return existing;
+    }
+
+    HealthProbeKind kind = PROBE_GENERIC;
+    if (dynamic_cast<NetworkDeviceImpl*>(impl)) {
+        kind = PROBE_NETWORK;
+    } else if (dynamic_cast<HardwareDeviceImpl*>(impl)) {
+        kind = PROBE_HARDWARE;
+    } else if (dynamic_cast<SimulatedDeviceImpl*>(impl)) {
+        kind = PROBE_SIMULATED;
+    }
+
+    size_t slot = m_impls.size();
+    m_impls.push_back(impl);
+    m_devices.push_back(device);
+    m_kinds.push_back(static_cast<uint8_t>(kind));
+    m_results.push_back(0);
+    m_misses.push_back(0);
+    m_status.push_back(static_cast<uint8_t>(HEALTH_UNKNOWN));
+    m_slotIndex[impl] = slot;
+    if (kind == PROBE_NETWORK) {
+        m_networkSlots.push_back(slot);
+    }
+    return static_cast<int>(slot);
+}
+
+bool HealthMonitor::unregisterImpl(IDeviceImpl* impl)
+{
+    int slot = findSlot(impl);
+    if (slot < 0) {
+        return false;
+    }
+
+    size_t index = static_cast<size_t>(slot);
+    m_impls.erase(m_impls.begin() + index);
+    m_devices.erase(m_devices.begin() + index);
+    m_kinds.erase(m_kinds.begin() + index);
+    m_results.erase(m_results.begin() + index);
+    m_misses.erase(m_misses.begin() + index);
+    m_status.erase(m_status.begin() + index);
+    rebuildIndex();
+    return true;
+}
+
+size_t HealthMonitor::unregisterDevice(const Device* device)
+{
+    size_t cleared = 0;
+    if (!device) {
+        return cleared;
+    }
+    for (size_t i = 0; i < m_devices.size(); ++i) {
+        if (m_devices[i] == device) {
+            m_devices[i] = 0;
+            ++cleared;
+        }
+    }
+    return cleared;
+}
+
+void HealthMonitor::clear()
+{
+    m_impls.clear();
+    m_devices.clear();
+    m_kinds.clear();
+    m_results.clear();
+    m_misses.clear();
+    m_status.clear();
+    m_networkSlots.clear();
+    m_slotIndex.clear();
+}
+
+size_t HealthMonitor::size() const
+{
+    return m_impls.size();
+}
+
+void HealthMonitor::setSweepInterval(int milliseconds)
+{
+    if (milliseconds > 0) {
+        m_sweepIntervalMs = milliseconds;
+    }
+}
+
+int HealthMonitor::getSweepInterval() const
+{
+    return m_sweepIntervalMs;
+}
+
+void HealthMonitor::setMaxMisses(int misses)
+{
+    if (misses > 0 && misses <= MAX_MISS_COUNT) {
+        m_maxMisses = misses;
+    }
+}
+
+int HealthMonitor::getMaxMisses() const
+{
+    return m_maxMisses;
+}
+
+void HealthMonitor::setConcurrency(int workers)
+{
+    if (workers > 0) {
+        m_concurrency = workers;
+    }
+}
+
+int HealthMonitor::getConcurrency() const
+{
+    return m_concurrency;
+}
+
+void HealthMonitor::setClock(IClock* clock)
+{
+    m_clock = clock;
+}
+
+IClock& HealthMonitor::clock() const
+{
+    return m_clock ? *m_clock : ClockProvider::getClock();
+}
+
+HealthSweepStats HealthMonitor::sweep()
+{
+    uint64_t start = monotonicMicros();
+    HealthSweepStats stats;
+
+    for (size_t i = 0; i < m_impls.size(); ++i) {
+        if (m_kinds[i] != PROBE_NETWORK) {
+            m_results[i] = probeLocal(i) ? 1 : 0;
+        }
+    }
+    pingNetworkSlots();
+
+    for (size_t i = 0; i < m_impls.size(); ++i) {
+        HealthStatus previous = static_cast<HealthStatus>(m_status[i]);
+        if (m_results[i]) {
+            m_misses[i] = 0;
+            m_status[i] = static_cast<uint8_t>(HEALTH_OK);
+            if (previous == HEALTH_FAILED) {
+                ++stats.recovered;
+            }
+        } else {
+            if (m_misses[i] < MAX_MISS_COUNT) {
+                ++m_misses[i];
+            }
+            if (m_misses[i] >= m_maxMisses) {
+                m_status[i] = static_cast<uint8_t>(HEALTH_FAILED);
+                if (previous != HEALTH_FAILED) {
+                    ++stats.newlyFailed;
+                    if (m_devices[i] && m_devices[i]->getStatus() != STATUS_ERROR) {
+                        m_devices[i]->simulateFailure();
+                    }
+                }
+            } else {
+                m_status[i] = static_cast<uint8_t>(HEALTH_DEGRADED);
+            }
+        }
+
+        switch (static_cast<HealthStatus>(m_status[i])) {
+            case HEALTH_OK:       ++stats.healthy;  break;
+            case HEALTH_DEGRADED: ++stats.degraded; break;
+            case HEALTH_FAILED:   ++stats.failed;   break;
+            default: break;
+        }
+    }
+
+    stats.probed = m_impls.size();
+    stats.durationMicros = monotonicMicros() - start;
+    m_lastStats = stats;
+    m_lastSweepAt = clock().nowMillis();
+    m_hasSwept = true;
+
+    if (stats.newlyFailed > 0 || stats.recovered > 0) {
+        std::ostringstream oss;
+        oss << "Health sweep: " << stats.newlyFailed << " device(s) failed, "
+            << stats.recovered << " recovered, " << stats.failed << " of "
+            << stats.probed << " down";
+        Logger::getInstance().warning(oss.str());
+    }
+    return stats;
+}
+
+bool HealthMonitor::sweepIfDue()
+{
+    uint64_t now = clock().nowMillis();
+    if (m_hasSwept && now < m_lastSweepAt + static_cast<uint64_t>(m_sweepIntervalMs)) {
+        return false;
+    }
+    sweep();
+    return true;
+}
+
+HealthStatus HealthMonitor::getStatus(int slot) const
+{
+    if (slot < 0 || static_cast<size_t>(slot) >= m_status.size()) {
+        return HEALTH_UNKNOWN;
+    }
+    return static_cast<HealthStatus>(m_status[static_cast<size_t>(slot)]);
+}
+
+int HealthMonitor::getMissCount(int slot) const
+{
+    if (slot < 0 || static_cast<size_t>(slot) >= m_misses.size()) {
+        return 0;
+    }
+    return m_misses[static_cast<size_t>(slot)];
+}
+
+int HealthMonitor::findSlot(IDeviceImpl* impl) const
+{
+    std::map<IDeviceImpl*, size_t>::const_iterator it = m_slotIndex.find(impl);
+    if (it == m_slotIndex.end()) {
+        return -1;
+    }
+    return static_cast<int>(it->second);
+}
+
+size_t HealthMonitor::countByStatus(HealthStatus status) const
+{
+    size_t count = 0;
+    for (size_t i = 0; i < m_status.size(); ++i) {
+        if (m_status[i] == static_cast<uint8_t>(status)) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+HealthSweepStats HealthMonitor::getLastSweepStats() const
+{
+    return m_lastStats;
+}
+
+std::string HealthMonitor::getStatusReport() const
+{
+    std::ostringstream oss;
+    oss << "Devices: " << m_impls.size()
+        << " | OK: " << countByStatus(HEALTH_OK)
+        << " | Degraded: " << countByStatus(HEALTH_DEGRADED)
+        << " | Failed: " << countByStatus(HEALTH_FAILED)
+        << " | Unknown: " << countByStatus(HEALTH_UNKNOWN)
+        << " | Last sweep: " << m_lastStats.durationMicros << "us";
+    return oss.str();
+}
+
+bool HealthMonitor::probeLocal(size_t slot) const
+{
+    IDeviceImpl* impl = m_impls[slot];
+    switch (static_cast<HealthProbeKind>(m_kinds[slot])) {
+        case PROBE_HARDWARE:
+            return impl->getHardwareStatus() == HW_STATUS_OK;
+        case PROBE_SIMULATED:
+            return impl->isConnected() && impl->getHardwareStatus() == HW_STATUS_OK;
+        default:
+            return impl->isConnected();
+    }
+}
+
+void HealthMonitor::pingNetworkSlots()
+{
+    m_nextNetworkIndex = 0;
+    size_t workerCount = static_cast<size_t>(m_concurrency);
+    size_t chunks = (m_networkSlots.size() + PING_CHUNK_SIZE - 1) / PING_CHUNK_SIZE;
+    if (workerCount > chunks) {
+        workerCount = chunks;
+    }
+
+    if (workerCount <= 1) {
+        runPingChunk(0, m_networkSlots.size());
+        return;
+    }
+
+    PingWorker worker(this);
+    std::vector<Thread*> threads;
+    for (size_t i = 1; i < workerCount; ++i) {
+        Thread* thread = new Thread(&worker);
+        if (thread->start()) {
+            threads.push_back(thread);
+        } else {
+            delete thread;
+        }
+    }
+    worker.run();
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->join();
+        delete threads[i];
+    }
+}
+
+bool HealthMonitor::takeNetworkChunk(size_t& begin, size_t& end)
+{
+    ScopedLock lock(m_chunkMutex);
+    if (m_nextNetworkIndex >= m_networkSlots.size()) {
+        return false;
+    }
+    begin = m_nextNetworkIndex;
+    end = begin + PING_CHUNK_SIZE;
+    if (end > m_networkSlots.size()) {
+        end = m_networkSlots.size();
+    }
+    m_nextNetworkIndex = end;
+    return true;
+}
+
+void HealthMonitor::runPingChunk(size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; ++i) {
+        size_t slot = m_networkSlots[i];
+        NetworkDeviceImpl* impl = static_cast<NetworkDeviceImpl*>(m_impls[slot]);
+        m_results[slot] = impl->ping() ? 1 : 0;
+    }
+}
+
+void HealthMonitor::rebuildIndex()
+{
+    m_slotIndex.clear();
+    m_networkSlots.clear();
+    for (size_t i = 0; i < m_impls.size(); ++i) {
+        m_slotIndex[m_impls[i]] = i;
+        if (m_kinds[i] == PROBE_NETWORK) {
+            m_networkSlots.push_back(i);
+        }
+    }
+}
+
+}
@@ -0,0 +1,99 @@
+#ifndef HEALTH_MONITOR_H
+#define HEALTH_MONITOR_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include "common_types.h"
+#include "Mutex.h"
+#include "Clock.h"
+
+namespace MySweetHome {
+
+class IDeviceImpl;
+class Device;
+enum HealthStatus {
+    HEALTH_UNKNOWN,
+    HEALTH_OK,
+    HEALTH_DEGRADED,
+    HEALTH_FAILED
+};
+enum HealthProbeKind {
+    PROBE_NETWORK,
+    PROBE_HARDWARE,
+    PROBE_SIMULATED,
+    PROBE_GENERIC
+};
+std::string healthStatusToString(HealthStatus status);
+struct HealthSweepStats {
+    size_t probed;
+    size_t healthy;
+    size_t degraded;
+    size_t failed;
+    size_t newlyFailed;
+    size_t recovered;
+    uint64_t durationMicros;
+
+    HealthSweepStats();
+};
+class HealthMonitor {
+public:
+    HealthMonitor();
+    ~HealthMonitor();
+    int registerImpl(IDeviceImpl* impl, Device* device = 0);
+    bool unregisterImpl(IDeviceImpl* impl);
+    size_t unregisterDevice(const Device* device);
+    void clear();
+    size_t size() const;
+    void setSweepInterval(int milliseconds);
+    int getSweepInterval() const;
+    void setMaxMisses(int misses);
+    int getMaxMisses() const;
+    void setConcurrency(int workers);
+    int getConcurrency() const;
+    void setClock(IClock* clock);
+    HealthSweepStats sweep();
+    bool sweepIfDue();
+    HealthStatus getStatus(int slot) const;
+    int getMissCount(int slot) const;
+    int findSlot(IDeviceImpl* impl) const;
+    size_t countByStatus(HealthStatus status) const;
+    HealthSweepStats getLastSweepStats() const;
+    std::string getStatusReport() const;
+
+private:
+    HealthMonitor(const HealthMonitor&);
+    HealthMonitor& operator=(const HealthMonitor&);
+
+    class PingWorker;
+    friend class PingWorker;
+
+    bool probeLocal(size_t slot) const;
+    void pingNetworkSlots();
+    bool takeNetworkChunk(size_t& begin, size_t& end);
+    void runPingChunk(size_t begin, size_t end);
+    void rebuildIndex();
+    IClock& clock() const;
+
+    std::vector<IDeviceImpl*> m_impls;
+    std::vector<Device*> m_devices;
+    std::vector<uint8_t> m_kinds;
+    std::vector<uint8_t> m_results;
+    std::vector<uint8_t> m_misses;
+    std::vector<uint8_t> m_status;
+    std::vector<size_t> m_networkSlots;
+    std::map<IDeviceImpl*, size_t> m_slotIndex;
+    Mutex m_chunkMutex;
+    size_t m_nextNetworkIndex;
+    int m_sweepIntervalMs;
+    int m_maxMisses;
+    int m_concurrency;
+    uint64_t m_lastSweepAt;
+    bool m_hasSwept;
+    HealthSweepStats m_lastStats;
+    IClock* m_clock;
+};
+
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "IObserver.h"
+#include "Metrics.h"
 #include <iostream>
 
 namespace MySweetHome {
@@ -13,6 +14,18 @@ NotificationManager::~NotificationManager()
 }
 
 void NotificationManager::onNotify(const std::string& event, const std::string& message) {
+    static const char* const channels[] = { "log", "alarm", "sms" };
+    static MetricCounter* delivered[3] = { 0, 0, 0 };
+    static LatencyHistogram* latencies[3] = { 0, 0, 0 };
+    if (!delivered[m_notificationType]) {
+        MetricLabels labels = MetricLabels("subsystem", "notification").add("channel", channels[m_notificationType]);
+        MetricsRegistry& metrics = MetricsRegistry::getInstance();
+        latencies[m_notificationType] = &metrics.histogram("msh_notification_delivery_micros",
+                                                           "Notification delivery time", labels);
+        delivered[m_notificationType] = &metrics.counter("msh_notifications_total", "Notifications delivered", labels);
+    }
+    delivered[m_notificationType]->increment();
+    ScopedLatency latency(*latencies[m_notificationType]);
     switch (m_notificationType) {
         case NOTIFY_LOG:
             notifyByLog(message);
@@ -0,0 +1,599 @@
+#include "Metrics.h"
+#include "Atomic.h"
+#include "MonotonicTime.h"
+#include "Logger.h"
+#include <cstring>
+#include <cstdio>
+#include <sstream>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#define METRIC_THREAD_LOCAL __declspec(thread)
+#else
+#define METRIC_THREAD_LOCAL __thread
+#endif
+
+namespace MySweetHome {
+namespace {
+METRIC_THREAD_LOCAL int t_shard = -1;
+AtomicCounter s_nextShard(0);
+
+inline size_t currentShard()
+{
+    if (t_shard < 0) {
+        t_shard = static_cast<int>(static_cast<unsigned long>(s_nextShard.increment()) % METRIC_SHARDS);
+    }
+    return static_cast<size_t>(t_shard);
+}
+
+inline void atomicAdd(volatile uint64_t* target, uint64_t delta)
+{
+#ifdef _WIN32
+    InterlockedExchangeAdd64(reinterpret_cast<volatile LONGLONG*>(target), static_cast<LONGLONG>(delta));
+#else
+    __sync_fetch_and_add(target, delta);
+#endif
+}
+
+inline void atomicStore(volatile uint64_t* target, uint64_t value)
+{
+#ifdef _WIN32
+    InterlockedExchange64(reinterpret_cast<volatile LONGLONG*>(target), static_cast<LONGLONG>(value));
+#else
+    __sync_lock_test_and_set(target, value);
+    __sync_synchronize();
+#endif
+}
+
+inline uint64_t atomicLoad(const volatile uint64_t* target)
+{
+    return *target;
+}
+
+inline void atomicMax(volatile uint64_t* target, uint64_t value)
+{
+    uint64_t current = *target;
+    while (value > current) {
+#ifdef _WIN32
+        uint64_t previous = static_cast<uint64_t>(InterlockedCompareExchange64(
+            reinterpret_cast<volatile LONGLONG*>(target), static_cast<LONGLONG>(value),
+            static_cast<LONGLONG>(current)));
+#else
+        uint64_t previous = __sync_val_compare_and_swap(target, current, value);
+#endif
+        if (previous == current) {
+            return;
+        }
+        current = previous;
+    }
+}
+
+inline int highestBit(uint64_t value)
+{
+#ifdef _WIN32
+    int bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+std::string escapeLabel(const std::string& value)
+{
+    std::string escaped;
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (value[i] == '\\' || value[i] == '"') {
+            escaped += '\\';
+            escaped += value[i];
+        } else if (value[i] == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += value[i];
+        }
+    }
+    return escaped;
+}
+
+std::string kindName(MetricKind kind)
+{
+    switch (kind) {
+        case METRIC_COUNTER:   return "counter";
+        case METRIC_GAUGE:     return "gauge";
+        case METRIC_HISTOGRAM: return "histogram";
+    }
+    return "untyped";
+}
+
+}
+
+MetricLabels::MetricLabels()
+{
+}
+
+MetricLabels::MetricLabels(const std::string& key, const std::string& value)
+{
+    add(key, value);
+}
+
+MetricLabels& MetricLabels::add(const std::string& key, const std::string& value)
+{
+    m_labels.push_back(std::make_pair(key, value));
+    return *this;
+}
+
+bool MetricLabels::empty() const
+{
+    return m_labels.empty();
+}
+
+std::string MetricLabels::toString() const
+{
+    if (m_labels.empty()) {
+        return "";
+    }
+    std::string text = "{";
+    for (size_t i = 0; i < m_labels.size(); ++i) {
+        if (i > 0) {
+            text += ",";
+        }
+        text += m_labels[i].first + "=\"" + escapeLabel(m_labels[i].second) + "\"";
+    }
+    return text + "}";
+}
+
+std::string MetricLabels::toStringWith(const std::string& key, const std::string& value) const
+{
+    MetricLabels extended = *this;
+    extended.add(key, value);
+    return extended.toString();
+}
+
+MetricCounter::MetricCounter()
+    : m_shards(static_cast<Shard*>(alignedAllocate(sizeof(Shard) * METRIC_SHARDS, 64)))
+{
+    std::memset(m_shards, 0, sizeof(Shard) * METRIC_SHARDS);
+}
+
+MetricCounter::~MetricCounter()
+{
+    alignedFree(m_shards);
+}
+
+void MetricCounter::increment()
+{
+    atomicAdd(&m_shards[currentShard()].value, 1);
+}
+
+void MetricCounter::add(uint64_t delta)
+{
+    atomicAdd(&m_shards[currentShard()].value, delta);
+}
+
+uint64_t MetricCounter::get() const
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i < METRIC_SHARDS; ++i) {
+        total += atomicLoad(&m_shards[i].value);
+    }
+    return total;
+}
+
+void MetricCounter::reset()
+{
+    for (size_t i = 0; i < METRIC_SHARDS; ++i) {
+        atomicStore(&m_shards[i].value, 0);
+    }
+}
+
+MetricGauge::MetricGauge()
+    : m_value(0)
+{
+}
+
+MetricGauge::~MetricGauge()
+{
+}
+
+void MetricGauge::set(int64_t value)
+{
+    atomicStore(reinterpret_cast<volatile uint64_t*>(&m_value), static_cast<uint64_t>(value));
+}
+
+void MetricGauge::add(int64_t delta)
+{
+    atomicAdd(reinterpret_cast<volatile uint64_t*>(&m_value), static_cast<uint64_t>(delta));
+}
+
+int64_t MetricGauge::get() const
+{
+    return m_value;
+}
+
+HistogramSnapshot::HistogramSnapshot()
+    : count(0)
+    , sum(0)
+    , max(0)
+    , buckets(HISTOGRAM_BUCKETS, 0)
+{
+}
+
+double HistogramSnapshot::mean() const
+{
+    return count > 0 ? static_cast<double>(sum) / static_cast<double>(count) : 0.0;
+}
+
+uint64_t HistogramSnapshot::percentile(double fraction) const
+{
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(fraction * static_cast<double>(count) + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            uint64_t upper = LatencyHistogram::bucketUpperBound(i);
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+void HistogramSnapshot::merge(const HistogramSnapshot& other)
+{
+    count += other.count;
+    sum += other.sum;
+    if (other.max > max) {
+        max = other.max;
+    }
+    for (size_t i = 0; i < buckets.size() && i < other.buckets.size(); ++i) {
+        buckets[i] += other.buckets[i];
+    }
+}
+
+LatencyHistogram::LatencyHistogram(size_t shards)
+    : m_shards(0)
+    , m_shardMask(0)
+{
+    size_t count = 1;
+    while (count < shards && count < METRIC_SHARDS) {
+        count <<= 1;
+    }
+    m_shardMask = count - 1;
+    m_shards = static_cast<Shard*>(alignedAllocate(sizeof(Shard) * count, 64));
+    std::memset(m_shards, 0, sizeof(Shard) * count);
+}
+
+LatencyHistogram::~LatencyHistogram()
+{
+    alignedFree(m_shards);
+}
+
+void LatencyHistogram::record(uint64_t value)
+{
+    Shard& shard = m_shards[currentShard() & m_shardMask];
+    atomicAdd(&shard.buckets[bucketIndex(value)], 1);
+    atomicAdd(&shard.sum, value);
+    atomicMax(&shard.max, value);
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const
+{
+    HistogramSnapshot result;
+    for (size_t s = 0; s <= m_shardMask; ++s) {
+        const Shard& shard = m_shards[s];
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+            result.buckets[i] += atomicLoad(&shard.buckets[i]);
+        }
+        result.sum += atomicLoad(&shard.sum);
+        uint64_t shardMax = atomicLoad(&shard.max);
+        if (shardMax > result.max) {
+            result.max = shardMax;
+        }
+    }
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        result.count += result.buckets[i];
+    }
+    return result;
+}
+
+uint64_t LatencyHistogram::getCount() const
+{
+    uint64_t total = 0;
+    for (size_t s = 0; s <= m_shardMask; ++s) {
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+            total += atomicLoad(&m_shards[s].buckets[i]);
+        }
+    }
+    return total;
+}
+
+void LatencyHistogram::reset()
+{
+    for (size_t s = 0; s <= m_shardMask; ++s) {
+        Shard& shard = m_shards[s];
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+            atomicStore(&shard.buckets[i], 0);
+        }
+        atomicStore(&shard.sum, 0);
+        atomicStore(&shard.max, 0);
+    }
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t value)
+{
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    size_t exponent = static_cast<size_t>(highestBit(value));
+    if (exponent > HISTOGRAM_MAX_EXPONENT) {
+        return HISTOGRAM_BUCKETS - 1;
+    }
+    size_t sub = static_cast<size_t>(value >> (exponent - HISTOGRAM_SUB_BUCKET_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1);
+    return HISTOGRAM_SUB_BUCKETS * (exponent - HISTOGRAM_SUB_BUCKET_BITS + 1) + sub;
+}
+
+uint64_t LatencyHistogram::bucketLowerBound(size_t index)
+{
+    if (index < HISTOGRAM_SUB_BUCKETS) {
+        return index;
+    }
+    size_t exponent = index / HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKET_BITS - 1;
+    size_t sub = index % HISTOGRAM_SUB_BUCKETS;
+    return static_cast<uint64_t>(HISTOGRAM_SUB_BUCKETS + sub) << (exponent - HISTOGRAM_SUB_BUCKET_BITS);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index)
+{
+    if (index < HISTOGRAM_SUB_BUCKETS) {
+        return index;
+    }
+    if (index >= HISTOGRAM_BUCKETS - 1) {
+        return ~static_cast<uint64_t>(0);
+    }
+    return bucketLowerBound(index + 1) - 1;
+}
+
+MetricsRegistry& MetricsRegistry::getInstance()
+{
+    static MetricsRegistry instance;
+    return instance;
+}
+
+MetricsRegistry::MetricsRegistry()
+{
+}
+
+MetricsRegistry::~MetricsRegistry()
+{
+    for (std::map<std::string, Family>::iterator it = m_families.begin(); it != m_families.end(); ++it) {
+        for (size_t i = 0; i < it->second.entries.size(); ++i) {
+            delete it->second.entries[i].counter;
+            delete it->second.entries[i].gauge;
+            delete it->second.entries[i].histogram;
+        }
+    }
+}
+
+MetricCounter& MetricsRegistry::counter(const std::string& name, const std::string& help, const MetricLabels& labels)
+{
+    Entry entry;
+    return findOrCreate(name, help, METRIC_COUNTER, labels, entry) ? *entry.counter : m_invalid;
+}
+
+MetricGauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const MetricLabels& labels)
+{
+    Entry entry;
+    return findOrCreate(name, help, METRIC_GAUGE, labels, entry) ? *entry.gauge : m_invalidGauge;
+}
+
+LatencyHistogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                             const MetricLabels& labels)
+{
+    Entry entry;
+    return findOrCreate(name, help, METRIC_HISTOGRAM, labels, entry) ? *entry.histogram : m_invalidHistogram;
+}
+
+size_t MetricsRegistry::getMetricCount() const
+{
+    ScopedLock lock(m_mutex);
+    size_t count = 0;
+    for (std::map<std::string, Family>::const_iterator it = m_families.begin(); it != m_families.end(); ++it) {
+        count += it->second.entries.size();
+    }
+    return count;
+}
+
+std::string MetricsRegistry::exportPrometheus() const
+{
+    ScopedLock lock(m_mutex);
+    std::ostringstream out;
+    for (std::map<std::string, Family>::const_iterator it = m_families.begin(); it != m_families.end(); ++it) {
+        const std::string& name = it->first;
+        const Family& family = it->second;
+        out << "# HELP " << name << " " << family.help << "\n";
+        out << "# TYPE " << name << " " << kindName(family.kind) << "\n";
+        for (size_t i = 0; i < family.entries.size(); ++i) {
+            const Entry& entry = family.entries[i];
+            if (family.kind == METRIC_COUNTER) {
+                out << name << entry.labels << " " << entry.counter->get() << "\n";
+                continue;
+            }
+            if (family.kind == METRIC_GAUGE) {
+                out << name << entry.labels << " " << entry.gauge->get() << "\n";
+                continue;
+            }
+            HistogramSnapshot snapshot = entry.histogram->snapshot();
+            std::string inner = entry.labels.empty() ? "" : entry.labels.substr(1, entry.labels.size() - 2);
+            std::string prefix = inner.empty() ? "{" : "{" + inner + ",";
+            size_t last = 0;
+            for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+                if (snapshot.buckets[b] > 0) {
+                    last = b;
+                }
+            }
+            uint64_t cumulative = 0;
+            for (size_t b = 0; b < HISTOGRAM_BUCKETS - 1 && b <= last; ++b) {
+                cumulative += snapshot.buckets[b];
+                if (b % HISTOGRAM_SUB_BUCKETS == HISTOGRAM_SUB_BUCKETS - 1 || b == last) {
+                    out << name << "_bucket" << prefix << "le=\"" << LatencyHistogram::bucketUpperBound(b)
+                        << "\"} " << cumulative << "\n";
+                }
+            }
+            out << name << "_bucket" << prefix << "le=\"+Inf\"} " << snapshot.count << "\n";
+            out << name << "_sum" << entry.labels << " " << snapshot.sum << "\n";
+            out << name << "_count" << entry.labels << " " << snapshot.count << "\n";
+        }
+    }
+    return out.str();
+}
+
+bool MetricsRegistry::writePrometheusFile(const std::string& path) const
+{
+    std::string text = exportPrometheus();
+    std::string temporary = path + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+        Logger::getInstance().warning("Cannot open metrics file: " + temporary);
+        return false;
+    }
+    bool written = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    written = std::fclose(file) == 0 && written;
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        Logger::getInstance().warning("Cannot write metrics file: " + path);
+        return false;
+    }
+    return true;
+}
+
+bool MetricsRegistry::writePrometheusSocket(const std::string& socketPath) const
+{
+#ifdef _WIN32
+    Logger::getInstance().warning("Metrics socket export is not supported on this platform");
+    return false;
+#else
+    struct sockaddr_un address;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        Logger::getInstance().warning("Metrics socket path too long: " + socketPath);
+        return false;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        Logger::getInstance().warning("Cannot connect to metrics socket: " + socketPath);
+        return false;
+    }
+    std::string text = exportPrometheus();
+    size_t offset = 0;
+    while (offset < text.size()) {
+        ssize_t sent = write(fd, text.data() + offset, text.size() - offset);
+        if (sent <= 0) {
+            close(fd);
+            return false;
+        }
+        offset += static_cast<size_t>(sent);
+    }
+    close(fd);
+    return true;
+#endif
+}
+
+void MetricsRegistry::reset()
+{
+    ScopedLock lock(m_mutex);
+    for (std::map<std::string, Family>::iterator it = m_families.begin(); it != m_families.end(); ++it) {
+        for (size_t i = 0; i < it->second.entries.size(); ++i) {
+            Entry& entry = it->second.entries[i];
+            if (entry.counter) {
+                entry.counter->reset();
+            }
+            if (entry.gauge) {
+                entry.gauge->set(0);
+            }
+            if (entry.histogram) {
+                entry.histogram->reset();
+            }
+        }
+    }
+}
+
+std::string MetricsRegistry::deviceTypeLabel(DeviceType type)
+{
+    switch (type) {
+        case DEVICE_LIGHT:          return "light";
+        case DEVICE_CAMERA:         return "camera";
+        case DEVICE_SMOKE_DETECTOR: return "smoke";
+        case DEVICE_GAS_DETECTOR:   return "gas";
+        case DEVICE_TV:             return "tv";
+        case DEVICE_ALARM:          return "alarm";
+        case DEVICE_SOUND_SYSTEM:   return "sound";
+    }
+    return "unknown";
+}
+
+bool MetricsRegistry::findOrCreate(const std::string& name, const std::string& help, MetricKind kind,
+                                   const MetricLabels& labels, Entry& result)
+{
+    std::string key = labels.toString();
+    {
+        ScopedLock lock(m_mutex);
+        std::map<std::string, Family>::iterator it = m_families.find(name);
+        if (it == m_families.end()) {
+            Family family;
+            family.kind = kind;
+            family.help = help;
+            it = m_families.insert(std::make_pair(name, family)).first;
+        }
+        Family& family = it->second;
+        if (family.kind == kind) {
+            for (size_t i = 0; i < family.entries.size(); ++i) {
+                if (family.entries[i].labels == key) {
+                    result = family.entries[i];
+                    return true;
+                }
+            }
+            Entry entry;
+            entry.labels = key;
+            entry.counter = kind == METRIC_COUNTER ? new MetricCounter() : 0;
+            entry.gauge = kind == METRIC_GAUGE ? new MetricGauge() : 0;
+            entry.histogram = kind == METRIC_HISTOGRAM ? new LatencyHistogram() : 0;
+            family.entries.push_back(entry);
+            result = entry;
+            return true;
+        }
+    }
+    Logger::getInstance().warning("Metric registered with conflicting type: " + name);
+    return false;
+}
+
+ScopedLatency::ScopedLatency(LatencyHistogram& histogram)
+    : m_histogram(histogram)
+    , m_start(monotonicMicros())
+{
+}
+
+ScopedLatency::~ScopedLatency()
+{
+    m_histogram.record(monotonicMicros() - m_start);
+}
+
+}
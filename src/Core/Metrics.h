@@ -0,0 +1,161 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include "common_types.h"
+#include "Mutex.h"
+
+namespace MySweetHome {
+const size_t METRIC_SHARDS = 16;
+const size_t HISTOGRAM_SUB_BUCKET_BITS = 2;
+const size_t HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BUCKET_BITS;
+const size_t HISTOGRAM_MAX_EXPONENT = 40;
+const size_t HISTOGRAM_BUCKETS = HISTOGRAM_SUB_BUCKETS * (HISTOGRAM_MAX_EXPONENT - HISTOGRAM_SUB_BUCKET_BITS + 2);
+enum MetricKind {
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM
+};
+class MetricLabels {
+public:
+    MetricLabels();
+    MetricLabels(const std::string& key, const std::string& value);
+    MetricLabels& add(const std::string& key, const std::string& value);
+    bool empty() const;
+    std::string toString() const;
+    std::string toStringWith(const std::string& key, const std::string& value) const;
+
+private:
+    std::vector<std::pair<std::string, std::string> > m_labels;
+};
+class MetricCounter {
+public:
+    MetricCounter();
+    ~MetricCounter();
+    void increment();
+    void add(uint64_t delta);
+    uint64_t get() const;
+    void reset();
+
+private:
+    MetricCounter(const MetricCounter&);
+    MetricCounter& operator=(const MetricCounter&);
+
+    struct Shard {
+        volatile uint64_t value;
+        char padding[64 - sizeof(uint64_t)];
+    };
+
+    Shard* m_shards;
+};
+class MetricGauge {
+public:
+    MetricGauge();
+    ~MetricGauge();
+    void set(int64_t value);
+    void add(int64_t delta);
+    int64_t get() const;
+
+private:
+    MetricGauge(const MetricGauge&);
+    MetricGauge& operator=(const MetricGauge&);
+
+    volatile int64_t m_value;
+};
+struct HistogramSnapshot {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    std::vector<uint64_t> buckets;
+
+    HistogramSnapshot();
+    double mean() const;
+    uint64_t percentile(double fraction) const;
+    void merge(const HistogramSnapshot& other);
+};
+class LatencyHistogram {
+public:
+    explicit LatencyHistogram(size_t shards = METRIC_SHARDS);
+    ~LatencyHistogram();
+    void record(uint64_t value);
+    HistogramSnapshot snapshot() const;
+    uint64_t getCount() const;
+    void reset();
+    static size_t bucketIndex(uint64_t value);
+    static uint64_t bucketLowerBound(size_t index);
+    static uint64_t bucketUpperBound(size_t index);
+
+private:
+    LatencyHistogram(const LatencyHistogram&);
+    LatencyHistogram& operator=(const LatencyHistogram&);
+
+    struct Shard {
+        volatile uint64_t buckets[HISTOGRAM_BUCKETS];
+        volatile uint64_t sum;
+        volatile uint64_t max;
+        char padding[64 - 2 * sizeof(uint64_t)];
+    };
+
+    Shard* m_shards;
+    size_t m_shardMask;
+};
+class MetricsRegistry {
+public:
+    static MetricsRegistry& getInstance();
+    MetricCounter& counter(const std::string& name, const std::string& help,
+                           const MetricLabels& labels = MetricLabels());
+    MetricGauge& gauge(const std::string& name, const std::string& help,
+                       const MetricLabels& labels = MetricLabels());
+    LatencyHistogram& histogram(const std::string& name, const std::string& help,
+                                const MetricLabels& labels = MetricLabels());
+    size_t getMetricCount() const;
+    std::string exportPrometheus() const;
+    bool writePrometheusFile(const std::string& path) const;
+    bool writePrometheusSocket(const std::string& socketPath) const;
+    void reset();
+    static std::string deviceTypeLabel(DeviceType type);
+
+private:
+    struct Entry {
+        std::string labels;
+        MetricCounter* counter;
+        MetricGauge* gauge;
+        LatencyHistogram* histogram;
+    };
+    struct Family {
+        MetricKind kind;
+        std::string help;
+        std::vector<Entry> entries;
+    };
+
+    MetricsRegistry();
+    ~MetricsRegistry();
+    MetricsRegistry(const MetricsRegistry&);
+    MetricsRegistry& operator=(const MetricsRegistry&);
+    bool findOrCreate(const std::string& name, const std::string& help, MetricKind kind,
+                      const MetricLabels& labels, Entry& result);
+
+    std::map<std::string, Family> m_families;
+    mutable Mutex m_mutex;
+    MetricCounter m_invalid;
+    MetricGauge m_invalidGauge;
+    LatencyHistogram m_invalidHistogram;
+};
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram& histogram);
+    ~ScopedLatency();
+
+private:
+    ScopedLatency(const ScopedLatency&);
+    ScopedLatency& operator=(const ScopedLatency&);
+
+    LatencyHistogram& m_histogram;
+    uint64_t m_start;
+};
+
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include "MonotonicTime.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace MySweetHome {
+uint64_t monotonicMicros()
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return static_cast<uint64_t>(counter.QuadPart) * 1000000ULL /
+           static_cast<uint64_t>(frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000ULL +
+           static_cast<uint64_t>(ts.tv_nsec / 1000);
+#endif
+}
+
+uint64_t monotonicNanos()
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return static_cast<uint64_t>(counter.QuadPart / frequency.QuadPart) * 1000000000ULL +
+           static_cast<uint64_t>(counter.QuadPart % frequency.QuadPart) * 1000000000ULL /
+           static_cast<uint64_t>(frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+uint64_t monotonicMillis()
+{
+    return monotonicMicros() / 1000ULL;
+}
+
+void sleepMicros(uint64_t micros)
+{
+    if (micros == 0) {
+        return;
+    }
+#ifdef _WIN32
+    Sleep(static_cast<DWORD>((micros + 999) / 1000));
+#else
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(micros / 1000000ULL);
+    ts.tv_nsec = static_cast<long>((micros % 1000000ULL) * 1000ULL);
+    nanosleep(&ts, 0);
+#endif
+}
+
+}
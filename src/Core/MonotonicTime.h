@@ -0,0 +1,14 @@
+#ifndef MONOTONIC_TIME_H
+#define MONOTONIC_TIME_H
+
+#include "common_types.h"
+
+namespace MySweetHome {
+uint64_t monotonicMillis();
+uint64_t monotonicMicros();
+uint64_t monotonicNanos();
+void sleepMicros(uint64_t micros);
+
+}
+
+#endif
@@ -0,0 +1,93 @@
+#include "Mutex.h"
+
+namespace MySweetHome {
+Mutex::Mutex()
+{
+#ifdef _WIN32
+    InitializeCriticalSection(&m_handle);
+#else
+    pthread_mutex_init(&m_handle, 0);
+#endif
+}
+
+Mutex::~Mutex()
+{
+#ifdef _WIN32
+    DeleteCriticalSection(&m_handle);
+#else
+    pthread_mutex_destroy(&m_handle);
+#endif
+}
+
+void Mutex::lock()
+{
+#ifdef _WIN32
+    EnterCriticalSection(&m_handle);
+#else
+    pthread_mutex_lock(&m_handle);
+#endif
+}
+
+void Mutex::unlock()
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&m_handle);
+#else
+    pthread_mutex_unlock(&m_handle);
+#endif
+}
+ScopedLock::ScopedLock(Mutex& mutex)
+    : m_mutex(mutex)
+{
+    m_mutex.lock();
+}
+
+ScopedLock::~ScopedLock()
+{
+    m_mutex.unlock();
+}
+
+Condition::Condition()
+{
+#ifdef _WIN32
+    InitializeConditionVariable(&m_handle);
+#else
+    pthread_cond_init(&m_handle, 0);
+#endif
+}
+
+Condition::~Condition()
+{
+#ifndef _WIN32
+    pthread_cond_destroy(&m_handle);
+#endif
+}
+
+void Condition::wait(Mutex& mutex)
+{
+#ifdef _WIN32
+    SleepConditionVariableCS(&m_handle, &mutex.m_handle, INFINITE);
+#else
+    pthread_cond_wait(&m_handle, &mutex.m_handle);
+#endif
+}
+
+void Condition::signal()
+{
+#ifdef _WIN32
+    WakeConditionVariable(&m_handle);
+#else
+    pthread_cond_signal(&m_handle);
+#endif
+}
+
+void Condition::broadcast()
+{
+#ifdef _WIN32
+    WakeAllConditionVariable(&m_handle);
+#else
+    pthread_cond_broadcast(&m_handle);
+#endif
+}
+
+}
@@ -0,0 +1,61 @@
+#ifndef MUTEX_H
+#define MUTEX_H
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+namespace MySweetHome {
+class Mutex {
+public:
+    Mutex();
+    ~Mutex();
+    void lock();
+    void unlock();
+
+private:
+    Mutex(const Mutex&);
+    Mutex& operator=(const Mutex&);
+    friend class Condition;
+
+#ifdef _WIN32
+    CRITICAL_SECTION m_handle;
+#else
+    pthread_mutex_t m_handle;
+#endif
+};
+class ScopedLock {
+public:
+    explicit ScopedLock(Mutex& mutex);
+    ~ScopedLock();
+
+private:
+    ScopedLock(const ScopedLock&);
+    ScopedLock& operator=(const ScopedLock&);
+
+    Mutex& m_mutex;
+};
+class Condition {
+public:
+    Condition();
+    ~Condition();
+    void wait(Mutex& mutex);
+    void signal();
+    void broadcast();
+
+private:
+    Condition(const Condition&);
+    Condition& operator=(const Condition&);
+
+#ifdef _WIN32
+    CONDITION_VARIABLE m_handle;
+#else
+    pthread_cond_t m_handle;
+#endif
+};
+
+}
+
+#endif
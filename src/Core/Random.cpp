@@ -0,0 +1,78 @@
+#include "Random.h"
+#include <cmath>
+
+namespace MySweetHome {
+Random::Random(uint64_t seedValue)
+    : m_seed(0)
+    , m_state(0)
+{
+    seed(seedValue);
+}
+
+Random::~Random()
+{
+}
+
+void Random::seed(uint64_t seedValue)
+{
+    m_seed = seedValue;
+    m_state = seedValue;
+}
+
+uint64_t Random::getSeed() const
+{
+    return m_seed;
+}
+
+uint64_t Random::nextUInt64()
+{
+    m_state += 0x9E3779B97F4A7C15ULL;
+    uint64_t z = m_state;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+uint32_t Random::nextUInt()
+{
+    return static_cast<uint32_t>(nextUInt64() >> 32);
+}
+
+int Random::nextInt(int minValue, int maxValue)
+{
+    if (maxValue <= minValue) {
+        return minValue;
+    }
+    uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(maxValue) - minValue) + 1;
+    return minValue + static_cast<int>(nextUInt64() % range);
+}
+
+double Random::nextDouble()
+{
+    return static_cast<double>(nextUInt64() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+float Random::nextFloat()
+{
+    return static_cast<float>(nextDouble());
+}
+
+double Random::nextGaussian()
+{
+    double u1 = nextDouble();
+    double u2 = nextDouble();
+    if (u1 < 1e-300) {
+        u1 = 1e-300;
+    }
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+}
+
+bool Random::nextBool(double probability)
+{
+    if (probability <= 0.0) {
+        return false;
+    }
+    return nextDouble() < probability;
+}
+
+}
@@ -0,0 +1,28 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include "common_types.h"
+
+namespace MySweetHome {
+class Random {
+public:
+    explicit Random(uint64_t seed = 0x9E3779B97F4A7C15ULL);
+    ~Random();
+    void seed(uint64_t seed);
+    uint64_t getSeed() const;
+    uint32_t nextUInt();
+    uint64_t nextUInt64();
+    int nextInt(int minValue, int maxValue);
+    double nextDouble();
+    float nextFloat();
+    double nextGaussian();
+    bool nextBool(double probability);
+
+private:
+    uint64_t m_seed;
+    uint64_t m_state;
+};
+
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef RESOURCE_USAGE_H
+#define RESOURCE_USAGE_H
+
+#include "common_types.h"
+
+namespace MySweetHome {
+class ResourceUsage {
+public:
+    static uint64_t currentRssBytes();
+    static uint64_t peakRssBytes();
+    static uint64_t processCpuMicros();
+    static uint64_t threadCpuMicros();
+
+private:
+    ResourceUsage();
+};
+
+}
+
+#endif
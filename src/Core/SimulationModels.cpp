@@ -0,0 +1,175 @@
+#include "SimulationModels.h"
+#include <cmath>
+#include <sstream>
+
+namespace MySweetHome {
+LatencyModel::LatencyModel()
+    : m_distribution(LATENCY_FIXED)
+    , m_a(0.0)
+    , m_b(0.0)
+    , m_sigma(0.0)
+    , m_tailProbability(0.0)
+{
+}
+
+LatencyModel::~LatencyModel()
+{
+}
+
+LatencyModel LatencyModel::fixed(double milliseconds)
+{
+    LatencyModel model;
+    model.m_distribution = LATENCY_FIXED;
+    model.m_a = milliseconds > 0.0 ? milliseconds : 0.0;
+    return model;
+}
+
+LatencyModel LatencyModel::uniform(double minMs, double maxMs)
+{
+    LatencyModel model;
+    model.m_distribution = LATENCY_UNIFORM;
+    model.m_a = minMs > 0.0 ? minMs : 0.0;
+    model.m_b = maxMs > model.m_a ? maxMs : model.m_a;
+    return model;
+}
+
+LatencyModel LatencyModel::logNormal(double medianMs, double sigma)
+{
+    LatencyModel model;
+    model.m_distribution = LATENCY_LOG_NORMAL;
+    model.m_a = medianMs > 0.0 ? medianMs : 0.0;
+    model.m_sigma = sigma > 0.0 ? sigma : 0.0;
+    return model;
+}
+
+LatencyModel LatencyModel::bimodal(double fastMedianMs, double slowMedianMs,
+                                   double slowProbability, double sigma)
+{
+    LatencyModel model;
+    model.m_distribution = LATENCY_BIMODAL;
+    model.m_a = fastMedianMs > 0.0 ? fastMedianMs : 0.0;
+    model.m_b = slowMedianMs > model.m_a ? slowMedianMs : model.m_a;
+    model.m_sigma = sigma > 0.0 ? sigma : 0.0;
+    if (slowProbability < 0.0) slowProbability = 0.0;
+    if (slowProbability > 1.0) slowProbability = 1.0;
+    model.m_tailProbability = slowProbability;
+    return model;
+}
+
+double LatencyModel::sampleMillis(Random& random) const
+{
+    switch (m_distribution) {
+        case LATENCY_FIXED:
+            return m_a;
+        case LATENCY_UNIFORM:
+            return m_a + (m_b - m_a) * random.nextDouble();
+        case LATENCY_LOG_NORMAL:
+            return m_a * std::exp(m_sigma * random.nextGaussian());
+        case LATENCY_BIMODAL: {
+            double median = random.nextBool(m_tailProbability) ? m_b : m_a;
+            return median * std::exp(m_sigma * random.nextGaussian());
+        }
+    }
+    return m_a;
+}
+
+LatencyDistribution LatencyModel::getDistribution() const
+{
+    return m_distribution;
+}
+
+double LatencyModel::getNominalMillis() const
+{
+    if (m_distribution == LATENCY_UNIFORM) {
+        return (m_a + m_b) / 2.0;
+    }
+    return m_a;
+}
+
+std::string LatencyModel::describe() const
+{
+    std::ostringstream oss;
+    switch (m_distribution) {
+        case LATENCY_FIXED:
+            oss << m_a << "ms";
+            break;
+        case LATENCY_UNIFORM:
+            oss << "uniform " << m_a << "-" << m_b << "ms";
+            break;
+        case LATENCY_LOG_NORMAL:
+            oss << "lognormal median " << m_a << "ms sigma " << m_sigma;
+            break;
+        case LATENCY_BIMODAL:
+            oss << "bimodal " << m_a << "ms/" << m_b << "ms tail "
+                << (m_tailProbability * 100.0) << "%";
+            break;
+    }
+    return oss.str();
+}
+FailureBurstModel::FailureBurstModel()
+    : m_baseRate(0.0)
+    , m_enterProbability(0.0)
+    , m_exitProbability(1.0)
+    , m_burstRate(0.0)
+    , m_inBurst(false)
+{
+}
+
+FailureBurstModel::~FailureBurstModel()
+{
+}
+
+void FailureBurstModel::setBaseFailureRate(double rate)
+{
+    if (rate >= 0.0 && rate <= 1.0) {
+        m_baseRate = rate;
+    }
+}
+
+double FailureBurstModel::getBaseFailureRate() const
+{
+    return m_baseRate;
+}
+
+void FailureBurstModel::setBurst(double enterProbability, double exitProbability,
+                                 double burstFailureRate)
+{
+    if (enterProbability < 0.0 || enterProbability > 1.0 ||
+        exitProbability <= 0.0 || exitProbability > 1.0 ||
+        burstFailureRate < 0.0 || burstFailureRate > 1.0) {
+        return;
+    }
+    m_enterProbability = enterProbability;
+    m_exitProbability = exitProbability;
+    m_burstRate = burstFailureRate;
+}
+
+void FailureBurstModel::disableBursts()
+{
+    m_enterProbability = 0.0;
+    m_inBurst = false;
+}
+
+bool FailureBurstModel::isInBurst() const
+{
+    return m_inBurst;
+}
+
+bool FailureBurstModel::nextFailure(Random& random)
+{
+    if (m_inBurst) {
+        if (random.nextBool(m_exitProbability)) {
+            m_inBurst = false;
+        }
+    } else if (random.nextBool(m_enterProbability)) {
+        m_inBurst = true;
+    }
+    return random.nextBool(m_inBurst ? m_burstRate : m_baseRate);
+}
+
+void FailureBurstModel::reset()
+{
+    m_inBurst = false;
+}
+
+}
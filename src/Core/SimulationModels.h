@@ -0,0 +1,58 @@
+#ifndef SIMULATION_MODELS_H
+#define SIMULATION_MODELS_H
+
+#include <string>
+#include "common_types.h"
+#include "Random.h"
+
+namespace MySweetHome {
+enum LatencyDistribution {
+    LATENCY_FIXED,
+    LATENCY_UNIFORM,
+    LATENCY_LOG_NORMAL,
+    LATENCY_BIMODAL
+};
+class LatencyModel {
+public:
+    LatencyModel();
+    ~LatencyModel();
+    static LatencyModel fixed(double milliseconds);
+    static LatencyModel uniform(double minMs, double maxMs);
+    static LatencyModel logNormal(double medianMs, double sigma);
+    static LatencyModel bimodal(double fastMedianMs, double slowMedianMs,
+                                double slowProbability, double sigma = 0.25);
+    double sampleMillis(Random& random) const;
+    LatencyDistribution getDistribution() const;
+    double getNominalMillis() const;
+    std::string describe() const;
+
+private:
+    LatencyDistribution m_distribution;
+    double m_a;
+    double m_b;
+    double m_sigma;
+    double m_tailProbability;
+};
+class FailureBurstModel {
+public:
+    FailureBurstModel();
+    ~FailureBurstModel();
+    void setBaseFailureRate(double rate);
+    double getBaseFailureRate() const;
+    void setBurst(double enterProbability, double exitProbability, double burstFailureRate);
+    void disableBursts();
+    bool isInBurst() const;
+    bool nextFailure(Random& random);
+    void reset();
+
+private:
+    double m_baseRate;
+    double m_enterProbability;
+    double m_exitProbability;
+    double m_burstRate;
+    bool m_inBurst;
+};
+
+}
+
+#endif
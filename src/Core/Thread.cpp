@@ -0,0 +1,62 @@
+#include "Thread.h"
+
+namespace MySweetHome {
+Thread::Thread(IRunnable* runnable)
+    : m_runnable(runnable)
+    , m_started(false)
+{
+}
+
+Thread::~Thread()
+{
+    join();
+}
+
+bool Thread::start()
+{
+    if (m_started || !m_runnable) {
+        return false;
+    }
+#ifdef _WIN32
+    m_handle = CreateThread(0, 0, &Thread::entryPoint, this, 0, 0);
+    m_started = (m_handle != 0);
+#else
+    m_started = (pthread_create(&m_handle, 0, &Thread::entryPoint, this) == 0);
+#endif
+    return m_started;
+}
+
+void Thread::join()
+{
+    if (!m_started) {
+        return;
+    }
+#ifdef _WIN32
+    WaitForSingleObject(m_handle, INFINITE);
+    CloseHandle(m_handle);
+#else
+    pthread_join(m_handle, 0);
+#endif
+    m_started = false;
+}
+
+bool Thread::isStarted() const
+{
+    return m_started;
+}
+
+#ifdef _WIN32
+DWORD WINAPI Thread::entryPoint(LPVOID arg)
+{
+    static_cast<Thread*>(arg)->m_runnable->run();
+    return 0;
+}
+#else
+void* Thread::entryPoint(void* arg)
+{
+    static_cast<Thread*>(arg)->m_runnable->run();
+    return 0;
+}
+#endif
+
+}
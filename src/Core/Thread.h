@@ -0,0 +1,41 @@
+#ifndef THREAD_H
+#define THREAD_H
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+namespace MySweetHome {
+class IRunnable {
+public:
+    virtual ~IRunnable() {}
+    virtual void run() = 0;
+};
+class Thread {
+public:
+    Thread(IRunnable* runnable);
+    ~Thread();
+    bool start();
+    void join();
+    bool isStarted() const;
+
+private:
+    Thread(const Thread&);
+    Thread& operator=(const Thread&);
+
+    IRunnable* m_runnable;
+    bool m_started;
+#ifdef _WIN32
+    HANDLE m_handle;
+    static DWORD WINAPI entryPoint(LPVOID arg);
+#else
+    pthread_t m_handle;
+    static void* entryPoint(void* arg);
+#endif
+};
+
+}
+
+#endif
@@ -0,0 +1,321 @@
+#include "Tracer.h"
+#include "MonotonicTime.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <iomanip>
+
+#ifdef _WIN32
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACE_THREAD_LOCAL __thread
+#endif
+
+namespace MySweetHome {
+namespace {
+const size_t DEFAULT_TRACE_CAPACITY = 65536;
+volatile int s_tracingEnabled = 0;
+volatile uint32_t s_sampleInterval = 1;
+TRACE_THREAD_LOCAL TraceBuffer* t_traceBuffer = 0;
+
+bool earlierFirst(const TraceEvent& a, const TraceEvent& b)
+{
+    if (a.startNanos != b.startNanos) {
+        return a.startNanos < b.startNanos;
+    }
+    return a.depth < b.depth;
+}
+
+std::string escapeJson(const char* text)
+{
+    std::string escaped;
+    for (const char* c = text; c && *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            escaped += '\\';
+        }
+        escaped += *c;
+    }
+    return escaped;
+}
+
+}
+
+TraceBuffer::TraceBuffer(uint32_t threadId, size_t capacity)
+    : depth(0)
+    , sampled(false)
+    , roots(0)
+    , m_threadId(threadId)
+    , m_capacity(capacity)
+    , m_dropped(0)
+{
+}
+
+TraceBuffer::~TraceBuffer()
+{
+}
+
+void TraceBuffer::append(const TraceEvent& event)
+{
+    ScopedLock lock(m_mutex);
+    if (m_events.size() >= m_capacity) {
+        ++m_dropped;
+        return;
+    }
+    m_events.push_back(event);
+}
+
+void TraceBuffer::collect(std::vector<TraceEvent>& events) const
+{
+    ScopedLock lock(m_mutex);
+    events.insert(events.end(), m_events.begin(), m_events.end());
+}
+
+void TraceBuffer::clear()
+{
+    ScopedLock lock(m_mutex);
+    m_events.clear();
+    m_dropped = 0;
+}
+
+void TraceBuffer::setCapacity(size_t capacity)
+{
+    ScopedLock lock(m_mutex);
+    m_capacity = capacity;
+}
+
+uint64_t TraceBuffer::getDropped() const
+{
+    ScopedLock lock(m_mutex);
+    return m_dropped;
+}
+
+uint32_t TraceBuffer::getThreadId() const
+{
+    return m_threadId;
+}
+
+Tracer& Tracer::getInstance()
+{
+    static Tracer instance;
+    return instance;
+}
+
+Tracer::Tracer()
+    : m_capacity(DEFAULT_TRACE_CAPACITY)
+    , m_epochNanos(monotonicNanos())
+{
+}
+
+Tracer::~Tracer()
+{
+    s_tracingEnabled = 0;
+    for (size_t i = 0; i < m_buffers.size(); ++i) {
+        delete m_buffers[i];
+    }
+}
+
+bool Tracer::isEnabled()
+{
+    return s_tracingEnabled != 0;
+}
+
+void Tracer::enable(bool enabled)
+{
+    s_tracingEnabled = enabled ? 1 : 0;
+}
+
+void Tracer::setSampleInterval(uint32_t interval)
+{
+    s_sampleInterval = interval;
+}
+
+void Tracer::setSampleRate(double rate)
+{
+    if (rate >= 1.0) {
+        setSampleInterval(1);
+    } else if (rate <= 0.0) {
+        setSampleInterval(0);
+    } else {
+        setSampleInterval(static_cast<uint32_t>(1.0 / rate + 0.5));
+    }
+}
+
+uint32_t Tracer::getSampleInterval() const
+{
+    return s_sampleInterval;
+}
+
+void Tracer::setBufferCapacity(size_t events)
+{
+    ScopedLock lock(m_mutex);
+    m_capacity = events;
+    for (size_t i = 0; i < m_buffers.size(); ++i) {
+        m_buffers[i]->setCapacity(events);
+    }
+}
+
+size_t Tracer::getEventCount() const
+{
+    return getEvents().size();
+}
+
+uint64_t Tracer::getDroppedCount() const
+{
+    ScopedLock lock(m_mutex);
+    uint64_t dropped = 0;
+    for (size_t i = 0; i < m_buffers.size(); ++i) {
+        dropped += m_buffers[i]->getDropped();
+    }
+    return dropped;
+}
+
+std::vector<TraceEvent> Tracer::getEvents() const
+{
+    std::vector<TraceEvent> events;
+    ScopedLock lock(m_mutex);
+    for (size_t i = 0; i < m_buffers.size(); ++i) {
+        m_buffers[i]->collect(events);
+    }
+    std::sort(events.begin(), events.end(), earlierFirst);
+    return events;
+}
+
+std::string Tracer::exportChromeJson() const
+{
+    std::vector<TraceEvent> events = getEvents();
+    std::vector<uint32_t> threads;
+    {
+        ScopedLock lock(m_mutex);
+        for (size_t i = 0; i < m_buffers.size(); ++i) {
+            threads.push_back(m_buffers[i]->getThreadId());
+        }
+    }
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (size_t i = 0; i < threads.size(); ++i) {
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threads[i]
+            << ",\"args\":{\"name\":\"thread-" << threads[i] << "\"}}";
+        first = false;
+    }
+    for (size_t i = 0; i < events.size(); ++i) {
+        const TraceEvent& event = events[i];
+        uint64_t start = event.startNanos >= m_epochNanos ? event.startNanos - m_epochNanos : 0;
+        out << (first ? "" : ",") << "\n{\"name\":\"" << escapeJson(event.name)
+            << "\",\"cat\":\"" << escapeJson(event.category)
+            << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.threadId
+            << ",\"ts\":" << start / 1000.0
+            << ",\"dur\":" << event.durationNanos / 1000.0
+            << ",\"args\":{\"depth\":" << event.depth;
+        if (event.id != 0) {
+            out << ",\"id\":" << event.id;
+        }
+        out << "}}";
+        first = false;
+    }
+    out << "\n]}\n";
+    return out.str();
+}
+
+bool Tracer::writeChromeJson(const std::string& path) const
+{
+    std::string json = exportChromeJson();
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        Logger::getInstance().warning("Cannot open trace file: " + path);
+        return false;
+    }
+    bool written = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+    written = std::fclose(file) == 0 && written;
+    if (!written) {
+        Logger::getInstance().warning("Cannot write trace file: " + path);
+    }
+    return written;
+}
+
+void Tracer::clear()
+{
+    ScopedLock lock(m_mutex);
+    for (size_t i = 0; i < m_buffers.size(); ++i) {
+        m_buffers[i]->clear();
+    }
+}
+
+bool Tracer::configureFromEnvironment()
+{
+    const char* path = std::getenv("MSH_TRACE");
+    if (!path || !*path) {
+        return false;
+    }
+    m_outputPath = path;
+    const char* rate = std::getenv("MSH_TRACE_RATE");
+    if (rate && *rate) {
+        setSampleRate(std::atof(rate));
+    }
+    enable(true);
+    Logger::getInstance().info("Tracing enabled, output: " + m_outputPath);
+    return true;
+}
+
+const std::string& Tracer::getOutputPath() const
+{
+    return m_outputPath;
+}
+
+TraceBuffer* Tracer::currentBuffer()
+{
+    if (!t_traceBuffer) {
+        ScopedLock lock(m_mutex);
+        t_traceBuffer = new TraceBuffer(static_cast<uint32_t>(m_buffers.size() + 1), m_capacity);
+        m_buffers.push_back(t_traceBuffer);
+    }
+    return t_traceBuffer;
+}
+
+TraceSpan::TraceSpan(const char* name, const char* category, uint32_t id)
+    : m_name(name)
+    , m_category(category)
+    , m_id(id)
+    , m_buffer(0)
+    , m_recording(false)
+    , m_start(0)
+{
+    if (!s_tracingEnabled) {
+        return;
+    }
+    m_buffer = Tracer::getInstance().currentBuffer();
+    if (m_buffer->depth == 0) {
+        uint32_t interval = s_sampleInterval;
+        m_buffer->sampled = interval > 0 && m_buffer->roots++ % interval == 0;
+    }
+    ++m_buffer->depth;
+    m_recording = m_buffer->sampled;
+    if (m_recording) {
+        m_start = monotonicNanos();
+    }
+}
+
+TraceSpan::~TraceSpan()
+{
+    if (!m_buffer) {
+        return;
+    }
+    --m_buffer->depth;
+    if (!m_recording) {
+        return;
+    }
+    TraceEvent event;
+    event.name = m_name;
+    event.category = m_category;
+    event.startNanos = m_start;
+    event.durationNanos = monotonicNanos() - m_start;
+    event.threadId = m_buffer->getThreadId();
+    event.depth = m_buffer->depth;
+    event.id = m_id;
+    m_buffer->append(event);
+}
+
+}
@@ -0,0 +1,94 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <string>
+#include <vector>
+#include "common_types.h"
+#include "Mutex.h"
+
+namespace MySweetHome {
+struct TraceEvent {
+    const char* name;
+    const char* category;
+    uint64_t startNanos;
+    uint64_t durationNanos;
+    uint32_t threadId;
+    uint32_t depth;
+    uint32_t id;
+};
+class TraceBuffer {
+public:
+    TraceBuffer(uint32_t threadId, size_t capacity);
+    ~TraceBuffer();
+    void append(const TraceEvent& event);
+    void collect(std::vector<TraceEvent>& events) const;
+    void clear();
+    void setCapacity(size_t capacity);
+    uint64_t getDropped() const;
+    uint32_t getThreadId() const;
+
+    uint32_t depth;
+    bool sampled;
+    uint64_t roots;
+
+private:
+    TraceBuffer(const TraceBuffer&);
+    TraceBuffer& operator=(const TraceBuffer&);
+
+    uint32_t m_threadId;
+    size_t m_capacity;
+    std::vector<TraceEvent> m_events;
+    uint64_t m_dropped;
+    mutable Mutex m_mutex;
+};
+class Tracer {
+public:
+    static Tracer& getInstance();
+    static bool isEnabled();
+    void enable(bool enabled);
+    void setSampleInterval(uint32_t interval);
+    void setSampleRate(double rate);
+    uint32_t getSampleInterval() const;
+    void setBufferCapacity(size_t events);
+    size_t getEventCount() const;
+    uint64_t getDroppedCount() const;
+    std::vector<TraceEvent> getEvents() const;
+    std::string exportChromeJson() const;
+    bool writeChromeJson(const std::string& path) const;
+    void clear();
+    bool configureFromEnvironment();
+    const std::string& getOutputPath() const;
+    TraceBuffer* currentBuffer();
+
+private:
+    Tracer();
+    ~Tracer();
+    Tracer(const Tracer&);
+    Tracer& operator=(const Tracer&);
+
+    std::vector<TraceBuffer*> m_buffers;
+    mutable Mutex m_mutex;
+    size_t m_capacity;
+    uint64_t m_epochNanos;
+    std::string m_outputPath;
+};
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, const char* category = "msh", uint32_t id = 0);
+    ~TraceSpan();
+
+private:
+    TraceSpan(const TraceSpan&);
+    TraceSpan& operator=(const TraceSpan&);
+
+    const char* m_name;
+    const char* m_category;
+    uint32_t m_id;
+    TraceBuffer* m_buffer;
+    bool m_recording;
+    uint64_t m_start;
+};
+
+}
+
+#endif
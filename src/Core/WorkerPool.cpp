@@ -0,0 +1,143 @@
+#include "WorkerPool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace MySweetHome {
+WorkerPool::Worker::Worker(WorkerPool* pool)
+    : m_pool(pool)
+{
+}
+
+void WorkerPool::Worker::run()
+{
+    m_pool->workerLoop();
+}
+
+WorkerPool::WorkerPool(size_t threadCount)
+    : m_worker(this)
+    , m_running(0)
+    , m_completed(0)
+    , m_stopping(false)
+{
+    if (threadCount == 0) {
+        threadCount = hardwareConcurrency();
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        Thread* thread = new Thread(&m_worker);
+        if (!thread->start()) {
+            delete thread;
+            break;
+        }
+        m_threads.push_back(thread);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    shutdown();
+}
+
+bool WorkerPool::submit(IRunnable* task)
+{
+    if (!task) {
+        return false;
+    }
+    if (m_threads.empty()) {
+        task->run();
+        ScopedLock lock(m_mutex);
+        ++m_completed;
+        return true;
+    }
+    ScopedLock lock(m_mutex);
+    if (m_stopping) {
+        return false;
+    }
+    m_tasks.push_back(task);
+    m_taskReady.signal();
+    return true;
+}
+
+void WorkerPool::waitIdle()
+{
+    ScopedLock lock(m_mutex);
+    while (!m_tasks.empty() || m_running > 0) {
+        m_idle.wait(m_mutex);
+    }
+}
+
+void WorkerPool::shutdown()
+{
+    {
+        ScopedLock lock(m_mutex);
+        if (m_stopping) {
+            return;
+        }
+        m_stopping = true;
+        m_taskReady.broadcast();
+    }
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+        m_threads[i]->join();
+        delete m_threads[i];
+    }
+    m_threads.clear();
+}
+
+size_t WorkerPool::getThreadCount() const
+{
+    return m_threads.size();
+}
+
+size_t WorkerPool::getPending() const
+{
+    ScopedLock lock(m_mutex);
+    return m_tasks.size() + m_running;
+}
+
+uint64_t WorkerPool::getCompleted() const
+{
+    ScopedLock lock(m_mutex);
+    return m_completed;
+}
+
+size_t WorkerPool::hardwareConcurrency()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? static_cast<size_t>(count) : 1;
+#endif
+}
+
+void WorkerPool::workerLoop()
+{
+    m_mutex.lock();
+    while (true) {
+        while (m_tasks.empty() && !m_stopping) {
+            m_taskReady.wait(m_mutex);
+        }
+        if (m_tasks.empty()) {
+            break;
+        }
+        IRunnable* task = m_tasks.front();
+        m_tasks.pop_front();
+        ++m_running;
+        m_mutex.unlock();
+        task->run();
+        m_mutex.lock();
+        --m_running;
+        ++m_completed;
+        if (m_tasks.empty() && m_running == 0) {
+            m_idle.broadcast();
+        }
+    }
+    m_mutex.unlock();
+}
+
+}
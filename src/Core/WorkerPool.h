@@ -0,0 +1,50 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <vector>
+#include <deque>
+#include "common_types.h"
+#include "Mutex.h"
+#include "Thread.h"
+
+namespace MySweetHome {
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t threadCount = 0);
+    ~WorkerPool();
+    bool submit(IRunnable* task);
+    void waitIdle();
+    void shutdown();
+    size_t getThreadCount() const;
+    size_t getPending() const;
+    uint64_t getCompleted() const;
+    static size_t hardwareConcurrency();
+
+private:
+    class Worker : public IRunnable {
+    public:
+        explicit Worker(WorkerPool* pool);
+        virtual void run();
+
+    private:
+        WorkerPool* m_pool;
+    };
+
+    WorkerPool(const WorkerPool&);
+    WorkerPool& operator=(const WorkerPool&);
+    void workerLoop();
+
+    std::vector<Thread*> m_threads;
+    std::deque<IRunnable*> m_tasks;
+    Worker m_worker;
+    mutable Mutex m_mutex;
+    Condition m_taskReady;
+    Condition m_idle;
+    size_t m_running;
+    uint64_t m_completed;
+    bool m_stopping;
+};
+
+}
+
+#endif
@@ -17,22 +17,26 @@ Alarm::~Alarm()
 }
 
 void Alarm::arm() {
+    markModified();
     armAway();
 }
 
 void Alarm::armHome() {
+    markModified();
     if (isOn() && m_alarmState == ALARM_DISARMED) {
         m_alarmState = ALARM_ARMED_HOME;
     }
 }
 
 void Alarm::armAway() {
+    markModified();
     if (isOn() && m_alarmState == ALARM_DISARMED) {
         m_alarmState = ALARM_ARMED_AWAY;
     }
 }
 
 void Alarm::disarm(const std::string& code) {
+    markModified();
     if (verifyPin(code)) {
         m_alarmState = ALARM_DISARMED;
         m_sirenActive = false;
@@ -40,6 +44,7 @@ void Alarm::disarm(const std::string& code) {
 }
 
 void Alarm::trigger(AlarmType type) {
+    markModified();
     if (isArmed()) {
         m_alarmState = ALARM_TRIGGERED;
         m_lastTriggerType = type;
@@ -48,10 +53,12 @@ void Alarm::trigger(AlarmType type) {
 }
 
 void Alarm::silence() {
+    markModified();
     m_sirenActive = false;
 }
 
 bool Alarm::setPin(const std::string& oldPin, const std::string& newPin) {
+    markModified();
     if (verifyPin(oldPin) && newPin.length() >= 4) {
         m_pinCode = newPin;
         return true;
@@ -86,10 +93,12 @@ Device* Alarm::clone() const {
 }
 
 void Alarm::turnOn() {
+    markModified();
     Device::turnOn();
 }
 
 void Alarm::turnOff() {
+    markModified();
     m_alarmState = ALARM_DISARMED;
     m_sirenActive = false;
 }
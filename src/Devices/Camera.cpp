@@ -17,30 +17,35 @@ Camera::~Camera()
 }
 
 void Camera::startRecording() {
+    markModified();
     if (isOn()) {
         m_cameraMode = CAMERA_RECORDING;
     }
 }
 
 void Camera::stopRecording() {
+    markModified();
     if (m_cameraMode == CAMERA_RECORDING) {
         m_cameraMode = CAMERA_IDLE;
     }
 }
 
 void Camera::startStreaming() {
+    markModified();
     if (isOn()) {
         m_cameraMode = CAMERA_STREAMING;
     }
 }
 
 void Camera::stopStreaming() {
+    markModified();
     if (m_cameraMode == CAMERA_STREAMING) {
         m_cameraMode = CAMERA_IDLE;
     }
 }
 
 void Camera::enableMotionDetection(bool enable) {
+    markModified();
     m_motionDetection = enable;
     if (enable && isOn()) {
         m_cameraMode = CAMERA_MOTION_DETECTION;
@@ -48,6 +53,7 @@ void Camera::enableMotionDetection(bool enable) {
 }
 
 void Camera::setFPS(int fps) {
+    markModified();
     if (fps > 0 && fps <= 60) {
         m_fps = fps;
     }
@@ -58,6 +64,7 @@ int Camera::getFPS() const {
 }
 
 void Camera::setNightVision(bool enable) {
+    markModified();
     m_nightVision = enable;
 }
 
@@ -90,11 +97,13 @@ Device* Camera::clone() const {
 }
 
 void Camera::turnOn() {
+    markModified();
     Device::turnOn();
     m_cameraMode = CAMERA_IDLE;
 }
 
 void Camera::turnOff() {
+    markModified();
     m_cameraMode = CAMERA_IDLE;
 }
 
@@ -157,6 +166,7 @@ std::string SamsungCamera::getInfo() const {
 }
 
 void SamsungCamera::enableSmartThings(bool enable) {
+    markModified();
     m_smartThingsEnabled = enable;
 }
 
@@ -165,6 +175,7 @@ bool SamsungCamera::hasSmartThings() const {
 }
 
 void SamsungCamera::setResolution(const std::string& resolution) {
+    markModified();
     m_resolution = resolution;
 }
 
@@ -202,6 +213,7 @@ std::string LogitechCamera::getInfo() const {
 }
 
 void LogitechCamera::enableAutoFocus(bool enable) {
+    markModified();
     m_autoFocus = enable;
 }
 
@@ -210,6 +222,7 @@ bool LogitechCamera::hasAutoFocus() const {
 }
 
 void LogitechCamera::setFieldOfView(int degrees) {
+    markModified();
     if (degrees >= 60 && degrees <= 180) {
         m_fieldOfView = degrees;
     }
@@ -246,6 +259,7 @@ std::string SonyCamera::getInfo() const {
 }
 
 void SonyCamera::enableStabilization(bool enable) {
+    markModified();
     m_stabilization = enable;
 }
 
@@ -0,0 +1,768 @@
+#include "CameraRecorder.h"
+#include "Camera.h"
+#include "Atomic.h"
+#include "Logger.h"
+#include "MonotonicTime.h"
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace MySweetHome {
+namespace {
+const size_t WRITE_ALIGNMENT = 4096;
+
+bool parseSegmentIndex(const std::string& name, const std::string& prefix, uint32_t& index)
+{
+    const std::string suffix = ".seg";
+    if (name.length() <= prefix.length() + suffix.length() ||
+        name.compare(0, prefix.length(), prefix) != 0 ||
+        name.compare(name.length() - suffix.length(), suffix.length(), suffix) != 0) {
+        return false;
+    }
+    std::string digits = name.substr(prefix.length(), name.length() - prefix.length() - suffix.length());
+    if (digits.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    index = static_cast<uint32_t>(std::strtoul(digits.c_str(), 0, 10));
+    return true;
+}
+
+void listSegmentIndices(const std::string& directory, uint32_t cameraId, std::vector<uint32_t>& indices)
+{
+    std::ostringstream prefix;
+    prefix << "cam" << cameraId << "-";
+    uint32_t index = 0;
+#ifdef _WIN32
+    WIN32_FIND_DATAA entry;
+    HANDLE find = FindFirstFileA((directory + "\\" + prefix.str() + "*.seg").c_str(), &entry);
+    if (find == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    do {
+        if (parseSegmentIndex(entry.cFileName, prefix.str(), index)) {
+            indices.push_back(index);
+        }
+    } while (FindNextFileA(find, &entry));
+    FindClose(find);
+#else
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        return;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        if (parseSegmentIndex(entry->d_name, prefix.str(), index)) {
+            indices.push_back(index);
+        }
+    }
+    closedir(dir);
+#endif
+    std::sort(indices.begin(), indices.end());
+}
+
+bool fileExists(const std::string& path)
+{
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    std::fclose(file);
+    return true;
+}
+
+}
+
+PreRollBuffer::PreRollBuffer(uint64_t windowMillis, size_t maxFrames)
+    : m_slots(maxFrames > 0 ? maxFrames : 1)
+    , m_head(0)
+    , m_count(0)
+    , m_windowMillis(windowMillis)
+{
+}
+
+PreRollBuffer::~PreRollBuffer()
+{
+}
+
+void PreRollBuffer::push(const FrameHandle& frame)
+{
+    if (!frame.isValid()) {
+        return;
+    }
+    if (frame->timestamp > m_windowMillis) {
+        evictOlderThan(frame->timestamp - m_windowMillis);
+    }
+    if (m_count == m_slots.size()) {
+        m_slots[m_head].reset();
+        m_head = (m_head + 1) % m_slots.size();
+        --m_count;
+    }
+    m_slots[(m_head + m_count) % m_slots.size()] = frame;
+    ++m_count;
+}
+
+size_t PreRollBuffer::drain(std::vector<FrameHandle>& frames)
+{
+    size_t drained = m_count;
+    for (size_t i = 0; i < m_count; ++i) {
+        FrameHandle& slot = m_slots[(m_head + i) % m_slots.size()];
+        frames.push_back(slot);
+        slot.reset();
+    }
+    m_head = 0;
+    m_count = 0;
+    return drained;
+}
+
+void PreRollBuffer::clear()
+{
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        m_slots[i].reset();
+    }
+    m_head = 0;
+    m_count = 0;
+}
+
+size_t PreRollBuffer::size() const
+{
+    return m_count;
+}
+
+size_t PreRollBuffer::capacity() const
+{
+    return m_slots.size();
+}
+
+uint64_t PreRollBuffer::getWindowMillis() const
+{
+    return m_windowMillis;
+}
+
+uint64_t PreRollBuffer::getSpanMillis() const
+{
+    if (m_count < 2) {
+        return 0;
+    }
+    const FrameHandle& oldest = m_slots[m_head];
+    const FrameHandle& newest = m_slots[(m_head + m_count - 1) % m_slots.size()];
+    return newest->timestamp - oldest->timestamp;
+}
+
+void PreRollBuffer::evictOlderThan(uint64_t timestamp)
+{
+    while (m_count > 0 && m_slots[m_head]->timestamp < timestamp) {
+        m_slots[m_head].reset();
+        m_head = (m_head + 1) % m_slots.size();
+        --m_count;
+    }
+}
+
+RetentionPolicy::RetentionPolicy()
+    : maxSegmentsPerCamera(24)
+    , maxBytesPerCamera(0)
+    , maxAgeMillis(0)
+{
+}
+
+SegmentConfig::SegmentConfig()
+    : directory(".")
+    , segmentMillis(60000)
+    , segmentBytes(256ULL * 1024 * 1024)
+    , writeBlockBytes(1024 * 1024)
+    , maxQueuedFrames(256)
+    , maxBurstFrames(4096)
+{
+}
+
+SegmentInfo::SegmentInfo()
+    : cameraId(0)
+    , index(0)
+    , bytes(0)
+    , frames(0)
+    , firstTimestamp(0)
+    , lastTimestamp(0)
+    , open(false)
+{
+}
+
+SegmentWriterStats::SegmentWriterStats()
+    : queued(0)
+    , written(0)
+    , dropped(0)
+    , bytes(0)
+    , writes(0)
+    , segmentsOpened(0)
+    , segmentsPruned(0)
+    , writeErrors(0)
+    , pending(0)
+    , queueHighWater(0)
+{
+}
+
+SegmentWriter::Worker::Worker(SegmentWriter* writer)
+    : m_writer(writer)
+{
+}
+
+void SegmentWriter::Worker::run()
+{
+    m_writer->writerLoop();
+}
+
+SegmentWriter::SegmentWriter(const SegmentConfig& config)
+    : m_config(config)
+    , m_queuedBurst(0)
+    , m_worker(this)
+    , m_thread(0)
+    , m_busy(false)
+    , m_stopping(false)
+{
+    if (m_config.writeBlockBytes < WRITE_ALIGNMENT) {
+        m_config.writeBlockBytes = WRITE_ALIGNMENT;
+    }
+    m_config.writeBlockBytes = m_config.writeBlockBytes / WRITE_ALIGNMENT * WRITE_ALIGNMENT;
+    if (m_config.maxQueuedFrames == 0) {
+        m_config.maxQueuedFrames = 1;
+    }
+    m_thread = new Thread(&m_worker);
+    if (!m_thread->start()) {
+        Logger::getInstance().error("SegmentWriter: failed to start writer thread");
+        delete m_thread;
+        m_thread = 0;
+        m_stopping = true;
+    }
+}
+
+SegmentWriter::~SegmentWriter()
+{
+    stop();
+    for (size_t i = 0; i < m_cameras.size(); ++i) {
+        finishSegment(*m_cameras[i]);
+        alignedFree(m_cameras[i]->staging);
+        delete m_cameras[i];
+    }
+    m_cameras.clear();
+}
+
+bool SegmentWriter::write(const FrameHandle& frame)
+{
+    if (!frame.isValid()) {
+        return false;
+    }
+    ScopedLock lock(m_mutex);
+    return enqueue(frame, false);
+}
+
+size_t SegmentWriter::writeAll(const std::vector<FrameHandle>& frames)
+{
+    // Bursts (pre-roll flushes) are counted against maxBurstFrames rather than
+    // the live cap, so many cameras starting at once do not crowd each other out.
+    size_t accepted = 0;
+    ScopedLock lock(m_mutex);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        if (frames[i].isValid() && enqueue(frames[i], true)) {
+            ++accepted;
+        }
+    }
+    return accepted;
+}
+
+void SegmentWriter::closeSegment(uint32_t cameraId)
+{
+    ScopedLock lock(m_mutex);
+    if (m_stopping) {
+        return;
+    }
+    Request request;
+    request.cameraId = cameraId;
+    request.close = true;
+    m_queue.push_back(request);
+    m_wake.signal();
+}
+
+void SegmentWriter::flush()
+{
+    ScopedLock lock(m_mutex);
+    while (m_thread && (!m_queue.empty() || m_busy)) {
+        m_idle.wait(m_mutex);
+    }
+}
+
+void SegmentWriter::stop()
+{
+    {
+        ScopedLock lock(m_mutex);
+        m_stopping = true;
+        m_wake.broadcast();
+    }
+    if (m_thread) {
+        m_thread->join();
+        delete m_thread;
+        m_thread = 0;
+    }
+}
+
+bool SegmentWriter::isRunning() const
+{
+    ScopedLock lock(m_mutex);
+    return m_thread != 0 && !m_stopping;
+}
+
+const SegmentConfig& SegmentWriter::getConfig() const
+{
+    return m_config;
+}
+
+std::vector<SegmentInfo> SegmentWriter::getSegments(uint32_t cameraId) const
+{
+    ScopedLock lock(m_stateMutex);
+    for (size_t i = 0; i < m_cameras.size(); ++i) {
+        if (m_cameras[i]->cameraId == cameraId) {
+            return m_cameras[i]->segments;
+        }
+    }
+    return std::vector<SegmentInfo>();
+}
+
+SegmentWriterStats SegmentWriter::getStats() const
+{
+    SegmentWriterStats stats;
+    {
+        ScopedLock lock(m_mutex);
+        stats.queued = m_stats.queued;
+        stats.dropped = m_stats.dropped;
+        stats.queueHighWater = m_stats.queueHighWater;
+        stats.pending = m_queue.size() + (m_busy ? 1 : 0);
+    }
+    ScopedLock lock(m_stateMutex);
+    stats.written = m_stats.written;
+    stats.bytes = m_stats.bytes;
+    stats.writes = m_stats.writes;
+    stats.segmentsOpened = m_stats.segmentsOpened;
+    stats.segmentsPruned = m_stats.segmentsPruned;
+    stats.writeErrors = m_stats.writeErrors;
+    return stats;
+}
+
+bool SegmentWriter::readSegment(const std::string& path, std::vector<SegmentFrameHeader>& frames)
+{
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    bool valid = true;
+    SegmentFrameHeader header;
+    while (std::fread(&header, sizeof(header), 1, file) == 1) {
+        long payload = static_cast<long>(header.width) * static_cast<long>(header.height);
+        if (header.magic != FRAME_MAGIC || std::fseek(file, payload, SEEK_CUR) != 0) {
+            valid = false;
+            break;
+        }
+        frames.push_back(header);
+    }
+    std::fclose(file);
+    return valid;
+}
+
+bool SegmentWriter::enqueue(const FrameHandle& frame, bool burst)
+{
+    bool full = burst ? m_queuedBurst >= m_config.maxBurstFrames
+                      : m_queue.size() - m_queuedBurst >= m_config.maxQueuedFrames;
+    if (m_stopping || full) {
+        ++m_stats.dropped;
+        return false;
+    }
+    Request request;
+    request.frame = frame;
+    request.cameraId = frame->cameraId;
+    request.close = false;
+    m_queue.push_back(request);
+    if (burst) {
+        ++m_queuedBurst;
+    }
+    ++m_stats.queued;
+    if (m_queue.size() > m_stats.queueHighWater) {
+        m_stats.queueHighWater = m_queue.size();
+    }
+    m_wake.signal();
+    return true;
+}
+
+void SegmentWriter::writerLoop()
+{
+    m_mutex.lock();
+    while (true) {
+        while (m_queue.empty() && !m_stopping) {
+            m_wake.wait(m_mutex);
+        }
+        if (m_queue.empty()) {
+            break;
+        }
+        std::deque<Request> batch;
+        batch.swap(m_queue);
+        m_queuedBurst = 0;
+        m_busy = true;
+        m_mutex.unlock();
+        {
+            ScopedLock state(m_stateMutex);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                process(batch[i]);
+            }
+        }
+        batch.clear();
+        m_mutex.lock();
+        m_busy = false;
+        if (m_queue.empty()) {
+            m_idle.broadcast();
+        }
+    }
+    m_idle.broadcast();
+    m_mutex.unlock();
+
+    ScopedLock state(m_stateMutex);
+    for (size_t i = 0; i < m_cameras.size(); ++i) {
+        finishSegment(*m_cameras[i]);
+    }
+}
+
+void SegmentWriter::process(Request& request)
+{
+    CameraSegments* camera = findCamera(request.cameraId);
+    if (request.close) {
+        if (camera) {
+            finishSegment(*camera);
+        }
+        return;
+    }
+    if (!camera) {
+        camera = new CameraSegments();
+        camera->cameraId = request.cameraId;
+        camera->nextIndex = 0;
+        camera->file = 0;
+        camera->staging = static_cast<uint8_t*>(alignedAllocate(m_config.writeBlockBytes, WRITE_ALIGNMENT));
+        camera->staged = 0;
+        m_cameras.push_back(camera);
+        adoptSegments(*camera);
+    }
+    const FrameBuffer& frame = *request.frame.get();
+    uint64_t frameBytes = sizeof(SegmentFrameHeader) + static_cast<uint64_t>(frame.width) * frame.height;
+    if (camera->file) {
+        const SegmentInfo& current = camera->segments.back();
+        if ((current.frames > 0 && current.bytes + frameBytes > m_config.segmentBytes) ||
+            frame.timestamp >= current.firstTimestamp + m_config.segmentMillis) {
+            finishSegment(*camera);
+        }
+    }
+    if (!camera->file && (!camera->staging || !openSegment(*camera, frame))) {
+        ++m_stats.writeErrors;
+        return;
+    }
+
+    SegmentFrameHeader header;
+    header.magic = FRAME_MAGIC;
+    header.cameraId = frame.cameraId;
+    header.sequence = frame.sequence;
+    header.timestamp = frame.timestamp;
+    header.width = static_cast<uint32_t>(frame.width);
+    header.height = static_cast<uint32_t>(frame.height);
+    append(*camera, reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+    if (frame.stride == frame.width) {
+        append(*camera, frame.data, static_cast<size_t>(frame.width) * frame.height);
+    } else {
+        for (int y = 0; y < frame.height; ++y) {
+            append(*camera, frame.data + static_cast<size_t>(y) * frame.stride, static_cast<size_t>(frame.width));
+        }
+    }
+
+    SegmentInfo& segment = camera->segments.back();
+    segment.bytes += frameBytes;
+    ++segment.frames;
+    segment.lastTimestamp = frame.timestamp;
+    ++m_stats.written;
+    m_stats.bytes += frameBytes;
+}
+
+SegmentWriter::CameraSegments* SegmentWriter::findCamera(uint32_t cameraId)
+{
+    for (size_t i = 0; i < m_cameras.size(); ++i) {
+        if (m_cameras[i]->cameraId == cameraId) {
+            return m_cameras[i];
+        }
+    }
+    return 0;
+}
+
+void SegmentWriter::adoptSegments(CameraSegments& camera)
+{
+    // Segments left by earlier runs stay on disk and count towards retention;
+    // new footage continues after the highest index found.
+    std::vector<uint32_t> indices;
+    listSegmentIndices(m_config.directory, camera.cameraId, indices);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        SegmentInfo segment;
+        segment.cameraId = camera.cameraId;
+        segment.index = indices[i];
+        segment.path = segmentPath(camera.cameraId, indices[i]);
+        std::vector<SegmentFrameHeader> frames;
+        readSegment(segment.path, frames);
+        for (size_t f = 0; f < frames.size(); ++f) {
+            segment.bytes += sizeof(SegmentFrameHeader) + static_cast<uint64_t>(frames[f].width) * frames[f].height;
+        }
+        segment.frames = frames.size();
+        if (!frames.empty()) {
+            segment.firstTimestamp = frames.front().timestamp;
+            segment.lastTimestamp = frames.back().timestamp;
+        }
+        camera.segments.push_back(segment);
+        camera.nextIndex = indices[i] + 1;
+    }
+    if (!indices.empty()) {
+        applyRetention(camera);
+    }
+}
+
+std::string SegmentWriter::segmentPath(uint32_t cameraId, uint32_t index) const
+{
+    std::ostringstream path;
+    path << m_config.directory << "/cam" << cameraId << "-" << std::setw(6) << std::setfill('0') << index << ".seg";
+    return path.str();
+}
+
+bool SegmentWriter::openSegment(CameraSegments& camera, const FrameBuffer& frame)
+{
+    std::string path = segmentPath(camera.cameraId, camera.nextIndex);
+    while (fileExists(path)) {
+        path = segmentPath(camera.cameraId, ++camera.nextIndex);
+    }
+    camera.file = std::fopen(path.c_str(), "wb");
+    if (!camera.file) {
+        Logger::getInstance().error("SegmentWriter: cannot open " + path);
+        return false;
+    }
+    std::setvbuf(camera.file, 0, _IONBF, 0);
+    SegmentInfo segment;
+    segment.cameraId = camera.cameraId;
+    segment.index = camera.nextIndex++;
+    segment.path = path;
+    segment.firstTimestamp = frame.timestamp;
+    segment.lastTimestamp = frame.timestamp;
+    segment.open = true;
+    camera.segments.push_back(segment);
+    ++m_stats.segmentsOpened;
+    return true;
+}
+
+void SegmentWriter::finishSegment(CameraSegments& camera)
+{
+    if (!camera.file) {
+        return;
+    }
+    flushStaging(camera);
+    std::fclose(camera.file);
+    camera.file = 0;
+    camera.segments.back().open = false;
+    applyRetention(camera);
+}
+
+void SegmentWriter::append(CameraSegments& camera, const uint8_t* data, size_t size)
+{
+    while (size > 0) {
+        size_t chunk = m_config.writeBlockBytes - camera.staged;
+        if (chunk > size) {
+            chunk = size;
+        }
+        std::memcpy(camera.staging + camera.staged, data, chunk);
+        camera.staged += chunk;
+        data += chunk;
+        size -= chunk;
+        if (camera.staged == m_config.writeBlockBytes) {
+            flushStaging(camera);
+        }
+    }
+}
+
+bool SegmentWriter::flushStaging(CameraSegments& camera)
+{
+    if (camera.staged == 0) {
+        return true;
+    }
+    size_t written = std::fwrite(camera.staging, 1, camera.staged, camera.file);
+    ++m_stats.writes;
+    bool ok = written == camera.staged;
+    if (!ok) {
+        ++m_stats.writeErrors;
+    }
+    camera.staged = 0;
+    return ok;
+}
+
+void SegmentWriter::applyRetention(CameraSegments& camera)
+{
+    const RetentionPolicy& policy = m_config.retention;
+    uint64_t newest = camera.segments.empty() ? 0 : camera.segments.back().lastTimestamp;
+    uint64_t totalBytes = 0;
+    for (size_t i = 0; i < camera.segments.size(); ++i) {
+        totalBytes += camera.segments[i].bytes;
+    }
+    while (!camera.segments.empty() && !camera.segments.front().open) {
+        const SegmentInfo& oldest = camera.segments.front();
+        bool tooMany = policy.maxSegmentsPerCamera > 0 && camera.segments.size() > policy.maxSegmentsPerCamera;
+        bool tooLarge = policy.maxBytesPerCamera > 0 && totalBytes > policy.maxBytesPerCamera &&
+                        camera.segments.size() > 1;
+        bool tooOld = policy.maxAgeMillis > 0 && oldest.lastTimestamp + policy.maxAgeMillis < newest;
+        if (!tooMany && !tooLarge && !tooOld) {
+            break;
+        }
+        std::remove(oldest.path.c_str());
+        totalBytes -= oldest.bytes;
+        camera.segments.erase(camera.segments.begin());
+        ++m_stats.segmentsPruned;
+    }
+}
+
+CameraRecorderStats::CameraRecorderStats()
+    : buffered(0)
+    , preRollFlushed(0)
+    , liveFrames(0)
+    , recordings(0)
+    , dropped(0)
+    , processMicros(0)
+    , maxProcessMicros(0)
+    , cameras(0)
+{
+}
+
+CameraRecorder::CameraRecorder(SegmentWriter* writer, uint64_t preRollMillis, size_t maxPreRollFrames)
+    : m_writer(writer)
+    , m_preRollMillis(preRollMillis)
+    , m_maxPreRollFrames(maxPreRollFrames)
+{
+}
+
+CameraRecorder::~CameraRecorder()
+{
+    for (size_t i = 0; i < m_cameras.size(); ++i) {
+        delete m_cameras[i]->preRoll;
+        delete m_cameras[i];
+    }
+    m_cameras.clear();
+}
+
+bool CameraRecorder::addCamera(Camera* camera)
+{
+    if (!camera || findCamera(camera->getId())) {
+        return false;
+    }
+    CameraState* state = new CameraState();
+    state->camera = camera;
+    state->preRoll = new PreRollBuffer(m_preRollMillis, m_maxPreRollFrames);
+    state->recording = false;
+    m_cameras.push_back(state);
+    return true;
+}
+
+bool CameraRecorder::removeCamera(uint32_t cameraId)
+{
+    for (size_t i = 0; i < m_cameras.size(); ++i) {
+        if (m_cameras[i]->camera->getId() == cameraId) {
+            if (m_cameras[i]->recording && m_writer) {
+                m_writer->closeSegment(cameraId);
+            }
+            delete m_cameras[i]->preRoll;
+            delete m_cameras[i];
+            m_cameras.erase(m_cameras.begin() + i);
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t CameraRecorder::getCameraCount() const
+{
+    return m_cameras.size();
+}
+
+size_t CameraRecorder::getPreRollFrames(uint32_t cameraId) const
+{
+    CameraState* state = findCamera(cameraId);
+    return state ? state->preRoll->size() : 0;
+}
+
+bool CameraRecorder::isRecording(uint32_t cameraId) const
+{
+    CameraState* state = findCamera(cameraId);
+    return state && state->recording;
+}
+
+CameraRecorderStats CameraRecorder::getStats() const
+{
+    CameraRecorderStats stats = m_stats;
+    stats.cameras = m_cameras.size();
+    return stats;
+}
+
+std::string CameraRecorder::getStageName() const
+{
+    return "Recorder";
+}
+
+bool CameraRecorder::processFrame(const FrameHandle& frame, Camera* camera)
+{
+    if (!camera || !m_writer) {
+        return false;
+    }
+    CameraState* state = findCamera(camera->getId());
+    if (!state) {
+        return false;
+    }
+    uint64_t start = monotonicMicros();
+    if (camera->isRecording()) {
+        if (!state->recording) {
+            state->recording = true;
+            ++m_stats.recordings;
+            m_flushScratch.clear();
+            state->preRoll->drain(m_flushScratch);
+            size_t accepted = m_writer->writeAll(m_flushScratch);
+            m_stats.preRollFlushed += accepted;
+            m_stats.dropped += m_flushScratch.size() - accepted;
+            m_flushScratch.clear();
+        }
+        if (m_writer->write(frame)) {
+            ++m_stats.liveFrames;
+        } else {
+            ++m_stats.dropped;
+        }
+    } else {
+        if (state->recording) {
+            state->recording = false;
+            m_writer->closeSegment(camera->getId());
+        }
+        state->preRoll->push(frame);
+        ++m_stats.buffered;
+    }
+    uint64_t elapsed = monotonicMicros() - start;
+    m_stats.processMicros += elapsed;
+    if (elapsed > m_stats.maxProcessMicros) {
+        m_stats.maxProcessMicros = elapsed;
+    }
+    return true;
+}
+
+CameraRecorder::CameraState* CameraRecorder::findCamera(uint32_t cameraId) const
+{
+    for (size_t i = 0; i < m_cameras.size(); ++i) {
+        if (m_cameras[i]->camera->getId() == cameraId) {
+            return m_cameras[i];
+        }
+    }
+    return 0;
+}
+
+}
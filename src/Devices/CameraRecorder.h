@@ -0,0 +1,202 @@
+#ifndef CAMERA_RECORDER_H
+#define CAMERA_RECORDER_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstdio>
+#include "common_types.h"
+#include "FramePipeline.h"
+#include "Mutex.h"
+#include "Thread.h"
+
+namespace MySweetHome {
+
+class Camera;
+class PreRollBuffer {
+public:
+    PreRollBuffer(uint64_t windowMillis = 5000, size_t maxFrames = 150);
+    ~PreRollBuffer();
+    void push(const FrameHandle& frame);
+    size_t drain(std::vector<FrameHandle>& frames);
+    void clear();
+    size_t size() const;
+    size_t capacity() const;
+    uint64_t getWindowMillis() const;
+    uint64_t getSpanMillis() const;
+
+private:
+    void evictOlderThan(uint64_t timestamp);
+
+    std::vector<FrameHandle> m_slots;
+    size_t m_head;
+    size_t m_count;
+    uint64_t m_windowMillis;
+};
+struct SegmentFrameHeader {
+    uint32_t magic;
+    uint32_t cameraId;
+    uint64_t sequence;
+    uint64_t timestamp;
+    uint32_t width;
+    uint32_t height;
+};
+struct RetentionPolicy {
+    uint32_t maxSegmentsPerCamera;
+    uint64_t maxBytesPerCamera;
+    uint64_t maxAgeMillis;
+
+    RetentionPolicy();
+};
+struct SegmentConfig {
+    std::string directory;
+    uint64_t segmentMillis;
+    uint64_t segmentBytes;
+    size_t writeBlockBytes;
+    size_t maxQueuedFrames;
+    size_t maxBurstFrames;
+    RetentionPolicy retention;
+
+    SegmentConfig();
+};
+struct SegmentInfo {
+    uint32_t cameraId;
+    uint32_t index;
+    std::string path;
+    uint64_t bytes;
+    uint64_t frames;
+    uint64_t firstTimestamp;
+    uint64_t lastTimestamp;
+    bool open;
+
+    SegmentInfo();
+};
+struct SegmentWriterStats {
+    uint64_t queued;
+    uint64_t written;
+    uint64_t dropped;
+    uint64_t bytes;
+    uint64_t writes;
+    uint64_t segmentsOpened;
+    uint64_t segmentsPruned;
+    uint64_t writeErrors;
+    size_t pending;
+    size_t queueHighWater;
+
+    SegmentWriterStats();
+};
+class SegmentWriter {
+public:
+    static const uint32_t FRAME_MAGIC = 0x4D534846;
+
+    explicit SegmentWriter(const SegmentConfig& config = SegmentConfig());
+    ~SegmentWriter();
+    bool write(const FrameHandle& frame);
+    size_t writeAll(const std::vector<FrameHandle>& frames);
+    void closeSegment(uint32_t cameraId);
+    void flush();
+    void stop();
+    bool isRunning() const;
+    const SegmentConfig& getConfig() const;
+    std::vector<SegmentInfo> getSegments(uint32_t cameraId) const;
+    SegmentWriterStats getStats() const;
+    static bool readSegment(const std::string& path, std::vector<SegmentFrameHeader>& frames);
+
+private:
+    struct Request {
+        FrameHandle frame;
+        uint32_t cameraId;
+        bool close;
+    };
+    struct CameraSegments {
+        uint32_t cameraId;
+        uint32_t nextIndex;
+        std::FILE* file;
+        uint8_t* staging;
+        size_t staged;
+        std::vector<SegmentInfo> segments;
+    };
+    class Worker : public IRunnable {
+    public:
+        explicit Worker(SegmentWriter* writer);
+        virtual void run();
+
+    private:
+        SegmentWriter* m_writer;
+    };
+
+    SegmentWriter(const SegmentWriter&);
+    SegmentWriter& operator=(const SegmentWriter&);
+    bool enqueue(const FrameHandle& frame, bool burst);
+    void writerLoop();
+    void process(Request& request);
+    CameraSegments* findCamera(uint32_t cameraId);
+    void adoptSegments(CameraSegments& camera);
+    std::string segmentPath(uint32_t cameraId, uint32_t index) const;
+    bool openSegment(CameraSegments& camera, const FrameBuffer& frame);
+    void finishSegment(CameraSegments& camera);
+    void append(CameraSegments& camera, const uint8_t* data, size_t size);
+    bool flushStaging(CameraSegments& camera);
+    void applyRetention(CameraSegments& camera);
+
+    SegmentConfig m_config;
+    std::deque<Request> m_queue;
+    size_t m_queuedBurst;
+    std::vector<CameraSegments*> m_cameras;
+    Worker m_worker;
+    Thread* m_thread;
+    mutable Mutex m_mutex;
+    mutable Mutex m_stateMutex;
+    Condition m_wake;
+    Condition m_idle;
+    bool m_busy;
+    bool m_stopping;
+    SegmentWriterStats m_stats;
+};
+struct CameraRecorderStats {
+    uint64_t buffered;
+    uint64_t preRollFlushed;
+    uint64_t liveFrames;
+    uint64_t recordings;
+    uint64_t dropped;
+    uint64_t processMicros;
+    uint64_t maxProcessMicros;
+    size_t cameras;
+
+    CameraRecorderStats();
+};
+class CameraRecorder : public IFrameStage {
+public:
+    CameraRecorder(SegmentWriter* writer, uint64_t preRollMillis = 5000, size_t maxPreRollFrames = 150);
+    virtual ~CameraRecorder();
+    bool addCamera(Camera* camera);
+    bool removeCamera(uint32_t cameraId);
+    size_t getCameraCount() const;
+    size_t getPreRollFrames(uint32_t cameraId) const;
+    bool isRecording(uint32_t cameraId) const;
+    CameraRecorderStats getStats() const;
+    virtual std::string getStageName() const;
+    virtual bool processFrame(const FrameHandle& frame, Camera* camera);
+
+private:
+    struct CameraState {
+        Camera* camera;
+        PreRollBuffer* preRoll;
+        bool recording;
+    };
+
+    CameraRecorder(const CameraRecorder&);
+    CameraRecorder& operator=(const CameraRecorder&);
+    CameraState* findCamera(uint32_t cameraId) const;
+
+    SegmentWriter* m_writer;
+    uint64_t m_preRollMillis;
+    size_t m_maxPreRollFrames;
+    std::vector<CameraState*> m_cameras;
+    std::vector<FrameHandle> m_flushScratch;
+    CameraRecorderStats m_stats;
+};
+
+}
+
+#endif
@@ -30,8 +30,8 @@ float SimpleThresholdStrategy::getRecommendedThreshold() const
     return 50.0f;
 }
 AveragingDetectionStrategy::AveragingDetectionStrategy(int windowSize)
-    : m_windowSize(windowSize > 0 ? windowSize : 5)
-    , m_lastAverage(0.0f)
+    : m_window(windowSize > 0 ? windowSize : 5)
+    , m_windowSize(windowSize > 0 ? windowSize : 5)
 {
 }
 
@@ -41,10 +41,9 @@ AveragingDetectionStrategy::~AveragingDetectionStrategy()
 
 bool AveragingDetectionStrategy::detect(float sensorValue, float threshold) const
 {
-    AveragingDetectionStrategy* self = const_cast<AveragingDetectionStrategy*>(this);
-    self->addReading(sensorValue);
-
-    return m_lastAverage > threshold;
+    ScopedLock lock(m_mutex);
+    m_window.add(sensorValue);
+    return m_window.mean() > threshold;
 }
 
 std::string AveragingDetectionStrategy::getName() const
@@ -64,30 +63,67 @@ float AveragingDetectionStrategy::getRecommendedThreshold() const
 
 void AveragingDetectionStrategy::addReading(float value)
 {
-    m_readings.push_back(value);
-    while (static_cast<int>(m_readings.size()) > m_windowSize) {
-        m_readings.erase(m_readings.begin());
-    }
-    m_lastAverage = getAverage();
+    ScopedLock lock(m_mutex);
+    m_window.add(value);
 }
 
 float AveragingDetectionStrategy::getAverage() const
 {
-    if (m_readings.empty()) {
-        return 0.0f;
-    }
+    ScopedLock lock(m_mutex);
+    return m_window.mean();
+}
 
-    float sum = 0.0f;
-    for (size_t i = 0; i < m_readings.size(); ++i) {
-        sum += m_readings[i];
-    }
-    return sum / static_cast<float>(m_readings.size());
+float AveragingDetectionStrategy::getEwma() const
+{
+    ScopedLock lock(m_mutex);
+    return m_window.ewma();
+}
+
+float AveragingDetectionStrategy::getVariance() const
+{
+    ScopedLock lock(m_mutex);
+    return m_window.variance();
+}
+
+float AveragingDetectionStrategy::getStandardDeviation() const
+{
+    ScopedLock lock(m_mutex);
+    return m_window.standardDeviation();
+}
+
+float AveragingDetectionStrategy::getMinimum() const
+{
+    ScopedLock lock(m_mutex);
+    return m_window.minimum();
+}
+
+float AveragingDetectionStrategy::getMaximum() const
+{
+    ScopedLock lock(m_mutex);
+    return m_window.maximum();
+}
+
+size_t AveragingDetectionStrategy::getReadingCount() const
+{
+    ScopedLock lock(m_mutex);
+    return m_window.size();
+}
+
+int AveragingDetectionStrategy::getWindowSize() const
+{
+    return m_windowSize;
+}
+
+void AveragingDetectionStrategy::setEwmaAlpha(double alpha)
+{
+    ScopedLock lock(m_mutex);
+    m_window.setEwmaAlpha(alpha);
 }
 
 void AveragingDetectionStrategy::clearReadings()
 {
-    m_readings.clear();
-    m_lastAverage = 0.0f;
+    ScopedLock lock(m_mutex);
+    m_window.clear();
 }
 RateOfChangeStrategy::RateOfChangeStrategy(float rateThreshold)
     : m_previousValue(0.0f)
@@ -97,19 +133,49 @@ RateOfChangeStrategy::RateOfChangeStrategy(float rateThreshold)
 {
 }
 
+RateOfChangeStrategy::RateOfChangeStrategy(const RateOfChangeStrategy& other)
+    : IDetectionStrategy()
+    , m_previousValue(0.0f)
+    , m_currentValue(0.0f)
+    , m_rateThreshold(other.m_rateThreshold)
+    , m_hasReadings(false)
+{
+    ScopedLock lock(other.m_mutex);
+    m_previousValue = other.m_previousValue;
+    m_currentValue = other.m_currentValue;
+    m_hasReadings = other.m_hasReadings;
+}
+
+RateOfChangeStrategy& RateOfChangeStrategy::operator=(const RateOfChangeStrategy& other)
+{
+    if (this == &other) {
+        return *this;
+    }
+    float previousValue;
+    float currentValue;
+    bool hasReadings;
+    {
+        ScopedLock lock(other.m_mutex);
+        previousValue = other.m_previousValue;
+        currentValue = other.m_currentValue;
+        hasReadings = other.m_hasReadings;
+    }
+    ScopedLock lock(m_mutex);
+    m_previousValue = previousValue;
+    m_currentValue = currentValue;
+    m_rateThreshold = other.m_rateThreshold;
+    m_hasReadings = hasReadings;
+    return *this;
+}
+
 RateOfChangeStrategy::~RateOfChangeStrategy()
 {
 }
 
 bool RateOfChangeStrategy::detect(float sensorValue, float threshold) const
 {
-    RateOfChangeStrategy* self = const_cast<RateOfChangeStrategy*>(this);
-    self->addReading(sensorValue);
-
-    if (!m_hasReadings) {
-        return false;
-    }
-    float rate = getRateOfChange();
+    ScopedLock lock(m_mutex);
+    float rate = record(sensorValue);
     return (sensorValue > threshold) && (rate > m_rateThreshold);
 }
 
@@ -130,13 +196,13 @@ float RateOfChangeStrategy::getRecommendedThreshold() const
 
 void RateOfChangeStrategy::addReading(float value)
 {
-    m_previousValue = m_currentValue;
-    m_currentValue = value;
-    m_hasReadings = true;
+    ScopedLock lock(m_mutex);
+    record(value);
 }
 
 float RateOfChangeStrategy::getRateOfChange() const
 {
+    ScopedLock lock(m_mutex);
     if (!m_hasReadings) {
         return 0.0f;
     }
@@ -145,10 +211,19 @@ float RateOfChangeStrategy::getRateOfChange() const
 
 void RateOfChangeStrategy::reset()
 {
+    ScopedLock lock(m_mutex);
     m_previousValue = 0.0f;
     m_currentValue = 0.0f;
     m_hasReadings = false;
 }
+
+float RateOfChangeStrategy::record(float value) const
+{
+    m_previousValue = m_currentValue;
+    m_currentValue = value;
+    m_hasReadings = true;
+    return m_currentValue - m_previousValue;
+}
 SmokeDetectionStrategy::SmokeDetectionStrategy()
     : m_sensitivity(5)
 {
@@ -193,11 +268,11 @@ int SmokeDetectionStrategy::getSensitivity() const
 
 float SmokeDetectionStrategy::calculateAdjustedThreshold(float baseThreshold) const
 {
-    float factor = 1.5f - (static_cast<float>(m_sensitivity - 1) / 9.0f);
-    return baseThreshold * factor;
+    return baseThreshold * smokeSensitivityFactor(m_sensitivity);
 }
 GasDetectionStrategy::GasDetectionStrategy(const std::string& gasType)
     : m_gasType(gasType)
+    , m_gasKind(parseGasKind(gasType))
 {
 }
 
@@ -209,7 +284,7 @@ bool GasDetectionStrategy::detect(float sensorValue, float threshold) const
 {
     float effectiveThreshold = threshold;
     if (threshold <= 0.0f) {
-        effectiveThreshold = getDefaultThresholdForGas(m_gasType);
+        effectiveThreshold = gasKindDefaultThreshold(m_gasKind);
     }
     return sensorValue > effectiveThreshold;
 }
@@ -226,12 +301,13 @@ std::string GasDetectionStrategy::getDescription() const
 
 float GasDetectionStrategy::getRecommendedThreshold() const
 {
-    return getDefaultThresholdForGas(m_gasType);
+    return gasKindDefaultThreshold(m_gasKind);
 }
 
 void GasDetectionStrategy::setGasType(const std::string& gasType)
 {
     m_gasType = gasType;
+    m_gasKind = parseGasKind(gasType);
 }
 
 std::string GasDetectionStrategy::getGasType() const
@@ -239,18 +315,14 @@ std::string GasDetectionStrategy::getGasType() const
     return m_gasType;
 }
 
+GasKind GasDetectionStrategy::getGasKind() const
+{
+    return m_gasKind;
+}
+
 float GasDetectionStrategy::getDefaultThresholdForGas(const std::string& gasType)
 {
-    if (gasType == "CO") {
-        return 50.0f;
-    } else if (gasType == "LPG") {
-        return 1000.0f;
-    } else if (gasType == "Methane") {
-        return 5000.0f;
-    } else if (gasType == "Natural") {
-        return 2500.0f;
-    }
-    return 1000.0f;
+    return gasKindDefaultThreshold(parseGasKind(gasType));
 }
 MotionDetectionStrategy::MotionDetectionStrategy(int sensitivityLevel)
     : m_sensitivity(sensitivityLevel)
@@ -265,10 +337,7 @@ MotionDetectionStrategy::~MotionDetectionStrategy()
 
 bool MotionDetectionStrategy::detect(float sensorValue, float threshold) const
 {
-    float factor = 1.0f + (static_cast<float>(10 - m_sensitivity) / 5.0f);
-    float adjustedThreshold = threshold * factor;
-
-    return sensorValue > adjustedThreshold;
+    return sensorValue > threshold * motionSensitivityFactor(m_sensitivity);
 }
 
 std::string MotionDetectionStrategy::getName() const
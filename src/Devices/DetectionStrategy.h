@@ -2,6 +2,9 @@
 #define DETECTION_STRATEGY_H
 
 #include "IDetectionStrategy.h"
+#include "StaticDetectionStrategy.h"
+#include "SlidingWindow.h"
+#include "Mutex.h"
 #include <vector>
 #include <string>
 
@@ -27,16 +30,29 @@ public:
     virtual float getRecommendedThreshold() const;
     void addReading(float value);
     float getAverage() const;
+    float getEwma() const;
+    float getVariance() const;
+    float getStandardDeviation() const;
+    float getMinimum() const;
+    float getMaximum() const;
+    size_t getReadingCount() const;
+    int getWindowSize() const;
+    void setEwmaAlpha(double alpha);
     void clearReadings();
 
 private:
-    std::vector<float> m_readings;
+    AveragingDetectionStrategy(const AveragingDetectionStrategy&);
+    AveragingDetectionStrategy& operator=(const AveragingDetectionStrategy&);
+
+    mutable Mutex m_mutex;
+    mutable SlidingWindow m_window;
     int m_windowSize;
-    mutable float m_lastAverage;
 };
 class RateOfChangeStrategy : public IDetectionStrategy {
 public:
     RateOfChangeStrategy(float rateThreshold = 10.0f);
+    RateOfChangeStrategy(const RateOfChangeStrategy& other);
+    RateOfChangeStrategy& operator=(const RateOfChangeStrategy& other);
     virtual ~RateOfChangeStrategy();
 
     virtual bool detect(float sensorValue, float threshold) const;
@@ -48,10 +64,13 @@ public:
     void reset();
 
 private:
-    float m_previousValue;
-    float m_currentValue;
+    float record(float value) const;
+
+    mutable Mutex m_mutex;
+    mutable float m_previousValue;
+    mutable float m_currentValue;
     float m_rateThreshold;
-    bool m_hasReadings;
+    mutable bool m_hasReadings;
 };
 class SmokeDetectionStrategy : public IDetectionStrategy {
 public:
@@ -80,10 +99,12 @@ public:
     virtual float getRecommendedThreshold() const;
     void setGasType(const std::string& gasType);
     std::string getGasType() const;
+    GasKind getGasKind() const;
     static float getDefaultThresholdForGas(const std::string& gasType);
 
 private:
     std::string m_gasType;
+    GasKind m_gasKind;
 };
 class MotionDetectionStrategy : public IDetectionStrategy {
 public:
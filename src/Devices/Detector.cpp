@@ -16,12 +16,14 @@ Detector::~Detector()
 }
 
 void Detector::testAlarm() {
+    markModified();
     if (isOn()) {
         m_alarmTriggered = true;
     }
 }
 
 void Detector::resetAlarm() {
+    markModified();
     m_alarmTriggered = false;
 }
 
@@ -34,6 +36,7 @@ float Detector::getSensorValue() const {
 }
 
 void Detector::setSensorValue(float value) {
+    markModified();
     m_sensorValue = value;
     if (isOn() && m_sensorValue >= m_threshold) {
         triggerAlarm();
@@ -41,6 +44,7 @@ void Detector::setSensorValue(float value) {
 }
 
 void Detector::setThreshold(float threshold) {
+    markModified();
     m_threshold = threshold;
 }
 
@@ -53,15 +57,18 @@ DetectorType Detector::getDetectorType() const {
 }
 
 void Detector::triggerAlarm() {
+    markModified();
     m_alarmTriggered = true;
 }
 
 void Detector::turnOn() {
+    markModified();
     Device::turnOn();
     m_alarmTriggered = false;
 }
 
 void Detector::turnOff() {
+    markModified();
     m_alarmTriggered = false;
 }
 
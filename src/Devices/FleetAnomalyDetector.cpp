@@ -0,0 +1,578 @@
+#include "FleetAnomalyDetector.h"
+#include "Detector.h"
+#include "MonotonicTime.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FLEET_ANOMALY_SSE2 1
+#endif
+
+namespace MySweetHome {
+namespace {
+
+struct ScoreKernel {
+    const float* values;
+    const float* fresh;
+    float* count;
+    float* mean;
+    float* m2;
+    float* residualCount;
+    float* residualVar;
+    float* seasonal;
+    float* seasonalCount;
+    const float* peerMean;
+    const float* peerValid;
+    float* peerCount;
+    float* peerOffset;
+    float* peerVar;
+    float* historyScore;
+    float* peerScore;
+    float warmup;
+    float seasonWarmup;
+    float alpha;
+    float minStd;
+    float historyThreshold;
+    float peerThreshold;
+};
+
+inline bool scoreScalar(const ScoreKernel& k, size_t i)
+{
+    float x = k.values[i];
+    float f = k.fresh[i];
+    float n = k.count[i];
+    float mean = k.mean[i];
+    float m2 = k.m2[i];
+
+    float variance = n > 1.0f ? m2 / (n - 1.0f) : 0.0f;
+    float sd = std::max(std::sqrt(variance), k.minStd);
+    float selfScore = n >= k.warmup ? std::fabs(x - mean) / sd : 0.0f;
+
+    float base = k.seasonal[i];
+    float sc = k.seasonalCount[i];
+    float rc = k.residualCount[i];
+    float rv = k.residualVar[i];
+    float residual = x - base;
+    bool seasonReady = sc >= k.seasonWarmup;
+    float seasonScore = std::fabs(residual) / std::max(std::sqrt(rv), k.minStd);
+    float history = (seasonReady && rc >= k.warmup) ? seasonScore : selfScore;
+    float pv = k.peerValid[i] * f;
+    float pc = k.peerCount[i];
+    float po = k.peerOffset[i];
+    float pvar = k.peerVar[i];
+    float pd = x - k.peerMean[i] - po;
+    float peer = (pv > 0.0f && pc >= k.warmup) ? std::fabs(pd) / std::max(std::sqrt(pvar), k.minStd) : 0.0f;
+
+    float n1 = n + f;
+    float delta = x - mean;
+    float mean1 = mean + f * delta / std::max(n1, 1.0f);
+    k.count[i] = n1;
+    k.mean[i] = mean1;
+    k.m2[i] = m2 + f * delta * (x - mean1);
+
+    float g = seasonReady ? f : 0.0f;
+    float rw = std::max(1.0f / (rc + 1.0f), k.alpha) * g;
+    k.residualVar[i] = (1.0f - rw) * (rv + rw * residual * residual);
+    k.residualCount[i] = rc + g;
+    float sw = std::max(1.0f / (sc + 1.0f), k.alpha) * f;
+    k.seasonal[i] = base + sw * residual;
+    k.seasonalCount[i] = sc + f;
+    float pw = std::max(1.0f / (pc + 1.0f), k.alpha) * pv;
+    k.peerOffset[i] = po + pw * pd;
+    k.peerVar[i] = (1.0f - pw) * (pvar + pw * pd * pd);
+    k.peerCount[i] = pc + pv;
+
+    k.historyScore[i] = history * f;
+    k.peerScore[i] = peer * f;
+    return f > 0.0f && (history > k.historyThreshold || peer > k.peerThreshold);
+}
+
+#ifdef FLEET_ANOMALY_SSE2
+inline __m128 absPs(__m128 v)
+{
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+
+inline __m128 selectPs(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+inline int scoreVector(const ScoreKernel& k, size_t i)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 minStd = _mm_set1_ps(k.minStd);
+    const __m128 alpha = _mm_set1_ps(k.alpha);
+    const __m128 warmup = _mm_set1_ps(k.warmup);
+
+    __m128 x = _mm_loadu_ps(k.values + i);
+    __m128 f = _mm_loadu_ps(k.fresh + i);
+    __m128 n = _mm_loadu_ps(k.count + i);
+    __m128 mean = _mm_loadu_ps(k.mean + i);
+    __m128 m2 = _mm_loadu_ps(k.m2 + i);
+
+    __m128 variance = _mm_and_ps(_mm_cmpgt_ps(n, one), _mm_div_ps(m2, _mm_max_ps(_mm_sub_ps(n, one), one)));
+    __m128 sd = _mm_max_ps(_mm_sqrt_ps(variance), minStd);
+    __m128 selfScore = _mm_and_ps(_mm_cmpge_ps(n, warmup), _mm_div_ps(absPs(_mm_sub_ps(x, mean)), sd));
+
+    __m128 base = _mm_loadu_ps(k.seasonal + i);
+    __m128 sc = _mm_loadu_ps(k.seasonalCount + i);
+    __m128 rc = _mm_loadu_ps(k.residualCount + i);
+    __m128 rv = _mm_loadu_ps(k.residualVar + i);
+    __m128 residual = _mm_sub_ps(x, base);
+    __m128 seasonReady = _mm_cmpge_ps(sc, _mm_set1_ps(k.seasonWarmup));
+    __m128 seasonScore = _mm_div_ps(absPs(residual), _mm_max_ps(_mm_sqrt_ps(rv), minStd));
+    __m128 useSeason = _mm_and_ps(seasonReady, _mm_cmpge_ps(rc, warmup));
+    __m128 history = selectPs(useSeason, seasonScore, selfScore);
+    __m128 pv = _mm_mul_ps(_mm_loadu_ps(k.peerValid + i), f);
+    __m128 pc = _mm_loadu_ps(k.peerCount + i);
+    __m128 po = _mm_loadu_ps(k.peerOffset + i);
+    __m128 pvar = _mm_loadu_ps(k.peerVar + i);
+    __m128 pd = _mm_sub_ps(_mm_sub_ps(x, _mm_loadu_ps(k.peerMean + i)), po);
+    __m128 peerReady = _mm_and_ps(_mm_cmpgt_ps(pv, zero), _mm_cmpge_ps(pc, warmup));
+    __m128 peer = _mm_and_ps(peerReady, _mm_div_ps(absPs(pd), _mm_max_ps(_mm_sqrt_ps(pvar), minStd)));
+
+    __m128 n1 = _mm_add_ps(n, f);
+    __m128 delta = _mm_sub_ps(x, mean);
+    __m128 mean1 = _mm_add_ps(mean, _mm_div_ps(_mm_mul_ps(f, delta), _mm_max_ps(n1, one)));
+    _mm_storeu_ps(k.count + i, n1);
+    _mm_storeu_ps(k.mean + i, mean1);
+    _mm_storeu_ps(k.m2 + i, _mm_add_ps(m2, _mm_mul_ps(_mm_mul_ps(f, delta), _mm_sub_ps(x, mean1))));
+
+    __m128 g = _mm_and_ps(seasonReady, f);
+    __m128 rw = _mm_mul_ps(_mm_max_ps(_mm_div_ps(one, _mm_add_ps(rc, one)), alpha), g);
+    _mm_storeu_ps(k.residualVar + i, _mm_mul_ps(_mm_sub_ps(one, rw), _mm_add_ps(rv, _mm_mul_ps(rw, _mm_mul_ps(residual, residual)))));
+    _mm_storeu_ps(k.residualCount + i, _mm_add_ps(rc, g));
+    __m128 sw = _mm_mul_ps(_mm_max_ps(_mm_div_ps(one, _mm_add_ps(sc, one)), alpha), f);
+    _mm_storeu_ps(k.seasonal + i, _mm_add_ps(base, _mm_mul_ps(sw, residual)));
+    _mm_storeu_ps(k.seasonalCount + i, _mm_add_ps(sc, f));
+    __m128 pw = _mm_mul_ps(_mm_max_ps(_mm_div_ps(one, _mm_add_ps(pc, one)), alpha), pv);
+    _mm_storeu_ps(k.peerOffset + i, _mm_add_ps(po, _mm_mul_ps(pw, pd)));
+    _mm_storeu_ps(k.peerVar + i, _mm_mul_ps(_mm_sub_ps(one, pw), _mm_add_ps(pvar, _mm_mul_ps(pw, _mm_mul_ps(pd, pd)))));
+    _mm_storeu_ps(k.peerCount + i, _mm_add_ps(pc, pv));
+
+    _mm_storeu_ps(k.historyScore + i, _mm_mul_ps(history, f));
+    _mm_storeu_ps(k.peerScore + i, _mm_mul_ps(peer, f));
+    __m128 flagged = _mm_or_ps(_mm_cmpgt_ps(history, _mm_set1_ps(k.historyThreshold)),
+                               _mm_cmpgt_ps(peer, _mm_set1_ps(k.peerThreshold)));
+    return _mm_movemask_ps(_mm_and_ps(flagged, _mm_cmpgt_ps(f, zero)));
+}
+#endif
+
+}
+
+AnomalyConfig::AnomalyConfig()
+    : seasonSlots(24)
+    , seasonMillis(24ULL * 3600ULL * 1000ULL)
+    , warmupSamples(30)
+    , seasonWarmupSamples(3)
+    , minPeers(3)
+    , seasonAlpha(0.05f)
+    , minStdDev(0.05f)
+    , historyThreshold(5.0f)
+    , peerThreshold(5.0f)
+{
+}
+
+AnomalyStats::AnomalyStats()
+    : passes(0)
+    , updates(0)
+    , unknownReadings(0)
+    , anomalies(0)
+    , lastPassMicros(0)
+    , detectors(0)
+    , groups(0)
+{
+}
+
+FleetAnomalyDetector::FleetAnomalyDetector(const AnomalyConfig& config)
+    : m_config(config)
+{
+    if (m_config.seasonSlots < 1) {
+        m_config.seasonSlots = 1;
+    }
+    if (m_config.seasonMillis < static_cast<uint64_t>(m_config.seasonSlots)) {
+        m_config.seasonMillis = m_config.seasonSlots;
+    }
+    m_seasonal.resize(m_config.seasonSlots);
+    m_seasonalCount.resize(m_config.seasonSlots);
+}
+
+FleetAnomalyDetector::~FleetAnomalyDetector()
+{
+}
+
+int FleetAnomalyDetector::findIndex(uint32_t detectorId) const
+{
+    return detectorId < m_indexById.size() ? m_indexById[detectorId] : -1;
+}
+
+bool FleetAnomalyDetector::registerDetector(uint32_t detectorId, const std::string& group)
+{
+    if (findIndex(detectorId) >= 0) {
+        return false;
+    }
+    uint32_t groupIndex;
+    std::map<std::string, uint32_t>::const_iterator it = m_groupByName.find(group);
+    if (it != m_groupByName.end()) {
+        groupIndex = it->second;
+    } else {
+        groupIndex = static_cast<uint32_t>(m_groupByName.size());
+        m_groupByName[group] = groupIndex;
+    }
+    if (detectorId >= m_indexById.size()) {
+        m_indexById.resize(detectorId + 1, -1);
+    }
+    m_indexById[detectorId] = static_cast<int>(m_ids.size());
+    m_ids.push_back(detectorId);
+    m_groupOf.push_back(groupIndex);
+    m_current.push_back(0.0f);
+    m_fresh.push_back(0.0f);
+    m_count.push_back(0.0f);
+    m_mean.push_back(0.0f);
+    m_m2.push_back(0.0f);
+    m_residualCount.push_back(0.0f);
+    m_residualVar.push_back(0.0f);
+    for (int s = 0; s < m_config.seasonSlots; ++s) {
+        m_seasonal[s].push_back(0.0f);
+        m_seasonalCount[s].push_back(0.0f);
+    }
+    m_peerMean.push_back(0.0f);
+    m_peerValid.push_back(0.0f);
+    m_peerCount.push_back(0.0f);
+    m_peerOffset.push_back(0.0f);
+    m_peerVar.push_back(0.0f);
+    m_historyScore.push_back(0.0f);
+    m_peerScore.push_back(0.0f);
+    return true;
+}
+
+bool FleetAnomalyDetector::registerDetector(Detector* detector)
+{
+    if (!detector) {
+        return false;
+    }
+    return registerDetector(detector->getId(), detector->getLocation());
+}
+
+void FleetAnomalyDetector::moveSlot(size_t from, size_t to)
+{
+    m_ids[to] = m_ids[from];
+    m_groupOf[to] = m_groupOf[from];
+    m_current[to] = m_current[from];
+    m_fresh[to] = m_fresh[from];
+    m_count[to] = m_count[from];
+    m_mean[to] = m_mean[from];
+    m_m2[to] = m_m2[from];
+    m_residualCount[to] = m_residualCount[from];
+    m_residualVar[to] = m_residualVar[from];
+    for (int s = 0; s < m_config.seasonSlots; ++s) {
+        m_seasonal[s][to] = m_seasonal[s][from];
+        m_seasonalCount[s][to] = m_seasonalCount[s][from];
+    }
+    m_peerMean[to] = m_peerMean[from];
+    m_peerValid[to] = m_peerValid[from];
+    m_peerCount[to] = m_peerCount[from];
+    m_peerOffset[to] = m_peerOffset[from];
+    m_peerVar[to] = m_peerVar[from];
+    m_historyScore[to] = m_historyScore[from];
+    m_peerScore[to] = m_peerScore[from];
+    m_indexById[m_ids[to]] = static_cast<int>(to);
+}
+
+void FleetAnomalyDetector::popSlot()
+{
+    m_ids.pop_back();
+    m_groupOf.pop_back();
+    m_current.pop_back();
+    m_fresh.pop_back();
+    m_count.pop_back();
+    m_mean.pop_back();
+    m_m2.pop_back();
+    m_residualCount.pop_back();
+    m_residualVar.pop_back();
+    for (int s = 0; s < m_config.seasonSlots; ++s) {
+        m_seasonal[s].pop_back();
+        m_seasonalCount[s].pop_back();
+    }
+    m_peerMean.pop_back();
+    m_peerValid.pop_back();
+    m_peerCount.pop_back();
+    m_peerOffset.pop_back();
+    m_peerVar.pop_back();
+    m_historyScore.pop_back();
+    m_peerScore.pop_back();
+}
+
+bool FleetAnomalyDetector::unregisterDetector(uint32_t detectorId)
+{
+    int index = findIndex(detectorId);
+    if (index < 0) {
+        return false;
+    }
+    size_t last = m_ids.size() - 1;
+    if (static_cast<size_t>(index) != last) {
+        moveSlot(last, index);
+    }
+    popSlot();
+    m_indexById[detectorId] = -1;
+    return true;
+}
+
+bool FleetAnomalyDetector::isRegistered(uint32_t detectorId) const
+{
+    return findIndex(detectorId) >= 0;
+}
+
+size_t FleetAnomalyDetector::size() const
+{
+    return m_ids.size();
+}
+
+void FleetAnomalyDetector::clear()
+{
+    m_ids.clear();
+    m_groupOf.clear();
+    m_current.clear();
+    m_fresh.clear();
+    m_count.clear();
+    m_mean.clear();
+    m_m2.clear();
+    m_residualCount.clear();
+    m_residualVar.clear();
+    for (int s = 0; s < m_config.seasonSlots; ++s) {
+        m_seasonal[s].clear();
+        m_seasonalCount[s].clear();
+    }
+    m_peerMean.clear();
+    m_peerValid.clear();
+    m_peerCount.clear();
+    m_peerOffset.clear();
+    m_peerVar.clear();
+    m_historyScore.clear();
+    m_peerScore.clear();
+    m_indexById.clear();
+    m_groupByName.clear();
+    m_events.clear();
+    m_stats = AnomalyStats();
+}
+
+const AnomalyConfig& FleetAnomalyDetector::getConfig() const
+{
+    return m_config;
+}
+
+size_t FleetAnomalyDetector::ingest(const SensorReading* readings, size_t count)
+{
+    size_t accepted = 0;
+    for (size_t i = 0; i < count; ++i) {
+        int index = findIndex(readings[i].detectorId);
+        if (index < 0) {
+            ++m_stats.unknownReadings;
+            continue;
+        }
+        m_current[index] = readings[i].value;
+        m_fresh[index] = 1.0f;
+        ++accepted;
+    }
+    return accepted;
+}
+
+size_t FleetAnomalyDetector::ingest(const std::vector<SensorReading>& readings)
+{
+    return readings.empty() ? 0 : ingest(&readings[0], readings.size());
+}
+
+void FleetAnomalyDetector::computePeers()
+{
+    size_t groups = m_groupByName.size();
+    m_groupSum.assign(groups, 0.0);
+    m_groupCount.assign(groups, 0);
+    size_t count = m_ids.size();
+    for (size_t i = 0; i < count; ++i) {
+        if (m_fresh[i] > 0.0f) {
+            uint32_t g = m_groupOf[i];
+            m_groupSum[g] += m_current[i];
+            ++m_groupCount[g];
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t g = m_groupOf[i];
+        uint32_t peers = m_groupCount[g] - (m_fresh[i] > 0.0f ? 1 : 0);
+        if (m_fresh[i] <= 0.0f || peers < m_config.minPeers) {
+            m_peerMean[i] = m_current[i];
+            m_peerValid[i] = 0.0f;
+            continue;
+        }
+        m_peerMean[i] = static_cast<float>((m_groupSum[g] - m_current[i]) / peers);
+        m_peerValid[i] = 1.0f;
+    }
+}
+
+size_t FleetAnomalyDetector::process(uint64_t timestamp)
+{
+    uint64_t start = monotonicMicros();
+    m_events.clear();
+    size_t count = m_ids.size();
+    if (count == 0) {
+        return 0;
+    }
+    computePeers();
+
+    int slot = getSeasonSlot(timestamp);
+    ScoreKernel kernel;
+    kernel.values = &m_current[0];
+    kernel.fresh = &m_fresh[0];
+    kernel.count = &m_count[0];
+    kernel.mean = &m_mean[0];
+    kernel.m2 = &m_m2[0];
+    kernel.residualCount = &m_residualCount[0];
+    kernel.residualVar = &m_residualVar[0];
+    kernel.seasonal = &m_seasonal[slot][0];
+    kernel.seasonalCount = &m_seasonalCount[slot][0];
+    kernel.peerMean = &m_peerMean[0];
+    kernel.peerValid = &m_peerValid[0];
+    kernel.peerCount = &m_peerCount[0];
+    kernel.peerOffset = &m_peerOffset[0];
+    kernel.peerVar = &m_peerVar[0];
+    kernel.historyScore = &m_historyScore[0];
+    kernel.peerScore = &m_peerScore[0];
+    kernel.warmup = static_cast<float>(m_config.warmupSamples);
+    kernel.seasonWarmup = static_cast<float>(m_config.seasonWarmupSamples);
+    kernel.alpha = m_config.seasonAlpha;
+    kernel.minStd = m_config.minStdDev;
+    kernel.historyThreshold = m_config.historyThreshold;
+    kernel.peerThreshold = m_config.peerThreshold;
+
+    std::vector<uint32_t> flagged;
+    size_t i = 0;
+#ifdef FLEET_ANOMALY_SSE2
+    for (; i + 4 <= count; i += 4) {
+        int mask = scoreVector(kernel, i);
+        while (mask) {
+            int bit = mask & -mask;
+            int lane = bit == 1 ? 0 : (bit == 2 ? 1 : (bit == 4 ? 2 : 3));
+            flagged.push_back(static_cast<uint32_t>(i + lane));
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        if (scoreScalar(kernel, i)) {
+            flagged.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    size_t updated = 0;
+    for (size_t j = 0; j < count; ++j) {
+        updated += m_fresh[j] > 0.0f ? 1 : 0;
+    }
+    std::fill(m_fresh.begin(), m_fresh.end(), 0.0f);
+
+    for (size_t f = 0; f < flagged.size(); ++f) {
+        uint32_t index = flagged[f];
+        AnomalyEvent event;
+        event.detectorId = m_ids[index];
+        event.value = m_current[index];
+        event.historyScore = m_historyScore[index];
+        event.peerScore = m_peerScore[index];
+        event.timestamp = timestamp;
+        event.reasons = 0;
+        if (event.historyScore > m_config.historyThreshold) {
+            event.reasons |= ANOMALY_HISTORY;
+        }
+        if (event.peerScore > m_config.peerThreshold) {
+            event.reasons |= ANOMALY_PEERS;
+        }
+        m_events.push_back(event);
+    }
+
+    ++m_stats.passes;
+    m_stats.updates += updated;
+    m_stats.anomalies += m_events.size();
+    m_stats.lastPassMicros = monotonicMicros() - start;
+    return m_events.size();
+}
+
+size_t FleetAnomalyDetector::ingestAndProcess(const std::vector<SensorReading>& readings, uint64_t timestamp)
+{
+    ingest(readings);
+    return process(timestamp);
+}
+
+const std::vector<AnomalyEvent>& FleetAnomalyDetector::getLastAnomalies() const
+{
+    return m_events;
+}
+
+float FleetAnomalyDetector::getMean(uint32_t detectorId) const
+{
+    int index = findIndex(detectorId);
+    return index >= 0 ? m_mean[index] : 0.0f;
+}
+
+float FleetAnomalyDetector::getStandardDeviation(uint32_t detectorId) const
+{
+    int index = findIndex(detectorId);
+    if (index < 0 || m_count[index] < 2.0f) {
+        return 0.0f;
+    }
+    return std::sqrt(m_m2[index] / (m_count[index] - 1.0f));
+}
+
+float FleetAnomalyDetector::getSeasonalBaseline(uint32_t detectorId, uint64_t timestamp) const
+{
+    int index = findIndex(detectorId);
+    return index >= 0 ? m_seasonal[getSeasonSlot(timestamp)][index] : 0.0f;
+}
+
+float FleetAnomalyDetector::getHistoryScore(uint32_t detectorId) const
+{
+    int index = findIndex(detectorId);
+    return index >= 0 ? m_historyScore[index] : 0.0f;
+}
+
+float FleetAnomalyDetector::getPeerScore(uint32_t detectorId) const
+{
+    int index = findIndex(detectorId);
+    return index >= 0 ? m_peerScore[index] : 0.0f;
+}
+
+uint32_t FleetAnomalyDetector::getSampleCount(uint32_t detectorId) const
+{
+    int index = findIndex(detectorId);
+    return index >= 0 ? static_cast<uint32_t>(m_count[index]) : 0;
+}
+
+int FleetAnomalyDetector::getSeasonSlot(uint64_t timestamp) const
+{
+    uint64_t slotMillis = m_config.seasonMillis / m_config.seasonSlots;
+    return static_cast<int>((timestamp / slotMillis) % m_config.seasonSlots);
+}
+
+size_t FleetAnomalyDetector::getMemoryBytes() const
+{
+    size_t perDetector = sizeof(uint32_t) * 2 + sizeof(float) * (14 + 2 * m_config.seasonSlots);
+    return m_ids.capacity() * perDetector + m_indexById.capacity() * sizeof(int);
+}
+
+AnomalyStats FleetAnomalyDetector::getStats() const
+{
+    AnomalyStats stats = m_stats;
+    stats.detectors = m_ids.size();
+    stats.groups = m_groupByName.size();
+    return stats;
+}
+
+std::string FleetAnomalyDetector::getKernelName()
+{
+#ifdef FLEET_ANOMALY_SSE2
+    return "SSE2";
+#else
+    return "Scalar";
+#endif
+}
+
+}
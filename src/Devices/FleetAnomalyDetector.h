@@ -0,0 +1,115 @@
+#ifndef FLEET_ANOMALY_DETECTOR_H
+#define FLEET_ANOMALY_DETECTOR_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include "common_types.h"
+#include "SensorPipeline.h"
+
+namespace MySweetHome {
+
+class Detector;
+
+enum AnomalyReason {
+    ANOMALY_HISTORY = 1,
+    ANOMALY_PEERS = 2
+};
+struct AnomalyEvent {
+    uint32_t detectorId;
+    float value;
+    float historyScore;
+    float peerScore;
+    uint64_t timestamp;
+    int reasons;
+};
+struct AnomalyConfig {
+    int seasonSlots;
+    uint64_t seasonMillis;
+    uint32_t warmupSamples;
+    uint32_t seasonWarmupSamples;
+    uint32_t minPeers;
+    float seasonAlpha;
+    float minStdDev;
+    float historyThreshold;
+    float peerThreshold;
+
+    AnomalyConfig();
+};
+struct AnomalyStats {
+    uint64_t passes;
+    uint64_t updates;
+    uint64_t unknownReadings;
+    uint64_t anomalies;
+    uint64_t lastPassMicros;
+    size_t detectors;
+    size_t groups;
+
+    AnomalyStats();
+};
+class FleetAnomalyDetector {
+public:
+    explicit FleetAnomalyDetector(const AnomalyConfig& config = AnomalyConfig());
+    ~FleetAnomalyDetector();
+    bool registerDetector(uint32_t detectorId, const std::string& group);
+    bool registerDetector(Detector* detector);
+    bool unregisterDetector(uint32_t detectorId);
+    bool isRegistered(uint32_t detectorId) const;
+    size_t size() const;
+    void clear();
+    const AnomalyConfig& getConfig() const;
+    size_t ingest(const SensorReading* readings, size_t count);
+    size_t ingest(const std::vector<SensorReading>& readings);
+    size_t process(uint64_t timestamp);
+    size_t ingestAndProcess(const std::vector<SensorReading>& readings, uint64_t timestamp);
+    const std::vector<AnomalyEvent>& getLastAnomalies() const;
+    float getMean(uint32_t detectorId) const;
+    float getStandardDeviation(uint32_t detectorId) const;
+    float getSeasonalBaseline(uint32_t detectorId, uint64_t timestamp) const;
+    float getHistoryScore(uint32_t detectorId) const;
+    float getPeerScore(uint32_t detectorId) const;
+    uint32_t getSampleCount(uint32_t detectorId) const;
+    int getSeasonSlot(uint64_t timestamp) const;
+    size_t getMemoryBytes() const;
+    AnomalyStats getStats() const;
+    static std::string getKernelName();
+
+private:
+    FleetAnomalyDetector(const FleetAnomalyDetector&);
+    FleetAnomalyDetector& operator=(const FleetAnomalyDetector&);
+
+    int findIndex(uint32_t detectorId) const;
+    void computePeers();
+    void moveSlot(size_t from, size_t to);
+    void popSlot();
+
+    AnomalyConfig m_config;
+    std::vector<uint32_t> m_ids;
+    std::vector<uint32_t> m_groupOf;
+    std::vector<float> m_current;
+    std::vector<float> m_fresh;
+    std::vector<float> m_count;
+    std::vector<float> m_mean;
+    std::vector<float> m_m2;
+    std::vector<float> m_residualCount;
+    std::vector<float> m_residualVar;
+    std::vector<std::vector<float> > m_seasonal;
+    std::vector<std::vector<float> > m_seasonalCount;
+    std::vector<float> m_peerMean;
+    std::vector<float> m_peerValid;
+    std::vector<float> m_peerCount;
+    std::vector<float> m_peerOffset;
+    std::vector<float> m_peerVar;
+    std::vector<float> m_historyScore;
+    std::vector<float> m_peerScore;
+    std::vector<int> m_indexById;
+    std::map<std::string, uint32_t> m_groupByName;
+    std::vector<double> m_groupSum;
+    std::vector<uint32_t> m_groupCount;
+    std::vector<AnomalyEvent> m_events;
+    AnomalyStats m_stats;
+};
+
+}
+
+#endif
@@ -0,0 +1,743 @@
+#include "FramePipeline.h"
+#include "Camera.h"
+#include "Logger.h"
+#include "MonotonicTime.h"
+#include <cstring>
+
+namespace MySweetHome {
+struct FrameSlab {
+    uint8_t* memory;
+    AtomicCounter frames;
+
+    FrameSlab(uint8_t* slab, long outstanding) : memory(slab), frames(outstanding) {}
+};
+FrameBuffer::FrameBuffer()
+    : data(0)
+    , size(0)
+    , width(0)
+    , height(0)
+    , stride(0)
+    , cameraId(0)
+    , sequence(0)
+    , timestamp(0)
+    , references(0)
+    , pool(0)
+    , orphanSlab(0)
+    , index(0)
+{
+}
+
+FrameHandle::FrameHandle()
+    : m_buffer(0)
+{
+}
+
+FrameHandle::FrameHandle(FrameBuffer* buffer)
+    : m_buffer(buffer)
+{
+    if (m_buffer) {
+        m_buffer->references.increment();
+    }
+}
+
+FrameHandle::FrameHandle(const FrameHandle& other)
+    : m_buffer(other.m_buffer)
+{
+    if (m_buffer) {
+        m_buffer->references.increment();
+    }
+}
+
+FrameHandle& FrameHandle::operator=(const FrameHandle& other)
+{
+    if (other.m_buffer) {
+        other.m_buffer->references.increment();
+    }
+    reset();
+    m_buffer = other.m_buffer;
+    return *this;
+}
+
+FrameHandle::~FrameHandle()
+{
+    reset();
+}
+
+bool FrameHandle::isValid() const
+{
+    return m_buffer != 0;
+}
+
+FrameBuffer* FrameHandle::get() const
+{
+    return m_buffer;
+}
+
+FrameBuffer* FrameHandle::operator->() const
+{
+    return m_buffer;
+}
+
+const uint8_t* FrameHandle::data() const
+{
+    return m_buffer ? m_buffer->data : 0;
+}
+
+uint8_t* FrameHandle::mutableData() const
+{
+    return m_buffer ? m_buffer->data : 0;
+}
+
+long FrameHandle::useCount() const
+{
+    return m_buffer ? m_buffer->references.get() : 0;
+}
+
+void FrameHandle::reset()
+{
+    if (m_buffer) {
+        FrameBuffer* buffer = m_buffer;
+        m_buffer = 0;
+        if (buffer->references.decrement() == 0) {
+            if (buffer->pool) {
+                buffer->pool->release(buffer);
+            } else if (buffer->orphanSlab) {
+                FramePool::releaseOrphan(buffer);
+            }
+        }
+    }
+}
+
+FramePoolStats::FramePoolStats()
+    : capacity(0)
+    , inUse(0)
+    , highWater(0)
+    , acquired(0)
+    , exhausted(0)
+    , slabBytes(0)
+{
+}
+
+FramePool::FramePool(size_t frameCount, int width, int height, size_t alignment)
+    : m_slab(0)
+    , m_width(width > 0 ? width : 1)
+    , m_height(height > 0 ? height : 1)
+    , m_stride(0)
+    , m_frameBytes(0)
+{
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) {
+        alignment = 64;
+    }
+    m_stride = static_cast<int>((m_width + alignment - 1) / alignment * alignment);
+    m_frameBytes = static_cast<size_t>(m_stride) * m_height;
+    m_slab = static_cast<uint8_t*>(alignedAllocate(m_frameBytes * (frameCount > 0 ? frameCount : 1), alignment));
+    if (!m_slab) {
+        Logger::getInstance().error("FramePool: failed to allocate frame slab");
+        frameCount = 0;
+    }
+    m_frames.reserve(frameCount);
+    m_free.reserve(frameCount);
+    for (size_t i = 0; i < frameCount; ++i) {
+        FrameBuffer* frame = new FrameBuffer();
+        frame->data = m_slab + i * m_frameBytes;
+        frame->size = m_frameBytes;
+        frame->width = m_width;
+        frame->height = m_height;
+        frame->stride = m_stride;
+        frame->pool = this;
+        frame->index = static_cast<uint32_t>(i);
+        m_frames.push_back(frame);
+        m_free.push_back(static_cast<uint32_t>(frameCount - 1 - i));
+    }
+    m_stats.capacity = frameCount;
+    m_stats.slabBytes = m_frameBytes * frameCount;
+}
+
+FramePool::~FramePool()
+{
+    // Handles that outlive the pool keep the slab alive; the last one to drop
+    // frees it. Dropping them concurrently with the destructor is not supported.
+    long outstanding = 0;
+    for (size_t i = 0; i < m_frames.size(); ++i) {
+        if (m_frames[i]->references.get() > 0) {
+            ++outstanding;
+        }
+    }
+    FrameSlab* orphanSlab = 0;
+    if (outstanding > 0) {
+        Logger::getInstance().warning("FramePool: destroyed while frames are still referenced");
+        orphanSlab = new FrameSlab(m_slab, outstanding);
+    }
+    for (size_t i = 0; i < m_frames.size(); ++i) {
+        m_frames[i]->pool = 0;
+        if (m_frames[i]->references.get() > 0) {
+            m_frames[i]->orphanSlab = orphanSlab;
+        } else {
+            delete m_frames[i];
+        }
+    }
+    if (m_slab && !orphanSlab) {
+        alignedFree(m_slab);
+    }
+}
+
+void FramePool::releaseOrphan(FrameBuffer* buffer)
+{
+    FrameSlab* slab = buffer->orphanSlab;
+    delete buffer;
+    if (slab->frames.decrement() == 0) {
+        alignedFree(slab->memory);
+        delete slab;
+    }
+}
+
+FrameHandle FramePool::acquire()
+{
+    FrameBuffer* frame = 0;
+    {
+        ScopedLock lock(m_mutex);
+        if (m_free.empty()) {
+            ++m_stats.exhausted;
+            return FrameHandle();
+        }
+        frame = m_frames[m_free.back()];
+        m_free.pop_back();
+        ++m_stats.acquired;
+        ++m_stats.inUse;
+        if (m_stats.inUse > m_stats.highWater) {
+            m_stats.highWater = m_stats.inUse;
+        }
+    }
+    frame->cameraId = 0;
+    frame->sequence = 0;
+    frame->timestamp = 0;
+    return FrameHandle(frame);
+}
+
+void FramePool::release(FrameBuffer* buffer)
+{
+    ScopedLock lock(m_mutex);
+    m_free.push_back(buffer->index);
+    --m_stats.inUse;
+}
+
+size_t FramePool::capacity() const
+{
+    return m_frames.size();
+}
+
+size_t FramePool::available() const
+{
+    ScopedLock lock(m_mutex);
+    return m_free.size();
+}
+
+int FramePool::getWidth() const
+{
+    return m_width;
+}
+
+int FramePool::getHeight() const
+{
+    return m_height;
+}
+
+int FramePool::getStride() const
+{
+    return m_stride;
+}
+
+FramePoolStats FramePool::getStats() const
+{
+    ScopedLock lock(m_mutex);
+    return m_stats;
+}
+
+FrameQueue::FrameQueue(size_t depth, DropPolicy policy)
+    : m_slots(depth > 0 ? depth : 1)
+    , m_head(0)
+    , m_count(0)
+    , m_policy(policy)
+    , m_dropped(0)
+    , m_highWater(0)
+{
+}
+
+FrameQueue::~FrameQueue()
+{
+}
+
+bool FrameQueue::push(const FrameHandle& frame)
+{
+    ScopedLock lock(m_mutex);
+    if (m_count == m_slots.size()) {
+        ++m_dropped;
+        if (m_policy == DROP_NEWEST) {
+            return false;
+        }
+        m_slots[m_head].reset();
+        m_head = (m_head + 1) % m_slots.size();
+        --m_count;
+    }
+    m_slots[(m_head + m_count) % m_slots.size()] = frame;
+    ++m_count;
+    if (m_count > m_highWater) {
+        m_highWater = m_count;
+    }
+    return true;
+}
+
+bool FrameQueue::pop(FrameHandle& frame)
+{
+    ScopedLock lock(m_mutex);
+    if (m_count == 0) {
+        return false;
+    }
+    frame = m_slots[m_head];
+    m_slots[m_head].reset();
+    m_head = (m_head + 1) % m_slots.size();
+    --m_count;
+    return true;
+}
+
+size_t FrameQueue::size() const
+{
+    ScopedLock lock(m_mutex);
+    return m_count;
+}
+
+size_t FrameQueue::depth() const
+{
+    return m_slots.size();
+}
+
+bool FrameQueue::empty() const
+{
+    return size() == 0;
+}
+
+void FrameQueue::clear()
+{
+    ScopedLock lock(m_mutex);
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        m_slots[i].reset();
+    }
+    m_head = 0;
+    m_count = 0;
+}
+
+uint64_t FrameQueue::getDropped() const
+{
+    ScopedLock lock(m_mutex);
+    return m_dropped;
+}
+
+size_t FrameQueue::getHighWater() const
+{
+    ScopedLock lock(m_mutex);
+    return m_highWater;
+}
+
+FrameQueue::DropPolicy FrameQueue::getPolicy() const
+{
+    return m_policy;
+}
+
+SyntheticFrameSource::SyntheticFrameSource(uint32_t seed, int objectSize, int speed)
+    : m_state(seed ? seed : 1)
+    , m_objectSize(objectSize > 0 ? objectSize : 1)
+    , m_speed(speed)
+    , m_noise(0)
+    , m_moving(true)
+    , m_frames(0)
+{
+}
+
+SyntheticFrameSource::~SyntheticFrameSource()
+{
+}
+
+bool SyntheticFrameSource::fill(FrameBuffer& frame, uint64_t nowMillis)
+{
+    (void)nowMillis;
+    int span = frame.width > m_objectSize ? frame.width - m_objectSize : 1;
+    int position = m_moving ? static_cast<int>((m_frames * m_speed) % span) : 0;
+    int top = (frame.height - m_objectSize) / 2;
+    for (int y = 0; y < frame.height; ++y) {
+        uint8_t* row = frame.data + static_cast<size_t>(y) * frame.stride;
+        std::memset(row, 32, frame.width);
+        if (y >= top && y < top + m_objectSize) {
+            int length = m_objectSize < frame.width - position ? m_objectSize : frame.width - position;
+            std::memset(row + position, 224, length);
+        }
+        if (m_noise > 0) {
+            for (int x = 0; x < frame.width; x += 7) {
+                m_state = m_state * 1664525u + 1013904223u;
+                row[x] = static_cast<uint8_t>(row[x] + (m_state >> 24) % (m_noise + 1));
+            }
+        }
+    }
+    ++m_frames;
+    return true;
+}
+
+void SyntheticFrameSource::setMoving(bool moving)
+{
+    m_moving = moving;
+}
+
+bool SyntheticFrameSource::isMoving() const
+{
+    return m_moving;
+}
+
+void SyntheticFrameSource::setNoise(int amplitude)
+{
+    m_noise = amplitude > 0 ? amplitude : 0;
+}
+
+FileFrameSource::FileFrameSource(const std::string& path, bool loop)
+    : m_file(std::fopen(path.c_str(), "rb"))
+    , m_path(path)
+    , m_loop(loop)
+    , m_framesRead(0)
+{
+    if (!m_file) {
+        Logger::getInstance().error("FileFrameSource: cannot open " + path);
+    }
+}
+
+FileFrameSource::~FileFrameSource()
+{
+    if (m_file) {
+        std::fclose(m_file);
+    }
+}
+
+bool FileFrameSource::fill(FrameBuffer& frame, uint64_t nowMillis)
+{
+    (void)nowMillis;
+    if (!m_file) {
+        return false;
+    }
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        int y = 0;
+        for (; y < frame.height; ++y) {
+            uint8_t* row = frame.data + static_cast<size_t>(y) * frame.stride;
+            if (std::fread(row, 1, frame.width, m_file) != static_cast<size_t>(frame.width)) {
+                break;
+            }
+        }
+        if (y == frame.height) {
+            ++m_framesRead;
+            return true;
+        }
+        if (!m_loop || std::fseek(m_file, 0, SEEK_SET) != 0) {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool FileFrameSource::isOpen() const
+{
+    return m_file != 0;
+}
+
+uint64_t FileFrameSource::getFramesRead() const
+{
+    return m_framesRead;
+}
+
+FramePipelineStats::FramePipelineStats()
+    : captured(0)
+    , captureFailures(0)
+    , poolExhausted(0)
+    , completed(0)
+    , cameras(0)
+{
+}
+
+RecordingStage::RecordingStage()
+    : m_frames(0)
+    , m_bytes(0)
+{
+}
+
+RecordingStage::~RecordingStage()
+{
+}
+
+std::string RecordingStage::getStageName() const
+{
+    return "Record";
+}
+
+bool RecordingStage::processFrame(const FrameHandle& frame, Camera* camera)
+{
+    if (!camera || !camera->isRecording()) {
+        return false;
+    }
+    ++m_frames;
+    m_bytes += static_cast<uint64_t>(frame->width) * frame->height;
+    return true;
+}
+
+uint64_t RecordingStage::getFrames() const
+{
+    return m_frames;
+}
+
+uint64_t RecordingStage::getBytes() const
+{
+    return m_bytes;
+}
+
+StreamingStage::StreamingStage()
+    : m_frames(0)
+    , m_bytes(0)
+{
+}
+
+StreamingStage::~StreamingStage()
+{
+}
+
+std::string StreamingStage::getStageName() const
+{
+    return "Stream";
+}
+
+bool StreamingStage::processFrame(const FrameHandle& frame, Camera* camera)
+{
+    if (!camera || camera->getCameraMode() != CAMERA_STREAMING) {
+        return false;
+    }
+    ++m_frames;
+    m_bytes += static_cast<uint64_t>(frame->width) * frame->height;
+    return true;
+}
+
+uint64_t StreamingStage::getFrames() const
+{
+    return m_frames;
+}
+
+uint64_t StreamingStage::getBytes() const
+{
+    return m_bytes;
+}
+
+FramePipeline::FramePipeline(FramePool* pool)
+    : m_pool(pool)
+{
+}
+
+FramePipeline::~FramePipeline()
+{
+    for (size_t i = 0; i < m_stages.size(); ++i) {
+        delete m_stages[i].queue;
+    }
+}
+
+bool FramePipeline::addCamera(Camera* camera, IFrameSource* source)
+{
+    if (!camera || !source || findCamera(camera->getId())) {
+        return false;
+    }
+    CameraSlot slot;
+    slot.camera = camera;
+    slot.source = source;
+    slot.startedAt = 0;
+    slot.frameIndex = 0;
+    slot.nextDue = 0;
+    slot.sequence = 0;
+    m_cameras.push_back(slot);
+    return true;
+}
+
+bool FramePipeline::removeCamera(Camera* camera)
+{
+    for (size_t i = 0; i < m_cameras.size(); ++i) {
+        if (m_cameras[i].camera == camera) {
+            m_cameras.erase(m_cameras.begin() + i);
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t FramePipeline::getCameraCount() const
+{
+    return m_cameras.size();
+}
+
+void FramePipeline::addStage(IFrameStage* stage, FrameStageKind kind, size_t queueDepth,
+                             size_t budgetPerPump, FrameQueue::DropPolicy policy)
+{
+    if (!stage) {
+        return;
+    }
+    StageSlot slot;
+    slot.stage = stage;
+    slot.kind = kind;
+    slot.queue = new FrameQueue(queueDepth, policy);
+    slot.budget = budgetPerPump;
+    slot.received = 0;
+    slot.processed = 0;
+    slot.rejected = 0;
+    slot.busyMicros = 0;
+    if (kind == FRAME_STAGE_ANALYSIS) {
+        size_t position = 0;
+        while (position < m_stages.size() && m_stages[position].kind == FRAME_STAGE_ANALYSIS) {
+            ++position;
+        }
+        m_stages.insert(m_stages.begin() + position, slot);
+    } else {
+        m_stages.push_back(slot);
+    }
+}
+
+Camera* FramePipeline::findCamera(uint32_t cameraId) const
+{
+    for (size_t i = 0; i < m_cameras.size(); ++i) {
+        if (m_cameras[i].camera->getId() == cameraId) {
+            return m_cameras[i].camera;
+        }
+    }
+    return 0;
+}
+
+void FramePipeline::enqueue(StageSlot& slot, const FrameHandle& frame)
+{
+    ++slot.received;
+    slot.queue->push(frame);
+}
+
+void FramePipeline::forward(size_t stageIndex, const FrameHandle& frame)
+{
+    size_t next = stageIndex;
+    if (next < m_stages.size() && m_stages[next].kind == FRAME_STAGE_ANALYSIS) {
+        enqueue(m_stages[next], frame);
+        return;
+    }
+    ++m_stats.completed;
+    for (size_t i = next; i < m_stages.size(); ++i) {
+        enqueue(m_stages[i], frame);
+    }
+}
+
+size_t FramePipeline::capture(uint64_t nowMillis)
+{
+    size_t captured = 0;
+    for (size_t i = 0; i < m_cameras.size(); ++i) {
+        CameraSlot& slot = m_cameras[i];
+        int fps = slot.camera->getFPS();
+        if (!slot.camera->isOn() || fps <= 0) {
+            continue;
+        }
+        if (slot.sequence == 0) {
+            slot.startedAt = nowMillis;
+            slot.frameIndex = 0;
+            slot.nextDue = nowMillis;
+        }
+        if (nowMillis < slot.nextDue) {
+            continue;
+        }
+        ++slot.frameIndex;
+        slot.nextDue = slot.startedAt + slot.frameIndex * 1000ULL / fps;
+        if (slot.nextDue <= nowMillis) {
+            slot.startedAt = nowMillis;
+            slot.frameIndex = 1;
+            slot.nextDue = nowMillis + 1000ULL / fps;
+        }
+        ++slot.sequence;
+
+        FrameHandle frame = m_pool ? m_pool->acquire() : FrameHandle();
+        if (!frame.isValid()) {
+            ++m_stats.poolExhausted;
+            continue;
+        }
+        frame->cameraId = slot.camera->getId();
+        frame->sequence = slot.sequence;
+        frame->timestamp = nowMillis;
+        if (!slot.source->fill(*frame.get(), nowMillis)) {
+            ++m_stats.captureFailures;
+            continue;
+        }
+        ++m_stats.captured;
+        ++captured;
+        forward(0, frame);
+    }
+    return captured;
+}
+
+size_t FramePipeline::pump()
+{
+    size_t handled = 0;
+    FrameHandle frame;
+    for (size_t s = 0; s < m_stages.size(); ++s) {
+        StageSlot& slot = m_stages[s];
+        size_t budget = slot.budget;
+        size_t done = 0;
+        while ((budget == 0 || done < budget) && slot.queue->pop(frame)) {
+            ++done;
+            Camera* camera = findCamera(frame->cameraId);
+            uint64_t start = monotonicMicros();
+            bool accepted = slot.stage->processFrame(frame, camera);
+            slot.busyMicros += monotonicMicros() - start;
+            if (!accepted) {
+                ++slot.rejected;
+            } else {
+                ++slot.processed;
+                if (slot.kind == FRAME_STAGE_ANALYSIS) {
+                    forward(s + 1, frame);
+                }
+            }
+            frame.reset();
+        }
+        handled += done;
+    }
+    return handled;
+}
+
+size_t FramePipeline::tick(uint64_t nowMillis)
+{
+    capture(nowMillis);
+    return pump();
+}
+
+void FramePipeline::drain()
+{
+    for (size_t i = 0; i < m_stages.size(); ++i) {
+        m_stages[i].queue->clear();
+    }
+}
+
+FramePool* FramePipeline::getPool() const
+{
+    return m_pool;
+}
+
+FramePipelineStats FramePipeline::getStats() const
+{
+    FramePipelineStats stats = m_stats;
+    stats.cameras = m_cameras.size();
+    for (size_t i = 0; i < m_stages.size(); ++i) {
+        const StageSlot& slot = m_stages[i];
+        FrameStageStats stage;
+        stage.name = slot.stage->getStageName();
+        stage.kind = slot.kind;
+        stage.received = slot.received;
+        stage.processed = slot.processed;
+        stage.rejected = slot.rejected;
+        stage.dropped = slot.queue->getDropped();
+        stage.queued = slot.queue->size();
+        stage.highWater = slot.queue->getHighWater();
+        stage.busyMicros = slot.busyMicros;
+        stats.stages.push_back(stage);
+    }
+    return stats;
+}
+
+}
@@ -0,0 +1,267 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include "common_types.h"
+#include "Atomic.h"
+#include "Mutex.h"
+
+namespace MySweetHome {
+
+class Camera;
+class FramePool;
+struct FrameSlab;
+struct FrameBuffer {
+    uint8_t* data;
+    size_t size;
+    int width;
+    int height;
+    int stride;
+    uint32_t cameraId;
+    uint64_t sequence;
+    uint64_t timestamp;
+    AtomicCounter references;
+    FramePool* pool;
+    FrameSlab* orphanSlab;
+    uint32_t index;
+
+    FrameBuffer();
+};
+class FrameHandle {
+public:
+    FrameHandle();
+    explicit FrameHandle(FrameBuffer* buffer);
+    FrameHandle(const FrameHandle& other);
+    FrameHandle& operator=(const FrameHandle& other);
+    ~FrameHandle();
+    bool isValid() const;
+    FrameBuffer* get() const;
+    FrameBuffer* operator->() const;
+    const uint8_t* data() const;
+    uint8_t* mutableData() const;
+    long useCount() const;
+    void reset();
+
+private:
+    FrameBuffer* m_buffer;
+};
+struct FramePoolStats {
+    size_t capacity;
+    size_t inUse;
+    size_t highWater;
+    uint64_t acquired;
+    uint64_t exhausted;
+    size_t slabBytes;
+
+    FramePoolStats();
+};
+class FramePool {
+public:
+    FramePool(size_t frameCount, int width, int height, size_t alignment = 64);
+    ~FramePool();
+    FrameHandle acquire();
+    size_t capacity() const;
+    size_t available() const;
+    int getWidth() const;
+    int getHeight() const;
+    int getStride() const;
+    FramePoolStats getStats() const;
+
+private:
+    FramePool(const FramePool&);
+    FramePool& operator=(const FramePool&);
+    friend class FrameHandle;
+    void release(FrameBuffer* buffer);
+    static void releaseOrphan(FrameBuffer* buffer);
+
+    uint8_t* m_slab;
+    std::vector<FrameBuffer*> m_frames;
+    std::vector<uint32_t> m_free;
+    int m_width;
+    int m_height;
+    int m_stride;
+    size_t m_frameBytes;
+    mutable Mutex m_mutex;
+    FramePoolStats m_stats;
+};
+class FrameQueue {
+public:
+    enum DropPolicy {
+        DROP_OLDEST,
+        DROP_NEWEST
+    };
+
+    explicit FrameQueue(size_t depth = 4, DropPolicy policy = DROP_OLDEST);
+    ~FrameQueue();
+    bool push(const FrameHandle& frame);
+    bool pop(FrameHandle& frame);
+    size_t size() const;
+    size_t depth() const;
+    bool empty() const;
+    void clear();
+    uint64_t getDropped() const;
+    size_t getHighWater() const;
+    DropPolicy getPolicy() const;
+
+private:
+    FrameQueue(const FrameQueue&);
+    FrameQueue& operator=(const FrameQueue&);
+
+    std::vector<FrameHandle> m_slots;
+    size_t m_head;
+    size_t m_count;
+    DropPolicy m_policy;
+    uint64_t m_dropped;
+    size_t m_highWater;
+    mutable Mutex m_mutex;
+};
+class IFrameSource {
+public:
+    virtual ~IFrameSource() {}
+    virtual bool fill(FrameBuffer& frame, uint64_t nowMillis) = 0;
+};
+class SyntheticFrameSource : public IFrameSource {
+public:
+    SyntheticFrameSource(uint32_t seed = 1, int objectSize = 16, int speed = 2);
+    virtual ~SyntheticFrameSource();
+    virtual bool fill(FrameBuffer& frame, uint64_t nowMillis);
+    void setMoving(bool moving);
+    bool isMoving() const;
+    void setNoise(int amplitude);
+
+private:
+    uint32_t m_state;
+    int m_objectSize;
+    int m_speed;
+    int m_noise;
+    bool m_moving;
+    uint64_t m_frames;
+};
+class FileFrameSource : public IFrameSource {
+public:
+    FileFrameSource(const std::string& path, bool loop = true);
+    virtual ~FileFrameSource();
+    virtual bool fill(FrameBuffer& frame, uint64_t nowMillis);
+    bool isOpen() const;
+    uint64_t getFramesRead() const;
+
+private:
+    FileFrameSource(const FileFrameSource&);
+    FileFrameSource& operator=(const FileFrameSource&);
+
+    std::FILE* m_file;
+    std::string m_path;
+    bool m_loop;
+    uint64_t m_framesRead;
+};
+class IFrameStage {
+public:
+    virtual ~IFrameStage() {}
+    virtual std::string getStageName() const = 0;
+    virtual bool processFrame(const FrameHandle& frame, Camera* camera) = 0;
+};
+enum FrameStageKind {
+    FRAME_STAGE_ANALYSIS,
+    FRAME_STAGE_OUTPUT
+};
+struct FrameStageStats {
+    std::string name;
+    FrameStageKind kind;
+    uint64_t received;
+    uint64_t processed;
+    uint64_t rejected;
+    uint64_t dropped;
+    size_t queued;
+    size_t highWater;
+    uint64_t busyMicros;
+};
+struct FramePipelineStats {
+    uint64_t captured;
+    uint64_t captureFailures;
+    uint64_t poolExhausted;
+    uint64_t completed;
+    size_t cameras;
+    std::vector<FrameStageStats> stages;
+
+    FramePipelineStats();
+};
+class RecordingStage : public IFrameStage {
+public:
+    RecordingStage();
+    virtual ~RecordingStage();
+    virtual std::string getStageName() const;
+    virtual bool processFrame(const FrameHandle& frame, Camera* camera);
+    uint64_t getFrames() const;
+    uint64_t getBytes() const;
+
+private:
+    uint64_t m_frames;
+    uint64_t m_bytes;
+};
+class StreamingStage : public IFrameStage {
+public:
+    StreamingStage();
+    virtual ~StreamingStage();
+    virtual std::string getStageName() const;
+    virtual bool processFrame(const FrameHandle& frame, Camera* camera);
+    uint64_t getFrames() const;
+    uint64_t getBytes() const;
+
+private:
+    uint64_t m_frames;
+    uint64_t m_bytes;
+};
+class FramePipeline {
+public:
+    explicit FramePipeline(FramePool* pool);
+    ~FramePipeline();
+    bool addCamera(Camera* camera, IFrameSource* source);
+    bool removeCamera(Camera* camera);
+    size_t getCameraCount() const;
+    void addStage(IFrameStage* stage, FrameStageKind kind, size_t queueDepth = 8,
+                  size_t budgetPerPump = 0, FrameQueue::DropPolicy policy = FrameQueue::DROP_OLDEST);
+    size_t capture(uint64_t nowMillis);
+    size_t pump();
+    size_t tick(uint64_t nowMillis);
+    void drain();
+    FramePool* getPool() const;
+    FramePipelineStats getStats() const;
+
+private:
+    struct CameraSlot {
+        Camera* camera;
+        IFrameSource* source;
+        uint64_t startedAt;
+        uint64_t frameIndex;
+        uint64_t nextDue;
+        uint64_t sequence;
+    };
+    struct StageSlot {
+        IFrameStage* stage;
+        FrameStageKind kind;
+        FrameQueue* queue;
+        size_t budget;
+        uint64_t received;
+        uint64_t processed;
+        uint64_t rejected;
+        uint64_t busyMicros;
+    };
+
+    FramePipeline(const FramePipeline&);
+    FramePipeline& operator=(const FramePipeline&);
+
+    Camera* findCamera(uint32_t cameraId) const;
+    void forward(size_t stageIndex, const FrameHandle& frame);
+    void enqueue(StageSlot& slot, const FrameHandle& frame);
+
+    FramePool* m_pool;
+    std::vector<CameraSlot> m_cameras;
+    std::vector<StageSlot> m_stages;
+    FramePipelineStats m_stats;
+};
+
+}
+
+#endif
@@ -16,6 +16,7 @@ Light::~Light()
 }
 
 void Light::setBrightness(uint8_t level) {
+    markModified();
     m_brightness = (level > 100) ? 100 : level;
 }
 
@@ -24,6 +25,7 @@ uint8_t Light::getBrightness() const {
 }
 
 void Light::setColor(uint8_t r, uint8_t g, uint8_t b) {
+    markModified();
     m_colorR = r;
     m_colorG = g;
     m_colorB = b;
@@ -43,6 +45,7 @@ Device* Light::clone() const {
 }
 
 void Light::turnOn() {
+    markModified();
     Device::turnOn();
     if (m_brightness == 0) {
         m_brightness = 100;
@@ -50,6 +53,7 @@ void Light::turnOn() {
 }
 
 void Light::turnOff() {
+    markModified();
     Device::turnOff();
 }
 
@@ -119,6 +123,7 @@ std::string PhilipsLight::getInfo() const {
 }
 
 void PhilipsLight::setColorTemperature(uint16_t kelvin) {
+    markModified();
     if (kelvin >= 2000 && kelvin <= 6500) {
         m_colorTemperature = kelvin;
     }
@@ -129,6 +134,7 @@ uint16_t PhilipsLight::getColorTemperature() const {
 }
 
 void PhilipsLight::enableZigbee(bool enable) {
+    markModified();
     m_zigbeeEnabled = enable;
 }
 
@@ -162,6 +168,7 @@ std::string IKEALight::getInfo() const {
 }
 
 void IKEALight::setWarmWhite(bool warm) {
+    markModified();
     m_warmWhite = warm;
 }
 
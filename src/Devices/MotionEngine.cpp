@@ -0,0 +1,389 @@
+#include "MotionEngine.h"
+#include "Camera.h"
+#include "DetectionStrategy.h"
+#include "MonotonicTime.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MOTION_ENGINE_SSE2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MOTION_ENGINE_SSE2 1
+#endif
+
+namespace MySweetHome {
+namespace {
+const int CHUNK = 16;
+
+int normalizeBlockSize(int blockSize)
+{
+    if (blockSize < CHUNK) {
+        return CHUNK;
+    }
+    return blockSize / CHUNK * CHUNK;
+}
+
+}
+
+MotionEngineStats::MotionEngineStats()
+    : submitted(0)
+    , analyzed(0)
+    , superseded(0)
+    , motionFrames(0)
+    , kernelMicros(0)
+    , pixels(0)
+    , cameras(0)
+{
+}
+
+void MotionKernel::blockSadScalar(const uint8_t* current, const uint8_t* previous, int width, int height,
+                                  int stride, int blockSize, uint32_t* blockSums)
+{
+    int blocksX = width / blockSize;
+    int blocksY = height / blockSize;
+    std::memset(blockSums, 0, sizeof(uint32_t) * blocksX * blocksY);
+    for (int y = 0; y < blocksY * blockSize; ++y) {
+        const uint8_t* a = current + static_cast<size_t>(y) * stride;
+        const uint8_t* b = previous + static_cast<size_t>(y) * stride;
+        uint32_t* rowSums = blockSums + (y / blockSize) * blocksX;
+        for (int x = 0; x < blocksX * blockSize; ++x) {
+            int diff = static_cast<int>(a[x]) - static_cast<int>(b[x]);
+            rowSums[x / blockSize] += static_cast<uint32_t>(diff < 0 ? -diff : diff);
+        }
+    }
+}
+
+void MotionKernel::blockSad(const uint8_t* current, const uint8_t* previous, int width, int height, int stride,
+                            int blockSize, uint32_t* blockSums)
+{
+#ifdef MOTION_ENGINE_SSE2
+    blockSize = normalizeBlockSize(blockSize);
+    int blocksX = width / blockSize;
+    int blocksY = height / blockSize;
+    int chunks = blocksX * blockSize / CHUNK;
+    int chunksPerBlock = blockSize / CHUNK;
+    std::memset(blockSums, 0, sizeof(uint32_t) * blocksX * blocksY);
+    for (int y = 0; y < blocksY * blockSize; ++y) {
+        const uint8_t* a = current + static_cast<size_t>(y) * stride;
+        const uint8_t* b = previous + static_cast<size_t>(y) * stride;
+        uint32_t* rowSums = blockSums + (y / blockSize) * blocksX;
+        int c = 0;
+#if defined(__AVX2__)
+        for (; c + 2 <= chunks; c += 2) {
+            __m256i sad = _mm256_sad_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + c * CHUNK)),
+                                          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + c * CHUNK)));
+            __m128i low = _mm256_castsi256_si128(sad);
+            __m128i high = _mm256_extracti128_si256(sad, 1);
+            rowSums[c / chunksPerBlock] += _mm_cvtsi128_si32(low) + _mm_cvtsi128_si32(_mm_srli_si128(low, 8));
+            rowSums[(c + 1) / chunksPerBlock] += _mm_cvtsi128_si32(high) + _mm_cvtsi128_si32(_mm_srli_si128(high, 8));
+        }
+#endif
+        for (; c < chunks; ++c) {
+            __m128i sad = _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + c * CHUNK)),
+                                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + c * CHUNK)));
+            rowSums[c / chunksPerBlock] += _mm_cvtsi128_si32(sad) + _mm_cvtsi128_si32(_mm_srli_si128(sad, 8));
+        }
+    }
+#else
+    blockSadScalar(current, previous, width, height, stride, normalizeBlockSize(blockSize), blockSums);
+#endif
+}
+
+std::string MotionKernel::getName()
+{
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(MOTION_ENGINE_SSE2)
+    return "SSE2";
+#else
+    return "Scalar";
+#endif
+}
+
+MotionEngine::CameraJob::CameraJob(MotionEngine* engine, Camera* camera, MotionDetectionStrategy* strategy)
+    : m_engine(engine)
+    , m_camera(camera)
+    , m_strategy(strategy)
+    , m_ownsStrategy(strategy == 0)
+    , m_queued(false)
+    , m_motion(false)
+{
+    if (!m_strategy) {
+        m_strategy = new MotionDetectionStrategy();
+    }
+}
+
+MotionEngine::CameraJob::~CameraJob()
+{
+    if (m_ownsStrategy) {
+        delete m_strategy;
+    }
+}
+
+bool MotionEngine::CameraJob::offer(const FrameHandle& frame, bool& superseded)
+{
+    ScopedLock lock(m_mutex);
+    superseded = m_pending.isValid();
+    m_pending = frame;
+    if (m_queued) {
+        return false;
+    }
+    m_queued = true;
+    return true;
+}
+
+void MotionEngine::CameraJob::run()
+{
+    while (true) {
+        FrameHandle current;
+        {
+            ScopedLock lock(m_mutex);
+            if (!m_pending.isValid()) {
+                m_queued = false;
+                return;
+            }
+            current = m_pending;
+            m_pending.reset();
+        }
+        analyze(current);
+    }
+}
+
+void MotionEngine::CameraJob::analyze(const FrameHandle& current)
+{
+    const FrameBuffer* frame = current.get();
+    const FrameBuffer* previous = m_previous.get();
+    if (!previous || previous->width != frame->width || previous->height != frame->height ||
+        previous->stride != frame->stride) {
+        m_previous = current;
+        return;
+    }
+
+    int blockSize = m_engine->m_blockSize;
+    int blocksX = frame->width / blockSize;
+    int blocksY = frame->height / blockSize;
+    size_t blocks = static_cast<size_t>(blocksX) * blocksY;
+    if (m_sums.size() != blocks) {
+        m_sums.assign(blocks, 0);
+    }
+    uint64_t start = monotonicMicros();
+    if (blocks > 0) {
+        MotionKernel::blockSad(frame->data, previous->data, frame->width, frame->height, frame->stride,
+                               blockSize, &m_sums[0]);
+    }
+    uint64_t kernelMicros = monotonicMicros() - start;
+
+    uint32_t blockPixels = static_cast<uint32_t>(blockSize * blockSize);
+    uint32_t limit = static_cast<uint32_t>(blockThresholdForSensitivity(m_strategy->getSensitivity()) * blockPixels);
+    uint32_t changed = 0;
+    uint64_t total = 0;
+    for (size_t i = 0; i < blocks; ++i) {
+        total += m_sums[i];
+        if (m_sums[i] >= limit) {
+            ++changed;
+        }
+    }
+
+    MotionResult result;
+    result.cameraId = frame->cameraId;
+    result.sequence = frame->sequence;
+    result.timestamp = frame->timestamp;
+    result.changedBlocks = changed;
+    result.totalBlocks = static_cast<uint32_t>(blocks);
+    result.changedPercent = blocks > 0 ? 100.0f * changed / blocks : 0.0f;
+    result.meanDifference = blocks > 0 ? static_cast<float>(total) / (static_cast<float>(blocks) * blockPixels) : 0.0f;
+    result.motion = m_strategy->detect(result.changedPercent, m_engine->getBasePercent());
+    {
+        ScopedLock lock(m_mutex);
+        m_motion = result.motion;
+    }
+    m_previous = current;
+    m_engine->publish(result, kernelMicros, static_cast<uint64_t>(blocks) * blockPixels);
+}
+
+MotionEngine::MotionEngine(WorkerPool* workers, int blockSize)
+    : m_workers(workers)
+    , m_blockSize(normalizeBlockSize(blockSize))
+    , m_basePercent(0.5f)
+{
+}
+
+MotionEngine::~MotionEngine()
+{
+    waitIdle();
+    for (size_t i = 0; i < m_jobs.size(); ++i) {
+        delete m_jobs[i];
+    }
+}
+
+MotionEngine::CameraJob* MotionEngine::findJob(uint32_t cameraId) const
+{
+    for (size_t i = 0; i < m_jobs.size(); ++i) {
+        if (m_jobs[i]->m_camera->getId() == cameraId) {
+            return m_jobs[i];
+        }
+    }
+    return 0;
+}
+
+bool MotionEngine::addCamera(Camera* camera, MotionDetectionStrategy* strategy)
+{
+    if (!camera || findJob(camera->getId())) {
+        return false;
+    }
+    m_jobs.push_back(new CameraJob(this, camera, strategy));
+    return true;
+}
+
+bool MotionEngine::removeCamera(uint32_t cameraId)
+{
+    for (size_t i = 0; i < m_jobs.size(); ++i) {
+        if (m_jobs[i]->m_camera->getId() == cameraId) {
+            waitIdle();
+            delete m_jobs[i];
+            m_jobs.erase(m_jobs.begin() + i);
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t MotionEngine::getCameraCount() const
+{
+    return m_jobs.size();
+}
+
+void MotionEngine::addListener(IMotionListener* listener)
+{
+    if (listener && std::find(m_listeners.begin(), m_listeners.end(), listener) == m_listeners.end()) {
+        m_listeners.push_back(listener);
+    }
+}
+
+void MotionEngine::removeListener(IMotionListener* listener)
+{
+    m_listeners.erase(std::remove(m_listeners.begin(), m_listeners.end(), listener), m_listeners.end());
+}
+
+void MotionEngine::setBasePercent(float percent)
+{
+    if (percent > 0.0f) {
+        m_basePercent = percent;
+    }
+}
+
+float MotionEngine::getBasePercent() const
+{
+    return m_basePercent;
+}
+
+int MotionEngine::getBlockSize() const
+{
+    return m_blockSize;
+}
+
+bool MotionEngine::submit(const FrameHandle& frame)
+{
+    if (!frame.isValid()) {
+        return false;
+    }
+    CameraJob* job = findJob(frame->cameraId);
+    if (!job) {
+        return false;
+    }
+    bool superseded = false;
+    bool schedule = job->offer(frame, superseded);
+    {
+        ScopedLock lock(m_mutex);
+        ++m_stats.submitted;
+        if (superseded) {
+            ++m_stats.superseded;
+        }
+    }
+    if (schedule) {
+        if (m_workers) {
+            m_workers->submit(job);
+        } else {
+            job->run();
+        }
+    }
+    return true;
+}
+
+void MotionEngine::waitIdle()
+{
+    if (m_workers) {
+        m_workers->waitIdle();
+    }
+}
+
+void MotionEngine::publish(const MotionResult& result, uint64_t kernelMicros, uint64_t pixels)
+{
+    ScopedLock lock(m_mutex);
+    m_results.push_back(result);
+    ++m_stats.analyzed;
+    if (result.motion) {
+        ++m_stats.motionFrames;
+    }
+    m_stats.kernelMicros += kernelMicros;
+    m_stats.pixels += pixels;
+}
+
+size_t MotionEngine::dispatch()
+{
+    std::vector<MotionResult> results;
+    {
+        ScopedLock lock(m_mutex);
+        results.swap(m_results);
+    }
+    for (size_t i = 0; i < results.size(); ++i) {
+        for (size_t l = 0; l < m_listeners.size(); ++l) {
+            m_listeners[l]->onMotion(results[i]);
+        }
+    }
+    return results.size();
+}
+
+bool MotionEngine::isMotionActive(uint32_t cameraId) const
+{
+    CameraJob* job = findJob(cameraId);
+    if (!job) {
+        return false;
+    }
+    ScopedLock lock(job->m_mutex);
+    return job->m_motion;
+}
+
+MotionEngineStats MotionEngine::getStats() const
+{
+    ScopedLock lock(m_mutex);
+    MotionEngineStats stats = m_stats;
+    stats.cameras = m_jobs.size();
+    return stats;
+}
+
+std::string MotionEngine::getStageName() const
+{
+    return "Motion";
+}
+
+bool MotionEngine::processFrame(const FrameHandle& frame, Camera* camera)
+{
+    if (!camera || !camera->isMotionDetectionEnabled()) {
+        return true;
+    }
+    submit(frame);
+    return true;
+}
+
+float MotionEngine::blockThresholdForSensitivity(int level)
+{
+    if (level < 1) level = 1;
+    if (level > 10) level = 10;
+    return 6.0f + 2.0f * static_cast<float>(10 - level);
+}
+
+}
@@ -0,0 +1,112 @@
+#ifndef MOTION_ENGINE_H
+#define MOTION_ENGINE_H
+
+#include <vector>
+#include <string>
+#include "common_types.h"
+#include "FramePipeline.h"
+#include "Mutex.h"
+#include "Thread.h"
+
+namespace MySweetHome {
+
+class Camera;
+class MotionDetectionStrategy;
+class WorkerPool;
+struct MotionResult {
+    uint32_t cameraId;
+    uint64_t sequence;
+    uint64_t timestamp;
+    uint32_t changedBlocks;
+    uint32_t totalBlocks;
+    float changedPercent;
+    float meanDifference;
+    bool motion;
+};
+struct MotionEngineStats {
+    uint64_t submitted;
+    uint64_t analyzed;
+    uint64_t superseded;
+    uint64_t motionFrames;
+    uint64_t kernelMicros;
+    uint64_t pixels;
+    size_t cameras;
+
+    MotionEngineStats();
+};
+class IMotionListener {
+public:
+    virtual ~IMotionListener() {}
+    virtual void onMotion(const MotionResult& result) = 0;
+};
+class MotionKernel {
+public:
+    static void blockSad(const uint8_t* current, const uint8_t* previous, int width, int height, int stride,
+                         int blockSize, uint32_t* blockSums);
+    static void blockSadScalar(const uint8_t* current, const uint8_t* previous, int width, int height, int stride,
+                               int blockSize, uint32_t* blockSums);
+    static std::string getName();
+
+private:
+    MotionKernel();
+};
+class MotionEngine : public IFrameStage {
+public:
+    explicit MotionEngine(WorkerPool* workers = 0, int blockSize = 16);
+    virtual ~MotionEngine();
+    bool addCamera(Camera* camera, MotionDetectionStrategy* strategy = 0);
+    bool removeCamera(uint32_t cameraId);
+    size_t getCameraCount() const;
+    void addListener(IMotionListener* listener);
+    void removeListener(IMotionListener* listener);
+    void setBasePercent(float percent);
+    float getBasePercent() const;
+    int getBlockSize() const;
+    bool submit(const FrameHandle& frame);
+    void waitIdle();
+    size_t dispatch();
+    bool isMotionActive(uint32_t cameraId) const;
+    MotionEngineStats getStats() const;
+    virtual std::string getStageName() const;
+    virtual bool processFrame(const FrameHandle& frame, Camera* camera);
+    static float blockThresholdForSensitivity(int level);
+
+private:
+    class CameraJob : public IRunnable {
+    public:
+        CameraJob(MotionEngine* engine, Camera* camera, MotionDetectionStrategy* strategy);
+        virtual ~CameraJob();
+        virtual void run();
+        bool offer(const FrameHandle& frame, bool& superseded);
+        void analyze(const FrameHandle& current);
+
+        MotionEngine* m_engine;
+        Camera* m_camera;
+        MotionDetectionStrategy* m_strategy;
+        bool m_ownsStrategy;
+        Mutex m_mutex;
+        FrameHandle m_pending;
+        FrameHandle m_previous;
+        bool m_queued;
+        bool m_motion;
+        std::vector<uint32_t> m_sums;
+    };
+
+    MotionEngine(const MotionEngine&);
+    MotionEngine& operator=(const MotionEngine&);
+    CameraJob* findJob(uint32_t cameraId) const;
+    void publish(const MotionResult& result, uint64_t kernelMicros, uint64_t pixels);
+
+    WorkerPool* m_workers;
+    int m_blockSize;
+    float m_basePercent;
+    std::vector<CameraJob*> m_jobs;
+    std::vector<IMotionListener*> m_listeners;
+    std::vector<MotionResult> m_results;
+    mutable Mutex m_mutex;
+    MotionEngineStats m_stats;
+};
+
+}
+
+#endif
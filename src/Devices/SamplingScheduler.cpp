@@ -0,0 +1,276 @@
+#include "SamplingScheduler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace MySweetHome {
+bool DeviceSensorSampler::sample(Detector* detector, uint64_t nowMillis, float& value)
+{
+    (void)nowMillis;
+    if (!detector || !detector->isOn()) {
+        return false;
+    }
+    value = detector->getSensorValue();
+    return true;
+}
+
+SamplingStats::SamplingStats()
+    : polls(0)
+    , failedPolls(0)
+    , deferredByBudget(0)
+    , demandPerSecond(0.0)
+    , stretchFactor(1.0)
+    , detectors(0)
+{
+}
+
+bool SamplingScheduler::DueEntry::operator<(const DueEntry& other) const
+{
+    return due > other.due;
+}
+
+SamplingScheduler::SamplingScheduler()
+    : m_minInterval(100)
+    , m_maxInterval(60000)
+    , m_budget(0.0)
+    , m_burst(1.0)
+    , m_safetyFactor(4.0)
+    , m_tokens(0.0)
+    , m_lastRefill(0)
+    , m_demand(0.0)
+    , m_activeCount(0)
+{
+}
+
+SamplingScheduler::~SamplingScheduler()
+{
+}
+
+int SamplingScheduler::findSlot(uint32_t detectorId) const
+{
+    if (detectorId >= m_slotById.size()) {
+        return -1;
+    }
+    return m_slotById[detectorId];
+}
+
+bool SamplingScheduler::registerDetector(Detector* detector, uint64_t nowMillis)
+{
+    if (!detector || findSlot(detector->getId()) >= 0) {
+        return false;
+    }
+    uint32_t index;
+    if (!m_freeSlots.empty()) {
+        index = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    } else {
+        index = static_cast<uint32_t>(m_slots.size());
+        m_slots.push_back(Slot());
+    }
+    Slot& slot = m_slots[index];
+    slot.detector = detector;
+    slot.rate.reset();
+    slot.lastSample = 0;
+    slot.interval = m_maxInterval;
+    slot.ratePerSecond = 0.0f;
+    slot.active = true;
+    m_demand += 1000.0 / slot.interval;
+
+    if (detector->getId() >= m_slotById.size()) {
+        m_slotById.resize(detector->getId() + 1, -1);
+    }
+    m_slotById[detector->getId()] = static_cast<int>(index);
+    ++m_activeCount;
+    schedule(index, nowMillis, 0);
+    return true;
+}
+
+bool SamplingScheduler::unregisterDetector(uint32_t detectorId)
+{
+    int index = findSlot(detectorId);
+    if (index < 0) {
+        return false;
+    }
+    Slot& slot = m_slots[index];
+    m_demand -= 1000.0 / slot.interval;
+    slot.active = false;
+    slot.detector = 0;
+    m_slotById[detectorId] = -1;
+    m_freeSlots.push_back(static_cast<uint32_t>(index));
+    --m_activeCount;
+    return true;
+}
+
+size_t SamplingScheduler::size() const
+{
+    return m_activeCount;
+}
+
+void SamplingScheduler::setIntervalRange(uint32_t minMillis, uint32_t maxMillis)
+{
+    m_minInterval = minMillis > 0 ? minMillis : 1;
+    m_maxInterval = maxMillis > m_minInterval ? maxMillis : m_minInterval;
+}
+
+uint32_t SamplingScheduler::getMinInterval() const
+{
+    return m_minInterval;
+}
+
+uint32_t SamplingScheduler::getMaxInterval() const
+{
+    return m_maxInterval;
+}
+
+void SamplingScheduler::setBudget(double samplesPerSecond)
+{
+    m_budget = samplesPerSecond > 0.0 ? samplesPerSecond : 0.0;
+    m_burst = std::max(1.0, m_budget / 10.0);
+    m_tokens = m_burst;
+}
+
+double SamplingScheduler::getBudget() const
+{
+    return m_budget;
+}
+
+void SamplingScheduler::setSafetyFactor(double factor)
+{
+    if (factor >= 1.0) {
+        m_safetyFactor = factor;
+    }
+}
+
+uint32_t SamplingScheduler::computeInterval(const Slot& slot, float value) const
+{
+    float threshold = slot.detector->getThreshold();
+    double headroom = threshold > 0.0f ? (threshold - value) / threshold : 0.0;
+    if (headroom <= 0.0) {
+        return m_minInterval;
+    }
+    if (headroom > 1.0) {
+        headroom = 1.0;
+    }
+    double interval = m_minInterval + (m_maxInterval - m_minInterval) * headroom * headroom;
+    if (slot.ratePerSecond > 0.0f) {
+        double secondsToThreshold = (threshold - value) / slot.ratePerSecond;
+        interval = std::min(interval, secondsToThreshold * 1000.0 / m_safetyFactor);
+    }
+    if (interval < m_minInterval) {
+        interval = m_minInterval;
+    }
+    return static_cast<uint32_t>(interval);
+}
+
+void SamplingScheduler::schedule(uint32_t slotIndex, uint64_t nowMillis, uint32_t interval)
+{
+    Slot& slot = m_slots[slotIndex];
+    double stretched = interval;
+    if (m_budget > 0.0 && m_demand > m_budget) {
+        stretched = std::min(interval * m_demand / m_budget, static_cast<double>(std::max(interval, m_maxInterval)));
+    }
+    slot.due = nowMillis + static_cast<uint64_t>(stretched);
+    DueEntry entry;
+    entry.due = slot.due;
+    entry.slot = slotIndex;
+    m_heap.push_back(entry);
+    std::push_heap(m_heap.begin(), m_heap.end());
+}
+
+void SamplingScheduler::refill(uint64_t nowMillis)
+{
+    if (m_budget <= 0.0) {
+        return;
+    }
+    if (nowMillis > m_lastRefill) {
+        m_tokens += m_budget * (nowMillis - m_lastRefill) / 1000.0;
+        if (m_tokens > m_burst) {
+            m_tokens = m_burst;
+        }
+    }
+    m_lastRefill = nowMillis;
+}
+
+size_t SamplingScheduler::runDue(uint64_t nowMillis, ISensorSampler& sampler, std::vector<SensorReading>* readings)
+{
+    refill(nowMillis);
+    size_t polled = 0;
+    while (!m_heap.empty() && m_heap.front().due <= nowMillis) {
+        DueEntry entry = m_heap.front();
+        Slot& slot = m_slots[entry.slot];
+        if (!slot.active || slot.due != entry.due) {
+            std::pop_heap(m_heap.begin(), m_heap.end());
+            m_heap.pop_back();
+            continue;
+        }
+        if (m_budget > 0.0 && m_tokens < 1.0) {
+            m_stats.deferredByBudget += 1;
+            break;
+        }
+        std::pop_heap(m_heap.begin(), m_heap.end());
+        m_heap.pop_back();
+        if (m_budget > 0.0) {
+            m_tokens -= 1.0;
+        }
+
+        float value = 0.0f;
+        ++m_stats.polls;
+        ++polled;
+        if (!sampler.sample(slot.detector, nowMillis, value)) {
+            ++m_stats.failedPolls;
+            schedule(entry.slot, nowMillis, slot.interval);
+            continue;
+        }
+
+        if (slot.lastSample == 0) {
+            slot.rate.addReading(value);
+        }
+        slot.rate.addReading(value);
+        if (slot.lastSample > 0 && nowMillis > slot.lastSample) {
+            double seconds = (nowMillis - slot.lastSample) / 1000.0;
+            slot.ratePerSecond = static_cast<float>(slot.rate.getRateOfChange() / seconds);
+        }
+        slot.lastSample = nowMillis > 0 ? nowMillis : 1;
+
+        uint32_t interval = computeInterval(slot, value);
+        m_demand += 1000.0 / interval - 1000.0 / slot.interval;
+        slot.interval = interval;
+        schedule(entry.slot, nowMillis, interval);
+
+        if (readings) {
+            SensorReading reading;
+            reading.detectorId = slot.detector->getId();
+            reading.value = value;
+            reading.timestamp = nowMillis;
+            readings->push_back(reading);
+        }
+    }
+    return polled;
+}
+
+uint64_t SamplingScheduler::getNextDue() const
+{
+    return m_heap.empty() ? 0 : m_heap.front().due;
+}
+
+uint32_t SamplingScheduler::getInterval(uint32_t detectorId) const
+{
+    int index = findSlot(detectorId);
+    return index >= 0 ? m_slots[index].interval : 0;
+}
+
+float SamplingScheduler::getRate(uint32_t detectorId) const
+{
+    int index = findSlot(detectorId);
+    return index >= 0 ? m_slots[index].ratePerSecond : 0.0f;
+}
+
+SamplingStats SamplingScheduler::getStats() const
+{
+    SamplingStats stats = m_stats;
+    stats.demandPerSecond = m_demand;
+    stats.stretchFactor = (m_budget > 0.0 && m_demand > m_budget) ? m_demand / m_budget : 1.0;
+    stats.detectors = m_activeCount;
+    return stats;
+}
+
+}
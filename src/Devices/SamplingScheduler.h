@@ -0,0 +1,89 @@
+#ifndef SAMPLING_SCHEDULER_H
+#define SAMPLING_SCHEDULER_H
+
+#include <vector>
+#include <string>
+#include "common_types.h"
+#include "Detector.h"
+#include "DetectionStrategy.h"
+#include "SensorPipeline.h"
+
+namespace MySweetHome {
+class ISensorSampler {
+public:
+    virtual ~ISensorSampler() {}
+    virtual bool sample(Detector* detector, uint64_t nowMillis, float& value) = 0;
+};
+class DeviceSensorSampler : public ISensorSampler {
+public:
+    virtual bool sample(Detector* detector, uint64_t nowMillis, float& value);
+};
+struct SamplingStats {
+    uint64_t polls;
+    uint64_t failedPolls;
+    uint64_t deferredByBudget;
+    double demandPerSecond;
+    double stretchFactor;
+    size_t detectors;
+
+    SamplingStats();
+};
+class SamplingScheduler {
+public:
+    SamplingScheduler();
+    ~SamplingScheduler();
+    bool registerDetector(Detector* detector, uint64_t nowMillis = 0);
+    bool unregisterDetector(uint32_t detectorId);
+    size_t size() const;
+    void setIntervalRange(uint32_t minMillis, uint32_t maxMillis);
+    uint32_t getMinInterval() const;
+    uint32_t getMaxInterval() const;
+    void setBudget(double samplesPerSecond);
+    double getBudget() const;
+    void setSafetyFactor(double factor);
+    size_t runDue(uint64_t nowMillis, ISensorSampler& sampler, std::vector<SensorReading>* readings = 0);
+    uint64_t getNextDue() const;
+    uint32_t getInterval(uint32_t detectorId) const;
+    float getRate(uint32_t detectorId) const;
+    SamplingStats getStats() const;
+
+private:
+    struct Slot {
+        Detector* detector;
+        RateOfChangeStrategy rate;
+        uint64_t lastSample;
+        uint64_t due;
+        uint32_t interval;
+        float ratePerSecond;
+        bool active;
+    };
+    struct DueEntry {
+        uint64_t due;
+        uint32_t slot;
+        bool operator<(const DueEntry& other) const;
+    };
+
+    uint32_t computeInterval(const Slot& slot, float value) const;
+    void schedule(uint32_t slotIndex, uint64_t nowMillis, uint32_t interval);
+    void refill(uint64_t nowMillis);
+    int findSlot(uint32_t detectorId) const;
+
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_freeSlots;
+    std::vector<DueEntry> m_heap;
+    std::vector<int> m_slotById;
+    uint32_t m_minInterval;
+    uint32_t m_maxInterval;
+    double m_budget;
+    double m_burst;
+    double m_safetyFactor;
+    double m_tokens;
+    uint64_t m_lastRefill;
+    double m_demand;
+    size_t m_activeCount;
+    SamplingStats m_stats;
+};
+
+}
+
+#endif
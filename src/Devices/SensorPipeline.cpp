@@ -0,0 +1,519 @@
+#include "SensorPipeline.h"
+#include "TimeSeriesStore.h"
+#include "AllocationTracker.h"
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SENSOR_PIPELINE_SSE2 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace MySweetHome {
+namespace {
+const uint8_t NO_LANE = 0xFF;
+const size_t BLOCK_SIZE = 32;
+
+inline int lowestBit(uint32_t mask)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    int index = 0;
+    while (!(mask & 1u)) {
+        mask >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+inline uint32_t scalarBlockMask(const float* values, const float* thresholds, size_t count)
+{
+    uint32_t mask = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (values[i] >= thresholds[i]) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+}
+
+inline uint32_t vectorBlockMask(const float* values, const float* thresholds)
+{
+#if defined(__AVX2__)
+    uint32_t mask = 0;
+    for (int lane = 0; lane < 4; ++lane) {
+        __m256 v = _mm256_loadu_ps(values + lane * 8);
+        __m256 t = _mm256_loadu_ps(thresholds + lane * 8);
+        mask |= static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(v, t, _CMP_GE_OQ))) << (lane * 8);
+    }
+    return mask;
+#elif defined(SENSOR_PIPELINE_SSE2)
+    uint32_t mask = 0;
+    for (int lane = 0; lane < 8; ++lane) {
+        __m128 v = _mm_loadu_ps(values + lane * 4);
+        __m128 t = _mm_loadu_ps(thresholds + lane * 4);
+        mask |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpge_ps(v, t))) << (lane * 4);
+    }
+    return mask;
+#else
+    return scalarBlockMask(values, thresholds, BLOCK_SIZE);
+#endif
+}
+
+inline void collectChanges(uint32_t changes, size_t base, std::vector<uint32_t>& changed)
+{
+    while (changes) {
+        int bit = lowestBit(changes);
+        changed.push_back(static_cast<uint32_t>(base + bit));
+        changes &= changes - 1;
+    }
+}
+}
+
+SensorPipelineStats::SensorPipelineStats()
+    : readings(0)
+    , unknownReadings(0)
+    , batches(0)
+    , passes(0)
+    , risingEvents(0)
+    , fallingEvents(0)
+    , detectors(0)
+{
+}
+
+size_t ThresholdKernel::scan(const float* values, const float* thresholds, uint32_t* aboveBits,
+                             size_t count, std::vector<uint32_t>& changed)
+{
+    size_t before = changed.size();
+    size_t fullBlocks = count / BLOCK_SIZE;
+    for (size_t block = 0; block < fullBlocks; ++block) {
+        size_t base = block * BLOCK_SIZE;
+        uint32_t mask = vectorBlockMask(values + base, thresholds + base);
+        uint32_t changes = mask ^ aboveBits[block];
+        if (changes) {
+            aboveBits[block] = mask;
+            collectChanges(changes, base, changed);
+        }
+    }
+    size_t tail = count - fullBlocks * BLOCK_SIZE;
+    if (tail > 0) {
+        size_t base = fullBlocks * BLOCK_SIZE;
+        uint32_t mask = scalarBlockMask(values + base, thresholds + base, tail);
+        uint32_t changes = mask ^ aboveBits[fullBlocks];
+        if (changes) {
+            aboveBits[fullBlocks] = mask;
+            collectChanges(changes, base, changed);
+        }
+    }
+    return changed.size() - before;
+}
+
+size_t ThresholdKernel::scanScalar(const float* values, const float* thresholds, uint32_t* aboveBits,
+                                   size_t count, std::vector<uint32_t>& changed)
+{
+    size_t before = changed.size();
+    for (size_t base = 0; base < count; base += BLOCK_SIZE) {
+        size_t length = std::min(BLOCK_SIZE, count - base);
+        uint32_t mask = scalarBlockMask(values + base, thresholds + base, length);
+        uint32_t changes = mask ^ aboveBits[base / BLOCK_SIZE];
+        if (changes) {
+            aboveBits[base / BLOCK_SIZE] = mask;
+            collectChanges(changes, base, changed);
+        }
+    }
+    return changed.size() - before;
+}
+
+std::string ThresholdKernel::getName()
+{
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(SENSOR_PIPELINE_SSE2)
+    return "SSE2";
+#else
+    return "Scalar";
+#endif
+}
+
+SensorPipeline::DetectorLane::DetectorLane()
+    : transform(0)
+    , dirty(false)
+{
+}
+
+SensorPipeline::SensorPipeline()
+    : m_syncDevices(true)
+    , m_history(0)
+{
+}
+
+SensorPipeline::~SensorPipeline()
+{
+}
+
+bool SensorPipeline::locate(uint32_t detectorId, int& lane, uint32_t& index) const
+{
+    if (detectorId >= m_laneById.size() || m_laneById[detectorId] == NO_LANE) {
+        return false;
+    }
+    lane = m_laneById[detectorId];
+    index = m_indexById[detectorId];
+    return true;
+}
+
+float SensorPipeline::laneThreshold(const DetectorLane& lane, const Detector* detector)
+{
+    float threshold = detector->getThreshold();
+    return lane.transform ? lane.transform(threshold) : threshold;
+}
+
+bool SensorPipeline::getBit(const std::vector<uint32_t>& bits, size_t index)
+{
+    return (bits[index / BLOCK_SIZE] >> (index % BLOCK_SIZE)) & 1u;
+}
+
+void SensorPipeline::setBit(std::vector<uint32_t>& bits, size_t index, bool value)
+{
+    uint32_t flag = 1u << (index % BLOCK_SIZE);
+    if (value) {
+        bits[index / BLOCK_SIZE] |= flag;
+    } else {
+        bits[index / BLOCK_SIZE] &= ~flag;
+    }
+}
+
+bool SensorPipeline::registerDetector(Detector* detector)
+{
+    if (!detector || isRegistered(detector->getId())) {
+        return false;
+    }
+    int laneIndex = static_cast<int>(detector->getDetectorType());
+    if (laneIndex < 0 || laneIndex >= DETECTOR_TYPE_COUNT) {
+        return false;
+    }
+    uint32_t id = detector->getId();
+    if (id >= m_laneById.size()) {
+        m_laneById.resize(id + 1, NO_LANE);
+        m_indexById.resize(id + 1, 0);
+    }
+
+    DetectorLane& lane = m_lanes[laneIndex];
+    size_t index = lane.ids.size();
+    lane.ids.push_back(id);
+    lane.devices.push_back(detector);
+    lane.values.push_back(detector->getSensorValue());
+    lane.thresholds.push_back(laneThreshold(lane, detector));
+    lane.timestamps.push_back(0);
+    if (lane.aboveBits.size() * BLOCK_SIZE < lane.ids.size()) {
+        lane.aboveBits.push_back(0);
+        lane.excursionBits.push_back(0);
+    }
+    setBit(lane.aboveBits, index, lane.values[index] >= lane.thresholds[index]);
+
+    m_laneById[id] = static_cast<uint8_t>(laneIndex);
+    m_indexById[id] = static_cast<uint32_t>(index);
+    ++m_stats.detectors;
+    return true;
+}
+
+bool SensorPipeline::unregisterDetector(uint32_t detectorId)
+{
+    int laneIndex;
+    uint32_t index;
+    if (!locate(detectorId, laneIndex, index)) {
+        return false;
+    }
+    DetectorLane& lane = m_lanes[laneIndex];
+    size_t last = lane.ids.size() - 1;
+    if (index != last) {
+        lane.ids[index] = lane.ids[last];
+        lane.devices[index] = lane.devices[last];
+        lane.values[index] = lane.values[last];
+        lane.thresholds[index] = lane.thresholds[last];
+        lane.timestamps[index] = lane.timestamps[last];
+        setBit(lane.aboveBits, index, getBit(lane.aboveBits, last));
+        setBit(lane.excursionBits, index, getBit(lane.excursionBits, last));
+        m_indexById[lane.ids[index]] = index;
+    }
+    for (size_t i = lane.excursions.size(); i-- > 0;) {
+        if (lane.excursions[i].index == index) {
+            lane.excursions.erase(lane.excursions.begin() + i);
+        } else if (lane.excursions[i].index == last) {
+            lane.excursions[i].index = index;
+        }
+    }
+    setBit(lane.aboveBits, last, false);
+    setBit(lane.excursionBits, last, false);
+    lane.ids.pop_back();
+    lane.devices.pop_back();
+    lane.values.pop_back();
+    lane.thresholds.pop_back();
+    lane.timestamps.pop_back();
+    if (lane.aboveBits.size() * BLOCK_SIZE >= lane.ids.size() + BLOCK_SIZE) {
+        lane.aboveBits.pop_back();
+        lane.excursionBits.pop_back();
+    }
+    m_laneById[detectorId] = NO_LANE;
+    --m_stats.detectors;
+    return true;
+}
+
+bool SensorPipeline::isRegistered(uint32_t detectorId) const
+{
+    int lane;
+    uint32_t index;
+    return locate(detectorId, lane, index);
+}
+
+size_t SensorPipeline::size() const
+{
+    return m_stats.detectors;
+}
+
+size_t SensorPipeline::size(DetectorType type) const
+{
+    int laneIndex = static_cast<int>(type);
+    if (laneIndex < 0 || laneIndex >= DETECTOR_TYPE_COUNT) {
+        return 0;
+    }
+    return m_lanes[laneIndex].ids.size();
+}
+
+void SensorPipeline::clear()
+{
+    for (int i = 0; i < DETECTOR_TYPE_COUNT; ++i) {
+        ThresholdTransform transform = m_lanes[i].transform;
+        m_lanes[i] = DetectorLane();
+        m_lanes[i].transform = transform;
+    }
+    m_laneById.clear();
+    m_indexById.clear();
+    m_events.clear();
+    m_stats.detectors = 0;
+}
+
+void SensorPipeline::syncThresholds()
+{
+    for (int l = 0; l < DETECTOR_TYPE_COUNT; ++l) {
+        DetectorLane& lane = m_lanes[l];
+        for (size_t i = 0; i < lane.devices.size(); ++i) {
+            lane.thresholds[i] = laneThreshold(lane, lane.devices[i]);
+        }
+        lane.dirty = true;
+    }
+}
+
+void SensorPipeline::setThresholdTransform(DetectorType type, ThresholdTransform transform)
+{
+    int laneIndex = static_cast<int>(type);
+    if (laneIndex < 0 || laneIndex >= DETECTOR_TYPE_COUNT) {
+        return;
+    }
+    DetectorLane& lane = m_lanes[laneIndex];
+    lane.transform = transform;
+    for (size_t i = 0; i < lane.devices.size(); ++i) {
+        lane.thresholds[i] = laneThreshold(lane, lane.devices[i]);
+    }
+    lane.dirty = true;
+}
+
+ThresholdTransform SensorPipeline::getThresholdTransform(DetectorType type) const
+{
+    int laneIndex = static_cast<int>(type);
+    if (laneIndex < 0 || laneIndex >= DETECTOR_TYPE_COUNT) {
+        return 0;
+    }
+    return m_lanes[laneIndex].transform;
+}
+
+void SensorPipeline::addListener(ISensorEventListener* listener)
+{
+    if (listener && std::find(m_listeners.begin(), m_listeners.end(), listener) == m_listeners.end()) {
+        m_listeners.push_back(listener);
+    }
+}
+
+void SensorPipeline::removeListener(ISensorEventListener* listener)
+{
+    m_listeners.erase(std::remove(m_listeners.begin(), m_listeners.end(), listener), m_listeners.end());
+}
+
+void SensorPipeline::setSyncDevices(bool enable)
+{
+    m_syncDevices = enable;
+}
+
+bool SensorPipeline::isSyncDevices() const
+{
+    return m_syncDevices;
+}
+
+void SensorPipeline::setHistory(TimeSeriesStore* history)
+{
+    m_history = history;
+}
+
+TimeSeriesStore* SensorPipeline::getHistory() const
+{
+    return m_history;
+}
+
+size_t SensorPipeline::ingest(const SensorReading* readings, size_t count)
+{
+    size_t accepted = 0;
+    size_t idCount = m_laneById.size();
+    for (size_t i = 0; i < count; ++i) {
+        const SensorReading& reading = readings[i];
+        uint8_t laneIndex = reading.detectorId < idCount ? m_laneById[reading.detectorId] : NO_LANE;
+        if (laneIndex == NO_LANE) {
+            continue;
+        }
+        DetectorLane& lane = m_lanes[laneIndex];
+        uint32_t index = m_indexById[reading.detectorId];
+        bool above = reading.value >= lane.thresholds[index];
+        if (above != getBit(lane.aboveBits, index) && !getBit(lane.excursionBits, index)) {
+            Excursion excursion;
+            excursion.index = index;
+            excursion.value = reading.value;
+            excursion.timestamp = reading.timestamp;
+            excursion.above = above;
+            lane.excursions.push_back(excursion);
+            setBit(lane.excursionBits, index, true);
+        }
+        lane.values[index] = reading.value;
+        lane.timestamps[index] = reading.timestamp;
+        lane.dirty = true;
+        ++accepted;
+        if (m_history) {
+            m_history->append(reading.detectorId, reading.timestamp, reading.value);
+        }
+    }
+    m_stats.readings += accepted;
+    m_stats.unknownReadings += count - accepted;
+    ++m_stats.batches;
+    return accepted;
+}
+
+size_t SensorPipeline::ingest(const std::vector<SensorReading>& readings)
+{
+    return ingest(readings.empty() ? 0 : &readings[0], readings.size());
+}
+
+void SensorPipeline::emit(int laneIndex, uint32_t index, float value, uint64_t timestamp, bool rising)
+{
+    DetectorLane& lane = m_lanes[laneIndex];
+    SensorEvent event;
+    event.detectorId = lane.ids[index];
+    event.detectorType = static_cast<DetectorType>(laneIndex);
+    event.value = value;
+    event.threshold = lane.thresholds[index];
+    event.timestamp = timestamp;
+    event.rising = rising;
+    if (event.rising) {
+        ++m_stats.risingEvents;
+    } else {
+        ++m_stats.fallingEvents;
+    }
+    if (m_syncDevices) {
+        lane.devices[index]->setSensorValue(event.value);
+    }
+    m_events.push_back(event);
+    for (size_t i = 0; i < m_listeners.size(); ++i) {
+        m_listeners[i]->onSensorEvent(event);
+    }
+}
+
+void SensorPipeline::emitExcursions(int laneIndex)
+{
+    DetectorLane& lane = m_lanes[laneIndex];
+    for (size_t i = 0; i < lane.excursions.size(); ++i) {
+        const Excursion& excursion = lane.excursions[i];
+        setBit(lane.excursionBits, excursion.index, false);
+        if (getBit(lane.aboveBits, excursion.index) == excursion.above) {
+            continue;
+        }
+        emit(laneIndex, excursion.index, excursion.value, excursion.timestamp, excursion.above);
+        emit(laneIndex, excursion.index, lane.values[excursion.index], lane.timestamps[excursion.index],
+             !excursion.above);
+    }
+    lane.excursions.clear();
+}
+
+size_t SensorPipeline::process()
+{
+    m_events.clear();
+    for (int l = 0; l < DETECTOR_TYPE_COUNT; ++l) {
+        DetectorLane& lane = m_lanes[l];
+        if (!lane.dirty || lane.ids.empty()) {
+            continue;
+        }
+        lane.dirty = false;
+        m_changed.clear();
+        ThresholdKernel::scan(&lane.values[0], &lane.thresholds[0], &lane.aboveBits[0],
+                              lane.ids.size(), m_changed);
+        for (size_t i = 0; i < m_changed.size(); ++i) {
+            uint32_t index = m_changed[i];
+            emit(l, index, lane.values[index], lane.timestamps[index], getBit(lane.aboveBits, index));
+        }
+        emitExcursions(l);
+    }
+    ++m_stats.passes;
+    return m_events.size();
+}
+
+size_t SensorPipeline::ingestAndProcess(const std::vector<SensorReading>& readings)
+{
+    AllocationScope allocations("sensors", "ingestAndProcess");
+    ingest(readings);
+    return process();
+}
+
+const std::vector<SensorEvent>& SensorPipeline::getLastEvents() const
+{
+    return m_events;
+}
+
+float SensorPipeline::getValue(uint32_t detectorId) const
+{
+    int lane;
+    uint32_t index;
+    if (!locate(detectorId, lane, index)) {
+        return 0.0f;
+    }
+    return m_lanes[lane].values[index];
+}
+
+bool SensorPipeline::isAboveThreshold(uint32_t detectorId) const
+{
+    int lane;
+    uint32_t index;
+    if (!locate(detectorId, lane, index)) {
+        return false;
+    }
+    return getBit(m_lanes[lane].aboveBits, index);
+}
+
+SensorPipelineStats SensorPipeline::getStats() const
+{
+    return m_stats;
+}
+
+void SensorPipeline::resetStats()
+{
+    size_t detectors = m_stats.detectors;
+    m_stats = SensorPipelineStats();
+    m_stats.detectors = detectors;
+}
+
+}
@@ -0,0 +1,128 @@
+#ifndef SENSOR_PIPELINE_H
+#define SENSOR_PIPELINE_H
+
+#include <vector>
+#include <string>
+#include "common_types.h"
+#include "Detector.h"
+#include "StaticDetectionStrategy.h"
+
+namespace MySweetHome {
+
+const int DETECTOR_TYPE_COUNT = 4;
+struct SensorReading {
+    uint32_t detectorId;
+    float value;
+    uint64_t timestamp;
+};
+struct SensorEvent {
+    uint32_t detectorId;
+    DetectorType detectorType;
+    float value;
+    float threshold;
+    uint64_t timestamp;
+    bool rising;
+};
+struct SensorPipelineStats {
+    uint64_t readings;
+    uint64_t unknownReadings;
+    uint64_t batches;
+    uint64_t passes;
+    uint64_t risingEvents;
+    uint64_t fallingEvents;
+    size_t detectors;
+
+    SensorPipelineStats();
+};
+class TimeSeriesStore;
+class ISensorEventListener {
+public:
+    virtual ~ISensorEventListener() {}
+    virtual void onSensorEvent(const SensorEvent& event) = 0;
+};
+class ThresholdKernel {
+public:
+    static size_t scan(const float* values, const float* thresholds, uint32_t* aboveBits,
+                       size_t count, std::vector<uint32_t>& changed);
+    static size_t scanScalar(const float* values, const float* thresholds, uint32_t* aboveBits,
+                             size_t count, std::vector<uint32_t>& changed);
+    static std::string getName();
+
+private:
+    ThresholdKernel();
+};
+class SensorPipeline {
+public:
+    SensorPipeline();
+    ~SensorPipeline();
+    bool registerDetector(Detector* detector);
+    bool unregisterDetector(uint32_t detectorId);
+    bool isRegistered(uint32_t detectorId) const;
+    size_t size() const;
+    size_t size(DetectorType type) const;
+    void clear();
+    void syncThresholds();
+    void setThresholdTransform(DetectorType type, ThresholdTransform transform);
+    ThresholdTransform getThresholdTransform(DetectorType type) const;
+    void addListener(ISensorEventListener* listener);
+    void removeListener(ISensorEventListener* listener);
+    void setSyncDevices(bool enable);
+    bool isSyncDevices() const;
+    void setHistory(TimeSeriesStore* history);
+    TimeSeriesStore* getHistory() const;
+    size_t ingest(const SensorReading* readings, size_t count);
+    size_t ingest(const std::vector<SensorReading>& readings);
+    size_t process();
+    size_t ingestAndProcess(const std::vector<SensorReading>& readings);
+    const std::vector<SensorEvent>& getLastEvents() const;
+    float getValue(uint32_t detectorId) const;
+    bool isAboveThreshold(uint32_t detectorId) const;
+    SensorPipelineStats getStats() const;
+    void resetStats();
+
+private:
+    struct Excursion {
+        uint32_t index;
+        float value;
+        uint64_t timestamp;
+        bool above;
+    };
+    struct DetectorLane {
+        std::vector<uint32_t> ids;
+        std::vector<Detector*> devices;
+        std::vector<float> values;
+        std::vector<float> thresholds;
+        std::vector<uint64_t> timestamps;
+        std::vector<uint32_t> aboveBits;
+        std::vector<uint32_t> excursionBits;
+        std::vector<Excursion> excursions;
+        ThresholdTransform transform;
+        bool dirty;
+
+        DetectorLane();
+    };
+
+    SensorPipeline(const SensorPipeline&);
+    SensorPipeline& operator=(const SensorPipeline&);
+
+    bool locate(uint32_t detectorId, int& lane, uint32_t& index) const;
+    static float laneThreshold(const DetectorLane& lane, const Detector* detector);
+    static bool getBit(const std::vector<uint32_t>& bits, size_t index);
+    static void setBit(std::vector<uint32_t>& bits, size_t index, bool value);
+    void emit(int lane, uint32_t index, float value, uint64_t timestamp, bool rising);
+    void emitExcursions(int lane);
+
+    DetectorLane m_lanes[DETECTOR_TYPE_COUNT];
+    std::vector<uint8_t> m_laneById;
+    std::vector<uint32_t> m_indexById;
+    std::vector<ISensorEventListener*> m_listeners;
+    std::vector<SensorEvent> m_events;
+    std::vector<uint32_t> m_changed;
+    bool m_syncDevices;
+    TimeSeriesStore* m_history;
+    SensorPipelineStats m_stats;
+};
+
+}
+
+#endif
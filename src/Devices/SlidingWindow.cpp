@@ -0,0 +1,176 @@
+#include "SlidingWindow.h"
+#include <cmath>
+
+namespace MySweetHome {
+SlidingWindow::SlidingWindow(size_t capacity, double ewmaAlpha)
+    : m_buffer(capacity > 0 ? capacity : 1, 0.0f)
+    , m_head(0)
+    , m_count(0)
+    , m_sequence(0)
+    , m_mean(0.0)
+    , m_m2(0.0)
+    , m_alpha(0.0)
+    , m_autoAlpha(true)
+    , m_ewma(0.0)
+{
+    setEwmaAlpha(ewmaAlpha);
+}
+
+SlidingWindow::~SlidingWindow()
+{
+}
+
+void SlidingWindow::add(float value)
+{
+    double x = value;
+    size_t cap = m_buffer.size();
+    if (m_count < cap) {
+        ++m_count;
+        double delta = x - m_mean;
+        m_mean += delta / static_cast<double>(m_count);
+        m_m2 += delta * (x - m_mean);
+    } else {
+        double old = m_buffer[m_head];
+        double oldMean = m_mean;
+        m_mean += (x - old) / static_cast<double>(m_count);
+        m_m2 += (x - old) * (x - m_mean + old - oldMean);
+        if (m_m2 < 0.0) {
+            m_m2 = 0.0;
+        }
+    }
+    m_buffer[m_head] = value;
+    m_head = (m_head + 1) % cap;
+
+    m_ewma = (m_sequence == 0) ? x : m_ewma + m_alpha * (x - m_ewma);
+    pushExtremes(value);
+    ++m_sequence;
+    expireExtremes();
+}
+
+void SlidingWindow::pushExtremes(float value)
+{
+    Entry entry;
+    entry.sequence = m_sequence;
+    entry.value = value;
+    while (!m_minQueue.empty() && m_minQueue.back().value >= value) {
+        m_minQueue.pop_back();
+    }
+    m_minQueue.push_back(entry);
+    while (!m_maxQueue.empty() && m_maxQueue.back().value <= value) {
+        m_maxQueue.pop_back();
+    }
+    m_maxQueue.push_back(entry);
+}
+
+void SlidingWindow::expireExtremes()
+{
+    uint64_t firstLive = m_sequence > m_count ? m_sequence - m_count : 0;
+    while (!m_minQueue.empty() && m_minQueue.front().sequence < firstLive) {
+        m_minQueue.pop_front();
+    }
+    while (!m_maxQueue.empty() && m_maxQueue.front().sequence < firstLive) {
+        m_maxQueue.pop_front();
+    }
+}
+
+void SlidingWindow::clear()
+{
+    m_head = 0;
+    m_count = 0;
+    m_sequence = 0;
+    m_mean = 0.0;
+    m_m2 = 0.0;
+    m_ewma = 0.0;
+    m_minQueue.clear();
+    m_maxQueue.clear();
+}
+
+void SlidingWindow::setCapacity(size_t capacity)
+{
+    m_buffer.assign(capacity > 0 ? capacity : 1, 0.0f);
+    if (m_autoAlpha) {
+        m_alpha = 2.0 / (static_cast<double>(m_buffer.size()) + 1.0);
+    }
+    clear();
+}
+
+size_t SlidingWindow::capacity() const
+{
+    return m_buffer.size();
+}
+
+size_t SlidingWindow::size() const
+{
+    return m_count;
+}
+
+bool SlidingWindow::empty() const
+{
+    return m_count == 0;
+}
+
+bool SlidingWindow::isFull() const
+{
+    return m_count == m_buffer.size();
+}
+
+void SlidingWindow::setEwmaAlpha(double alpha)
+{
+    m_autoAlpha = !(alpha > 0.0 && alpha <= 1.0);
+    m_alpha = m_autoAlpha ? 2.0 / (static_cast<double>(m_buffer.size()) + 1.0) : alpha;
+}
+
+double SlidingWindow::getEwmaAlpha() const
+{
+    return m_alpha;
+}
+
+float SlidingWindow::mean() const
+{
+    return m_count > 0 ? static_cast<float>(m_mean) : 0.0f;
+}
+
+float SlidingWindow::variance() const
+{
+    return m_count > 1 ? static_cast<float>(m_m2 / static_cast<double>(m_count)) : 0.0f;
+}
+
+float SlidingWindow::standardDeviation() const
+{
+    return static_cast<float>(std::sqrt(variance()));
+}
+
+float SlidingWindow::minimum() const
+{
+    return m_minQueue.empty() ? 0.0f : m_minQueue.front().value;
+}
+
+float SlidingWindow::maximum() const
+{
+    return m_maxQueue.empty() ? 0.0f : m_maxQueue.front().value;
+}
+
+float SlidingWindow::ewma() const
+{
+    return static_cast<float>(m_ewma);
+}
+
+float SlidingWindow::last() const
+{
+    if (m_count == 0) {
+        return 0.0f;
+    }
+    size_t cap = m_buffer.size();
+    return m_buffer[(m_head + cap - 1) % cap];
+}
+
+float SlidingWindow::oldest() const
+{
+    if (m_count == 0) {
+        return 0.0f;
+    }
+    size_t cap = m_buffer.size();
+    return m_buffer[(m_head + cap - m_count) % cap];
+}
+
+}
@@ -0,0 +1,55 @@
+#ifndef SLIDING_WINDOW_H
+#define SLIDING_WINDOW_H
+
+#include <vector>
+#include <deque>
+#include "common_types.h"
+
+namespace MySweetHome {
+class SlidingWindow {
+public:
+    explicit SlidingWindow(size_t capacity = 5, double ewmaAlpha = 0.0);
+    ~SlidingWindow();
+    void add(float value);
+    void clear();
+    void setCapacity(size_t capacity);
+    size_t capacity() const;
+    size_t size() const;
+    bool empty() const;
+    bool isFull() const;
+    void setEwmaAlpha(double alpha);
+    double getEwmaAlpha() const;
+    float mean() const;
+    float variance() const;
+    float standardDeviation() const;
+    float minimum() const;
+    float maximum() const;
+    float ewma() const;
+    float last() const;
+    float oldest() const;
+
+private:
+    struct Entry {
+        uint64_t sequence;
+        float value;
+    };
+
+    void pushExtremes(float value);
+    void expireExtremes();
+
+    std::vector<float> m_buffer;
+    size_t m_head;
+    size_t m_count;
+    uint64_t m_sequence;
+    double m_mean;
+    double m_m2;
+    double m_alpha;
+    bool m_autoAlpha;
+    double m_ewma;
+    std::deque<Entry> m_minQueue;
+    std::deque<Entry> m_maxQueue;
+};
+
+}
+
+#endif
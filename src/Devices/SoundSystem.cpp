@@ -18,6 +18,7 @@ SoundSystem::~SoundSystem()
 }
 
 void SoundSystem::setVolume(uint8_t volume) {
+    markModified();
     m_volume = (volume > 100) ? 100 : volume;
     if (m_volume > 0) {
         m_muted = false;
@@ -29,6 +30,7 @@ uint8_t SoundSystem::getVolume() const {
 }
 
 void SoundSystem::mute() {
+    markModified();
     if (!m_muted) {
         m_previousVolume = m_volume;
         m_volume = 0;
@@ -37,6 +39,7 @@ void SoundSystem::mute() {
 }
 
 void SoundSystem::unmute() {
+    markModified();
     if (m_muted) {
         m_volume = m_previousVolume;
         m_muted = false;
@@ -48,6 +51,7 @@ bool SoundSystem::isMuted() const {
 }
 
 void SoundSystem::volumeUp() {
+    markModified();
     if (m_muted) {
         unmute();
     }
@@ -57,6 +61,7 @@ void SoundSystem::volumeUp() {
 }
 
 void SoundSystem::volumeDown() {
+    markModified();
     if (m_volume > 0) {
         m_volume--;
     }
@@ -66,16 +71,19 @@ void SoundSystem::volumeDown() {
 }
 
 void SoundSystem::play() {
+    markModified();
     if (isOn()) {
         m_playing = true;
     }
 }
 
 void SoundSystem::pause() {
+    markModified();
     m_playing = false;
 }
 
 void SoundSystem::stop() {
+    markModified();
     m_playing = false;
 }
 
@@ -84,6 +92,7 @@ bool SoundSystem::isPlaying() const {
 }
 
 void SoundSystem::setSource(const std::string& source) {
+    markModified();
     m_source = source;
 }
 
@@ -99,10 +108,12 @@ Device* SoundSystem::clone() const {
 }
 
 void SoundSystem::turnOn() {
+    markModified();
     Device::turnOn();
 }
 
 void SoundSystem::turnOff() {
+    markModified();
     Device::turnOff();
     m_playing = false;
 }
@@ -146,6 +157,7 @@ std::string SonySoundSystem::getInfo() const {
 }
 
 void SonySoundSystem::enableSurroundSound(bool enable) {
+    markModified();
     m_surroundSound = enable;
 }
 
@@ -154,6 +166,7 @@ bool SonySoundSystem::hasSurroundSound() const {
 }
 
 void SonySoundSystem::setBassLevel(int level) {
+    markModified();
     if (level >= -10 && level <= 10) {
         m_bassLevel = level;
     }
@@ -192,6 +205,7 @@ std::string BoseSoundSystem::getInfo() const {
 }
 
 void BoseSoundSystem::enableNoiseCancel(bool enable) {
+    markModified();
     m_noiseCancel = enable;
 }
 
@@ -200,6 +214,7 @@ bool BoseSoundSystem::hasNoiseCancel() const {
 }
 
 void BoseSoundSystem::enableBluetooth(bool enable) {
+    markModified();
     m_bluetoothEnabled = enable;
 }
 
@@ -233,6 +248,7 @@ std::string JBLSoundSystem::getInfo() const {
 }
 
 void JBLSoundSystem::enablePartyMode(bool enable) {
+    markModified();
     m_partyMode = enable;
 }
 
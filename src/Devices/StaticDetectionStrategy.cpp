@@ -0,0 +1,75 @@
+#include "StaticDetectionStrategy.h"
+
+namespace MySweetHome {
+namespace {
+
+const float GAS_THRESHOLDS[GAS_KIND_COUNT] = {
+    static_cast<float>(GasThresholdTable<GAS_CO>::PPM),
+    static_cast<float>(GasThresholdTable<GAS_LPG>::PPM),
+    static_cast<float>(GasThresholdTable<GAS_METHANE>::PPM),
+    static_cast<float>(GasThresholdTable<GAS_NATURAL>::PPM)
+};
+
+const float SMOKE_FACTORS[10] = {
+    SmokeSensitivityTable<1>::factor(), SmokeSensitivityTable<2>::factor(),
+    SmokeSensitivityTable<3>::factor(), SmokeSensitivityTable<4>::factor(),
+    SmokeSensitivityTable<5>::factor(), SmokeSensitivityTable<6>::factor(),
+    SmokeSensitivityTable<7>::factor(), SmokeSensitivityTable<8>::factor(),
+    SmokeSensitivityTable<9>::factor(), SmokeSensitivityTable<10>::factor()
+};
+
+const float MOTION_FACTORS[10] = {
+    MotionSensitivityTable<1>::factor(), MotionSensitivityTable<2>::factor(),
+    MotionSensitivityTable<3>::factor(), MotionSensitivityTable<4>::factor(),
+    MotionSensitivityTable<5>::factor(), MotionSensitivityTable<6>::factor(),
+    MotionSensitivityTable<7>::factor(), MotionSensitivityTable<8>::factor(),
+    MotionSensitivityTable<9>::factor(), MotionSensitivityTable<10>::factor()
+};
+
+int clampLevel(int level)
+{
+    if (level < 1) return 1;
+    if (level > 10) return 10;
+    return level;
+}
+
+}
+
+GasKind parseGasKind(const std::string& gasType)
+{
+    if (gasType == GasThresholdTable<GAS_CO>::name()) {
+        return GAS_CO;
+    } else if (gasType == GasThresholdTable<GAS_METHANE>::name()) {
+        return GAS_METHANE;
+    } else if (gasType == GasThresholdTable<GAS_NATURAL>::name()) {
+        return GAS_NATURAL;
+    }
+    return GAS_LPG;
+}
+
+const char* gasKindToString(GasKind kind)
+{
+    switch (kind) {
+        case GAS_CO: return GasThresholdTable<GAS_CO>::name();
+        case GAS_METHANE: return GasThresholdTable<GAS_METHANE>::name();
+        case GAS_NATURAL: return GasThresholdTable<GAS_NATURAL>::name();
+        default: return GasThresholdTable<GAS_LPG>::name();
+    }
+}
+
+float gasKindDefaultThreshold(GasKind kind)
+{
+    return (kind >= 0 && kind < GAS_KIND_COUNT) ? GAS_THRESHOLDS[kind] : GAS_THRESHOLDS[GAS_LPG];
+}
+
+float smokeSensitivityFactor(int level)
+{
+    return SMOKE_FACTORS[clampLevel(level) - 1];
+}
+
+float motionSensitivityFactor(int level)
+{
+    return MOTION_FACTORS[clampLevel(level) - 1];
+}
+
+}
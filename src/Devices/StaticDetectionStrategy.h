@@ -0,0 +1,123 @@
+#ifndef STATIC_DETECTION_STRATEGY_H
+#define STATIC_DETECTION_STRATEGY_H
+
+#include <string>
+#include "common_types.h"
+#include "IDetectionStrategy.h"
+
+namespace MySweetHome {
+
+enum GasKind {
+    GAS_CO,
+    GAS_LPG,
+    GAS_METHANE,
+    GAS_NATURAL,
+    GAS_KIND_COUNT
+};
+
+typedef float (*ThresholdTransform)(float threshold);
+
+GasKind parseGasKind(const std::string& gasType);
+const char* gasKindToString(GasKind kind);
+float gasKindDefaultThreshold(GasKind kind);
+float smokeSensitivityFactor(int level);
+float motionSensitivityFactor(int level);
+template<GasKind Kind> struct GasThresholdTable;
+template<> struct GasThresholdTable<GAS_CO> { enum { PPM = 50 }; static const char* name() { return "CO"; } };
+template<> struct GasThresholdTable<GAS_LPG> { enum { PPM = 1000 }; static const char* name() { return "LPG"; } };
+template<> struct GasThresholdTable<GAS_METHANE> { enum { PPM = 5000 }; static const char* name() { return "Methane"; } };
+template<> struct GasThresholdTable<GAS_NATURAL> { enum { PPM = 2500 }; static const char* name() { return "Natural"; } };
+template<int Level> struct SensitivityLevel {
+    enum { VALUE = Level < 1 ? 1 : (Level > 10 ? 10 : Level) };
+};
+template<int Level> struct SmokeSensitivityTable {
+    static float factor() { return 1.5f - static_cast<float>(SensitivityLevel<Level>::VALUE - 1) / 9.0f; }
+};
+template<int Level> struct MotionSensitivityTable {
+    static float factor() { return 1.0f + static_cast<float>(10 - SensitivityLevel<Level>::VALUE) / 5.0f; }
+};
+struct ThresholdPolicy {
+    static float effectiveThreshold(float threshold) { return threshold; }
+    static bool detect(float sensorValue, float threshold) { return sensorValue > threshold; }
+    static const char* name() { return "SimpleThreshold"; }
+    static const char* description() { return "Triggers when sensor value exceeds threshold"; }
+    static float recommendedThreshold() { return 50.0f; }
+};
+template<int Level> struct SmokePolicy {
+    static float effectiveThreshold(float threshold) { return threshold * SmokeSensitivityTable<Level>::factor(); }
+    static bool detect(float sensorValue, float threshold) { return sensorValue > effectiveThreshold(threshold); }
+    static const char* name() { return "SmokeDetection"; }
+    static const char* description() { return "Optimized for smoke particle density detection"; }
+    static float recommendedThreshold() { return 3.0f; }
+};
+template<int Level> struct MotionPolicy {
+    static float effectiveThreshold(float threshold) { return threshold * MotionSensitivityTable<Level>::factor(); }
+    static bool detect(float sensorValue, float threshold) { return sensorValue > effectiveThreshold(threshold); }
+    static const char* name() { return "MotionDetection"; }
+    static const char* description() { return "PIR-based motion detection with adjustable sensitivity"; }
+    static float recommendedThreshold() { return 30.0f; }
+};
+template<GasKind Kind> struct GasPolicy {
+    static float effectiveThreshold(float threshold)
+    {
+        return threshold > 0.0f ? threshold : static_cast<float>(GasThresholdTable<Kind>::PPM);
+    }
+    static bool detect(float sensorValue, float threshold) { return sensorValue > effectiveThreshold(threshold); }
+    static const char* name() { return "GasDetection"; }
+    static const char* description() { return "PPM-based detection"; }
+    static float recommendedThreshold() { return static_cast<float>(GasThresholdTable<Kind>::PPM); }
+};
+template<class Policy>
+inline size_t detectBatch(const float* values, const float* thresholds, uint8_t* results, size_t count)
+{
+    size_t hits = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t hit = Policy::detect(values[i], thresholds[i]) ? 1 : 0;
+        results[i] = hit;
+        hits += hit;
+    }
+    return hits;
+}
+template<class Policy>
+inline size_t detectBatch(const float* values, float threshold, uint8_t* results, size_t count)
+{
+    const float effective = Policy::effectiveThreshold(threshold);
+    size_t hits = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t hit = values[i] > effective ? 1 : 0;
+        results[i] = hit;
+        hits += hit;
+    }
+    return hits;
+}
+template<class Policy>
+class StaticStrategyAdapter : public IDetectionStrategy {
+public:
+    StaticStrategyAdapter() {}
+    virtual ~StaticStrategyAdapter() {}
+
+    virtual bool detect(float sensorValue, float threshold) const { return Policy::detect(sensorValue, threshold); }
+    virtual std::string getName() const { return Policy::name(); }
+    virtual std::string getDescription() const { return Policy::description(); }
+    virtual float getRecommendedThreshold() const { return Policy::recommendedThreshold(); }
+    static ThresholdTransform getThresholdTransform() { return &Policy::effectiveThreshold; }
+};
+template<GasKind Kind>
+class StaticStrategyAdapter<GasPolicy<Kind> > : public IDetectionStrategy {
+public:
+    StaticStrategyAdapter() {}
+    virtual ~StaticStrategyAdapter() {}
+
+    virtual bool detect(float sensorValue, float threshold) const { return GasPolicy<Kind>::detect(sensorValue, threshold); }
+    virtual std::string getName() const { return std::string("GasDetection_") + GasThresholdTable<Kind>::name(); }
+    virtual std::string getDescription() const
+    {
+        return std::string("PPM-based detection for ") + GasThresholdTable<Kind>::name() + " gas";
+    }
+    virtual float getRecommendedThreshold() const { return GasPolicy<Kind>::recommendedThreshold(); }
+    static ThresholdTransform getThresholdTransform() { return &GasPolicy<Kind>::effectiveThreshold; }
+};
+
+}
+
+#endif
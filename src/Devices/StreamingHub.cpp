@@ -0,0 +1,259 @@
+#include "StreamingHub.h"
+#include "Camera.h"
+
+namespace MySweetHome {
+StreamSubscriberStats::StreamSubscriberStats()
+    : subscriberId(0)
+    , cameraId(0)
+    , delivered(0)
+    , consumed(0)
+    , skipped(0)
+    , queued(0)
+    , highWater(0)
+    , lagFrames(0)
+    , maxLagFrames(0)
+    , lagMillis(0)
+    , maxLagMillis(0)
+{
+}
+
+StreamSubscription::StreamSubscription(uint32_t id, uint32_t cameraId, const std::string& name, size_t depth)
+    : m_id(id)
+    , m_cameraId(cameraId)
+    , m_name(name)
+    , m_queue(depth, FrameQueue::DROP_OLDEST)
+    , m_delivered(0)
+    , m_consumed(0)
+    , m_latestSequence(0)
+    , m_latestTimestamp(0)
+    , m_lagFrames(0)
+    , m_maxLagFrames(0)
+    , m_lagMillis(0)
+    , m_maxLagMillis(0)
+{
+}
+
+StreamSubscription::~StreamSubscription()
+{
+}
+
+uint32_t StreamSubscription::getId() const
+{
+    return m_id;
+}
+
+uint32_t StreamSubscription::getCameraId() const
+{
+    return m_cameraId;
+}
+
+const std::string& StreamSubscription::getName() const
+{
+    return m_name;
+}
+
+bool StreamSubscription::poll(FrameHandle& frame)
+{
+    if (!m_queue.pop(frame)) {
+        return false;
+    }
+    ScopedLock lock(m_mutex);
+    ++m_consumed;
+    m_lagFrames = m_latestSequence > frame->sequence ? m_latestSequence - frame->sequence : 0;
+    m_lagMillis = m_latestTimestamp > frame->timestamp ? m_latestTimestamp - frame->timestamp : 0;
+    if (m_lagFrames > m_maxLagFrames) {
+        m_maxLagFrames = m_lagFrames;
+    }
+    if (m_lagMillis > m_maxLagMillis) {
+        m_maxLagMillis = m_lagMillis;
+    }
+    return true;
+}
+
+size_t StreamSubscription::pending() const
+{
+    return m_queue.size();
+}
+
+StreamSubscriberStats StreamSubscription::getStats() const
+{
+    StreamSubscriberStats stats;
+    stats.subscriberId = m_id;
+    stats.cameraId = m_cameraId;
+    stats.name = m_name;
+    stats.skipped = m_queue.getDropped();
+    stats.queued = m_queue.size();
+    stats.highWater = m_queue.getHighWater();
+    ScopedLock lock(m_mutex);
+    stats.delivered = m_delivered;
+    stats.consumed = m_consumed;
+    stats.lagFrames = m_lagFrames;
+    stats.maxLagFrames = m_maxLagFrames;
+    stats.lagMillis = m_lagMillis;
+    stats.maxLagMillis = m_maxLagMillis;
+    return stats;
+}
+
+void StreamSubscription::offer(const FrameHandle& frame)
+{
+    {
+        ScopedLock lock(m_mutex);
+        ++m_delivered;
+        m_latestSequence = frame->sequence;
+        m_latestTimestamp = frame->timestamp;
+    }
+    m_queue.push(frame);
+}
+
+StreamingHubStats::StreamingHubStats()
+    : published(0)
+    , unsubscribedFrames(0)
+    , deliveries(0)
+    , skipped(0)
+    , subscribers(0)
+    , cameras(0)
+{
+}
+
+StreamingHub::StreamingHub(size_t defaultDepth)
+    : m_defaultDepth(defaultDepth > 0 ? defaultDepth : 1)
+    , m_nextId(1)
+{
+}
+
+StreamingHub::~StreamingHub()
+{
+    for (size_t i = 0; i < m_streams.size(); ++i) {
+        for (size_t j = 0; j < m_streams[i]->subscribers.size(); ++j) {
+            delete m_streams[i]->subscribers[j];
+        }
+        delete m_streams[i];
+    }
+    m_streams.clear();
+}
+
+StreamSubscription* StreamingHub::subscribe(uint32_t cameraId, const std::string& name, size_t depth)
+{
+    ScopedLock lock(m_mutex);
+    CameraStream* stream = findStream(cameraId);
+    if (!stream) {
+        stream = new CameraStream();
+        stream->cameraId = cameraId;
+        m_streams.push_back(stream);
+    }
+    StreamSubscription* subscription =
+        new StreamSubscription(m_nextId++, cameraId, name, depth > 0 ? depth : m_defaultDepth);
+    stream->subscribers.push_back(subscription);
+    return subscription;
+}
+
+bool StreamingHub::unsubscribe(StreamSubscription* subscription)
+{
+    if (!subscription) {
+        return false;
+    }
+    ScopedLock lock(m_mutex);
+    for (size_t i = 0; i < m_streams.size(); ++i) {
+        std::vector<StreamSubscription*>& subscribers = m_streams[i]->subscribers;
+        for (size_t j = 0; j < subscribers.size(); ++j) {
+            if (subscribers[j] == subscription) {
+                m_stats.skipped += subscription->m_queue.getDropped();
+                subscribers.erase(subscribers.begin() + j);
+                delete subscription;
+                if (subscribers.empty()) {
+                    delete m_streams[i];
+                    m_streams.erase(m_streams.begin() + i);
+                }
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+size_t StreamingHub::publish(const FrameHandle& frame)
+{
+    if (!frame.isValid()) {
+        return 0;
+    }
+    ScopedLock lock(m_mutex);
+    CameraStream* stream = findStream(frame->cameraId);
+    if (!stream) {
+        ++m_stats.unsubscribedFrames;
+        return 0;
+    }
+    ++m_stats.published;
+    for (size_t i = 0; i < stream->subscribers.size(); ++i) {
+        stream->subscribers[i]->offer(frame);
+    }
+    m_stats.deliveries += stream->subscribers.size();
+    return stream->subscribers.size();
+}
+
+size_t StreamingHub::getSubscriberCount(uint32_t cameraId) const
+{
+    ScopedLock lock(m_mutex);
+    CameraStream* stream = findStream(cameraId);
+    return stream ? stream->subscribers.size() : 0;
+}
+
+size_t StreamingHub::getSubscriberCount() const
+{
+    ScopedLock lock(m_mutex);
+    size_t count = 0;
+    for (size_t i = 0; i < m_streams.size(); ++i) {
+        count += m_streams[i]->subscribers.size();
+    }
+    return count;
+}
+
+std::vector<StreamSubscriberStats> StreamingHub::getSubscriberStats() const
+{
+    ScopedLock lock(m_mutex);
+    std::vector<StreamSubscriberStats> stats;
+    for (size_t i = 0; i < m_streams.size(); ++i) {
+        for (size_t j = 0; j < m_streams[i]->subscribers.size(); ++j) {
+            stats.push_back(m_streams[i]->subscribers[j]->getStats());
+        }
+    }
+    return stats;
+}
+
+StreamingHubStats StreamingHub::getStats() const
+{
+    ScopedLock lock(m_mutex);
+    StreamingHubStats stats = m_stats;
+    stats.cameras = m_streams.size();
+    for (size_t i = 0; i < m_streams.size(); ++i) {
+        stats.subscribers += m_streams[i]->subscribers.size();
+        for (size_t j = 0; j < m_streams[i]->subscribers.size(); ++j) {
+            stats.skipped += m_streams[i]->subscribers[j]->m_queue.getDropped();
+        }
+    }
+    return stats;
+}
+
+std::string StreamingHub::getStageName() const
+{
+    return "StreamHub";
+}
+
+bool StreamingHub::processFrame(const FrameHandle& frame, Camera* camera)
+{
+    if (!camera || !camera->isOn()) {
+        return false;
+    }
+    return publish(frame) > 0;
+}
+
+StreamingHub::CameraStream* StreamingHub::findStream(uint32_t cameraId) const
+{
+    for (size_t i = 0; i < m_streams.size(); ++i) {
+        if (m_streams[i]->cameraId == cameraId) {
+            return m_streams[i];
+        }
+    }
+    return 0;
+}
+
+}
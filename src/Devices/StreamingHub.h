@@ -0,0 +1,103 @@
+#ifndef STREAMING_HUB_H
+#define STREAMING_HUB_H
+
+#include <vector>
+#include <string>
+#include "common_types.h"
+#include "FramePipeline.h"
+#include "Mutex.h"
+
+namespace MySweetHome {
+
+class Camera;
+struct StreamSubscriberStats {
+    uint32_t subscriberId;
+    uint32_t cameraId;
+    std::string name;
+    uint64_t delivered;
+    uint64_t consumed;
+    uint64_t skipped;
+    size_t queued;
+    size_t highWater;
+    uint64_t lagFrames;
+    uint64_t maxLagFrames;
+    uint64_t lagMillis;
+    uint64_t maxLagMillis;
+
+    StreamSubscriberStats();
+};
+class StreamSubscription {
+public:
+    uint32_t getId() const;
+    uint32_t getCameraId() const;
+    const std::string& getName() const;
+    bool poll(FrameHandle& frame);
+    size_t pending() const;
+    StreamSubscriberStats getStats() const;
+
+private:
+    friend class StreamingHub;
+    StreamSubscription(uint32_t id, uint32_t cameraId, const std::string& name, size_t depth);
+    ~StreamSubscription();
+    StreamSubscription(const StreamSubscription&);
+    StreamSubscription& operator=(const StreamSubscription&);
+    void offer(const FrameHandle& frame);
+
+    uint32_t m_id;
+    uint32_t m_cameraId;
+    std::string m_name;
+    FrameQueue m_queue;
+    mutable Mutex m_mutex;
+    uint64_t m_delivered;
+    uint64_t m_consumed;
+    uint64_t m_latestSequence;
+    uint64_t m_latestTimestamp;
+    uint64_t m_lagFrames;
+    uint64_t m_maxLagFrames;
+    uint64_t m_lagMillis;
+    uint64_t m_maxLagMillis;
+};
+struct StreamingHubStats {
+    uint64_t published;
+    uint64_t unsubscribedFrames;
+    uint64_t deliveries;
+    uint64_t skipped;
+    size_t subscribers;
+    size_t cameras;
+
+    StreamingHubStats();
+};
+class StreamingHub : public IFrameStage {
+public:
+    explicit StreamingHub(size_t defaultDepth = 4);
+    virtual ~StreamingHub();
+    StreamSubscription* subscribe(uint32_t cameraId, const std::string& name, size_t depth = 0);
+    bool unsubscribe(StreamSubscription* subscription);
+    size_t publish(const FrameHandle& frame);
+    size_t getSubscriberCount(uint32_t cameraId) const;
+    size_t getSubscriberCount() const;
+    std::vector<StreamSubscriberStats> getSubscriberStats() const;
+    StreamingHubStats getStats() const;
+    virtual std::string getStageName() const;
+    virtual bool processFrame(const FrameHandle& frame, Camera* camera);
+
+private:
+    struct CameraStream {
+        uint32_t cameraId;
+        std::vector<StreamSubscription*> subscribers;
+    };
+
+    StreamingHub(const StreamingHub&);
+    StreamingHub& operator=(const StreamingHub&);
+    CameraStream* findStream(uint32_t cameraId) const;
+
+    size_t m_defaultDepth;
+    uint32_t m_nextId;
+    std::vector<CameraStream*> m_streams;
+    mutable Mutex m_mutex;
+    StreamingHubStats m_stats;
+};
+
+}
+
+#endif
@@ -16,6 +16,7 @@ TV::~TV()
 }
 
 void TV::setChannel(uint16_t channel) {
+    markModified();
     if (channel > 0 && channel <= 999) {
         m_channel = channel;
     }
@@ -26,6 +27,7 @@ uint16_t TV::getChannel() const {
 }
 
 void TV::setVolume(uint8_t volume) {
+    markModified();
     m_volume = (volume > 100) ? 100 : volume;
     if (m_volume > 0) {
         m_muted = false;
@@ -37,6 +39,7 @@ uint8_t TV::getVolume() const {
 }
 
 void TV::mute() {
+    markModified();
     if (!m_muted) {
         m_previousVolume = m_volume;
         m_volume = 0;
@@ -45,6 +48,7 @@ void TV::mute() {
 }
 
 void TV::unmute() {
+    markModified();
     if (m_muted) {
         m_volume = m_previousVolume;
         m_muted = false;
@@ -56,6 +60,7 @@ bool TV::isMuted() const {
 }
 
 void TV::volumeUp() {
+    markModified();
     if (m_muted) {
         unmute();
     }
@@ -65,6 +70,7 @@ void TV::volumeUp() {
 }
 
 void TV::volumeDown() {
+    markModified();
     if (m_volume > 0) {
         m_volume--;
     }
@@ -74,6 +80,7 @@ void TV::volumeDown() {
 }
 
 void TV::channelUp() {
+    markModified();
     if (m_channel < 999) {
         m_channel++;
     } else {
@@ -82,6 +89,7 @@ void TV::channelUp() {
 }
 
 void TV::channelDown() {
+    markModified();
     if (m_channel > 1) {
         m_channel--;
     } else {
@@ -97,10 +105,12 @@ Device* TV::clone() const {
 }
 
 void TV::turnOn() {
+    markModified();
     Device::turnOn();
 }
 
 void TV::turnOff() {
+    markModified();
     Device::turnOff();
 }
 
@@ -139,6 +149,7 @@ std::string SamsungTV::getInfo() const {
 }
 
 void SamsungTV::enableSmartFeatures(bool enable) {
+    markModified();
     m_smartFeatures = enable;
 }
 
@@ -172,6 +183,7 @@ std::string LGTV::getInfo() const {
 }
 
 void LGTV::enableWebOS(bool enable) {
+    markModified();
     m_webOS = enable;
 }
 
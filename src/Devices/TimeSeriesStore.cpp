@@ -0,0 +1,981 @@
+#include "TimeSeriesStore.h"
+#include "Logger.h"
+#include "Atomic.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <sstream>
+
+#ifdef _WIN32
+#include <fstream>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace MySweetHome {
+namespace {
+const uint64_t SPILL_SEGMENT_BYTES = 64ULL * 1024ULL * 1024ULL;
+const uint32_t MAX_REPEAT_RUN = 64;
+const int NO_WINDOW = -1;
+AtomicCounter s_nextStore(0);
+
+std::string uniqueSpillPrefix()
+{
+    std::ostringstream prefix;
+#ifdef _WIN32
+    prefix << "timeseries-" << _getpid() << "-" << s_nextStore.increment();
+#else
+    prefix << "timeseries-" << getpid() << "-" << s_nextStore.increment();
+#endif
+    return prefix.str();
+}
+
+uint32_t floatBits(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float bitsFloat(uint32_t bits)
+{
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+int leadingZeros(uint32_t value)
+{
+    int count = 0;
+    for (uint32_t mask = 0x80000000u; mask && !(value & mask); mask >>= 1) {
+        ++count;
+    }
+    return count;
+}
+
+int trailingZeros(uint32_t value)
+{
+    int count = 0;
+    for (uint32_t mask = 1u; mask && !(value & mask); mask <<= 1) {
+        ++count;
+    }
+    return count;
+}
+
+int64_t signExtend(uint64_t value, int bits)
+{
+    uint64_t sign = 1ULL << (bits - 1);
+    return static_cast<int64_t>((value ^ sign) - sign);
+}
+}
+
+float TimeSeriesBucket::average() const
+{
+    return count > 0 ? static_cast<float>(sum / count) : 0.0f;
+}
+
+TimeSeriesStats::TimeSeriesStats()
+    : series(0)
+    , blocks(0)
+    , spilledBlocks(0)
+    , samples(0)
+    , memoryBytes(0)
+    , spilledBytes(0)
+    , evictedBlocks(0)
+    , rejectedSamples(0)
+{
+}
+
+double TimeSeriesStats::bitsPerSample() const
+{
+    return samples > 0 ? (memoryBytes + spilledBytes) * 8.0 / samples : 0.0;
+}
+
+BitWriter::BitWriter()
+    : m_bitCount(0)
+{
+}
+
+void BitWriter::writeBit(bool bit)
+{
+    write(bit ? 1 : 0, 1);
+}
+
+void BitWriter::write(uint64_t value, int bits)
+{
+    while (bits > 0) {
+        int used = static_cast<int>(m_bitCount & 7);
+        if (used == 0) {
+            m_bytes.push_back(0);
+        }
+        int free = 8 - used;
+        int take = bits < free ? bits : free;
+        uint8_t chunk = static_cast<uint8_t>((value >> (bits - take)) & ((1u << take) - 1));
+        m_bytes.back() |= static_cast<uint8_t>(chunk << (free - take));
+        bits -= take;
+        m_bitCount += take;
+    }
+}
+
+uint64_t BitWriter::getBitCount() const
+{
+    return m_bitCount;
+}
+
+const std::vector<uint8_t>& BitWriter::getBytes() const
+{
+    return m_bytes;
+}
+
+void BitWriter::swap(std::vector<uint8_t>& bytes)
+{
+    m_bytes.swap(bytes);
+    m_bitCount = 0;
+}
+
+void BitWriter::clear()
+{
+    m_bytes.clear();
+    m_bitCount = 0;
+}
+
+BitReader::BitReader(const uint8_t* data, size_t size)
+    : m_data(data)
+    , m_size(size)
+    , m_position(0)
+{
+}
+
+bool BitReader::readBit()
+{
+    return read(1) != 0;
+}
+
+uint64_t BitReader::read(int bits)
+{
+    uint64_t value = 0;
+    while (bits > 0) {
+        size_t byteIndex = static_cast<size_t>(m_position >> 3);
+        if (byteIndex >= m_size) {
+            return value << bits;
+        }
+        int used = static_cast<int>(m_position & 7);
+        int available = 8 - used;
+        int take = bits < available ? bits : available;
+        uint8_t chunk = static_cast<uint8_t>((m_data[byteIndex] >> (available - take)) & ((1u << take) - 1));
+        value = (value << take) | chunk;
+        bits -= take;
+        m_position += take;
+    }
+    return value;
+}
+
+bool BitReader::isExhausted() const
+{
+    return (m_position >> 3) >= m_size;
+}
+
+class TimeSeriesStore::SpillSegment {
+public:
+    explicit SpillSegment(const std::string& path)
+        : m_path(path)
+        , m_size(0)
+        , m_liveBlocks(0)
+#ifndef _WIN32
+        , m_fd(-1)
+        , m_map(0)
+        , m_mappedSize(0)
+#endif
+    {
+    }
+
+    ~SpillSegment()
+    {
+#ifdef _WIN32
+        m_file.close();
+#else
+        if (m_map) {
+            munmap(m_map, m_mappedSize);
+        }
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+#endif
+        std::remove(m_path.c_str());
+    }
+
+    bool open()
+    {
+#ifdef _WIN32
+        m_file.open(m_path.c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        return m_file.is_open();
+#else
+        m_fd = ::open(m_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        return m_fd >= 0;
+#endif
+    }
+
+    bool append(const uint8_t* data, uint32_t length, uint64_t& offset)
+    {
+        offset = m_size;
+#ifdef _WIN32
+        m_file.seekp(static_cast<std::streamoff>(offset));
+        m_file.write(reinterpret_cast<const char*>(data), length);
+        if (!m_file.good()) {
+            return false;
+        }
+#else
+        size_t written = 0;
+        while (written < length) {
+            ssize_t result = pwrite(m_fd, data + written, length - written,
+                                    static_cast<off_t>(offset + written));
+            if (result <= 0) {
+                return false;
+            }
+            written += static_cast<size_t>(result);
+        }
+#endif
+        m_size += length;
+        return true;
+    }
+
+    const uint8_t* read(uint64_t offset, uint32_t length, std::vector<uint8_t>& scratch)
+    {
+#ifdef _WIN32
+        scratch.resize(length);
+        m_file.flush();
+        m_file.seekg(static_cast<std::streamoff>(offset));
+        m_file.read(reinterpret_cast<char*>(scratch.empty() ? 0 : &scratch[0]), length);
+        return scratch.empty() ? 0 : &scratch[0];
+#else
+        (void)scratch;
+        if (offset + length > m_mappedSize) {
+            if (m_map) {
+                munmap(m_map, m_mappedSize);
+                m_map = 0;
+                m_mappedSize = 0;
+            }
+            void* mapped = mmap(0, static_cast<size_t>(m_size), PROT_READ, MAP_SHARED, m_fd, 0);
+            if (mapped == MAP_FAILED) {
+                return 0;
+            }
+            m_map = static_cast<uint8_t*>(mapped);
+            m_mappedSize = m_size;
+        }
+        return m_map + offset;
+#endif
+    }
+
+    uint64_t size() const
+    {
+        return m_size;
+    }
+
+    int& liveBlocks()
+    {
+        return m_liveBlocks;
+    }
+
+private:
+    std::string m_path;
+    uint64_t m_size;
+    int m_liveBlocks;
+#ifdef _WIN32
+    std::fstream m_file;
+#else
+    int m_fd;
+    uint8_t* m_map;
+    uint64_t m_mappedSize;
+#endif
+};
+
+TimeSeriesStore::Series::Series()
+    : firstInMemory(0)
+    , encodedCount(0)
+    , pendingRepeats(0)
+    , lastTime(0)
+    , lastDelta(0)
+    , lastBits(0)
+    , leading(NO_WINDOW)
+    , trailing(NO_WINDOW)
+{
+    TimeSeriesStore::resetBlock(open);
+}
+
+TimeSeriesStore::TimeSeriesStore(uint32_t samplesPerBlock)
+    : m_samplesPerBlock(samplesPerBlock > 1 ? samplesPerBlock : 2)
+    , m_retentionMillis(0)
+    , m_memoryBudget(0)
+    , m_resolution(0.0f)
+    , m_nextSequence(1)
+    , m_memoryBytes(0)
+    , m_spilledBytes(0)
+    , m_samples(0)
+    , m_evictedBlocks(0)
+    , m_rejectedSamples(0)
+    , m_blockCount(0)
+    , m_spilledBlocks(0)
+{
+}
+
+TimeSeriesStore::~TimeSeriesStore()
+{
+    clear();
+}
+
+void TimeSeriesStore::resetBlock(Block& block)
+{
+    block.sequence = 0;
+    block.firstTime = 0;
+    block.lastTime = 0;
+    block.count = 0;
+    block.minimum = 0.0f;
+    block.maximum = 0.0f;
+    block.sum = 0.0;
+    block.data.clear();
+    block.segment = -1;
+    block.offset = 0;
+    block.length = 0;
+}
+
+bool TimeSeriesStore::append(uint32_t seriesId, uint64_t timestamp, float value)
+{
+    ScopedLock lock(m_mutex);
+    std::map<uint32_t, Series*>::iterator it = m_series.find(seriesId);
+    Series* series = 0;
+    if (it == m_series.end()) {
+        series = new Series();
+        m_series[seriesId] = series;
+        m_memoryBytes += sizeof(Series);
+    } else {
+        series = it->second;
+        bool hasData = series->open.count > 0 || !series->sealed.empty();
+        if (hasData && timestamp < series->lastTime) {
+            ++m_rejectedSamples;
+            return false;
+        }
+        if (hasData && m_resolution > 0.0f &&
+            std::fabs(value - bitsFloat(series->lastBits)) < m_resolution) {
+            value = bitsFloat(series->lastBits);
+        }
+    }
+    if (m_resolution > 0.0f) {
+        value = static_cast<float>(std::floor(value / m_resolution + 0.5f) * m_resolution);
+    }
+
+    size_t bytesBefore = series->writer.getBytes().size();
+    encode(*series, timestamp, value);
+    m_memoryBytes += series->writer.getBytes().size() - bytesBefore;
+    ++m_samples;
+
+    if (series->open.count >= m_samplesPerBlock) {
+        seal(seriesId, *series);
+        applyRetention(*series);
+        enforceBudget();
+    }
+    return true;
+}
+
+void TimeSeriesStore::encode(Series& series, uint64_t timestamp, float value)
+{
+    Block& open = series.open;
+    uint32_t bits = floatBits(value);
+    if (open.count == 0) {
+        series.writer.write(timestamp, 64);
+        series.writer.write(bits, 32);
+        series.encodedCount = 1;
+        series.pendingRepeats = 0;
+        series.lastDelta = 0;
+        series.leading = NO_WINDOW;
+        series.trailing = NO_WINDOW;
+        open.firstTime = timestamp;
+        open.minimum = value;
+        open.maximum = value;
+    } else {
+        uint64_t delta = timestamp - series.lastTime;
+        if (delta == series.lastDelta && bits == series.lastBits) {
+            if (++series.pendingRepeats == MAX_REPEAT_RUN) {
+                flushRepeats(series);
+            }
+        } else {
+            flushRepeats(series);
+            series.writer.writeBit(true);
+            writeTimestampDelta(series.writer,
+                                static_cast<int64_t>(delta) - static_cast<int64_t>(series.lastDelta));
+            writeValueXor(series, bits ^ series.lastBits);
+            ++series.encodedCount;
+        }
+        series.lastDelta = delta;
+        open.minimum = std::min(open.minimum, value);
+        open.maximum = std::max(open.maximum, value);
+    }
+    series.lastTime = timestamp;
+    series.lastBits = bits;
+    open.lastTime = timestamp;
+    open.sum += value;
+    ++open.count;
+}
+
+void TimeSeriesStore::flushRepeats(Series& series)
+{
+    if (series.pendingRepeats == 0) {
+        return;
+    }
+    series.writer.writeBit(false);
+    series.writer.write(series.pendingRepeats - 1, 6);
+    series.encodedCount += series.pendingRepeats;
+    series.pendingRepeats = 0;
+}
+
+void TimeSeriesStore::writeTimestampDelta(BitWriter& writer, int64_t deltaOfDelta)
+{
+    if (deltaOfDelta == 0) {
+        writer.writeBit(false);
+    } else if (deltaOfDelta >= -64 && deltaOfDelta <= 63) {
+        writer.write(0x2, 2);
+        writer.write(static_cast<uint64_t>(deltaOfDelta), 7);
+    } else if (deltaOfDelta >= -256 && deltaOfDelta <= 255) {
+        writer.write(0x6, 3);
+        writer.write(static_cast<uint64_t>(deltaOfDelta), 9);
+    } else if (deltaOfDelta >= -2048 && deltaOfDelta <= 2047) {
+        writer.write(0xE, 4);
+        writer.write(static_cast<uint64_t>(deltaOfDelta), 12);
+    } else {
+        writer.write(0xF, 4);
+        writer.write(static_cast<uint64_t>(deltaOfDelta), 64);
+    }
+}
+
+void TimeSeriesStore::writeValueXor(Series& series, uint32_t xorValue)
+{
+    BitWriter& writer = series.writer;
+    if (xorValue == 0) {
+        writer.writeBit(false);
+        return;
+    }
+    writer.writeBit(true);
+    int leading = leadingZeros(xorValue);
+    int trailing = trailingZeros(xorValue);
+    if (leading > 31) {
+        leading = 31;
+    }
+    if (series.leading != NO_WINDOW && leading >= series.leading && trailing >= series.trailing) {
+        writer.writeBit(false);
+        int length = 32 - series.leading - series.trailing;
+        writer.write(xorValue >> series.trailing, length);
+    } else {
+        int length = 32 - leading - trailing;
+        writer.writeBit(true);
+        writer.write(static_cast<uint64_t>(leading), 5);
+        writer.write(static_cast<uint64_t>(length - 1), 5);
+        writer.write(xorValue >> trailing, length);
+        series.leading = leading;
+        series.trailing = trailing;
+    }
+}
+
+void TimeSeriesStore::decode(const uint8_t* data, size_t size, uint32_t count,
+                             std::vector<TimeSeriesSample>& out)
+{
+    if (!data || count == 0) {
+        return;
+    }
+    BitReader reader(data, size);
+    TimeSeriesSample sample;
+    sample.timestamp = reader.read(64);
+    uint32_t bits = static_cast<uint32_t>(reader.read(32));
+    sample.value = bitsFloat(bits);
+    out.push_back(sample);
+
+    uint64_t delta = 0;
+    int leading = 0;
+    int trailing = 0;
+    uint32_t decoded = 1;
+    while (decoded < count) {
+        if (!reader.readBit()) {
+            uint32_t run = static_cast<uint32_t>(reader.read(6)) + 1;
+            for (uint32_t i = 0; i < run && decoded < count; ++i) {
+                sample.timestamp += delta;
+                out.push_back(sample);
+                ++decoded;
+            }
+            continue;
+        }
+
+        int64_t deltaOfDelta = 0;
+        if (reader.readBit()) {
+            if (!reader.readBit()) {
+                deltaOfDelta = signExtend(reader.read(7), 7);
+            } else if (!reader.readBit()) {
+                deltaOfDelta = signExtend(reader.read(9), 9);
+            } else if (!reader.readBit()) {
+                deltaOfDelta = signExtend(reader.read(12), 12);
+            } else {
+                deltaOfDelta = static_cast<int64_t>(reader.read(64));
+            }
+        }
+        delta = static_cast<uint64_t>(static_cast<int64_t>(delta) + deltaOfDelta);
+        sample.timestamp += delta;
+
+        if (reader.readBit()) {
+            if (reader.readBit()) {
+                leading = static_cast<int>(reader.read(5));
+                int length = static_cast<int>(reader.read(5)) + 1;
+                trailing = 32 - leading - length;
+            }
+            int length = 32 - leading - trailing;
+            bits ^= static_cast<uint32_t>(reader.read(length)) << trailing;
+            sample.value = bitsFloat(bits);
+        }
+        out.push_back(sample);
+        ++decoded;
+    }
+}
+
+void TimeSeriesStore::seal(uint32_t seriesId, Series& series)
+{
+    if (series.open.count == 0) {
+        return;
+    }
+    flushRepeats(series);
+    Block* block = new Block(series.open);
+    block->sequence = m_nextSequence++;
+    std::vector<uint8_t> bytes;
+    series.writer.swap(bytes);
+    m_memoryBytes -= bytes.size();
+    std::vector<uint8_t>(bytes).swap(block->data);
+    block->length = static_cast<uint32_t>(block->data.size());
+    m_memoryBytes += block->data.size() + sizeof(Block);
+    series.sealed.push_back(block);
+    ++m_blockCount;
+    resetBlock(series.open);
+    series.encodedCount = 0;
+
+    if (m_memoryBudget > 0) {
+        SealRef ref;
+        ref.seriesId = seriesId;
+        ref.sequence = block->sequence;
+        m_sealOrder.push_back(ref);
+    }
+}
+
+void TimeSeriesStore::releaseBlock(Block* block)
+{
+    if (block->segment >= 0) {
+        SpillSegment* segment = m_segments[block->segment];
+        m_spilledBytes -= block->length;
+        --m_spilledBlocks;
+        if (segment && --segment->liveBlocks() == 0 &&
+            block->segment != static_cast<int>(m_segments.size()) - 1) {
+            delete segment;
+            m_segments[block->segment] = 0;
+        }
+    } else {
+        m_memoryBytes -= block->data.size() + sizeof(Block);
+    }
+    --m_blockCount;
+    m_samples -= block->count;
+    delete block;
+}
+
+void TimeSeriesStore::dropFront(Series& series)
+{
+    releaseBlock(series.sealed.front());
+    series.sealed.pop_front();
+    if (series.firstInMemory > 0) {
+        --series.firstInMemory;
+    }
+}
+
+void TimeSeriesStore::applyRetention(Series& series)
+{
+    if (m_retentionMillis == 0) {
+        return;
+    }
+    while (!series.sealed.empty() &&
+           series.sealed.front()->lastTime + m_retentionMillis < series.lastTime) {
+        dropFront(series);
+    }
+}
+
+bool TimeSeriesStore::spillBlock(Block* block)
+{
+    if (m_spillDirectory.empty()) {
+        return false;
+    }
+    SpillSegment* segment = m_segments.empty() ? 0 : m_segments.back();
+    if (!segment || segment->size() + block->length > SPILL_SEGMENT_BYTES) {
+        if (segment && segment->liveBlocks() == 0) {
+            delete segment;
+            m_segments.back() = 0;
+        }
+        std::ostringstream path;
+        path << m_spillDirectory << "/" << m_spillPrefix << "-" << m_segments.size() << ".seg";
+        segment = new SpillSegment(path.str());
+        if (!segment->open()) {
+            Logger::getInstance().error("Cannot open time-series spill file: " + path.str());
+            delete segment;
+            return false;
+        }
+        m_segments.push_back(segment);
+    }
+
+    uint64_t offset = 0;
+    if (!segment->append(block->data.empty() ? 0 : &block->data[0], block->length, offset)) {
+        Logger::getInstance().error("Time-series spill write failed.");
+        return false;
+    }
+    m_memoryBytes -= block->data.size();
+    std::vector<uint8_t>().swap(block->data);
+    m_memoryBytes -= sizeof(Block);
+    block->segment = static_cast<int>(m_segments.size()) - 1;
+    block->offset = offset;
+    ++segment->liveBlocks();
+    m_spilledBytes += block->length;
+    ++m_spilledBlocks;
+    return true;
+}
+
+void TimeSeriesStore::enforceBudget()
+{
+    while (m_memoryBudget > 0 && m_memoryBytes > m_memoryBudget && !m_sealOrder.empty()) {
+        SealRef ref = m_sealOrder.front();
+        m_sealOrder.pop_front();
+        std::map<uint32_t, Series*>::iterator it = m_series.find(ref.seriesId);
+        if (it == m_series.end()) {
+            continue;
+        }
+        Series& series = *it->second;
+        if (series.firstInMemory >= series.sealed.size() ||
+            series.sealed[series.firstInMemory]->sequence != ref.sequence) {
+            continue;
+        }
+        if (spillBlock(series.sealed[series.firstInMemory])) {
+            ++series.firstInMemory;
+        } else {
+            releaseBlock(series.sealed[series.firstInMemory]);
+            series.sealed.erase(series.sealed.begin() + series.firstInMemory);
+            ++m_evictedBlocks;
+        }
+    }
+}
+
+const uint8_t* TimeSeriesStore::blockData(const Block& block, std::vector<uint8_t>& scratch) const
+{
+    if (block.segment < 0) {
+        return block.data.empty() ? 0 : &block.data[0];
+    }
+    SpillSegment* segment = m_segments[block.segment];
+    return segment ? segment->read(block.offset, block.length, scratch) : 0;
+}
+
+void TimeSeriesStore::decodeBlock(const Block& block, std::vector<TimeSeriesSample>& out) const
+{
+    std::vector<uint8_t> scratch;
+    decode(blockData(block, scratch), block.length, block.count, out);
+}
+
+void TimeSeriesStore::decodeOpen(const Series& series, std::vector<TimeSeriesSample>& out) const
+{
+    if (series.open.count == 0) {
+        return;
+    }
+    const std::vector<uint8_t>& bytes = series.writer.getBytes();
+    decode(bytes.empty() ? 0 : &bytes[0], bytes.size(), series.encodedCount, out);
+    TimeSeriesSample sample;
+    sample.value = bitsFloat(series.lastBits);
+    for (uint32_t i = series.pendingRepeats; i > 0; --i) {
+        sample.timestamp = series.lastTime - (i - 1) * series.lastDelta;
+        out.push_back(sample);
+    }
+}
+
+void TimeSeriesStore::collect(const Series& series, uint64_t from, uint64_t to,
+                              std::vector<TimeSeriesSample>& out) const
+{
+    std::vector<TimeSeriesSample> decoded;
+    for (size_t i = 0; i < series.sealed.size(); ++i) {
+        const Block& block = *series.sealed[i];
+        if (block.lastTime < from || block.firstTime > to) {
+            continue;
+        }
+        decoded.clear();
+        decodeBlock(block, decoded);
+        for (size_t j = 0; j < decoded.size(); ++j) {
+            if (decoded[j].timestamp >= from && decoded[j].timestamp <= to) {
+                out.push_back(decoded[j]);
+            }
+        }
+    }
+    if (series.open.count > 0 && series.open.lastTime >= from && series.open.firstTime <= to) {
+        decoded.clear();
+        decodeOpen(series, decoded);
+        for (size_t j = 0; j < decoded.size(); ++j) {
+            if (decoded[j].timestamp >= from && decoded[j].timestamp <= to) {
+                out.push_back(decoded[j]);
+            }
+        }
+    }
+}
+
+size_t TimeSeriesStore::query(uint32_t seriesId, uint64_t from, uint64_t to,
+                              std::vector<TimeSeriesSample>& out) const
+{
+    ScopedLock lock(m_mutex);
+    std::map<uint32_t, Series*>::const_iterator it = m_series.find(seriesId);
+    if (it == m_series.end()) {
+        return 0;
+    }
+    size_t before = out.size();
+    collect(*it->second, from, to, out);
+    return out.size() - before;
+}
+
+size_t TimeSeriesStore::downsample(uint32_t seriesId, uint64_t from, uint64_t to, uint64_t bucketMillis,
+                                   std::vector<TimeSeriesBucket>& out) const
+{
+    ScopedLock lock(m_mutex);
+    std::map<uint32_t, Series*>::const_iterator it = m_series.find(seriesId);
+    if (it == m_series.end() || bucketMillis == 0 || to < from) {
+        return 0;
+    }
+    const Series& series = *it->second;
+    std::map<uint64_t, TimeSeriesBucket> buckets;
+    std::vector<TimeSeriesSample> samples;
+
+    for (size_t i = 0; i <= series.sealed.size(); ++i) {
+        bool isOpen = (i == series.sealed.size());
+        const Block& block = isOpen ? series.open : *series.sealed[i];
+        if (block.count == 0 || block.lastTime < from || block.firstTime > to) {
+            continue;
+        }
+        uint64_t firstBucket = (block.firstTime - std::min(block.firstTime, from)) / bucketMillis;
+        uint64_t lastBucket = (block.lastTime - std::min(block.lastTime, from)) / bucketMillis;
+        if (block.firstTime >= from && block.lastTime <= to && firstBucket == lastBucket) {
+            TimeSeriesBucket& bucket = buckets[firstBucket];
+            if (bucket.count == 0) {
+                bucket.minimum = block.minimum;
+                bucket.maximum = block.maximum;
+                bucket.sum = 0.0;
+            } else {
+                bucket.minimum = std::min(bucket.minimum, block.minimum);
+                bucket.maximum = std::max(bucket.maximum, block.maximum);
+            }
+            bucket.sum += block.sum;
+            bucket.count += block.count;
+            continue;
+        }
+        samples.clear();
+        if (isOpen) {
+            decodeOpen(series, samples);
+        } else {
+            decodeBlock(block, samples);
+        }
+        for (size_t j = 0; j < samples.size(); ++j) {
+            const TimeSeriesSample& sample = samples[j];
+            if (sample.timestamp < from || sample.timestamp > to) {
+                continue;
+            }
+            TimeSeriesBucket& bucket = buckets[(sample.timestamp - from) / bucketMillis];
+            if (bucket.count == 0) {
+                bucket.minimum = sample.value;
+                bucket.maximum = sample.value;
+                bucket.sum = 0.0;
+            } else {
+                bucket.minimum = std::min(bucket.minimum, sample.value);
+                bucket.maximum = std::max(bucket.maximum, sample.value);
+            }
+            bucket.sum += sample.value;
+            ++bucket.count;
+        }
+    }
+
+    size_t before = out.size();
+    for (std::map<uint64_t, TimeSeriesBucket>::iterator b = buckets.begin(); b != buckets.end(); ++b) {
+        b->second.start = from + b->first * bucketMillis;
+        out.push_back(b->second);
+    }
+    return out.size() - before;
+}
+
+bool TimeSeriesStore::getLatest(uint32_t seriesId, TimeSeriesSample& sample) const
+{
+    ScopedLock lock(m_mutex);
+    std::map<uint32_t, Series*>::const_iterator it = m_series.find(seriesId);
+    if (it == m_series.end() || (it->second->open.count == 0 && it->second->sealed.empty())) {
+        return false;
+    }
+    sample.timestamp = it->second->lastTime;
+    sample.value = bitsFloat(it->second->lastBits);
+    return true;
+}
+
+bool TimeSeriesStore::hasSeries(uint32_t seriesId) const
+{
+    ScopedLock lock(m_mutex);
+    return m_series.find(seriesId) != m_series.end();
+}
+
+std::vector<uint32_t> TimeSeriesStore::getSeriesIds() const
+{
+    ScopedLock lock(m_mutex);
+    std::vector<uint32_t> ids;
+    for (std::map<uint32_t, Series*>::const_iterator it = m_series.begin(); it != m_series.end(); ++it) {
+        ids.push_back(it->first);
+    }
+    return ids;
+}
+
+bool TimeSeriesStore::removeSeries(uint32_t seriesId)
+{
+    ScopedLock lock(m_mutex);
+    std::map<uint32_t, Series*>::iterator it = m_series.find(seriesId);
+    if (it == m_series.end()) {
+        return false;
+    }
+    Series* series = it->second;
+    while (!series->sealed.empty()) {
+        dropFront(*series);
+    }
+    m_memoryBytes -= series->writer.getBytes().size() + sizeof(Series);
+    m_samples -= series->open.count;
+    delete series;
+    m_series.erase(it);
+    return true;
+}
+
+void TimeSeriesStore::clear()
+{
+    ScopedLock lock(m_mutex);
+    for (std::map<uint32_t, Series*>::iterator it = m_series.begin(); it != m_series.end(); ++it) {
+        Series* series = it->second;
+        for (size_t i = 0; i < series->sealed.size(); ++i) {
+            delete series->sealed[i];
+        }
+        delete series;
+    }
+    m_series.clear();
+    m_sealOrder.clear();
+    for (size_t i = 0; i < m_segments.size(); ++i) {
+        delete m_segments[i];
+    }
+    m_segments.clear();
+    m_memoryBytes = 0;
+    m_spilledBytes = 0;
+    m_samples = 0;
+    m_blockCount = 0;
+    m_spilledBlocks = 0;
+}
+
+void TimeSeriesStore::flush()
+{
+    ScopedLock lock(m_mutex);
+    for (std::map<uint32_t, Series*>::iterator it = m_series.begin(); it != m_series.end(); ++it) {
+        seal(it->first, *it->second);
+        applyRetention(*it->second);
+    }
+    enforceBudget();
+}
+
+void TimeSeriesStore::setRetention(uint64_t maxAgeMillis)
+{
+    ScopedLock lock(m_mutex);
+    m_retentionMillis = maxAgeMillis;
+    for (std::map<uint32_t, Series*>::iterator it = m_series.begin(); it != m_series.end(); ++it) {
+        applyRetention(*it->second);
+    }
+}
+
+uint64_t TimeSeriesStore::getRetention() const
+{
+    ScopedLock lock(m_mutex);
+    return m_retentionMillis;
+}
+
+void TimeSeriesStore::setMemoryBudget(uint64_t bytes)
+{
+    ScopedLock lock(m_mutex);
+    m_memoryBudget = bytes;
+    m_sealOrder.clear();
+    if (bytes == 0) {
+        return;
+    }
+    std::map<uint64_t, SealRef> ordered;
+    for (std::map<uint32_t, Series*>::iterator it = m_series.begin(); it != m_series.end(); ++it) {
+        Series& series = *it->second;
+        for (size_t i = series.firstInMemory; i < series.sealed.size(); ++i) {
+            SealRef ref;
+            ref.seriesId = it->first;
+            ref.sequence = series.sealed[i]->sequence;
+            ordered[ref.sequence] = ref;
+        }
+    }
+    for (std::map<uint64_t, SealRef>::iterator it = ordered.begin(); it != ordered.end(); ++it) {
+        m_sealOrder.push_back(it->second);
+    }
+    enforceBudget();
+}
+
+uint64_t TimeSeriesStore::getMemoryBudget() const
+{
+    ScopedLock lock(m_mutex);
+    return m_memoryBudget;
+}
+
+void TimeSeriesStore::setResolution(float resolution)
+{
+    ScopedLock lock(m_mutex);
+    m_resolution = resolution > 0.0f ? resolution : 0.0f;
+}
+
+float TimeSeriesStore::getResolution() const
+{
+    ScopedLock lock(m_mutex);
+    return m_resolution;
+}
+
+bool TimeSeriesStore::enableSpill(const std::string& directory)
+{
+    ScopedLock lock(m_mutex);
+    if (directory.empty()) {
+        return false;
+    }
+    m_spillDirectory = directory;
+    if (m_spillPrefix.empty()) {
+        m_spillPrefix = uniqueSpillPrefix();
+    }
+    return true;
+}
+
+void TimeSeriesStore::disableSpill()
+{
+    ScopedLock lock(m_mutex);
+    m_spillDirectory.clear();
+}
+
+bool TimeSeriesStore::isSpillEnabled() const
+{
+    ScopedLock lock(m_mutex);
+    return !m_spillDirectory.empty();
+}
+
+TimeSeriesStats TimeSeriesStore::getStats() const
+{
+    ScopedLock lock(m_mutex);
+    TimeSeriesStats stats;
+    stats.series = m_series.size();
+    stats.blocks = m_blockCount;
+    stats.spilledBlocks = m_spilledBlocks;
+    stats.samples = m_samples;
+    stats.memoryBytes = m_memoryBytes;
+    stats.spilledBytes = m_spilledBytes;
+    stats.evictedBlocks = m_evictedBlocks;
+    stats.rejectedSamples = m_rejectedSamples;
+    return stats;
+}
+
+}
@@ -0,0 +1,170 @@
+#ifndef TIME_SERIES_STORE_H
+#define TIME_SERIES_STORE_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include "common_types.h"
+#include "Mutex.h"
+
+namespace MySweetHome {
+
+struct TimeSeriesSample {
+    uint64_t timestamp;
+    float value;
+};
+struct TimeSeriesBucket {
+    uint64_t start;
+    float minimum;
+    float maximum;
+    double sum;
+    uint32_t count;
+
+    float average() const;
+};
+struct TimeSeriesStats {
+    size_t series;
+    size_t blocks;
+    size_t spilledBlocks;
+    uint64_t samples;
+    uint64_t memoryBytes;
+    uint64_t spilledBytes;
+    uint64_t evictedBlocks;
+    uint64_t rejectedSamples;
+
+    TimeSeriesStats();
+    double bitsPerSample() const;
+};
+class BitWriter {
+public:
+    BitWriter();
+    void writeBit(bool bit);
+    void write(uint64_t value, int bits);
+    uint64_t getBitCount() const;
+    const std::vector<uint8_t>& getBytes() const;
+    void swap(std::vector<uint8_t>& bytes);
+    void clear();
+
+private:
+    std::vector<uint8_t> m_bytes;
+    uint64_t m_bitCount;
+};
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size);
+    bool readBit();
+    uint64_t read(int bits);
+    bool isExhausted() const;
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    uint64_t m_position;
+};
+class TimeSeriesStore {
+public:
+    explicit TimeSeriesStore(uint32_t samplesPerBlock = 4096);
+    ~TimeSeriesStore();
+    bool append(uint32_t seriesId, uint64_t timestamp, float value);
+    size_t query(uint32_t seriesId, uint64_t from, uint64_t to,
+                 std::vector<TimeSeriesSample>& out) const;
+    size_t downsample(uint32_t seriesId, uint64_t from, uint64_t to, uint64_t bucketMillis,
+                      std::vector<TimeSeriesBucket>& out) const;
+    bool getLatest(uint32_t seriesId, TimeSeriesSample& sample) const;
+    bool hasSeries(uint32_t seriesId) const;
+    std::vector<uint32_t> getSeriesIds() const;
+    bool removeSeries(uint32_t seriesId);
+    void clear();
+    void flush();
+    void setRetention(uint64_t maxAgeMillis);
+    uint64_t getRetention() const;
+    void setMemoryBudget(uint64_t bytes);
+    uint64_t getMemoryBudget() const;
+    void setResolution(float resolution);
+    float getResolution() const;
+    bool enableSpill(const std::string& directory);
+    void disableSpill();
+    bool isSpillEnabled() const;
+    TimeSeriesStats getStats() const;
+
+private:
+    struct Block {
+        uint64_t sequence;
+        uint64_t firstTime;
+        uint64_t lastTime;
+        uint32_t count;
+        float minimum;
+        float maximum;
+        double sum;
+        std::vector<uint8_t> data;
+        int segment;
+        uint64_t offset;
+        uint32_t length;
+    };
+    struct Series {
+        std::deque<Block*> sealed;
+        size_t firstInMemory;
+        Block open;
+        BitWriter writer;
+        uint32_t encodedCount;
+        uint32_t pendingRepeats;
+        uint64_t lastTime;
+        uint64_t lastDelta;
+        uint32_t lastBits;
+        int leading;
+        int trailing;
+
+        Series();
+    };
+    struct SealRef {
+        uint32_t seriesId;
+        uint64_t sequence;
+    };
+    class SpillSegment;
+
+    TimeSeriesStore(const TimeSeriesStore&);
+    TimeSeriesStore& operator=(const TimeSeriesStore&);
+
+    void encode(Series& series, uint64_t timestamp, float value);
+    void flushRepeats(Series& series);
+    void writeTimestampDelta(BitWriter& writer, int64_t deltaOfDelta);
+    void writeValueXor(Series& series, uint32_t xorValue);
+    void seal(uint32_t seriesId, Series& series);
+    void applyRetention(Series& series);
+    void enforceBudget();
+    bool spillBlock(Block* block);
+    void releaseBlock(Block* block);
+    void dropFront(Series& series);
+    const uint8_t* blockData(const Block& block, std::vector<uint8_t>& scratch) const;
+    void decodeBlock(const Block& block, std::vector<TimeSeriesSample>& out) const;
+    void decodeOpen(const Series& series, std::vector<TimeSeriesSample>& out) const;
+    static void decode(const uint8_t* data, size_t size, uint32_t count,
+                       std::vector<TimeSeriesSample>& out);
+    static void resetBlock(Block& block);
+    void collect(const Series& series, uint64_t from, uint64_t to,
+                 std::vector<TimeSeriesSample>& out) const;
+
+    mutable Mutex m_mutex;
+    std::map<uint32_t, Series*> m_series;
+    std::deque<SealRef> m_sealOrder;
+    std::vector<SpillSegment*> m_segments;
+    std::string m_spillDirectory;
+    std::string m_spillPrefix;
+    uint32_t m_samplesPerBlock;
+    uint64_t m_retentionMillis;
+    uint64_t m_memoryBudget;
+    float m_resolution;
+    uint64_t m_nextSequence;
+    uint64_t m_memoryBytes;
+    uint64_t m_spilledBytes;
+    uint64_t m_samples;
+    uint64_t m_evictedBlocks;
+    uint64_t m_rejectedSamples;
+    size_t m_blockCount;
+    size_t m_spilledBlocks;
+};
+
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "Logger.h"
+#include "AllocationTracker.h"
 #include <iostream>
 #include <ctime>
 #include <sstream>
@@ -16,7 +17,18 @@ Logger::Logger()
     , m_logToFile(false)
     , m_logToConsole(true)
     , m_logFilename("mysweethome.log")
+    , m_clock(0)
+    , m_writeLatency(0)
 {
+    MetricsRegistry& metrics = MetricsRegistry::getInstance();
+    for (int level = LOG_DEBUG; level <= LOG_CRITICAL; ++level) {
+        std::string name = logLevelToString(static_cast<LogLevel>(level));
+        name.erase(name.find_last_not_of(' ') + 1);
+        m_messageCounters[level] = &metrics.counter("msh_log_messages_total", "Log lines written",
+            MetricLabels("subsystem", "logger").add("level", name));
+    }
+    m_writeLatency = &metrics.histogram("msh_log_write_micros", "Time spent formatting and writing a log line",
+                                        MetricLabels("subsystem", "logger"));
 }
 
 Logger::~Logger() {
@@ -28,7 +40,11 @@ void Logger::log(LogLevel level, const std::string& message) {
         return;
     }
 
+    AllocationScope allocations("logger", "log");
+    m_messageCounters[level]->increment();
+    ScopedLatency latency(*m_writeLatency);
     std::string formattedMessage = formatLogMessage(level, message);
+    ScopedLock lock(m_mutex);
     m_logBuffer.push_back(formattedMessage);
     if (m_logBuffer.size() > MAX_LOG_ENTRIES) {
         m_logBuffer.erase(m_logBuffer.begin());
@@ -113,6 +129,7 @@ void Logger::closeLogFile() {
 }
 
 std::vector<std::string> Logger::getRecentLogs(size_t count) const {
+    ScopedLock lock(m_mutex);
     if (count >= m_logBuffer.size()) {
         return m_logBuffer;
     }
@@ -126,9 +143,15 @@ std::vector<std::string> Logger::getRecentLogs(size_t count) const {
 }
 
 void Logger::clearLogs() {
+    ScopedLock lock(m_mutex);
     m_logBuffer.clear();
 }
 
+void Logger::setClock(IClock* clock) {
+    ScopedLock lock(m_mutex);
+    m_clock = clock;
+}
+
 std::string Logger::formatLogMessage(LogLevel level, const std::string& message) {
     std::ostringstream oss;
     oss << "[" << getCurrentTimestamp() << "]"
@@ -149,8 +172,14 @@ std::string Logger::logLevelToString(LogLevel level) const {
 }
 
 std::string Logger::getCurrentTimestamp() const {
-    time_t now = time(0);
-    struct tm* timeinfo = localtime(&now);
+    time_t now = m_clock ? m_clock->wallTime() : ClockProvider::getClock().wallTime();
+    struct tm timeBuffer;
+#ifdef _WIN32
+    localtime_s(&timeBuffer, &now);
+#else
+    localtime_r(&now, &timeBuffer);
+#endif
+    struct tm* timeinfo = &timeBuffer;
 
     std::ostringstream oss;
     oss << (1900 + timeinfo->tm_year) << "-"
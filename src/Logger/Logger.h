@@ -5,6 +5,9 @@
 #include <vector>
 #include <fstream>
 #include "common_types.h"
+#include "Mutex.h"
+#include "Clock.h"
+#include "Metrics.h"
 
 namespace MySweetHome {
 
@@ -27,6 +30,7 @@ public:
     void closeLogFile();
     std::vector<std::string> getRecentLogs(size_t count) const;
     void clearLogs();
+    void setClock(IClock* clock);
 
 private:
     Logger();
@@ -44,6 +48,10 @@ private:
     std::string m_logFilename;
     std::ofstream m_logFile;
     std::vector<std::string> m_logBuffer;
+    mutable Mutex m_mutex;
+    IClock* m_clock;
+    MetricCounter* m_messageCounters[LOG_CRITICAL + 1];
+    LatencyHistogram* m_writeLatency;
 };
 
 }
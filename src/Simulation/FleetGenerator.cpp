@@ -0,0 +1,131 @@
+#include "FleetGenerator.h"
+#include "SmartHome.h"
+#include "Light.h"
+#include "Camera.h"
+#include "Detector.h"
+#include "TV.h"
+#include "Alarm.h"
+#include "SoundSystem.h"
+#include "Logger.h"
+#include <sstream>
+
+namespace MySweetHome {
+FleetGenerator::FleetGenerator(const FleetSpec& spec)
+    : m_spec(spec)
+{
+}
+
+Device* FleetGenerator::createPrototype(DeviceType type, const std::string& brand)
+{
+    switch (type) {
+        case DEVICE_LIGHT:
+            if (brand == "Generic") return new Light(0, "Light", "");
+            if (brand == "China") return new ChinaLight(0, "China Light", "");
+            if (brand == "Philips") return new PhilipsLight(0, "Philips Light", "");
+            if (brand == "IKEA") return new IKEALight(0, "IKEA Light", "");
+            break;
+        case DEVICE_CAMERA:
+            if (brand == "Generic") return new Camera(0, "Camera", "");
+            if (brand == "Samsung") return new SamsungCamera(0, "");
+            if (brand == "Logitech") return new LogitechCamera(0, "");
+            if (brand == "Sony") return new SonyCamera(0, "");
+            break;
+        case DEVICE_SMOKE_DETECTOR:
+            if (brand == "Generic") return new SmokeDetector(0, "Smoke Detector", "");
+            break;
+        case DEVICE_GAS_DETECTOR:
+            if (brand == "Generic") return new GasDetector(0, "Gas Detector", "");
+            break;
+        case DEVICE_TV:
+            if (brand == "Samsung") return new SamsungTV(0, "");
+            if (brand == "LG") return new LGTV(0, "");
+            break;
+        case DEVICE_ALARM:
+            if (brand == "Generic") return new Alarm(0, "Alarm", "");
+            break;
+        case DEVICE_SOUND_SYSTEM:
+            if (brand == "Generic") return new SoundSystem(0, "Sound System", "");
+            if (brand == "Sony") return new SonySoundSystem(0, "");
+            if (brand == "Bose") return new BoseSoundSystem(0, "");
+            if (brand == "JBL") return new JBLSoundSystem(0, "");
+            break;
+    }
+    return 0;
+}
+
+bool FleetGenerator::isSupported(DeviceType type, const std::string& brand)
+{
+    Device* prototype = createPrototype(type, brand);
+    bool supported = prototype != 0;
+    delete prototype;
+    return supported;
+}
+
+std::string FleetGenerator::roomName(uint32_t index)
+{
+    std::ostringstream oss;
+    oss << "Room " << (index + 1);
+    return oss.str();
+}
+
+void FleetGenerator::prepareDevice(Device* device, DeviceType type)
+{
+    if (type == DEVICE_CAMERA) {
+        device->turnOn();
+        static_cast<Camera*>(device)->enableMotionDetection(true);
+    } else if (type == DEVICE_SMOKE_DETECTOR || type == DEVICE_GAS_DETECTOR) {
+        device->turnOn();
+    } else if (type == DEVICE_ALARM) {
+        device->turnOn();
+        static_cast<Alarm*>(device)->armAway();
+    }
+}
+
+size_t FleetGenerator::populate(SmartHome& home)
+{
+    size_t required = home.getDeviceCount() + m_spec.getTotalDevices();
+    if (home.getMaxDevices() < required) {
+        home.setMaxDevices(required);
+    }
+
+    Logger& logger = Logger::getInstance();
+    LogLevel previousLevel = logger.getLogLevel();
+    if (previousLevel < LOG_WARNING) {
+        logger.setLogLevel(LOG_WARNING);
+    }
+
+    size_t added = 0;
+    uint32_t rooms = m_spec.getRooms();
+    const std::vector<FleetEntry>& entries = m_spec.getEntries();
+    for (size_t e = 0; e < entries.size(); ++e) {
+        const FleetEntry& entry = entries[e];
+        Device* prototype = createPrototype(entry.type, entry.brand);
+        if (!prototype) {
+            logger.warning("Unsupported fleet entry: " + FleetSpec::deviceTypeToString(entry.type) +
+                           ":" + entry.brand);
+            continue;
+        }
+        for (uint32_t i = 0; i < entry.count; ++i) {
+            Device* device = prototype->clone();
+            std::ostringstream name;
+            name << prototype->getName() << " " << (i + 1);
+            device->setName(name.str());
+            device->setLocation(roomName(i % rooms));
+            if (!home.addClonedDevice(device)) {
+                delete device;
+                break;
+            }
+            prepareDevice(device, entry.type);
+            ++added;
+        }
+        delete prototype;
+    }
+
+    logger.setLogLevel(previousLevel);
+    std::ostringstream oss;
+    oss << "Fleet generated: " << added << " devices in " << rooms << " rooms.";
+    logger.info(oss.str());
+    return added;
+}
+
+}
@@ -0,0 +1,27 @@
+#ifndef FLEET_GENERATOR_H
+#define FLEET_GENERATOR_H
+
+#include <string>
+#include "FleetSpec.h"
+
+namespace MySweetHome {
+
+class Device;
+class SmartHome;
+class FleetGenerator {
+public:
+    explicit FleetGenerator(const FleetSpec& spec);
+    size_t populate(SmartHome& home);
+    static Device* createPrototype(DeviceType type, const std::string& brand);
+    static bool isSupported(DeviceType type, const std::string& brand);
+    static std::string roomName(uint32_t index);
+
+private:
+    void prepareDevice(Device* device, DeviceType type);
+
+    FleetSpec m_spec;
+};
+
+}
+
+#endif
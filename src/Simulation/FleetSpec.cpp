@@ -0,0 +1,321 @@
+#include "FleetSpec.h"
+#include "Logger.h"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+namespace MySweetHome {
+namespace {
+std::string trim(const std::string& text)
+{
+    const char* whitespace = " \t\r\n";
+    std::string::size_type begin = text.find_first_not_of(whitespace);
+    if (begin == std::string::npos) {
+        return "";
+    }
+    std::string::size_type end = text.find_last_not_of(whitespace);
+    return text.substr(begin, end - begin + 1);
+}
+
+bool parseUnsigned(const std::string& text, uint64_t& value)
+{
+    if (text.empty()) {
+        return false;
+    }
+    char* end = 0;
+    unsigned long long parsed = std::strtoull(text.c_str(), &end, 10);
+    if (*end != '\0' || text[0] == '-') {
+        return false;
+    }
+    value = static_cast<uint64_t>(parsed);
+    return true;
+}
+
+bool parseDouble(const std::string& text, double& value)
+{
+    if (text.empty()) {
+        return false;
+    }
+    char* end = 0;
+    double parsed = std::strtod(text.c_str(), &end);
+    if (*end != '\0' || parsed < 0.0) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+}
+
+FleetSpec::FleetSpec()
+    : m_rooms(1)
+    , m_seed(1)
+    , m_durationSeconds(3600)
+    , m_tickMillis(1000)
+    , m_incidentsPerHour(1.0)
+    , m_motionPerHour(4.0)
+    , m_sensorNoise(1.0)
+{
+}
+
+void FleetSpec::addDevices(DeviceType type, const std::string& brand, uint32_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        if (m_entries[i].type == type && m_entries[i].brand == brand) {
+            m_entries[i].count += count;
+            return;
+        }
+    }
+    FleetEntry entry;
+    entry.type = type;
+    entry.brand = brand;
+    entry.count = count;
+    m_entries.push_back(entry);
+}
+
+const std::vector<FleetEntry>& FleetSpec::getEntries() const
+{
+    return m_entries;
+}
+
+uint32_t FleetSpec::getTotalDevices() const
+{
+    uint32_t total = 0;
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        total += m_entries[i].count;
+    }
+    return total;
+}
+
+uint32_t FleetSpec::getCount(DeviceType type) const
+{
+    uint32_t total = 0;
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        if (m_entries[i].type == type) {
+            total += m_entries[i].count;
+        }
+    }
+    return total;
+}
+
+void FleetSpec::setRooms(uint32_t rooms)
+{
+    m_rooms = rooms > 0 ? rooms : 1;
+}
+
+uint32_t FleetSpec::getRooms() const
+{
+    return m_rooms;
+}
+
+void FleetSpec::setSeed(uint64_t seed)
+{
+    m_seed = seed;
+}
+
+uint64_t FleetSpec::getSeed() const
+{
+    return m_seed;
+}
+
+void FleetSpec::setDurationSeconds(uint32_t seconds)
+{
+    m_durationSeconds = seconds;
+}
+
+uint32_t FleetSpec::getDurationSeconds() const
+{
+    return m_durationSeconds;
+}
+
+void FleetSpec::setTickMillis(uint32_t millis)
+{
+    m_tickMillis = millis > 0 ? millis : 1;
+}
+
+uint32_t FleetSpec::getTickMillis() const
+{
+    return m_tickMillis;
+}
+
+void FleetSpec::setIncidentsPerHour(double rate)
+{
+    m_incidentsPerHour = rate < 0.0 ? 0.0 : rate;
+}
+
+double FleetSpec::getIncidentsPerHour() const
+{
+    return m_incidentsPerHour;
+}
+
+void FleetSpec::setMotionPerHour(double rate)
+{
+    m_motionPerHour = rate < 0.0 ? 0.0 : rate;
+}
+
+double FleetSpec::getMotionPerHour() const
+{
+    return m_motionPerHour;
+}
+
+void FleetSpec::setSensorNoise(double noise)
+{
+    m_sensorNoise = noise < 0.0 ? 0.0 : noise;
+}
+
+double FleetSpec::getSensorNoise() const
+{
+    return m_sensorNoise;
+}
+
+bool FleetSpec::applySetting(const std::string& key, const std::string& value)
+{
+    uint64_t number = 0;
+    double real = 0.0;
+    if (key == "rooms" && parseUnsigned(value, number)) {
+        setRooms(static_cast<uint32_t>(number));
+    } else if (key == "seed" && parseUnsigned(value, number)) {
+        setSeed(number);
+    } else if (key == "duration" && parseUnsigned(value, number)) {
+        setDurationSeconds(static_cast<uint32_t>(number));
+    } else if (key == "tick" && parseUnsigned(value, number)) {
+        setTickMillis(static_cast<uint32_t>(number));
+    } else if (key == "incidents_per_hour" && parseDouble(value, real)) {
+        setIncidentsPerHour(real);
+    } else if (key == "motion_per_hour" && parseDouble(value, real)) {
+        setMotionPerHour(real);
+    } else if (key == "noise" && parseDouble(value, real)) {
+        setSensorNoise(real);
+    } else {
+        std::string typeName = key;
+        std::string brand = "Generic";
+        std::string::size_type colon = key.find(':');
+        if (colon != std::string::npos) {
+            typeName = trim(key.substr(0, colon));
+            brand = trim(key.substr(colon + 1));
+        }
+        DeviceType type;
+        if (!parseDeviceType(typeName, type) || brand.empty() || !parseUnsigned(value, number)) {
+            return false;
+        }
+        addDevices(type, brand, static_cast<uint32_t>(number));
+    }
+    return true;
+}
+
+bool FleetSpec::parse(const std::string& text)
+{
+    std::istringstream input(text);
+    std::string line;
+    int lineNumber = 0;
+    bool ok = true;
+    while (std::getline(input, line)) {
+        ++lineNumber;
+        std::string::size_type comment = line.find('#');
+        if (comment != std::string::npos) {
+            line = line.substr(0, comment);
+        }
+        line = trim(line);
+        if (line.empty()) {
+            continue;
+        }
+        std::string::size_type equals = line.find('=');
+        if (equals == std::string::npos ||
+            !applySetting(trim(line.substr(0, equals)), trim(line.substr(equals + 1)))) {
+            std::ostringstream oss;
+            oss << "Fleet spec line " << lineNumber << " ignored: " << line;
+            Logger::getInstance().warning(oss.str());
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool FleetSpec::loadFromFile(const std::string& path)
+{
+    std::ifstream file(path.c_str());
+    if (!file.is_open()) {
+        Logger::getInstance().error("Could not open fleet spec: " + path);
+        return false;
+    }
+    std::ostringstream content;
+    content << file.rdbuf();
+    return parse(content.str());
+}
+
+std::string FleetSpec::describe() const
+{
+    std::ostringstream oss;
+    oss << "Fleet: " << getTotalDevices() << " devices in " << m_rooms << " rooms"
+        << " | seed " << m_seed
+        << " | " << m_durationSeconds << " s simulated, tick " << m_tickMillis << " ms"
+        << " | incidents/h " << m_incidentsPerHour
+        << " | motion/h per camera " << m_motionPerHour;
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        oss << "\n  " << deviceTypeToString(m_entries[i].type) << ":" << m_entries[i].brand
+            << " x" << m_entries[i].count;
+    }
+    return oss.str();
+}
+
+bool FleetSpec::parseDeviceType(const std::string& name, DeviceType& type)
+{
+    if (name == "light") {
+        type = DEVICE_LIGHT;
+    } else if (name == "camera") {
+        type = DEVICE_CAMERA;
+    } else if (name == "smoke") {
+        type = DEVICE_SMOKE_DETECTOR;
+    } else if (name == "gas") {
+        type = DEVICE_GAS_DETECTOR;
+    } else if (name == "tv") {
+        type = DEVICE_TV;
+    } else if (name == "alarm") {
+        type = DEVICE_ALARM;
+    } else if (name == "sound") {
+        type = DEVICE_SOUND_SYSTEM;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string FleetSpec::deviceTypeToString(DeviceType type)
+{
+    switch (type) {
+        case DEVICE_LIGHT: return "light";
+        case DEVICE_CAMERA: return "camera";
+        case DEVICE_SMOKE_DETECTOR: return "smoke";
+        case DEVICE_GAS_DETECTOR: return "gas";
+        case DEVICE_TV: return "tv";
+        case DEVICE_ALARM: return "alarm";
+        case DEVICE_SOUND_SYSTEM: return "sound";
+    }
+    return "unknown";
+}
+
+FleetSpec FleetSpec::defaultSpec()
+{
+    FleetSpec spec;
+    spec.setRooms(50);
+    spec.addDevices(DEVICE_LIGHT, "Generic", 400);
+    spec.addDevices(DEVICE_LIGHT, "Philips", 300);
+    spec.addDevices(DEVICE_LIGHT, "IKEA", 200);
+    spec.addDevices(DEVICE_LIGHT, "China", 100);
+    spec.addDevices(DEVICE_CAMERA, "Samsung", 40);
+    spec.addDevices(DEVICE_CAMERA, "Sony", 40);
+    spec.addDevices(DEVICE_CAMERA, "Logitech", 20);
+    spec.addDevices(DEVICE_SMOKE_DETECTOR, "Generic", 300);
+    spec.addDevices(DEVICE_GAS_DETECTOR, "Generic", 150);
+    spec.addDevices(DEVICE_TV, "Samsung", 30);
+    spec.addDevices(DEVICE_TV, "LG", 20);
+    spec.addDevices(DEVICE_SOUND_SYSTEM, "Bose", 25);
+    spec.addDevices(DEVICE_SOUND_SYSTEM, "JBL", 25);
+    spec.addDevices(DEVICE_ALARM, "Generic", 50);
+    spec.setIncidentsPerHour(6.0);
+    return spec;
+}
+
+}
@@ -0,0 +1,58 @@
+#ifndef FLEET_SPEC_H
+#define FLEET_SPEC_H
+
+#include <string>
+#include <vector>
+#include "common_types.h"
+
+namespace MySweetHome {
+
+struct FleetEntry {
+    DeviceType type;
+    std::string brand;
+    uint32_t count;
+};
+class FleetSpec {
+public:
+    FleetSpec();
+    void addDevices(DeviceType type, const std::string& brand, uint32_t count);
+    const std::vector<FleetEntry>& getEntries() const;
+    uint32_t getTotalDevices() const;
+    uint32_t getCount(DeviceType type) const;
+    void setRooms(uint32_t rooms);
+    uint32_t getRooms() const;
+    void setSeed(uint64_t seed);
+    uint64_t getSeed() const;
+    void setDurationSeconds(uint32_t seconds);
+    uint32_t getDurationSeconds() const;
+    void setTickMillis(uint32_t millis);
+    uint32_t getTickMillis() const;
+    void setIncidentsPerHour(double rate);
+    double getIncidentsPerHour() const;
+    void setMotionPerHour(double rate);
+    double getMotionPerHour() const;
+    void setSensorNoise(double noise);
+    double getSensorNoise() const;
+    bool parse(const std::string& text);
+    bool loadFromFile(const std::string& path);
+    std::string describe() const;
+    static bool parseDeviceType(const std::string& name, DeviceType& type);
+    static std::string deviceTypeToString(DeviceType type);
+    static FleetSpec defaultSpec();
+
+private:
+    bool applySetting(const std::string& key, const std::string& value);
+
+    std::vector<FleetEntry> m_entries;
+    uint32_t m_rooms;
+    uint64_t m_seed;
+    uint32_t m_durationSeconds;
+    uint32_t m_tickMillis;
+    double m_incidentsPerHour;
+    double m_motionPerHour;
+    double m_sensorNoise;
+};
+
+}
+
+#endif
@@ -0,0 +1,388 @@
+#include "LoadHarness.h"
+#include "SmartHome.h"
+#include "Detector.h"
+#include "Camera.h"
+#include "Alarm.h"
+#include "Logger.h"
+#include "MonotonicTime.h"
+#include "ResourceUsage.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+
+namespace MySweetHome {
+namespace {
+const char* const SUBSYSTEM_NAMES[SUBSYSTEM_COUNT] = {
+    "sensors", "detectors", "alarms", "cameras", "system"
+};
+const double SENSOR_SMOOTHING = 0.9;
+const uint64_t SYSTEM_UPDATE_MILLIS = 10000;
+const std::string DEFAULT_ALARM_PIN = "1234";
+
+std::string formatBytes(uint64_t bytes)
+{
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1) << (bytes / (1024.0 * 1024.0)) << " MB";
+    return oss.str();
+}
+}
+
+LoadReport::LoadReport()
+    : deviceCount(0)
+    , detectorCount(0)
+    , cameraCount(0)
+    , alarmCount(0)
+    , simulatedMillis(0)
+    , wallMicros(0)
+    , ticks(0)
+    , sensorReadings(0)
+    , incidents(0)
+    , motionEvents(0)
+    , alarmEvents(0)
+    , falseAlarms(0)
+    , readingsPerSecond(0.0)
+    , speedup(0.0)
+    , latencySamples(0)
+    , latencyP50Micros(0)
+    , latencyP90Micros(0)
+    , latencyP99Micros(0)
+    , latencyMaxMicros(0)
+    , rssBeforeBytes(0)
+    , rssAfterBytes(0)
+    , peakRssBytes(0)
+    , processCpuMicros(0)
+    , allocationsTracked(false)
+{
+}
+
+std::string LoadReport::toString() const
+{
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1);
+    oss << "=== Load Report ===\n"
+        << "Devices: " << deviceCount << " (detectors " << detectorCount
+        << ", cameras " << cameraCount << ", alarms " << alarmCount << ")\n"
+        << "Simulated: " << (simulatedMillis / 1000.0) << " s in " << ticks << " ticks, wall "
+        << (wallMicros / 1000.0) << " ms (x" << speedup << ")\n"
+        << "Throughput: " << sensorReadings << " readings, " << readingsPerSecond << " readings/s\n"
+        << "Events: " << incidents << " incidents, " << motionEvents << " motion, "
+        << alarmEvents << " alarms, " << falseAlarms << " false alarms\n"
+        << "Event-to-alarm latency (us, n=" << latencySamples << "): p50 " << latencyP50Micros
+        << " | p90 " << latencyP90Micros << " | p99 " << latencyP99Micros
+        << " | max " << latencyMaxMicros << "\n"
+        << "Memory: RSS " << formatBytes(rssBeforeBytes) << " -> " << formatBytes(rssAfterBytes)
+        << ", peak " << formatBytes(peakRssBytes) << "\n"
+        << "CPU: " << (processCpuMicros / 1000.0) << " ms process\n";
+    for (size_t i = 0; i < subsystems.size(); ++i) {
+        oss << "  " << std::left << std::setw(10) << subsystems[i].name << std::right
+            << " cpu " << std::setw(9) << (subsystems[i].cpuMicros / 1000.0) << " ms"
+            << " | wall " << std::setw(9) << (subsystems[i].wallMicros / 1000.0) << " ms"
+            << " | ops " << subsystems[i].operations;
+        if (allocationsTracked) {
+            oss << " | alloc " << subsystems[i].allocations << " (" << formatBytes(subsystems[i].allocatedBytes) << ")";
+        }
+        oss << "\n";
+    }
+    return oss.str();
+}
+
+LoadHarness::LoadHarness(SmartHome& home, const FleetSpec& spec)
+    : m_home(home)
+    , m_spec(spec)
+    , m_random(spec.getSeed())
+    , m_phaseCpuStart(0)
+    , m_phaseWallStart(0)
+    , m_incidents(0)
+    , m_motionEvents(0)
+    , m_alarmEvents(0)
+    , m_falseAlarms(0)
+{
+    for (int i = 0; i < SUBSYSTEM_COUNT; ++i) {
+        m_usage[i].name = SUBSYSTEM_NAMES[i];
+        m_usage[i].cpuMicros = 0;
+        m_usage[i].wallMicros = 0;
+        m_usage[i].operations = 0;
+        m_usage[i].allocations = 0;
+        m_usage[i].allocatedBytes = 0;
+    }
+}
+
+LoadHarness::~LoadHarness()
+{
+}
+
+uint64_t LoadHarness::percentile(const std::vector<uint64_t>& sorted, double fraction)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+    if (rank == 0) {
+        rank = 1;
+    }
+    if (rank > sorted.size()) {
+        rank = sorted.size();
+    }
+    return sorted[rank - 1];
+}
+
+void LoadHarness::collectDevices()
+{
+    std::vector<Device*> devices = m_home.getAllDevices();
+    for (size_t i = 0; i < devices.size(); ++i) {
+        if (Detector* detector = dynamic_cast<Detector*>(devices[i])) {
+            float threshold = detector->getThreshold();
+            float baseline = threshold * static_cast<float>(0.1 + 0.2 * m_random.nextDouble());
+            m_detectors.push_back(detector);
+            m_baseline.push_back(baseline);
+            m_values.push_back(baseline);
+            m_ramp.push_back(0.0f);
+            m_eventStart.push_back(0);
+            if (detector->getId() >= m_indexById.size()) {
+                m_indexById.resize(detector->getId() + 1, 0);
+            }
+            m_indexById[detector->getId()] = static_cast<uint32_t>(m_detectors.size() - 1);
+            m_pipeline.registerDetector(detector);
+            SensorReading reading;
+            reading.detectorId = detector->getId();
+            reading.value = baseline;
+            reading.timestamp = 0;
+            m_batch.push_back(reading);
+        } else if (Camera* camera = dynamic_cast<Camera*>(devices[i])) {
+            m_cameras.push_back(camera);
+        } else if (Alarm* alarm = dynamic_cast<Alarm*>(devices[i])) {
+            m_alarms.push_back(alarm);
+            if (m_roomAlarms.find(alarm->getLocation()) == m_roomAlarms.end()) {
+                m_roomAlarms[alarm->getLocation()] = alarm;
+            }
+        }
+    }
+}
+
+uint32_t LoadHarness::poissonSample(double lambda)
+{
+    if (lambda <= 0.0) {
+        return 0;
+    }
+    double limit = std::exp(-lambda);
+    double product = m_random.nextDouble();
+    uint32_t count = 0;
+    while (product > limit) {
+        ++count;
+        product *= m_random.nextDouble();
+    }
+    return count;
+}
+
+void LoadHarness::startIncidents(double dtSeconds)
+{
+    if (m_detectors.empty()) {
+        return;
+    }
+    uint32_t count = poissonSample(m_spec.getIncidentsPerHour() * dtSeconds / 3600.0);
+    for (uint32_t i = 0; i < count; ++i) {
+        size_t index = m_random.nextUInt() % m_detectors.size();
+        if (m_ramp[index] > 0.0f) {
+            continue;
+        }
+        float threshold = m_detectors[index]->getThreshold();
+        m_ramp[index] = threshold * static_cast<float>(0.02 + 0.08 * m_random.nextDouble());
+        ++m_incidents;
+    }
+}
+
+void LoadHarness::generateReadings(double dtSeconds)
+{
+    float noise = static_cast<float>(m_spec.getSensorNoise());
+    float smoothing = static_cast<float>(std::pow(SENSOR_SMOOTHING, dtSeconds));
+    for (size_t i = 0; i < m_detectors.size(); ++i) {
+        float sigma = m_baseline[i] * 0.05f * noise;
+        float value = m_baseline[i] + smoothing * (m_values[i] - m_baseline[i]) +
+                      sigma * static_cast<float>(m_random.nextGaussian());
+        if (m_ramp[i] > 0.0f) {
+            value = m_values[i] + m_ramp[i] * static_cast<float>(dtSeconds);
+        }
+        if (value < 0.0f) {
+            value = 0.0f;
+        }
+        m_values[i] = value;
+        if (m_ramp[i] > 0.0f && m_eventStart[i] == 0 && value >= m_detectors[i]->getThreshold()) {
+            m_eventStart[i] = monotonicMicros();
+        }
+    }
+}
+
+void LoadHarness::ingestReadings(uint64_t timestamp)
+{
+    for (size_t i = 0; i < m_batch.size(); ++i) {
+        m_batch[i].value = m_values[i];
+        m_batch[i].timestamp = timestamp;
+    }
+    m_pipeline.ingestAndProcess(m_batch);
+}
+
+Alarm* LoadHarness::alarmForRoom(const std::string& room) const
+{
+    std::map<std::string, Alarm*>::const_iterator it = m_roomAlarms.find(room);
+    if (it != m_roomAlarms.end()) {
+        return it->second;
+    }
+    return m_alarms.empty() ? 0 : m_alarms[0];
+}
+
+void LoadHarness::raiseAlarm(Alarm* alarm, AlarmType type)
+{
+    ++m_alarmEvents;
+    if (!alarm) {
+        return;
+    }
+    alarm->trigger(type);
+    alarm->disarm(DEFAULT_ALARM_PIN);
+    alarm->armAway();
+}
+
+void LoadHarness::handleAlarms()
+{
+    const std::vector<SensorEvent>& events = m_pipeline.getLastEvents();
+    for (size_t e = 0; e < events.size(); ++e) {
+        if (!events[e].rising) {
+            continue;
+        }
+        size_t i = m_indexById[events[e].detectorId];
+        Detector* detector = m_detectors[i];
+        if (!detector->isAlarmTriggered()) {
+            continue;
+        }
+        AlarmType type = detector->getDetectorType() == DETECTOR_GAS ? ALARM_GAS_LEAK : ALARM_FIRE;
+        raiseAlarm(alarmForRoom(detector->getLocation()), type);
+        if (m_eventStart[i] != 0) {
+            m_latencies.push_back(monotonicMicros() - m_eventStart[i]);
+            m_eventStart[i] = 0;
+            m_ramp[i] = 0.0f;
+            m_values[i] = m_baseline[i];
+        } else {
+            ++m_falseAlarms;
+        }
+        detector->resetAlarm();
+    }
+}
+
+void LoadHarness::simulateMotion(double dtSeconds)
+{
+    double probability = m_spec.getMotionPerHour() * dtSeconds / 3600.0;
+    for (size_t i = 0; i < m_cameras.size(); ++i) {
+        if (!m_random.nextBool(probability)) {
+            continue;
+        }
+        ++m_motionEvents;
+        uint64_t start = monotonicMicros();
+        if (m_cameras[i]->detectMotion()) {
+            raiseAlarm(alarmForRoom(m_cameras[i]->getLocation()), ALARM_INTRUSION);
+            m_latencies.push_back(monotonicMicros() - start);
+        }
+    }
+}
+
+void LoadHarness::beginPhase()
+{
+    m_phaseCpuStart = ResourceUsage::threadCpuMicros();
+    m_phaseWallStart = monotonicMicros();
+    m_phaseAllocations.restart();
+}
+
+void LoadHarness::endPhase(HarnessSubsystem subsystem, uint64_t operations)
+{
+    m_usage[subsystem].cpuMicros += ResourceUsage::threadCpuMicros() - m_phaseCpuStart;
+    m_usage[subsystem].wallMicros += monotonicMicros() - m_phaseWallStart;
+    m_usage[subsystem].operations += operations;
+    m_usage[subsystem].allocations += m_phaseAllocations.getAllocations();
+    m_usage[subsystem].allocatedBytes += m_phaseAllocations.getBytes();
+}
+
+LoadReport LoadHarness::run()
+{
+    LoadReport report;
+    report.rssBeforeBytes = ResourceUsage::currentRssBytes();
+    uint64_t cpuStart = ResourceUsage::processCpuMicros();
+    uint64_t wallStart = monotonicMicros();
+
+    collectDevices();
+    report.deviceCount = m_home.getDeviceCount();
+    report.detectorCount = m_detectors.size();
+    report.cameraCount = m_cameras.size();
+    report.alarmCount = m_alarms.size();
+
+    uint64_t tickMillis = m_spec.getTickMillis();
+    uint64_t durationMillis = static_cast<uint64_t>(m_spec.getDurationSeconds()) * 1000ULL;
+    double dtSeconds = tickMillis / 1000.0;
+    uint64_t nextSystemUpdate = SYSTEM_UPDATE_MILLIS;
+    uint64_t simulated = 0;
+
+    std::ostringstream oss;
+    oss << "Load run started: " << report.deviceCount << " devices, "
+        << m_spec.getDurationSeconds() << " s simulated.";
+    Logger::getInstance().info(oss.str());
+
+    while (simulated < durationMillis) {
+        simulated += tickMillis;
+        ++report.ticks;
+
+        beginPhase();
+        startIncidents(dtSeconds);
+        generateReadings(dtSeconds);
+        endPhase(SUBSYSTEM_SENSORS, m_detectors.size());
+
+        beginPhase();
+        ingestReadings(simulated);
+        endPhase(SUBSYSTEM_DETECTORS, m_detectors.size());
+
+        beginPhase();
+        uint64_t alarmsBefore = m_alarmEvents;
+        handleAlarms();
+        endPhase(SUBSYSTEM_ALARMS, m_alarmEvents - alarmsBefore);
+
+        beginPhase();
+        uint64_t motionBefore = m_motionEvents;
+        simulateMotion(dtSeconds);
+        endPhase(SUBSYSTEM_CAMERAS, m_motionEvents - motionBefore);
+
+        if (simulated >= nextSystemUpdate) {
+            nextSystemUpdate += SYSTEM_UPDATE_MILLIS;
+            beginPhase();
+            m_home.update();
+            endPhase(SUBSYSTEM_SYSTEM, 1);
+        }
+    }
+
+    report.simulatedMillis = simulated;
+    report.wallMicros = monotonicMicros() - wallStart;
+    report.processCpuMicros = ResourceUsage::processCpuMicros() - cpuStart;
+    report.sensorReadings = report.ticks * m_detectors.size();
+    report.incidents = m_incidents;
+    report.motionEvents = m_motionEvents;
+    report.alarmEvents = m_alarmEvents;
+    report.falseAlarms = m_falseAlarms;
+    if (report.wallMicros > 0) {
+        report.readingsPerSecond = report.sensorReadings * 1000000.0 / report.wallMicros;
+        report.speedup = report.simulatedMillis * 1000.0 / report.wallMicros;
+    }
+
+    std::sort(m_latencies.begin(), m_latencies.end());
+    report.latencySamples = m_latencies.size();
+    report.latencyP50Micros = percentile(m_latencies, 0.50);
+    report.latencyP90Micros = percentile(m_latencies, 0.90);
+    report.latencyP99Micros = percentile(m_latencies, 0.99);
+    report.latencyMaxMicros = m_latencies.empty() ? 0 : m_latencies.back();
+
+    report.rssAfterBytes = ResourceUsage::currentRssBytes();
+    report.peakRssBytes = ResourceUsage::peakRssBytes();
+    report.allocationsTracked = AllocationTracker::isAvailable();
+    for (int i = 0; i < SUBSYSTEM_COUNT; ++i) {
+        report.subsystems.push_back(m_usage[i]);
+    }
+    Logger::getInstance().info("Load run finished.");
+    return report;
+}
+
+}
@@ -0,0 +1,113 @@
+#ifndef LOAD_HARNESS_H
+#define LOAD_HARNESS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include "FleetSpec.h"
+#include "Random.h"
+#include "SensorPipeline.h"
+#include "AllocationTracker.h"
+
+namespace MySweetHome {
+
+class SmartHome;
+class Detector;
+class Camera;
+class Alarm;
+enum HarnessSubsystem {
+    SUBSYSTEM_SENSORS,
+    SUBSYSTEM_DETECTORS,
+    SUBSYSTEM_ALARMS,
+    SUBSYSTEM_CAMERAS,
+    SUBSYSTEM_SYSTEM,
+    SUBSYSTEM_COUNT
+};
+struct SubsystemUsage {
+    std::string name;
+    uint64_t cpuMicros;
+    uint64_t wallMicros;
+    uint64_t operations;
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+};
+struct LoadReport {
+    size_t deviceCount;
+    size_t detectorCount;
+    size_t cameraCount;
+    size_t alarmCount;
+    uint64_t simulatedMillis;
+    uint64_t wallMicros;
+    uint64_t ticks;
+    uint64_t sensorReadings;
+    uint64_t incidents;
+    uint64_t motionEvents;
+    uint64_t alarmEvents;
+    uint64_t falseAlarms;
+    double readingsPerSecond;
+    double speedup;
+    size_t latencySamples;
+    uint64_t latencyP50Micros;
+    uint64_t latencyP90Micros;
+    uint64_t latencyP99Micros;
+    uint64_t latencyMaxMicros;
+    uint64_t rssBeforeBytes;
+    uint64_t rssAfterBytes;
+    uint64_t peakRssBytes;
+    uint64_t processCpuMicros;
+    bool allocationsTracked;
+    std::vector<SubsystemUsage> subsystems;
+    LoadReport();
+    std::string toString() const;
+};
+class LoadHarness {
+public:
+    LoadHarness(SmartHome& home, const FleetSpec& spec);
+    ~LoadHarness();
+    LoadReport run();
+    static uint64_t percentile(const std::vector<uint64_t>& sorted, double fraction);
+
+private:
+    LoadHarness(const LoadHarness&);
+    LoadHarness& operator=(const LoadHarness&);
+
+    void collectDevices();
+    void generateReadings(double dtSeconds);
+    void startIncidents(double dtSeconds);
+    void ingestReadings(uint64_t timestamp);
+    void handleAlarms();
+    void simulateMotion(double dtSeconds);
+    uint32_t poissonSample(double lambda);
+    Alarm* alarmForRoom(const std::string& room) const;
+    void raiseAlarm(Alarm* alarm, AlarmType type);
+    void beginPhase();
+    void endPhase(HarnessSubsystem subsystem, uint64_t operations);
+
+    SmartHome& m_home;
+    FleetSpec m_spec;
+    Random m_random;
+    std::vector<Detector*> m_detectors;
+    std::vector<float> m_baseline;
+    std::vector<float> m_values;
+    std::vector<float> m_ramp;
+    std::vector<uint64_t> m_eventStart;
+    std::vector<uint32_t> m_indexById;
+    std::vector<SensorReading> m_batch;
+    SensorPipeline m_pipeline;
+    std::vector<Camera*> m_cameras;
+    std::vector<Alarm*> m_alarms;
+    std::map<std::string, Alarm*> m_roomAlarms;
+    std::vector<uint64_t> m_latencies;
+    SubsystemUsage m_usage[SUBSYSTEM_COUNT];
+    uint64_t m_phaseCpuStart;
+    uint64_t m_phaseWallStart;
+    AllocationMeter m_phaseAllocations;
+    uint64_t m_incidents;
+    uint64_t m_motionEvents;
+    uint64_t m_alarmEvents;
+    uint64_t m_falseAlarms;
+};
+
+}
+
+#endif
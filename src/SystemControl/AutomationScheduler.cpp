@@ -0,0 +1,456 @@
+#include "AutomationScheduler.h"
+#include "SmartHome.h"
+#include "Device.h"
+#include "Logger.h"
+#include <algorithm>
+#include <sstream>
+
+namespace MySweetHome {
+namespace {
+const int MAX_EXCEPTION_SKIPS = 4096;
+const size_t MAX_MISSED_SCAN = 100000;
+
+int64_t localDayOf(int64_t localSeconds) {
+    int64_t day = localSeconds / 86400;
+    if (localSeconds < 0 && localSeconds % 86400 != 0) {
+        --day;
+    }
+    return day;
+}
+
+}
+
+ScheduleAction::ScheduleAction()
+    : kind(SCHEDULE_SET_MODE)
+    , mode(MODE_NORMAL)
+    , state(STATE_NORMAL)
+    , anyType(true)
+    , type(DEVICE_LIGHT)
+{
+}
+
+ScheduleAction ScheduleAction::setMode(SystemMode mode) {
+    ScheduleAction action;
+    action.kind = SCHEDULE_SET_MODE;
+    action.mode = mode;
+    return action;
+}
+
+ScheduleAction ScheduleAction::setState(SystemState state) {
+    ScheduleAction action;
+    action.kind = SCHEDULE_SET_STATE;
+    action.state = state;
+    return action;
+}
+
+ScheduleAction ScheduleAction::applyScene(const std::string& scene) {
+    ScheduleAction action;
+    action.kind = SCHEDULE_APPLY_SCENE;
+    action.scene = scene;
+    return action;
+}
+
+ScheduleAction ScheduleAction::devices(const std::vector<uint32_t>& deviceIds, const DeviceTarget& target) {
+    ScheduleAction action;
+    action.kind = SCHEDULE_DEVICES;
+    action.deviceIds = deviceIds;
+    action.target = target;
+    return action;
+}
+
+ScheduleAction ScheduleAction::allInLocation(const std::string& location, const DeviceTarget& target) {
+    ScheduleAction action;
+    action.kind = SCHEDULE_LOCATION;
+    action.location = location;
+    action.target = target;
+    return action;
+}
+
+ScheduleAction ScheduleAction::typeInLocation(DeviceType type, const std::string& location,
+                                              const DeviceTarget& target) {
+    ScheduleAction action = allInLocation(location, target);
+    action.anyType = false;
+    action.type = type;
+    return action;
+}
+
+ScheduleDefinition::ScheduleDefinition(const std::string& scheduleName, const std::string& expression,
+                                       const ScheduleAction& scheduleAction)
+    : name(scheduleName)
+    , cron(expression)
+    , action(scheduleAction)
+    , catchUp(CATCH_UP_ONCE)
+    , graceSeconds(60)
+    , maxLatenessSeconds(0)
+    , maxCatchUp(24)
+    , skipHolidays(false)
+{
+}
+
+ScheduleDefinition& ScheduleDefinition::exclude(int year, int month, int day) {
+    int64_t date = daysFromCivil(year, month, day);
+    exclusions.push_back(std::make_pair(date, date));
+    return *this;
+}
+
+ScheduleDefinition& ScheduleDefinition::excludeRange(int fromYear, int fromMonth, int fromDay,
+                                                     int toYear, int toMonth, int toDay) {
+    exclusions.push_back(std::make_pair(daysFromCivil(fromYear, fromMonth, fromDay),
+                                        daysFromCivil(toYear, toMonth, toDay)));
+    return *this;
+}
+
+ScheduleDefinition& ScheduleDefinition::withCatchUp(CatchUpPolicy policy, int64_t maxLateness) {
+    catchUp = policy;
+    maxLatenessSeconds = maxLateness;
+    return *this;
+}
+
+ScheduleDefinition& ScheduleDefinition::withHolidays(bool skip) {
+    skipHolidays = skip;
+    return *this;
+}
+
+SchedulerStats::SchedulerStats()
+    : fired(0)
+    , caughtUp(0)
+    , skippedMissed(0)
+    , skippedExceptions(0)
+    , nextComputations(0)
+    , ticks(0)
+    , heapEntries(0)
+    , schedules(0)
+{
+}
+
+bool AutomationScheduler::HeapEntry::operator<(const HeapEntry& other) const {
+    if (due != other.due) {
+        return due > other.due;
+    }
+    return scheduleId > other.scheduleId;
+}
+
+AutomationScheduler::AutomationScheduler(SmartHome* home)
+    : m_home(home)
+    , m_listener(0)
+    , m_utcOffset(0)
+    , m_nextId(1)
+{
+}
+
+AutomationScheduler::~AutomationScheduler() {
+    for (std::map<uint32_t, Schedule*>::iterator it = m_schedules.begin(); it != m_schedules.end(); ++it) {
+        delete it->second;
+    }
+    m_schedules.clear();
+}
+
+void AutomationScheduler::setSmartHome(SmartHome* home) {
+    m_home = home;
+}
+
+void AutomationScheduler::setListener(IScheduleListener* listener) {
+    m_listener = listener;
+}
+
+void AutomationScheduler::setUtcOffset(int seconds) {
+    m_utcOffset = seconds;
+}
+
+int AutomationScheduler::getUtcOffset() const {
+    return m_utcOffset;
+}
+
+int AutomationScheduler::hostUtcOffset(time_t when) {
+    struct tm local;
+    struct tm utc;
+#ifdef _WIN32
+    if (localtime_s(&local, &when) != 0 || gmtime_s(&utc, &when) != 0) {
+        return 0;
+    }
+#else
+    if (!localtime_r(&when, &local) || !gmtime_r(&when, &utc)) {
+        return 0;
+    }
+#endif
+    int64_t localSeconds = daysFromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday) * 86400
+        + local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+    int64_t utcSeconds = daysFromCivil(utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday) * 86400
+        + utc.tm_hour * 3600 + utc.tm_min * 60 + utc.tm_sec;
+    return static_cast<int>(localSeconds - utcSeconds);
+}
+
+void AutomationScheduler::addHoliday(int year, int month, int day) {
+    int64_t date = daysFromCivil(year, month, day);
+    std::vector<int64_t>::iterator it = std::lower_bound(m_holidays.begin(), m_holidays.end(), date);
+    if (it == m_holidays.end() || *it != date) {
+        m_holidays.insert(it, date);
+    }
+}
+
+void AutomationScheduler::clearHolidays() {
+    m_holidays.clear();
+}
+
+uint32_t AutomationScheduler::addSchedule(const ScheduleDefinition& definition, time_t now) {
+    CronExpression cron(definition.cron);
+    if (!cron.isValid()) {
+        Logger::getInstance().warning("Gecersiz zamanlama ifadesi (" + definition.name + "): " + cron.getError());
+        return 0;
+    }
+    Schedule* schedule = new Schedule();
+    schedule->id = m_nextId++;
+    schedule->definition = definition;
+    schedule->cron = cron;
+    schedule->next = 0;
+    schedule->generation = 0;
+    schedule->enabled = true;
+    schedule->fired = 0;
+    m_schedules[schedule->id] = schedule;
+    reschedule(*schedule, now);
+    return schedule->id;
+}
+
+bool AutomationScheduler::removeSchedule(uint32_t scheduleId) {
+    std::map<uint32_t, Schedule*>::iterator it = m_schedules.find(scheduleId);
+    if (it == m_schedules.end()) {
+        return false;
+    }
+    delete it->second;
+    m_schedules.erase(it);
+    return true;
+}
+
+bool AutomationScheduler::setScheduleEnabled(uint32_t scheduleId, bool enabled, time_t now) {
+    Schedule* schedule = findSchedule(scheduleId);
+    if (!schedule) {
+        return false;
+    }
+    if (schedule->enabled != enabled) {
+        schedule->enabled = enabled;
+        if (enabled) {
+            reschedule(*schedule, now);
+        } else {
+            ++schedule->generation;
+            schedule->next = 0;
+        }
+    }
+    return true;
+}
+
+size_t AutomationScheduler::tick(time_t now) {
+    ++m_stats.ticks;
+    size_t fired = 0;
+    while (!m_heap.empty() && m_heap.top().due <= now) {
+        HeapEntry entry = m_heap.top();
+        m_heap.pop();
+        Schedule* schedule = findSchedule(entry.scheduleId);
+        if (!schedule || !schedule->enabled || schedule->generation != entry.generation) {
+            continue;
+        }
+        const ScheduleDefinition& definition = schedule->definition;
+        if (now - entry.due <= definition.graceSeconds) {
+            fire(*schedule, entry.due, now, false);
+            ++fired;
+            reschedule(*schedule, entry.due);
+            continue;
+        }
+
+        std::vector<time_t> missed;
+        time_t occurrence = entry.due;
+        size_t scanned = 0;
+        while (occurrence <= now && scanned < MAX_MISSED_SCAN) {
+            if (now - occurrence <= definition.graceSeconds) {
+                break;
+            }
+            missed.push_back(occurrence);
+            ++scanned;
+            if (!computeNext(*schedule, occurrence, occurrence)) {
+                occurrence = now + 1;
+            }
+        }
+        if (occurrence <= now && now - occurrence > definition.graceSeconds) {
+            Logger::getInstance().warning("Kacirilan zamanlama taramasi sinira ulasti (" + definition.name + ")");
+            if (!computeNext(*schedule, now - definition.graceSeconds - 1, occurrence)) {
+                occurrence = now + 1;
+            }
+        }
+        switch (definition.catchUp) {
+            case CATCH_UP_SKIP:
+                m_stats.skippedMissed += missed.size();
+                break;
+
+            case CATCH_UP_ONCE: {
+                time_t latest = missed.back();
+                if (definition.maxLatenessSeconds > 0 && now - latest > definition.maxLatenessSeconds) {
+                    m_stats.skippedMissed += missed.size();
+                } else {
+                    m_stats.skippedMissed += missed.size() - 1;
+                    fire(*schedule, latest, now, true);
+                    ++fired;
+                }
+                break;
+            }
+
+            case CATCH_UP_ALL: {
+                size_t start = missed.size() > definition.maxCatchUp ? missed.size() - definition.maxCatchUp : 0;
+                m_stats.skippedMissed += start;
+                for (size_t i = start; i < missed.size(); ++i) {
+                    if (definition.maxLatenessSeconds > 0 && now - missed[i] > definition.maxLatenessSeconds) {
+                        ++m_stats.skippedMissed;
+                        continue;
+                    }
+                    fire(*schedule, missed[i], now, true);
+                    ++fired;
+                }
+                break;
+            }
+        }
+        if (occurrence <= now) {
+            fire(*schedule, occurrence, now, false);
+            ++fired;
+            reschedule(*schedule, occurrence);
+        } else {
+            reschedule(*schedule, now);
+        }
+    }
+    return fired;
+}
+
+time_t AutomationScheduler::getNextFireTime(uint32_t scheduleId) const {
+    Schedule* schedule = findSchedule(scheduleId);
+    return schedule && schedule->enabled ? schedule->next : 0;
+}
+
+time_t AutomationScheduler::getNextDue() const {
+    return m_heap.empty() ? 0 : m_heap.top().due;
+}
+
+size_t AutomationScheduler::getScheduleCount() const {
+    return m_schedules.size();
+}
+
+uint64_t AutomationScheduler::getFireCount(uint32_t scheduleId) const {
+    Schedule* schedule = findSchedule(scheduleId);
+    return schedule ? schedule->fired : 0;
+}
+
+SchedulerStats AutomationScheduler::getStats() const {
+    SchedulerStats stats = m_stats;
+    stats.heapEntries = m_heap.size();
+    stats.schedules = m_schedules.size();
+    return stats;
+}
+
+AutomationScheduler::Schedule* AutomationScheduler::findSchedule(uint32_t scheduleId) const {
+    std::map<uint32_t, Schedule*>::const_iterator it = m_schedules.find(scheduleId);
+    return it != m_schedules.end() ? it->second : 0;
+}
+
+bool AutomationScheduler::computeNext(const Schedule& schedule, time_t after, time_t& next) {
+    int64_t local = static_cast<int64_t>(after) + m_utcOffset;
+    for (int attempt = 0; attempt < MAX_EXCEPTION_SKIPS; ++attempt) {
+        int64_t candidate = 0;
+        ++m_stats.nextComputations;
+        if (!schedule.cron.next(local, candidate)) {
+            return false;
+        }
+        int64_t day = localDayOf(candidate);
+        if (!isExcluded(schedule, day)) {
+            next = static_cast<time_t>(candidate - m_utcOffset);
+            return true;
+        }
+        ++m_stats.skippedExceptions;
+        local = (day + 1) * 86400 - 1;
+    }
+    return false;
+}
+
+bool AutomationScheduler::isExcluded(const Schedule& schedule, int64_t localDay) const {
+    const ScheduleDefinition& definition = schedule.definition;
+    if (definition.skipHolidays && std::binary_search(m_holidays.begin(), m_holidays.end(), localDay)) {
+        return true;
+    }
+    for (size_t i = 0; i < definition.exclusions.size(); ++i) {
+        if (localDay >= definition.exclusions[i].first && localDay <= definition.exclusions[i].second) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void AutomationScheduler::reschedule(Schedule& schedule, time_t after) {
+    ++schedule.generation;
+    time_t next = 0;
+    if (!computeNext(schedule, after, next)) {
+        schedule.next = 0;
+        return;
+    }
+    schedule.next = next;
+    HeapEntry entry;
+    entry.due = next;
+    entry.scheduleId = schedule.id;
+    entry.generation = schedule.generation;
+    m_heap.push(entry);
+}
+
+void AutomationScheduler::fire(Schedule& schedule, time_t due, time_t now, bool catchUp) {
+    ++schedule.fired;
+    ++m_stats.fired;
+    if (catchUp) {
+        ++m_stats.caughtUp;
+    }
+    std::ostringstream oss;
+    oss << "Zamanlanmis gorev calisti: " << schedule.definition.name;
+    if (catchUp) {
+        oss << " (gecikmeli, " << (now - due) << " sn)";
+    }
+    Logger::getInstance().info(oss.str());
+    execute(schedule.definition.action);
+    if (m_listener) {
+        ScheduleFiring firing;
+        firing.scheduleId = schedule.id;
+        firing.name = schedule.definition.name;
+        firing.dueTime = due;
+        firing.firedAt = now;
+        firing.catchUp = catchUp;
+        m_listener->onScheduleFired(firing);
+    }
+}
+
+void AutomationScheduler::execute(const ScheduleAction& action) {
+    if (!m_home) {
+        return;
+    }
+    switch (action.kind) {
+        case SCHEDULE_SET_MODE:
+            m_home->setMode(action.mode);
+            break;
+
+        case SCHEDULE_SET_STATE:
+            m_home->setState(action.state);
+            break;
+
+        case SCHEDULE_APPLY_SCENE:
+            m_home->applyScene(action.scene);
+            break;
+
+        case SCHEDULE_DEVICES:
+            for (size_t i = 0; i < action.deviceIds.size(); ++i) {
+                SceneEngine::applyTarget(m_home->getDevice(action.deviceIds[i]), action.target);
+            }
+            break;
+
+        case SCHEDULE_LOCATION: {
+            std::vector<Device*> devices = m_home->getDevicesByLocation(action.location);
+            for (size_t i = 0; i < devices.size(); ++i) {
+                if (action.anyType || devices[i]->getType() == action.type) {
+                    SceneEngine::applyTarget(devices[i], action.target);
+                }
+            }
+            break;
+        }
+    }
+}
+
+}
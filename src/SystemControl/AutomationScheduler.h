@@ -0,0 +1,149 @@
+#ifndef AUTOMATION_SCHEDULER_H
+#define AUTOMATION_SCHEDULER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <queue>
+#include <ctime>
+#include "common_types.h"
+#include "CronExpression.h"
+#include "SceneEngine.h"
+
+namespace MySweetHome {
+
+class SmartHome;
+enum ScheduleActionKind {
+    SCHEDULE_SET_MODE,
+    SCHEDULE_SET_STATE,
+    SCHEDULE_APPLY_SCENE,
+    SCHEDULE_DEVICES,
+    SCHEDULE_LOCATION
+};
+enum CatchUpPolicy {
+    CATCH_UP_SKIP,
+    CATCH_UP_ONCE,
+    CATCH_UP_ALL
+};
+struct ScheduleAction {
+    ScheduleActionKind kind;
+    SystemMode mode;
+    SystemState state;
+    std::string scene;
+    std::vector<uint32_t> deviceIds;
+    bool anyType;
+    DeviceType type;
+    std::string location;
+    DeviceTarget target;
+
+    ScheduleAction();
+    static ScheduleAction setMode(SystemMode mode);
+    static ScheduleAction setState(SystemState state);
+    static ScheduleAction applyScene(const std::string& scene);
+    static ScheduleAction devices(const std::vector<uint32_t>& deviceIds, const DeviceTarget& target);
+    static ScheduleAction allInLocation(const std::string& location, const DeviceTarget& target);
+    static ScheduleAction typeInLocation(DeviceType type, const std::string& location, const DeviceTarget& target);
+};
+struct ScheduleDefinition {
+    std::string name;
+    std::string cron;
+    ScheduleAction action;
+    CatchUpPolicy catchUp;
+    int64_t graceSeconds;
+    int64_t maxLatenessSeconds;
+    size_t maxCatchUp;
+    bool skipHolidays;
+    std::vector<std::pair<int64_t, int64_t> > exclusions;
+
+    ScheduleDefinition(const std::string& scheduleName = "", const std::string& expression = "",
+                       const ScheduleAction& scheduleAction = ScheduleAction());
+    ScheduleDefinition& exclude(int year, int month, int day);
+    ScheduleDefinition& excludeRange(int fromYear, int fromMonth, int fromDay, int toYear, int toMonth, int toDay);
+    ScheduleDefinition& withCatchUp(CatchUpPolicy policy, int64_t maxLateness = 0);
+    ScheduleDefinition& withHolidays(bool skip);
+};
+struct ScheduleFiring {
+    uint32_t scheduleId;
+    std::string name;
+    time_t dueTime;
+    time_t firedAt;
+    bool catchUp;
+};
+class IScheduleListener {
+public:
+    virtual ~IScheduleListener() {}
+    virtual void onScheduleFired(const ScheduleFiring& firing) = 0;
+};
+struct SchedulerStats {
+    uint64_t fired;
+    uint64_t caughtUp;
+    uint64_t skippedMissed;
+    uint64_t skippedExceptions;
+    uint64_t nextComputations;
+    uint64_t ticks;
+    size_t heapEntries;
+    size_t schedules;
+
+    SchedulerStats();
+};
+class AutomationScheduler {
+public:
+    explicit AutomationScheduler(SmartHome* home = 0);
+    ~AutomationScheduler();
+    void setSmartHome(SmartHome* home);
+    void setListener(IScheduleListener* listener);
+    void setUtcOffset(int seconds);
+    int getUtcOffset() const;
+    static int hostUtcOffset(time_t when);
+    void addHoliday(int year, int month, int day);
+    void clearHolidays();
+    uint32_t addSchedule(const ScheduleDefinition& definition, time_t now);
+    bool removeSchedule(uint32_t scheduleId);
+    bool setScheduleEnabled(uint32_t scheduleId, bool enabled, time_t now);
+    size_t tick(time_t now);
+    time_t getNextFireTime(uint32_t scheduleId) const;
+    time_t getNextDue() const;
+    size_t getScheduleCount() const;
+    uint64_t getFireCount(uint32_t scheduleId) const;
+    SchedulerStats getStats() const;
+
+private:
+    struct Schedule {
+        uint32_t id;
+        ScheduleDefinition definition;
+        CronExpression cron;
+        time_t next;
+        uint64_t generation;
+        bool enabled;
+        uint64_t fired;
+    };
+    struct HeapEntry {
+        time_t due;
+        uint32_t scheduleId;
+        uint64_t generation;
+
+        bool operator<(const HeapEntry& other) const;
+    };
+
+    AutomationScheduler(const AutomationScheduler&);
+    AutomationScheduler& operator=(const AutomationScheduler&);
+    Schedule* findSchedule(uint32_t scheduleId) const;
+    bool computeNext(const Schedule& schedule, time_t after, time_t& next);
+    bool isExcluded(const Schedule& schedule, int64_t localDay) const;
+    void reschedule(Schedule& schedule, time_t after);
+    void fire(Schedule& schedule, time_t due, time_t now, bool catchUp);
+    void execute(const ScheduleAction& action);
+
+    SmartHome* m_home;
+    IScheduleListener* m_listener;
+    int m_utcOffset;
+    std::vector<int64_t> m_holidays;
+    std::map<uint32_t, Schedule*> m_schedules;
+    std::priority_queue<HeapEntry> m_heap;
+    uint32_t m_nextId;
+    SchedulerStats m_stats;
+};
+
+}
+
+#endif
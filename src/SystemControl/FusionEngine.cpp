@@ -0,0 +1,354 @@
+#include "FusionEngine.h"
+#include "SecurityManager.h"
+#include "Detector.h"
+#include "Camera.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace MySweetHome {
+namespace {
+
+const float EVIDENCE_EPSILON = 0.01f;
+const float MAX_EXCESS_RATIO = 3.0f;
+
+FusionSource sourceForDetector(DetectorType type)
+{
+    return type == DETECTOR_SMOKE ? FUSION_SOURCE_SMOKE : FUSION_SOURCE_GAS;
+}
+
+}
+
+FusionConfig::FusionConfig()
+    : windowMillis(30000)
+    , maxStepMillis(2000)
+    , corroborationLevel(1.0f)
+    , corroborationBonus(1.0f)
+    , incidentScore(6.0f)
+    , clearScore(1.0f)
+{
+    weights[FUSION_SOURCE_SMOKE] = 1.0f;
+    weights[FUSION_SOURCE_GAS] = 1.0f;
+    weights[FUSION_SOURCE_MOTION] = 0.1f;
+}
+
+FusionStats::FusionStats()
+    : readings(0)
+    , unknownReadings(0)
+    , motionReports(0)
+    , incidents(0)
+    , triggeringReadings(0)
+    , evaluatedLocations(0)
+    , activeLocations(0)
+    , locations(0)
+{
+}
+
+FusionEngine::FusionEngine()
+    : m_securityManager(0)
+{
+}
+
+FusionEngine::~FusionEngine()
+{
+}
+
+void FusionEngine::setConfig(const FusionConfig& config) {
+    m_config = config;
+    if (m_config.windowMillis == 0) {
+        m_config.windowMillis = 1;
+    }
+}
+
+const FusionConfig& FusionEngine::getConfig() const {
+    return m_config;
+}
+
+int FusionEngine::findLocation(const std::string& name) const {
+    std::map<std::string, int>::const_iterator it = m_locationByName.find(name);
+    return it != m_locationByName.end() ? it->second : -1;
+}
+
+int FusionEngine::locationIndex(const std::string& name) {
+    int index = findLocation(name);
+    if (index >= 0) {
+        return index;
+    }
+    LocationState state;
+    state.name = name;
+    for (int s = 0; s < FUSION_SOURCE_COUNT; ++s) {
+        state.evidence[s] = 0.0f;
+    }
+    state.updatedAt = 0;
+    state.active = false;
+    state.incident = false;
+    index = static_cast<int>(m_locations.size());
+    m_locations.push_back(state);
+    m_locationByName[name] = index;
+    return index;
+}
+
+bool FusionEngine::registerDetector(Detector* detector) {
+    if (!detector) {
+        return false;
+    }
+    uint32_t id = detector->getId();
+    if (id < m_detectorById.size() && m_detectorById[id] >= 0) {
+        return false;
+    }
+    if (id >= m_detectorById.size()) {
+        m_detectorById.resize(id + 1, -1);
+    }
+    SourceSlot slot;
+    slot.detector = detector;
+    slot.location = locationIndex(detector->getLocation());
+    slot.source = sourceForDetector(detector->getDetectorType());
+    slot.lastReadingAt = 0;
+    m_detectorById[id] = static_cast<int>(m_detectors.size());
+    m_detectors.push_back(slot);
+    return true;
+}
+
+void FusionEngine::registerDetectorPair(const IDetectorFactory::DetectorPair& pair) {
+    registerDetector(pair.smoke);
+    registerDetector(pair.gas);
+}
+
+bool FusionEngine::registerCamera(Camera* camera) {
+    if (!camera) {
+        return false;
+    }
+    uint32_t id = camera->getId();
+    if (id >= m_cameraLocationById.size()) {
+        m_cameraLocationById.resize(id + 1, -1);
+    }
+    if (m_cameraLocationById[id] >= 0) {
+        return false;
+    }
+    m_cameraLocationById[id] = locationIndex(camera->getLocation());
+    return true;
+}
+
+void FusionEngine::addListener(IFusionListener* listener) {
+    if (listener && std::find(m_listeners.begin(), m_listeners.end(), listener) == m_listeners.end()) {
+        m_listeners.push_back(listener);
+    }
+}
+
+void FusionEngine::removeListener(IFusionListener* listener) {
+    m_listeners.erase(std::remove(m_listeners.begin(), m_listeners.end(), listener), m_listeners.end());
+}
+
+void FusionEngine::setSecurityManager(SecurityManager* securityManager) {
+    m_securityManager = securityManager;
+}
+
+void FusionEngine::addReading(uint32_t detectorId, float value, uint64_t timestamp) {
+    if (detectorId >= m_detectorById.size() || m_detectorById[detectorId] < 0) {
+        ++m_stats.unknownReadings;
+        return;
+    }
+    ++m_stats.readings;
+    SourceSlot& slot = m_detectors[m_detectorById[detectorId]];
+    uint64_t step = m_config.maxStepMillis;
+    if (slot.lastReadingAt > 0 && timestamp >= slot.lastReadingAt) {
+        step = std::min(step, timestamp - slot.lastReadingAt);
+    }
+    slot.lastReadingAt = timestamp > 0 ? timestamp : 1;
+
+    float threshold = slot.detector->getThreshold();
+    if (threshold <= 0.0f || value < threshold) {
+        return;
+    }
+    ++m_stats.triggeringReadings;
+    float ratio = std::min(value / threshold, MAX_EXCESS_RATIO);
+    accumulate(slot.location, slot.source, ratio * static_cast<float>(step) / 1000.0f, timestamp);
+}
+
+void FusionEngine::addReadings(const std::vector<SensorReading>& readings) {
+    for (size_t i = 0; i < readings.size(); ++i) {
+        addReading(readings[i].detectorId, readings[i].value, readings[i].timestamp);
+    }
+}
+
+void FusionEngine::reportMotion(uint32_t cameraId, uint64_t timestamp) {
+    if (cameraId >= m_cameraLocationById.size() || m_cameraLocationById[cameraId] < 0) {
+        ++m_stats.unknownReadings;
+        return;
+    }
+    ++m_stats.motionReports;
+    accumulate(m_cameraLocationById[cameraId], FUSION_SOURCE_MOTION, 1.0f, timestamp);
+}
+
+void FusionEngine::onSensorEvent(const SensorEvent& event) {
+    addReading(event.detectorId, event.value, event.timestamp);
+}
+
+void FusionEngine::decay(LocationState& state, uint64_t nowMillis) const {
+    if (nowMillis <= state.updatedAt) {
+        return;
+    }
+    float factor = static_cast<float>(std::exp(-static_cast<double>(nowMillis - state.updatedAt) / m_config.windowMillis));
+    for (int s = 0; s < FUSION_SOURCE_COUNT; ++s) {
+        state.evidence[s] *= factor;
+    }
+    state.updatedAt = nowMillis;
+}
+
+float FusionEngine::score(const LocationState& state) const {
+    float total = 0.0f;
+    int corroborating = 0;
+    for (int s = 0; s < FUSION_SOURCE_COUNT; ++s) {
+        float weighted = m_config.weights[s] * state.evidence[s];
+        total += weighted;
+        if (weighted >= m_config.corroborationLevel) {
+            ++corroborating;
+        }
+    }
+    if (corroborating >= 2) {
+        total *= 1.0f + m_config.corroborationBonus;
+    }
+    return total;
+}
+
+void FusionEngine::activate(int location) {
+    LocationState& state = m_locations[location];
+    if (!state.active) {
+        state.active = true;
+        m_active.push_back(location);
+    }
+}
+
+void FusionEngine::accumulate(int location, FusionSource source, float amount, uint64_t timestamp) {
+    LocationState& state = m_locations[location];
+    if (!state.active) {
+        state.updatedAt = timestamp;
+    }
+    decay(state, timestamp);
+    state.evidence[source] += amount;
+    activate(location);
+    decide(location, timestamp);
+}
+
+void FusionEngine::decide(int location, uint64_t timestamp) {
+    LocationState& state = m_locations[location];
+    float current = score(state);
+    if (state.incident) {
+        if (current < m_config.clearScore) {
+            state.incident = false;
+            Logger::getInstance().info("Fuzyon: " + state.name + " normale dondu");
+        }
+        return;
+    }
+    if (current < m_config.incidentScore) {
+        return;
+    }
+
+    state.incident = true;
+    ++m_stats.incidents;
+
+    FusionIncident incident;
+    incident.location = state.name;
+    incident.score = current;
+    incident.timestamp = timestamp;
+    for (int s = 0; s < FUSION_SOURCE_COUNT; ++s) {
+        incident.evidence[s] = state.evidence[s];
+    }
+    float smoke = m_config.weights[FUSION_SOURCE_SMOKE] * state.evidence[FUSION_SOURCE_SMOKE];
+    float gas = m_config.weights[FUSION_SOURCE_GAS] * state.evidence[FUSION_SOURCE_GAS];
+    if (smoke <= 0.0f && gas <= 0.0f) {
+        incident.type = ALARM_INTRUSION;
+    } else {
+        incident.type = smoke >= gas ? ALARM_FIRE : ALARM_GAS_LEAK;
+    }
+    m_incidents.push_back(incident);
+
+    std::ostringstream oss;
+    oss << "Fuzyon: " << state.name << " icin olay skoru " << current;
+    Logger::getInstance().warning(oss.str());
+
+    for (size_t i = 0; i < m_listeners.size(); ++i) {
+        m_listeners[i]->onIncident(incident);
+    }
+    if (m_securityManager && !m_securityManager->isSequenceActive()) {
+        if (incident.type == ALARM_FIRE) {
+            m_securityManager->handleSmokeDetected(state.name);
+        } else if (incident.type == ALARM_GAS_LEAK) {
+            m_securityManager->handleGasDetected(state.name);
+        } else {
+            m_securityManager->handleMotionDetected(state.name);
+        }
+    }
+}
+
+size_t FusionEngine::evaluate(uint64_t nowMillis) {
+    size_t evaluated = 0;
+    size_t i = 0;
+    while (i < m_active.size()) {
+        int location = m_active[i];
+        LocationState& state = m_locations[location];
+        decay(state, nowMillis);
+        decide(location, nowMillis);
+        ++evaluated;
+
+        bool idle = !state.incident;
+        for (int s = 0; s < FUSION_SOURCE_COUNT && idle; ++s) {
+            idle = m_config.weights[s] * state.evidence[s] < EVIDENCE_EPSILON;
+        }
+        if (idle) {
+            for (int s = 0; s < FUSION_SOURCE_COUNT; ++s) {
+                state.evidence[s] = 0.0f;
+            }
+            state.active = false;
+            m_active[i] = m_active.back();
+            m_active.pop_back();
+        } else {
+            ++i;
+        }
+    }
+    m_stats.evaluatedLocations += evaluated;
+    return evaluated;
+}
+
+float FusionEngine::getScore(const std::string& location) const {
+    int index = findLocation(location);
+    return index >= 0 ? score(m_locations[index]) : 0.0f;
+}
+
+float FusionEngine::getEvidence(const std::string& location, FusionSource source) const {
+    int index = findLocation(location);
+    if (index < 0 || source < 0 || source >= FUSION_SOURCE_COUNT) {
+        return 0.0f;
+    }
+    return m_locations[index].evidence[source];
+}
+
+bool FusionEngine::isIncidentActive(const std::string& location) const {
+    int index = findLocation(location);
+    return index >= 0 && m_locations[index].incident;
+}
+
+const std::vector<FusionIncident>& FusionEngine::getIncidents() const {
+    return m_incidents;
+}
+
+FusionStats FusionEngine::getStats() const {
+    FusionStats stats = m_stats;
+    stats.activeLocations = m_active.size();
+    stats.locations = m_locations.size();
+    return stats;
+}
+
+void FusionEngine::clear() {
+    m_locations.clear();
+    m_locationByName.clear();
+    m_active.clear();
+    m_detectors.clear();
+    m_detectorById.clear();
+    m_cameraLocationById.clear();
+    m_incidents.clear();
+    m_stats = FusionStats();
+}
+
+}
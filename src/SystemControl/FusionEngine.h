@@ -0,0 +1,123 @@
+#ifndef FUSION_ENGINE_H
+#define FUSION_ENGINE_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include "common_types.h"
+#include "SensorPipeline.h"
+#include "DetectorFactory.h"
+
+namespace MySweetHome {
+
+class Detector;
+class Camera;
+class SecurityManager;
+
+enum FusionSource {
+    FUSION_SOURCE_SMOKE,
+    FUSION_SOURCE_GAS,
+    FUSION_SOURCE_MOTION,
+    FUSION_SOURCE_COUNT
+};
+struct FusionConfig {
+    uint64_t windowMillis;
+    uint64_t maxStepMillis;
+    float weights[FUSION_SOURCE_COUNT];
+    float corroborationLevel;
+    float corroborationBonus;
+    float incidentScore;
+    float clearScore;
+
+    FusionConfig();
+};
+struct FusionIncident {
+    std::string location;
+    AlarmType type;
+    float score;
+    float evidence[FUSION_SOURCE_COUNT];
+    uint64_t timestamp;
+};
+struct FusionStats {
+    uint64_t readings;
+    uint64_t unknownReadings;
+    uint64_t motionReports;
+    uint64_t incidents;
+    uint64_t triggeringReadings;
+    uint64_t evaluatedLocations;
+    size_t activeLocations;
+    size_t locations;
+
+    FusionStats();
+};
+class IFusionListener {
+public:
+    virtual ~IFusionListener() {}
+    virtual void onIncident(const FusionIncident& incident) = 0;
+};
+class FusionEngine : public ISensorEventListener {
+public:
+    FusionEngine();
+    virtual ~FusionEngine();
+    void setConfig(const FusionConfig& config);
+    const FusionConfig& getConfig() const;
+    bool registerDetector(Detector* detector);
+    void registerDetectorPair(const IDetectorFactory::DetectorPair& pair);
+    bool registerCamera(Camera* camera);
+    void addListener(IFusionListener* listener);
+    void removeListener(IFusionListener* listener);
+    void setSecurityManager(SecurityManager* securityManager);
+    void addReading(uint32_t detectorId, float value, uint64_t timestamp);
+    void addReadings(const std::vector<SensorReading>& readings);
+    void reportMotion(uint32_t cameraId, uint64_t timestamp);
+    virtual void onSensorEvent(const SensorEvent& event);
+    size_t evaluate(uint64_t nowMillis);
+    float getScore(const std::string& location) const;
+    float getEvidence(const std::string& location, FusionSource source) const;
+    bool isIncidentActive(const std::string& location) const;
+    const std::vector<FusionIncident>& getIncidents() const;
+    FusionStats getStats() const;
+    void clear();
+
+private:
+    struct LocationState {
+        std::string name;
+        float evidence[FUSION_SOURCE_COUNT];
+        uint64_t updatedAt;
+        bool active;
+        bool incident;
+    };
+    struct SourceSlot {
+        Detector* detector;
+        int location;
+        FusionSource source;
+        uint64_t lastReadingAt;
+    };
+
+    FusionEngine(const FusionEngine&);
+    FusionEngine& operator=(const FusionEngine&);
+
+    int locationIndex(const std::string& name);
+    int findLocation(const std::string& name) const;
+    void decay(LocationState& state, uint64_t nowMillis) const;
+    float score(const LocationState& state) const;
+    void accumulate(int location, FusionSource source, float amount, uint64_t timestamp);
+    void decide(int location, uint64_t timestamp);
+    void activate(int location);
+
+    FusionConfig m_config;
+    std::vector<LocationState> m_locations;
+    std::map<std::string, int> m_locationByName;
+    std::vector<int> m_active;
+    std::vector<SourceSlot> m_detectors;
+    std::vector<int> m_detectorById;
+    std::vector<int> m_cameraLocationById;
+    std::vector<IFusionListener*> m_listeners;
+    std::vector<FusionIncident> m_incidents;
+    SecurityManager* m_securityManager;
+    FusionStats m_stats;
+};
+
+}
+
+#endif
@@ -1,12 +1,17 @@
 #include "ModeManager.h"
 #include "Device.h"
 #include "Logger.h"
+#include "Metrics.h"
+#include "Tracer.h"
+#include "AllocationTracker.h"
+#include <sstream>
 
 namespace MySweetHome {
 
 ModeManager::ModeManager()
     : m_currentMode(MODE_NORMAL)
 {
+    defineDefaultScenes();
 }
 
 ModeManager::~ModeManager()
@@ -14,8 +19,13 @@ ModeManager::~ModeManager()
 }
 
 void ModeManager::setMode(SystemMode mode) {
+    TraceSpan span("ModeManager::setMode", "mode");
+    AllocationScope allocations("mode", "setMode");
     if (mode != m_currentMode) {
         m_currentMode = mode;
+        static const char* const labels[] = { "normal", "evening", "party", "cinema" };
+        MetricsRegistry::getInstance().counter("msh_mode_transitions_total", "System mode changes",
+            MetricLabels("subsystem", "mode").add("mode", labels[mode])).increment();
         Logger::getInstance().info("Sistem modu degistirildi: " + getCurrentModeString());
     }
 }
@@ -25,7 +35,11 @@ SystemMode ModeManager::getCurrentMode() const {
 }
 
 std::string ModeManager::getCurrentModeString() const {
-    switch (m_currentMode) {
+    return getModeName(m_currentMode);
+}
+
+std::string ModeManager::getModeName(SystemMode mode) {
+    switch (mode) {
         case MODE_NORMAL:  return "Normal";
         case MODE_EVENING: return "Aksam";
         case MODE_PARTY:   return "Parti";
@@ -35,73 +49,82 @@ std::string ModeManager::getCurrentModeString() const {
 }
 
 bool ModeManager::shouldLightBeOn() const {
-    switch (m_currentMode) {
-        case MODE_NORMAL:  return true;
-        case MODE_EVENING: return false;
-        case MODE_PARTY:   return true;
-        case MODE_CINEMA:  return false;
-        default:           return true;
-    }
+    const Scene* scene = getCurrentScene();
+    return scene ? scene->getTypePower(DEVICE_LIGHT, true) : true;
 }
 
 bool ModeManager::shouldTVBeOn() const {
-    switch (m_currentMode) {
-        case MODE_NORMAL:  return false;
-        case MODE_EVENING: return false;
-        case MODE_PARTY:   return false;
-        case MODE_CINEMA:  return true;
-        default:           return false;
-    }
+    const Scene* scene = getCurrentScene();
+    return scene ? scene->getTypePower(DEVICE_TV, false) : false;
 }
 
 bool ModeManager::shouldMusicBeOn() const {
-    switch (m_currentMode) {
-        case MODE_NORMAL:  return false;
-        case MODE_EVENING: return false;
-        case MODE_PARTY:   return true;
-        case MODE_CINEMA:  return false;
-        default:           return false;
-    }
+    const Scene* scene = getCurrentScene();
+    return scene ? scene->getTypePower(DEVICE_SOUND_SYSTEM, false) : false;
 }
 
 void ModeManager::applyModeToDevices(std::vector<Device*>& devices) {
-    for (size_t i = 0; i < devices.size(); ++i) {
-        Device* device = devices[i];
-        if (!device) continue;
-        if (device->isCritical()) {
-            device->turnOn();
-            continue;
-        }
-
-        switch (device->getType()) {
-            case DEVICE_LIGHT:
-                if (shouldLightBeOn()) {
-                    device->turnOn();
-                } else {
-                    device->turnOff();
-                }
-                break;
-
-            case DEVICE_TV:
-                if (shouldTVBeOn()) {
-                    device->turnOn();
-                } else {
-                    device->turnOff();
-                }
-                break;
-
-            case DEVICE_SOUND_SYSTEM:
-                if (shouldMusicBeOn()) {
-                    device->turnOn();
-                } else {
-                    device->turnOff();
-                }
-                break;
-
-            default:
-                break;
-        }
+    applyScene(getCurrentModeString(), devices);
+}
+
+void ModeManager::defineScene(const Scene& scene) {
+    m_sceneEngine.defineScene(scene);
+}
+
+bool ModeManager::applyScene(const std::string& name, std::vector<Device*>& devices) {
+    TraceSpan span("ModeManager::applyScene", "mode");
+    AllocationScope allocations("mode", "applyScene");
+    SceneApplyResult result;
+    if (!m_sceneEngine.apply(name, devices, &result)) {
+        return false;
     }
+    m_lastApply = result;
+    if (result.commands > 0) {
+        std::ostringstream oss;
+        oss << "Sahne uygulandi: " << name << " (" << result.devicesChanged << " cihaz, "
+            << result.commands << " komut)";
+        Logger::getInstance().info(oss.str());
+    }
+    return true;
+}
+
+void ModeManager::invalidateScenes() {
+    m_sceneEngine.invalidate();
+}
+
+SceneEngine& ModeManager::getSceneEngine() {
+    return m_sceneEngine;
+}
+
+const SceneApplyResult& ModeManager::getLastApplyResult() const {
+    return m_lastApply;
+}
+
+void ModeManager::defineDefaultScenes() {
+    DeviceTarget on;
+    on.setPower(true);
+    DeviceTarget off;
+    off.setPower(false);
+
+    Scene normal(getModeName(MODE_NORMAL));
+    normal.forType(DEVICE_LIGHT, on).forType(DEVICE_TV, off).forType(DEVICE_SOUND_SYSTEM, off);
+    m_sceneEngine.defineScene(normal);
+
+    Scene evening(getModeName(MODE_EVENING));
+    evening.forType(DEVICE_LIGHT, off).forType(DEVICE_TV, off).forType(DEVICE_SOUND_SYSTEM, off);
+    m_sceneEngine.defineScene(evening);
+
+    Scene party(getModeName(MODE_PARTY));
+    party.forType(DEVICE_LIGHT, on).forType(DEVICE_TV, off).forType(DEVICE_SOUND_SYSTEM, on);
+    m_sceneEngine.defineScene(party);
+
+    Scene cinema(getModeName(MODE_CINEMA));
+    cinema.forType(DEVICE_LIGHT, off).forType(DEVICE_TV, on).forType(DEVICE_SOUND_SYSTEM, off);
+    m_sceneEngine.defineScene(cinema);
+}
+
+const Scene* ModeManager::getCurrentScene() const {
+    return m_sceneEngine.getScene(getCurrentModeString());
 }
 
 }
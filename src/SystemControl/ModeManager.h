@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include "common_types.h"
+#include "SceneEngine.h"
 
 namespace MySweetHome {
 
@@ -19,9 +20,20 @@ public:
     bool shouldTVBeOn() const;
     bool shouldMusicBeOn() const;
     void applyModeToDevices(std::vector<Device*>& devices);
+    void defineScene(const Scene& scene);
+    bool applyScene(const std::string& name, std::vector<Device*>& devices);
+    void invalidateScenes();
+    SceneEngine& getSceneEngine();
+    const SceneApplyResult& getLastApplyResult() const;
+    static std::string getModeName(SystemMode mode);
 
 private:
+    void defineDefaultScenes();
+    const Scene* getCurrentScene() const;
+
     SystemMode m_currentMode;
+    SceneEngine m_sceneEngine;
+    SceneApplyResult m_lastApply;
 };
 
 }
@@ -0,0 +1,475 @@
+#include "RuleEngine.h"
+#include "ModeManager.h"
+#include "Device.h"
+#include "Logger.h"
+#include "MonotonicTime.h"
+#include "Tracer.h"
+#include "AllocationTracker.h"
+#include <algorithm>
+
+namespace MySweetHome {
+
+RuleEvent::RuleEvent(const std::string& eventType, uint32_t device, const std::string& where, float reading,
+                     uint64_t time)
+    : type(eventType)
+    , deviceId(device)
+    , location(where)
+    , value(reading)
+    , timestamp(time)
+{
+}
+
+RuleTrigger::RuleTrigger(const std::string& type, uint32_t device, const std::string& where)
+    : eventType(type)
+    , deviceId(device)
+    , location(where)
+{
+}
+
+RuleCondition::RuleCondition()
+    : kind(CONDITION_MODE_IS)
+    , mode(MODE_NORMAL)
+    , deviceId(0)
+    , threshold(0.0f)
+{
+}
+
+RuleCondition RuleCondition::modeIs(SystemMode mode) {
+    RuleCondition condition;
+    condition.kind = CONDITION_MODE_IS;
+    condition.mode = mode;
+    return condition;
+}
+
+RuleCondition RuleCondition::deviceOn(uint32_t deviceId) {
+    RuleCondition condition;
+    condition.kind = CONDITION_DEVICE_ON;
+    condition.deviceId = deviceId;
+    return condition;
+}
+
+RuleCondition RuleCondition::deviceOff(uint32_t deviceId) {
+    RuleCondition condition;
+    condition.kind = CONDITION_DEVICE_OFF;
+    condition.deviceId = deviceId;
+    return condition;
+}
+
+RuleCondition RuleCondition::valueAbove(float threshold) {
+    RuleCondition condition;
+    condition.kind = CONDITION_VALUE_ABOVE;
+    condition.threshold = threshold;
+    return condition;
+}
+
+RuleCondition RuleCondition::valueBelow(float threshold) {
+    RuleCondition condition;
+    condition.kind = CONDITION_VALUE_BELOW;
+    condition.threshold = threshold;
+    return condition;
+}
+
+RuleAction::RuleAction()
+    : deviceId(0)
+    , anyType(true)
+    , type(DEVICE_LIGHT)
+{
+}
+
+RuleAction RuleAction::forDevice(uint32_t deviceId, const DeviceTarget& target) {
+    RuleAction action;
+    action.deviceId = deviceId;
+    action.target = target;
+    return action;
+}
+
+RuleAction RuleAction::forLocation(const std::string& location, DeviceType type, const DeviceTarget& target) {
+    RuleAction action;
+    action.anyType = false;
+    action.type = type;
+    action.location = location;
+    action.target = target;
+    return action;
+}
+
+RuleAction RuleAction::applyScene(const std::string& scene) {
+    RuleAction action;
+    action.scene = scene;
+    return action;
+}
+
+RuleDefinition::RuleDefinition(const std::string& ruleName)
+    : name(ruleName)
+    , cooldownMillis(0)
+{
+}
+
+RuleDefinition& RuleDefinition::when(const RuleTrigger& trigger) {
+    triggers.push_back(trigger);
+    return *this;
+}
+
+RuleDefinition& RuleDefinition::onlyIf(const RuleCondition& condition) {
+    conditions.push_back(condition);
+    return *this;
+}
+
+RuleDefinition& RuleDefinition::then(const RuleAction& action) {
+    actions.push_back(action);
+    return *this;
+}
+
+RuleDefinition& RuleDefinition::cooldown(uint64_t millis) {
+    cooldownMillis = millis;
+    return *this;
+}
+
+RuleEngineStats::RuleEngineStats()
+    : events(0)
+    , unmatchedEvents(0)
+    , candidates(0)
+    , fired(0)
+    , suppressed(0)
+    , commands(0)
+    , totalMicros(0)
+    , maxMicros(0)
+    , rules(0)
+{
+}
+
+RuleEngine::RuleEngine()
+    : m_modeIndex(MODE_CINEMA + 1)
+    , m_seen(1, 0)
+    , m_evaluation(0)
+    , m_nextRuleId(1)
+    , m_mode(MODE_NORMAL)
+    , m_devices(0)
+    , m_devicesDirty(false)
+    , m_modeManager(0)
+{
+}
+
+RuleEngine::~RuleEngine() {
+    for (std::map<uint32_t, Rule*>::iterator it = m_rules.begin(); it != m_rules.end(); ++it) {
+        delete it->second;
+    }
+    m_rules.clear();
+}
+
+uint32_t RuleEngine::addRule(const RuleDefinition& definition) {
+    if (definition.triggers.empty() || definition.actions.empty()) {
+        Logger::getInstance().warning("Kural eklenemedi (tetikleyici/eylem yok): " + definition.name);
+        return 0;
+    }
+    Rule* rule = new Rule();
+    rule->id = m_nextRuleId++;
+    rule->definition = definition;
+    rule->unsatisfiedModes = 0;
+    rule->enabled = true;
+    rule->hasFired = false;
+    rule->lastFired = 0;
+    rule->fireCount = 0;
+    for (size_t i = 0; i < definition.conditions.size(); ++i) {
+        const RuleCondition& condition = definition.conditions[i];
+        if (condition.kind == CONDITION_MODE_IS && condition.mode != m_mode) {
+            ++rule->unsatisfiedModes;
+        }
+    }
+    m_rules[rule->id] = rule;
+    m_seen.resize(m_nextRuleId, 0);
+    indexRule(rule);
+    return rule->id;
+}
+
+bool RuleEngine::removeRule(uint32_t ruleId) {
+    std::map<uint32_t, Rule*>::iterator it = m_rules.find(ruleId);
+    if (it == m_rules.end()) {
+        return false;
+    }
+    unindexRule(it->second);
+    delete it->second;
+    m_rules.erase(it);
+    return true;
+}
+
+bool RuleEngine::setRuleEnabled(uint32_t ruleId, bool enabled) {
+    Rule* rule = findRule(ruleId);
+    if (!rule) {
+        return false;
+    }
+    rule->enabled = enabled;
+    return true;
+}
+
+size_t RuleEngine::getRuleCount() const {
+    return m_rules.size();
+}
+
+uint64_t RuleEngine::getFireCount(uint32_t ruleId) const {
+    Rule* rule = findRule(ruleId);
+    return rule ? rule->fireCount : 0;
+}
+
+void RuleEngine::attachDevices(std::vector<Device*>* devices) {
+    m_devices = devices;
+    m_devicesDirty = true;
+}
+
+void RuleEngine::invalidateDevices() {
+    m_devicesDirty = true;
+}
+
+void RuleEngine::setModeManager(ModeManager* modeManager) {
+    m_modeManager = modeManager;
+}
+
+void RuleEngine::setMode(SystemMode mode, uint64_t timestamp) {
+    if (mode == m_mode) {
+        return;
+    }
+    const std::vector<uint32_t>& leaving = m_modeIndex[m_mode];
+    for (size_t i = 0; i < leaving.size(); ++i) {
+        ++m_rules[leaving[i]]->unsatisfiedModes;
+    }
+    const std::vector<uint32_t>& entering = m_modeIndex[mode];
+    for (size_t i = 0; i < entering.size(); ++i) {
+        --m_rules[entering[i]]->unsatisfiedModes;
+    }
+    m_mode = mode;
+    post(RuleEvent(RULE_EVENT_MODE_CHANGED, 0, "", static_cast<float>(mode), timestamp));
+}
+
+SystemMode RuleEngine::getMode() const {
+    return m_mode;
+}
+
+size_t RuleEngine::post(const RuleEvent& event) {
+    TraceSpan span("RuleEngine::post", "rules", event.deviceId);
+    AllocationScope allocations("rules", "post");
+    uint64_t start = monotonicMicros();
+    if (m_devicesDirty) {
+        rebuildDeviceIndex();
+    }
+    RuleEvent located;
+    bool resolved = false;
+    if (event.location.empty() && event.deviceId != 0) {
+        Device* source = findDevice(event.deviceId);
+        if (source) {
+            located = event;
+            located.location = source->getLocation();
+            resolved = true;
+        }
+    }
+    const RuleEvent& current = resolved ? located : event;
+    ++m_stats.events;
+    collectCandidates(current);
+    if (m_candidates.empty()) {
+        ++m_stats.unmatchedEvents;
+    }
+    m_stats.candidates += m_candidates.size();
+
+    size_t fired = 0;
+    for (size_t i = 0; i < m_candidates.size(); ++i) {
+        Rule* rule = m_rules[m_candidates[i]];
+        if (!rule->enabled || rule->unsatisfiedModes > 0 || !conditionsHold(*rule, current)) {
+            continue;
+        }
+        if (rule->hasFired && rule->definition.cooldownMillis > 0 &&
+            current.timestamp < rule->lastFired + rule->definition.cooldownMillis) {
+            ++m_stats.suppressed;
+            continue;
+        }
+        m_stats.commands += execute(*rule);
+        rule->hasFired = true;
+        rule->lastFired = current.timestamp;
+        ++rule->fireCount;
+        ++fired;
+    }
+    m_stats.fired += fired;
+
+    uint64_t elapsed = monotonicMicros() - start;
+    m_stats.totalMicros += elapsed;
+    if (elapsed > m_stats.maxMicros) {
+        m_stats.maxMicros = elapsed;
+    }
+    return fired;
+}
+
+RuleEngineStats RuleEngine::getStats() const {
+    RuleEngineStats stats = m_stats;
+    stats.rules = m_rules.size();
+    return stats;
+}
+
+void RuleEngine::resetStats() {
+    m_stats = RuleEngineStats();
+}
+
+RuleEngine::Rule* RuleEngine::findRule(uint32_t ruleId) const {
+    std::map<uint32_t, Rule*>::const_iterator it = m_rules.find(ruleId);
+    return it != m_rules.end() ? it->second : 0;
+}
+
+void RuleEngine::indexRule(Rule* rule) {
+    const RuleDefinition& definition = rule->definition;
+    for (size_t i = 0; i < definition.triggers.size(); ++i) {
+        const RuleTrigger& trigger = definition.triggers[i];
+        TriggerIndex& index = m_triggers[trigger.eventType];
+        if (trigger.deviceId != 0) {
+            index.byDevice[trigger.deviceId].push_back(rule->id);
+        } else if (!trigger.location.empty()) {
+            index.byLocation[trigger.location].push_back(rule->id);
+        } else {
+            index.any.push_back(rule->id);
+        }
+    }
+    for (size_t i = 0; i < definition.conditions.size(); ++i) {
+        const RuleCondition& condition = definition.conditions[i];
+        if (condition.kind == CONDITION_MODE_IS && condition.mode >= 0 &&
+            static_cast<size_t>(condition.mode) < m_modeIndex.size()) {
+            m_modeIndex[condition.mode].push_back(rule->id);
+        }
+    }
+}
+
+void RuleEngine::unindexRule(Rule* rule) {
+    const RuleDefinition& definition = rule->definition;
+    for (size_t i = 0; i < definition.triggers.size(); ++i) {
+        const RuleTrigger& trigger = definition.triggers[i];
+        std::map<std::string, TriggerIndex>::iterator it = m_triggers.find(trigger.eventType);
+        if (it == m_triggers.end()) {
+            continue;
+        }
+        std::vector<uint32_t>* bucket = &it->second.any;
+        if (trigger.deviceId != 0) {
+            bucket = &it->second.byDevice[trigger.deviceId];
+        } else if (!trigger.location.empty()) {
+            bucket = &it->second.byLocation[trigger.location];
+        }
+        bucket->erase(std::remove(bucket->begin(), bucket->end(), rule->id), bucket->end());
+    }
+    for (size_t mode = 0; mode < m_modeIndex.size(); ++mode) {
+        std::vector<uint32_t>& bucket = m_modeIndex[mode];
+        bucket.erase(std::remove(bucket.begin(), bucket.end(), rule->id), bucket.end());
+    }
+}
+
+void RuleEngine::collectCandidates(const RuleEvent& event) {
+    m_candidates.clear();
+    std::map<std::string, TriggerIndex>::const_iterator it = m_triggers.find(event.type);
+    if (it == m_triggers.end()) {
+        return;
+    }
+    ++m_evaluation;
+    const TriggerIndex& index = it->second;
+    const std::vector<uint32_t>* buckets[3] = { &index.any, 0, 0 };
+    if (event.deviceId != 0) {
+        std::map<uint32_t, std::vector<uint32_t> >::const_iterator device = index.byDevice.find(event.deviceId);
+        if (device != index.byDevice.end()) {
+            buckets[1] = &device->second;
+        }
+    }
+    if (!event.location.empty()) {
+        std::map<std::string, std::vector<uint32_t> >::const_iterator location =
+            index.byLocation.find(event.location);
+        if (location != index.byLocation.end()) {
+            buckets[2] = &location->second;
+        }
+    }
+    for (size_t b = 0; b < 3; ++b) {
+        if (!buckets[b]) {
+            continue;
+        }
+        for (size_t i = 0; i < buckets[b]->size(); ++i) {
+            uint32_t ruleId = (*buckets[b])[i];
+            if (m_seen[ruleId] != m_evaluation) {
+                m_seen[ruleId] = m_evaluation;
+                m_candidates.push_back(ruleId);
+            }
+        }
+    }
+    std::sort(m_candidates.begin(), m_candidates.end());
+}
+
+bool RuleEngine::conditionsHold(const Rule& rule, const RuleEvent& event) {
+    const std::vector<RuleCondition>& conditions = rule.definition.conditions;
+    for (size_t i = 0; i < conditions.size(); ++i) {
+        const RuleCondition& condition = conditions[i];
+        switch (condition.kind) {
+            case CONDITION_MODE_IS:
+                break;
+
+            case CONDITION_DEVICE_ON:
+            case CONDITION_DEVICE_OFF: {
+                Device* device = findDevice(condition.deviceId);
+                if (!device || device->isOn() != (condition.kind == CONDITION_DEVICE_ON)) {
+                    return false;
+                }
+                break;
+            }
+
+            case CONDITION_VALUE_ABOVE:
+                if (!(event.value > condition.threshold)) {
+                    return false;
+                }
+                break;
+
+            case CONDITION_VALUE_BELOW:
+                if (!(event.value < condition.threshold)) {
+                    return false;
+                }
+                break;
+        }
+    }
+    return true;
+}
+
+size_t RuleEngine::execute(Rule& rule) {
+    size_t commands = 0;
+    const std::vector<RuleAction>& actions = rule.definition.actions;
+    for (size_t i = 0; i < actions.size(); ++i) {
+        const RuleAction& action = actions[i];
+        if (!action.scene.empty()) {
+            if (m_modeManager && m_devices && m_modeManager->applyScene(action.scene, *m_devices)) {
+                commands += m_modeManager->getLastApplyResult().commands;
+            }
+        } else if (action.deviceId != 0) {
+            commands += SceneEngine::applyTarget(findDevice(action.deviceId), action.target);
+        } else {
+            std::map<std::string, std::vector<Device*> >::iterator it = m_deviceByLocation.find(action.location);
+            if (it == m_deviceByLocation.end()) {
+                continue;
+            }
+            for (size_t d = 0; d < it->second.size(); ++d) {
+                Device* device = it->second[d];
+                if (action.anyType || device->getType() == action.type) {
+                    commands += SceneEngine::applyTarget(device, action.target);
+                }
+            }
+        }
+    }
+    return commands;
+}
+
+void RuleEngine::rebuildDeviceIndex() {
+    m_deviceById.clear();
+    m_deviceByLocation.clear();
+    m_devicesDirty = false;
+    if (!m_devices) {
+        return;
+    }
+    for (size_t i = 0; i < m_devices->size(); ++i) {
+        Device* device = (*m_devices)[i];
+        if (device) {
+            m_deviceById[device->getId()] = device;
+            m_deviceByLocation[device->getLocation()].push_back(device);
+        }
+    }
+}
+
+Device* RuleEngine::findDevice(uint32_t deviceId) {
+    std::map<uint32_t, Device*>::const_iterator it = m_deviceById.find(deviceId);
+    return it != m_deviceById.end() ? it->second : 0;
+}
+
+}
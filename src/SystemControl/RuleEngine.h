@@ -0,0 +1,160 @@
+#ifndef RULE_ENGINE_H
+#define RULE_ENGINE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include "common_types.h"
+#include "SceneEngine.h"
+
+namespace MySweetHome {
+
+class Device;
+class ModeManager;
+const std::string RULE_EVENT_MOTION = "MOTION_DETECTED";
+const std::string RULE_EVENT_SMOKE = "SMOKE_DETECTED";
+const std::string RULE_EVENT_GAS = "GAS_DETECTED";
+const std::string RULE_EVENT_DEVICE_ON = "DEVICE_ON";
+const std::string RULE_EVENT_DEVICE_OFF = "DEVICE_OFF";
+const std::string RULE_EVENT_SENSOR_VALUE = "SENSOR_VALUE";
+const std::string RULE_EVENT_MODE_CHANGED = "MODE_CHANGED";
+struct RuleEvent {
+    std::string type;
+    uint32_t deviceId;
+    std::string location;
+    float value;
+    uint64_t timestamp;
+
+    RuleEvent(const std::string& eventType = "", uint32_t device = 0, const std::string& where = "",
+              float reading = 0.0f, uint64_t time = 0);
+};
+struct RuleTrigger {
+    std::string eventType;
+    uint32_t deviceId;
+    std::string location;
+
+    RuleTrigger(const std::string& type = "", uint32_t device = 0, const std::string& where = "");
+};
+enum RuleConditionKind {
+    CONDITION_MODE_IS,
+    CONDITION_DEVICE_ON,
+    CONDITION_DEVICE_OFF,
+    CONDITION_VALUE_ABOVE,
+    CONDITION_VALUE_BELOW
+};
+struct RuleCondition {
+    RuleConditionKind kind;
+    SystemMode mode;
+    uint32_t deviceId;
+    float threshold;
+
+    RuleCondition();
+    static RuleCondition modeIs(SystemMode mode);
+    static RuleCondition deviceOn(uint32_t deviceId);
+    static RuleCondition deviceOff(uint32_t deviceId);
+    static RuleCondition valueAbove(float threshold);
+    static RuleCondition valueBelow(float threshold);
+};
+struct RuleAction {
+    uint32_t deviceId;
+    bool anyType;
+    DeviceType type;
+    std::string location;
+    DeviceTarget target;
+    std::string scene;
+
+    RuleAction();
+    static RuleAction forDevice(uint32_t deviceId, const DeviceTarget& target);
+    static RuleAction forLocation(const std::string& location, DeviceType type, const DeviceTarget& target);
+    static RuleAction applyScene(const std::string& scene);
+};
+struct RuleDefinition {
+    std::string name;
+    std::vector<RuleTrigger> triggers;
+    std::vector<RuleCondition> conditions;
+    std::vector<RuleAction> actions;
+    uint64_t cooldownMillis;
+
+    explicit RuleDefinition(const std::string& ruleName = "");
+    RuleDefinition& when(const RuleTrigger& trigger);
+    RuleDefinition& onlyIf(const RuleCondition& condition);
+    RuleDefinition& then(const RuleAction& action);
+    RuleDefinition& cooldown(uint64_t millis);
+};
+struct RuleEngineStats {
+    uint64_t events;
+    uint64_t unmatchedEvents;
+    uint64_t candidates;
+    uint64_t fired;
+    uint64_t suppressed;
+    uint64_t commands;
+    uint64_t totalMicros;
+    uint64_t maxMicros;
+    size_t rules;
+
+    RuleEngineStats();
+};
+class RuleEngine {
+public:
+    RuleEngine();
+    ~RuleEngine();
+    uint32_t addRule(const RuleDefinition& definition);
+    bool removeRule(uint32_t ruleId);
+    bool setRuleEnabled(uint32_t ruleId, bool enabled);
+    size_t getRuleCount() const;
+    uint64_t getFireCount(uint32_t ruleId) const;
+    void attachDevices(std::vector<Device*>* devices);
+    void invalidateDevices();
+    void setModeManager(ModeManager* modeManager);
+    void setMode(SystemMode mode, uint64_t timestamp = 0);
+    SystemMode getMode() const;
+    size_t post(const RuleEvent& event);
+    RuleEngineStats getStats() const;
+    void resetStats();
+
+private:
+    struct Rule {
+        uint32_t id;
+        RuleDefinition definition;
+        size_t unsatisfiedModes;
+        bool enabled;
+        bool hasFired;
+        uint64_t lastFired;
+        uint64_t fireCount;
+    };
+    struct TriggerIndex {
+        std::vector<uint32_t> any;
+        std::map<uint32_t, std::vector<uint32_t> > byDevice;
+        std::map<std::string, std::vector<uint32_t> > byLocation;
+    };
+
+    RuleEngine(const RuleEngine&);
+    RuleEngine& operator=(const RuleEngine&);
+    Rule* findRule(uint32_t ruleId) const;
+    void indexRule(Rule* rule);
+    void unindexRule(Rule* rule);
+    void collectCandidates(const RuleEvent& event);
+    bool conditionsHold(const Rule& rule, const RuleEvent& event);
+    size_t execute(Rule& rule);
+    void rebuildDeviceIndex();
+    Device* findDevice(uint32_t deviceId);
+
+    std::map<uint32_t, Rule*> m_rules;
+    std::map<std::string, TriggerIndex> m_triggers;
+    std::vector<std::vector<uint32_t> > m_modeIndex;
+    std::vector<uint32_t> m_candidates;
+    std::vector<uint64_t> m_seen;
+    uint64_t m_evaluation;
+    uint32_t m_nextRuleId;
+    SystemMode m_mode;
+    std::vector<Device*>* m_devices;
+    std::map<uint32_t, Device*> m_deviceById;
+    std::map<std::string, std::vector<Device*> > m_deviceByLocation;
+    bool m_devicesDirty;
+    ModeManager* m_modeManager;
+    RuleEngineStats m_stats;
+};
+
+}
+
+#endif
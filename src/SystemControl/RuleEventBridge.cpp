@@ -0,0 +1,88 @@
+#include "RuleEventBridge.h"
+#include "SmartHome.h"
+#include "RuleEngine.h"
+#include <algorithm>
+
+namespace MySweetHome {
+RuleEventBridge::RuleEventBridge(SmartHome* home)
+    : m_home(home)
+    , m_posted(0)
+    , m_fired(0)
+{
+}
+
+RuleEventBridge::~RuleEventBridge()
+{
+}
+
+void RuleEventBridge::setSmartHome(SmartHome* home)
+{
+    m_home = home;
+}
+
+void RuleEventBridge::onSensorEvent(const SensorEvent& event)
+{
+    post(RULE_EVENT_SENSOR_VALUE, event.detectorId, "", event.value, event.timestamp);
+    if (!event.rising) {
+        return;
+    }
+    if (event.detectorType == DETECTOR_SMOKE) {
+        post(RULE_EVENT_SMOKE, event.detectorId, "", event.value, event.timestamp);
+    } else if (event.detectorType == DETECTOR_GAS) {
+        post(RULE_EVENT_GAS, event.detectorId, "", event.value, event.timestamp);
+    }
+}
+
+void RuleEventBridge::onMotion(const MotionResult& result)
+{
+    std::vector<uint32_t>::iterator it = std::find(m_camerasInMotion.begin(), m_camerasInMotion.end(), result.cameraId);
+    if (!result.motion) {
+        if (it != m_camerasInMotion.end()) {
+            m_camerasInMotion.erase(it);
+        }
+        return;
+    }
+    if (it != m_camerasInMotion.end()) {
+        return;
+    }
+    m_camerasInMotion.push_back(result.cameraId);
+    postMotion(result.cameraId, "", result.changedPercent, result.timestamp);
+}
+
+size_t RuleEventBridge::postMotion(uint32_t deviceId, const std::string& location, float changedPercent,
+                                   uint64_t timestamp)
+{
+    return post(RULE_EVENT_MOTION, deviceId, location, changedPercent, timestamp);
+}
+
+void RuleEventBridge::forgetCamera(uint32_t cameraId)
+{
+    std::vector<uint32_t>::iterator it = std::find(m_camerasInMotion.begin(), m_camerasInMotion.end(), cameraId);
+    if (it != m_camerasInMotion.end()) {
+        m_camerasInMotion.erase(it);
+    }
+}
+
+uint64_t RuleEventBridge::getPostedCount() const
+{
+    return m_posted;
+}
+
+uint64_t RuleEventBridge::getFiredCount() const
+{
+    return m_fired;
+}
+
+size_t RuleEventBridge::post(const std::string& type, uint32_t deviceId, const std::string& location, float value,
+                             uint64_t timestamp)
+{
+    if (!m_home) {
+        return 0;
+    }
+    ++m_posted;
+    size_t fired = m_home->postEvent(RuleEvent(type, deviceId, location, value, timestamp));
+    m_fired += fired;
+    return fired;
+}
+
+}
@@ -0,0 +1,39 @@
+#ifndef RULE_EVENT_BRIDGE_H
+#define RULE_EVENT_BRIDGE_H
+
+#include <vector>
+#include <string>
+#include "common_types.h"
+#include "SensorPipeline.h"
+#include "MotionEngine.h"
+
+namespace MySweetHome {
+
+class SmartHome;
+class RuleEventBridge : public ISensorEventListener, public IMotionListener {
+public:
+    explicit RuleEventBridge(SmartHome* home = 0);
+    virtual ~RuleEventBridge();
+    void setSmartHome(SmartHome* home);
+    virtual void onSensorEvent(const SensorEvent& event);
+    virtual void onMotion(const MotionResult& result);
+    size_t postMotion(uint32_t deviceId, const std::string& location, float changedPercent, uint64_t timestamp);
+    void forgetCamera(uint32_t cameraId);
+    uint64_t getPostedCount() const;
+    uint64_t getFiredCount() const;
+
+private:
+    RuleEventBridge(const RuleEventBridge&);
+    RuleEventBridge& operator=(const RuleEventBridge&);
+    size_t post(const std::string& type, uint32_t deviceId, const std::string& location, float value,
+                uint64_t timestamp);
+
+    SmartHome* m_home;
+    std::vector<uint32_t> m_camerasInMotion;
+    uint64_t m_posted;
+    uint64_t m_fired;
+};
+
+}
+
+#endif
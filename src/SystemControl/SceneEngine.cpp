@@ -0,0 +1,371 @@
+#include "SceneEngine.h"
+#include "Device.h"
+#include "Light.h"
+#include "TV.h"
+#include "SoundSystem.h"
+#include "Logger.h"
+#include "Tracer.h"
+#include "AllocationTracker.h"
+
+namespace MySweetHome {
+
+DeviceTarget::DeviceTarget()
+    : fields(0)
+    , power(false)
+    , brightness(0)
+    , red(0)
+    , green(0)
+    , blue(0)
+    , volume(0)
+{
+}
+
+DeviceTarget& DeviceTarget::setPower(bool on) {
+    fields |= SCENE_FIELD_POWER;
+    power = on;
+    return *this;
+}
+
+DeviceTarget& DeviceTarget::setBrightness(uint8_t level) {
+    fields |= SCENE_FIELD_BRIGHTNESS;
+    brightness = level > 100 ? 100 : level;
+    return *this;
+}
+
+DeviceTarget& DeviceTarget::setColor(uint8_t r, uint8_t g, uint8_t b) {
+    fields |= SCENE_FIELD_COLOR;
+    red = r;
+    green = g;
+    blue = b;
+    return *this;
+}
+
+DeviceTarget& DeviceTarget::setVolume(uint8_t level) {
+    fields |= SCENE_FIELD_VOLUME;
+    volume = level > 100 ? 100 : level;
+    return *this;
+}
+
+DeviceTarget& DeviceTarget::setSource(const std::string& name) {
+    fields |= SCENE_FIELD_SOURCE;
+    source = name;
+    return *this;
+}
+
+void DeviceTarget::merge(const DeviceTarget& other) {
+    if (other.has(SCENE_FIELD_POWER)) {
+        setPower(other.power);
+    }
+    if (other.has(SCENE_FIELD_BRIGHTNESS)) {
+        setBrightness(other.brightness);
+    }
+    if (other.has(SCENE_FIELD_COLOR)) {
+        setColor(other.red, other.green, other.blue);
+    }
+    if (other.has(SCENE_FIELD_VOLUME)) {
+        setVolume(other.volume);
+    }
+    if (other.has(SCENE_FIELD_SOURCE)) {
+        setSource(other.source);
+    }
+}
+
+bool DeviceTarget::has(SceneField field) const {
+    return (fields & field) != 0;
+}
+
+bool DeviceTarget::empty() const {
+    return fields == 0;
+}
+
+Scene::Scene(const std::string& name)
+    : m_name(name)
+{
+}
+
+Scene::~Scene()
+{
+}
+
+const std::string& Scene::getName() const {
+    return m_name;
+}
+
+Scene& Scene::forAll(const DeviceTarget& target) {
+    return addRule(true, DEVICE_LIGHT, "", 0, target);
+}
+
+Scene& Scene::forType(DeviceType type, const DeviceTarget& target) {
+    return addRule(false, type, "", 0, target);
+}
+
+Scene& Scene::forLocation(const std::string& location, const DeviceTarget& target) {
+    return addRule(true, DEVICE_LIGHT, location, 0, target);
+}
+
+Scene& Scene::forTypeInLocation(DeviceType type, const std::string& location, const DeviceTarget& target) {
+    return addRule(false, type, location, 0, target);
+}
+
+Scene& Scene::forDevice(uint32_t deviceId, const DeviceTarget& target) {
+    return addRule(true, DEVICE_LIGHT, "", deviceId, target);
+}
+
+size_t Scene::getRuleCount() const {
+    return m_rules.size();
+}
+
+DeviceTarget Scene::resolve(const Device& device) const {
+    DeviceTarget target;
+    DeviceType type = device.getType();
+    std::string location = device.getLocation();
+    for (size_t i = 0; i < m_rules.size(); ++i) {
+        const Rule& rule = m_rules[i];
+        if (!rule.anyType && rule.type != type) {
+            continue;
+        }
+        if (!rule.location.empty() && rule.location != location) {
+            continue;
+        }
+        if (rule.deviceId != 0 && rule.deviceId != device.getId()) {
+            continue;
+        }
+        target.merge(rule.target);
+    }
+    return target;
+}
+
+bool Scene::getTypePower(DeviceType type, bool fallback) const {
+    bool power = fallback;
+    for (size_t i = 0; i < m_rules.size(); ++i) {
+        const Rule& rule = m_rules[i];
+        if ((rule.anyType || rule.type == type) && rule.location.empty() && rule.deviceId == 0 &&
+            rule.target.has(SCENE_FIELD_POWER)) {
+            power = rule.target.power;
+        }
+    }
+    return power;
+}
+
+Scene& Scene::addRule(bool anyType, DeviceType type, const std::string& location, uint32_t deviceId,
+                      const DeviceTarget& target) {
+    Rule rule;
+    rule.anyType = anyType;
+    rule.type = type;
+    rule.location = location;
+    rule.deviceId = deviceId;
+    rule.target = target;
+    m_rules.push_back(rule);
+    return *this;
+}
+
+SceneApplyResult::SceneApplyResult()
+    : devices(0)
+    , devicesChanged(0)
+    , commands(0)
+    , compiled(false)
+{
+}
+
+SceneEngine::SceneEngine()
+    : m_compileCount(0)
+{
+}
+
+SceneEngine::~SceneEngine() {
+    invalidate();
+}
+
+void SceneEngine::defineScene(const Scene& scene) {
+    dropCompiled(scene.getName());
+    for (size_t i = 0; i < m_scenes.size(); ++i) {
+        if (m_scenes[i].getName() == scene.getName()) {
+            m_scenes[i] = scene;
+            return;
+        }
+    }
+    m_scenes.push_back(scene);
+}
+
+bool SceneEngine::removeScene(const std::string& name) {
+    for (size_t i = 0; i < m_scenes.size(); ++i) {
+        if (m_scenes[i].getName() == name) {
+            dropCompiled(name);
+            m_scenes.erase(m_scenes.begin() + i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SceneEngine::hasScene(const std::string& name) const {
+    return getScene(name) != 0;
+}
+
+const Scene* SceneEngine::getScene(const std::string& name) const {
+    for (size_t i = 0; i < m_scenes.size(); ++i) {
+        if (m_scenes[i].getName() == name) {
+            return &m_scenes[i];
+        }
+    }
+    return 0;
+}
+
+std::vector<std::string> SceneEngine::getSceneNames() const {
+    std::vector<std::string> names;
+    for (size_t i = 0; i < m_scenes.size(); ++i) {
+        names.push_back(m_scenes[i].getName());
+    }
+    return names;
+}
+
+bool SceneEngine::apply(const std::string& name, const std::vector<Device*>& devices, SceneApplyResult* result) {
+    TraceSpan span("SceneEngine::apply", "scene");
+    AllocationScope allocations("scene", "apply");
+    const Scene* scene = getScene(name);
+    if (!scene) {
+        Logger::getInstance().warning("Sahne bulunamadi: " + name);
+        return false;
+    }
+    SceneApplyResult applied;
+    applied.scene = name;
+    CompiledScene* compiled = findCompiled(name);
+    if (!compiled || compiled->source != devices) {
+        dropCompiled(name);
+        compiled = compile(*scene, devices);
+        applied.compiled = true;
+    }
+    applied.devices = compiled->devices.size();
+    for (size_t i = 0; i < compiled->devices.size(); ++i) {
+        size_t commands = applyTarget(compiled->devices[i], compiled->targets[i]);
+        if (commands > 0) {
+            ++applied.devicesChanged;
+            applied.commands += commands;
+        }
+    }
+    if (result) {
+        *result = applied;
+    }
+    return true;
+}
+
+void SceneEngine::invalidate() {
+    for (size_t i = 0; i < m_compiled.size(); ++i) {
+        delete m_compiled[i];
+    }
+    m_compiled.clear();
+}
+
+uint64_t SceneEngine::getCompileCount() const {
+    return m_compileCount;
+}
+
+size_t SceneEngine::applyTarget(Device* device, const DeviceTarget& target) {
+    if (!device || target.empty()) {
+        return 0;
+    }
+    size_t commands = 0;
+    if (target.has(SCENE_FIELD_POWER) && device->isOn() != target.power) {
+        if (target.power) {
+            device->turnOn();
+        } else {
+            device->turnOff();
+        }
+        ++commands;
+    }
+    switch (device->getType()) {
+        case DEVICE_LIGHT: {
+            Light* light = static_cast<Light*>(device);
+            if (target.has(SCENE_FIELD_BRIGHTNESS) && light->getBrightness() != target.brightness) {
+                light->setBrightness(target.brightness);
+                ++commands;
+            }
+            if (target.has(SCENE_FIELD_COLOR)) {
+                uint8_t r = 0;
+                uint8_t g = 0;
+                uint8_t b = 0;
+                light->getColor(r, g, b);
+                if (r != target.red || g != target.green || b != target.blue) {
+                    light->setColor(target.red, target.green, target.blue);
+                    ++commands;
+                }
+            }
+            break;
+        }
+
+        case DEVICE_TV: {
+            TV* tv = static_cast<TV*>(device);
+            if (target.has(SCENE_FIELD_VOLUME) && tv->getVolume() != target.volume) {
+                tv->setVolume(target.volume);
+                ++commands;
+            }
+            break;
+        }
+
+        case DEVICE_SOUND_SYSTEM: {
+            SoundSystem* sound = static_cast<SoundSystem*>(device);
+            if (target.has(SCENE_FIELD_VOLUME) && sound->getVolume() != target.volume) {
+                sound->setVolume(target.volume);
+                ++commands;
+            }
+            if (target.has(SCENE_FIELD_SOURCE) && sound->getSource() != target.source) {
+                sound->setSource(target.source);
+                ++commands;
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+    return commands;
+}
+
+SceneEngine::CompiledScene* SceneEngine::findCompiled(const std::string& name) const {
+    for (size_t i = 0; i < m_compiled.size(); ++i) {
+        if (m_compiled[i]->name == name) {
+            return m_compiled[i];
+        }
+    }
+    return 0;
+}
+
+void SceneEngine::dropCompiled(const std::string& name) {
+    for (size_t i = 0; i < m_compiled.size(); ++i) {
+        if (m_compiled[i]->name == name) {
+            delete m_compiled[i];
+            m_compiled.erase(m_compiled.begin() + i);
+            return;
+        }
+    }
+}
+
+SceneEngine::CompiledScene* SceneEngine::compile(const Scene& scene, const std::vector<Device*>& devices) {
+    CompiledScene* compiled = new CompiledScene();
+    compiled->name = scene.getName();
+    compiled->source = devices;
+    compiled->devices.reserve(devices.size());
+    compiled->targets.reserve(devices.size());
+    for (size_t i = 0; i < devices.size(); ++i) {
+        Device* device = devices[i];
+        if (!device) {
+            continue;
+        }
+        DeviceTarget target;
+        if (device->isCritical()) {
+            target.setPower(true);
+        } else {
+            target = scene.resolve(*device);
+        }
+        if (target.empty()) {
+            continue;
+        }
+        compiled->devices.push_back(device);
+        compiled->targets.push_back(target);
+    }
+    m_compiled.push_back(compiled);
+    ++m_compileCount;
+    return compiled;
+}
+
+}
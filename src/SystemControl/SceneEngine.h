@@ -0,0 +1,111 @@
+#ifndef SCENE_ENGINE_H
+#define SCENE_ENGINE_H
+
+#include <string>
+#include <vector>
+#include "common_types.h"
+
+namespace MySweetHome {
+
+class Device;
+enum SceneField {
+    SCENE_FIELD_POWER = 1 << 0,
+    SCENE_FIELD_BRIGHTNESS = 1 << 1,
+    SCENE_FIELD_COLOR = 1 << 2,
+    SCENE_FIELD_VOLUME = 1 << 3,
+    SCENE_FIELD_SOURCE = 1 << 4
+};
+struct DeviceTarget {
+    uint32_t fields;
+    bool power;
+    uint8_t brightness;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint8_t volume;
+    std::string source;
+
+    DeviceTarget();
+    DeviceTarget& setPower(bool on);
+    DeviceTarget& setBrightness(uint8_t level);
+    DeviceTarget& setColor(uint8_t r, uint8_t g, uint8_t b);
+    DeviceTarget& setVolume(uint8_t level);
+    DeviceTarget& setSource(const std::string& name);
+    void merge(const DeviceTarget& other);
+    bool has(SceneField field) const;
+    bool empty() const;
+};
+class Scene {
+public:
+    explicit Scene(const std::string& name = "");
+    ~Scene();
+    const std::string& getName() const;
+    Scene& forAll(const DeviceTarget& target);
+    Scene& forType(DeviceType type, const DeviceTarget& target);
+    Scene& forLocation(const std::string& location, const DeviceTarget& target);
+    Scene& forTypeInLocation(DeviceType type, const std::string& location, const DeviceTarget& target);
+    Scene& forDevice(uint32_t deviceId, const DeviceTarget& target);
+    size_t getRuleCount() const;
+    DeviceTarget resolve(const Device& device) const;
+    bool getTypePower(DeviceType type, bool fallback) const;
+
+private:
+    struct Rule {
+        bool anyType;
+        DeviceType type;
+        std::string location;
+        uint32_t deviceId;
+        DeviceTarget target;
+    };
+
+    Scene& addRule(bool anyType, DeviceType type, const std::string& location, uint32_t deviceId,
+                   const DeviceTarget& target);
+
+    std::string m_name;
+    std::vector<Rule> m_rules;
+};
+struct SceneApplyResult {
+    std::string scene;
+    size_t devices;
+    size_t devicesChanged;
+    size_t commands;
+    bool compiled;
+
+    SceneApplyResult();
+};
+class SceneEngine {
+public:
+    SceneEngine();
+    ~SceneEngine();
+    void defineScene(const Scene& scene);
+    bool removeScene(const std::string& name);
+    bool hasScene(const std::string& name) const;
+    const Scene* getScene(const std::string& name) const;
+    std::vector<std::string> getSceneNames() const;
+    bool apply(const std::string& name, const std::vector<Device*>& devices, SceneApplyResult* result = 0);
+    void invalidate();
+    uint64_t getCompileCount() const;
+    static size_t applyTarget(Device* device, const DeviceTarget& target);
+
+private:
+    struct CompiledScene {
+        std::string name;
+        std::vector<Device*> source;
+        std::vector<Device*> devices;
+        std::vector<DeviceTarget> targets;
+    };
+
+    SceneEngine(const SceneEngine&);
+    SceneEngine& operator=(const SceneEngine&);
+    CompiledScene* findCompiled(const std::string& name) const;
+    void dropCompiled(const std::string& name);
+    CompiledScene* compile(const Scene& scene, const std::vector<Device*>& devices);
+
+    std::vector<Scene> m_scenes;
+    std::vector<CompiledScene*> m_compiled;
+    uint64_t m_compileCount;
+};
+
+}
+
+#endif
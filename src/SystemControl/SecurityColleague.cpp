@@ -4,6 +4,7 @@
 #include "Camera.h"
 #include "Detector.h"
 #include "Logger.h"
+#include "RuleEventBridge.h"
 #include <algorithm>
 #include <iostream>
 
@@ -219,7 +220,9 @@ void LightColleague::performBlink()
     }
 }
 CameraColleague::CameraColleague()
-    : m_isRecording(false)
+    : m_eventBridge(0)
+    , m_isRecording(false)
+    , m_motionReports(0)
 {
 }
 
@@ -319,10 +322,52 @@ bool CameraColleague::isRecording() const
     return m_isRecording;
 }
 
-void CameraColleague::reportMotion()
+void CameraColleague::setEventBridge(RuleEventBridge* bridge)
 {
+    m_eventBridge = bridge;
+}
+
+void CameraColleague::reportMotion(const Camera* camera, uint64_t timestamp)
+{
+    ++m_motionReports;
     Logger::getInstance().warning("Motion detected by camera");
     notifyMediator(EVENT_MOTION_DETECTED);
+    if (m_eventBridge) {
+        m_eventBridge->postMotion(camera ? camera->getId() : 0, camera ? camera->getLocation() : "", 0.0f, timestamp);
+    }
+}
+
+void CameraColleague::onMotion(const MotionResult& result)
+{
+    Camera* camera = 0;
+    for (size_t i = 0; i < m_cameras.size(); ++i) {
+        if (m_cameras[i] && m_cameras[i]->getId() == result.cameraId) {
+            camera = m_cameras[i];
+            break;
+        }
+    }
+    if (!camera) {
+        return;
+    }
+    std::vector<uint32_t>::iterator it = std::find(m_camerasInMotion.begin(), m_camerasInMotion.end(), result.cameraId);
+    if (!result.motion) {
+        if (it != m_camerasInMotion.end()) {
+            m_camerasInMotion.erase(it);
+        }
+        return;
+    }
+    if (it != m_camerasInMotion.end()) {
+        return;
+    }
+    m_camerasInMotion.push_back(result.cameraId);
+    if (camera->isMotionDetectionEnabled()) {
+        reportMotion(camera, result.timestamp);
+    }
+}
+
+uint64_t CameraColleague::getMotionReports() const
+{
+    return m_motionReports;
 }
 DetectorColleague::DetectorColleague()
 {
@@ -2,6 +2,7 @@
 #define SECURITY_COLLEAGUE_H
 
 #include "ISecurityMediator.h"
+#include "MotionEngine.h"
 #include <vector>
 #include <string>
 
@@ -10,6 +11,7 @@ class Alarm;
 class Light;
 class Camera;
 class Detector;
+class RuleEventBridge;
 class BaseSecurityColleague : public ISecurityColleague {
 public:
     BaseSecurityColleague();
@@ -61,7 +63,7 @@ private:
 
     void performBlink();
 };
-class CameraColleague : public BaseSecurityColleague {
+class CameraColleague : public BaseSecurityColleague, public IMotionListener {
 public:
     CameraColleague();
     virtual ~CameraColleague();
@@ -76,11 +78,17 @@ public:
     void enableMotionDetectionAll();
     void disableMotionDetectionAll();
     bool isRecording() const;
-    void reportMotion();
+    void setEventBridge(RuleEventBridge* bridge);
+    void reportMotion(const Camera* camera = 0, uint64_t timestamp = 0);
+    virtual void onMotion(const MotionResult& result);
+    uint64_t getMotionReports() const;
 
 private:
+    RuleEventBridge* m_eventBridge;
     std::vector<Camera*> m_cameras;
+    std::vector<uint32_t> m_camerasInMotion;
     bool m_isRecording;
+    uint64_t m_motionReports;
 };
 class DetectorColleague : public BaseSecurityColleague {
 public:
@@ -5,6 +5,9 @@
 #include "Camera.h"
 #include "Detector.h"
 #include "Logger.h"
+#include "Clock.h"
+#include "Tracer.h"
+#include "AllocationTracker.h"
 #include <iostream>
 #include <ctime>
 
@@ -25,6 +28,8 @@ SecurityManager::SecurityManager(SmartHome* smartHome)
     , m_alarmAcknowledged(false)
     , m_sequenceActive(false)
     , m_isBlinking(false)
+    , m_clock(0)
+    , m_keyInput(0)
 {
     std::vector<Device*> alarms = m_smartHome->getDevicesByType(DEVICE_ALARM);
     if (!alarms.empty()) {
@@ -35,7 +40,10 @@ SecurityManager::SecurityManager(SmartHome* smartHome)
 SecurityManager::~SecurityManager()
 {
 }
-void SecurityManager::handleMotionDetected() {
+void SecurityManager::handleMotionDetected(const std::string& location) {
+    TraceSpan span("SecurityManager::handleMotionDetected", "security");
+    AllocationScope allocations("security", "handleMotionDetected");
+    postRuleEvent(RULE_EVENT_MOTION, location);
     if (m_sequenceActive) return;
 
     m_sequenceActive = true;
@@ -76,13 +84,17 @@ void SecurityManager::handleMotionDetected() {
     std::cout << "  Guvenlik dizisi tamamlandi." << std::endl;
     std::cout << std::endl;
 }
-void SecurityManager::handleSmokeDetected() {
+void SecurityManager::handleSmokeDetected(const std::string& location) {
+    postRuleEvent(RULE_EVENT_SMOKE, location);
     handleFireGasSequence(ALARM_FIRE, "Duman");
 }
-void SecurityManager::handleGasDetected() {
+void SecurityManager::handleGasDetected(const std::string& location) {
+    postRuleEvent(RULE_EVENT_GAS, location);
     handleFireGasSequence(ALARM_GAS_LEAK, "Gaz");
 }
 void SecurityManager::handleFireGasSequence(AlarmType type, const std::string& detectorName) {
+    TraceSpan span("SecurityManager::handleFireGasSequence", "security");
+    AllocationScope allocations("security", "handleFireGasSequence");
     if (m_sequenceActive) return;
 
     m_sequenceActive = true;
@@ -150,9 +162,11 @@ void SecurityManager::handleFireGasSequence(AlarmType type, const std::string& d
 }
 
 bool SecurityManager::waitForAcknowledgment(int timeoutSeconds) {
-    time_t startTime = time(0);
+    IClock& clock = getClock();
+    uint64_t startTime = clock.nowMillis();
+    uint64_t timeoutMillis = timeoutSeconds > 0 ? static_cast<uint64_t>(timeoutSeconds) * 1000ULL : 0;
 
-    while (difftime(time(0), startTime) < timeoutSeconds) {
+    while (clock.nowMillis() - startTime < timeoutMillis) {
         if (checkForKeyPress()) {
             acknowledgeAlarm();
             return true;
@@ -174,6 +188,7 @@ bool SecurityManager::isAlarmAcknowledged() const {
 }
 
 void SecurityManager::callPolice() {
+    TraceSpan span("SecurityManager::callPolice", "security");
     Logger::getInstance().critical("ACIL DURUM: Polise cagri yapiliyor.");
     std::cout << std::endl;
     std::cout << "  ================================================" << std::endl;
@@ -183,6 +198,7 @@ void SecurityManager::callPolice() {
 }
 
 void SecurityManager::callFireStation() {
+    TraceSpan span("SecurityManager::callFireStation", "security");
     Logger::getInstance().critical("ACIL DURUM: Itfaiyeye cagri yapiliyor.");
     std::cout << std::endl;
     std::cout << "  ================================================" << std::endl;
@@ -218,6 +234,7 @@ void SecurityManager::resetSequence() {
 }
 
 void SecurityManager::activateAlarm(AlarmType type) {
+    TraceSpan span("SecurityManager::activateAlarm", "security");
     if (m_alarm) {
         m_alarm->arm();
         m_alarm->trigger(type);
@@ -231,6 +248,7 @@ void SecurityManager::deactivateAlarm() {
 }
 
 void SecurityManager::turnOnAllLights() {
+    TraceSpan span("SecurityManager::turnOnAllLights", "security");
     std::vector<Device*> lights = m_smartHome->getDevicesByType(DEVICE_LIGHT);
     for (size_t i = 0; i < lights.size(); ++i) {
         lights[i]->turnOn();
@@ -238,29 +256,41 @@ void SecurityManager::turnOnAllLights() {
 }
 
 void SecurityManager::turnOffAllLights() {
+    TraceSpan span("SecurityManager::turnOffAllLights", "security");
     std::vector<Device*> lights = m_smartHome->getDevicesByType(DEVICE_LIGHT);
     for (size_t i = 0; i < lights.size(); ++i) {
         lights[i]->turnOff();
     }
 }
 
+void SecurityManager::setClock(IClock* clock) {
+    m_clock = clock;
+}
+
+IClock& SecurityManager::getClock() const {
+    return m_clock ? *m_clock : ClockProvider::getClock();
+}
+
+void SecurityManager::postRuleEvent(const std::string& type, const std::string& location) {
+    m_smartHome->postEvent(RuleEvent(type, 0, location, 0.0f, getClock().nowMillis()));
+}
+
+void SecurityManager::setKeyInput(IKeyInput* input) {
+    m_keyInput = input;
+}
+
 void SecurityManager::sleepSeconds(int seconds) {
-#ifdef _WIN32
-    Sleep(seconds * 1000);
-#else
-    sleep(seconds);
-#endif
+    getClock().sleepSeconds(static_cast<uint64_t>(seconds));
 }
 
 void SecurityManager::sleepMilliseconds(int milliseconds) {
-#ifdef _WIN32
-    Sleep(milliseconds);
-#else
-    usleep(milliseconds * 1000);
-#endif
+    getClock().sleepMillis(static_cast<uint64_t>(milliseconds));
 }
 
 bool SecurityManager::checkForKeyPress() {
+    if (m_keyInput) {
+        return m_keyInput->keyPressed();
+    }
 #ifdef _WIN32
     if (_kbhit()) {
         _getch();
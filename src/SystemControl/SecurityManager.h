@@ -9,13 +9,19 @@ namespace MySweetHome {
 
 class SmartHome;
 class Alarm;
+class IClock;
+class IKeyInput {
+public:
+    virtual ~IKeyInput() {}
+    virtual bool keyPressed() = 0;
+};
 class SecurityManager {
 public:
     SecurityManager(SmartHome* smartHome);
     ~SecurityManager();
-    void handleMotionDetected();
-    void handleSmokeDetected();
-    void handleGasDetected();
+    void handleMotionDetected(const std::string& location = "");
+    void handleSmokeDetected(const std::string& location = "");
+    void handleGasDetected(const std::string& location = "");
     bool waitForAcknowledgment(int timeoutSeconds);
     void acknowledgeAlarm();
     bool isAlarmAcknowledged() const;
@@ -26,6 +32,9 @@ public:
     void blinkLightsOnce();
     bool isSequenceActive() const;
     void resetSequence();
+    void setClock(IClock* clock);
+    IClock& getClock() const;
+    void setKeyInput(IKeyInput* input);
 
 private:
     void activateAlarm(AlarmType type);
@@ -36,12 +45,15 @@ private:
     void sleepMilliseconds(int milliseconds);
     bool checkForKeyPress();
     void handleFireGasSequence(AlarmType type, const std::string& detectorName);
+    void postRuleEvent(const std::string& type, const std::string& location);
 
     SmartHome* m_smartHome;
     Alarm* m_alarm;
     bool m_alarmAcknowledged;
     bool m_sequenceActive;
     bool m_isBlinking;
+    IClock* m_clock;
+    IKeyInput* m_keyInput;
 };
 
 }
@@ -8,6 +8,10 @@
 #include "Alarm.h"
 #include "SoundSystem.h"
 #include "Logger.h"
+#include "Clock.h"
+#include "Metrics.h"
+#include "Tracer.h"
+#include "AllocationTracker.h"
 #include <algorithm>
 #include <sstream>
 
@@ -18,9 +22,15 @@ SmartHome::SmartHome()
     , m_securityManager(0)
     , m_notificationManager(0)
     , m_nextDeviceId(1)
+    , m_maxDevices(MAX_DEVICES)
 {
     m_detectorFactory = new StandardDetectorFactory();
     m_notificationManager = new NotificationManager();
+    m_ruleEngine.attachDevices(&m_devices);
+    m_ruleEngine.setModeManager(&m_modeManager);
+    m_eventBridge.setSmartHome(this);
+    m_scheduler.setSmartHome(this);
+    m_scheduler.setUtcOffset(AutomationScheduler::hostUtcOffset(ClockProvider::getClock().wallTime()));
     Logger::getInstance().info("SmartHome system started.");
 }
 
@@ -34,9 +44,13 @@ SmartHome::~SmartHome() {
 
 void SmartHome::cleanupDevices() {
     for (size_t i = 0; i < m_devices.size(); ++i) {
+        trackDevice(m_devices[i], -1);
+        m_healthMonitor.unregisterDevice(m_devices[i]);
         delete m_devices[i];
     }
     m_devices.clear();
+    m_infoCache.clear();
+    m_ruleEngine.invalidateDevices();
 }
 
 bool SmartHome::addDevice(Device* device) {
@@ -44,12 +58,14 @@ bool SmartHome::addDevice(Device* device) {
         return false;
     }
 
-    if (m_devices.size() >= MAX_DEVICES) {
+    if (m_devices.size() >= m_maxDevices) {
         Logger::getInstance().warning("Maximum device count reached!");
         return false;
     }
 
     m_devices.push_back(device);
+    trackDevice(device, 1);
+    m_ruleEngine.invalidateDevices();
     Logger::getInstance().info("Device added: " + device->getName());
     return true;
 }
@@ -58,8 +74,14 @@ bool SmartHome::removeDevice(uint32_t id) {
     for (size_t i = 0; i < m_devices.size(); ++i) {
         if (m_devices[i]->getId() == id) {
             Logger::getInstance().info("Device removed: " + m_devices[i]->getName());
+            trackDevice(m_devices[i], -1);
+            m_infoCache.forget(m_devices[i]);
+            m_healthMonitor.unregisterDevice(m_devices[i]);
+            m_eventBridge.forgetCamera(id);
             delete m_devices[i];
             m_devices.erase(m_devices.begin() + i);
+            m_modeManager.invalidateScenes();
+            m_ruleEngine.invalidateDevices();
             return true;
         }
     }
@@ -204,8 +226,10 @@ bool SmartHome::addClonedDevice(Device* clone) {
 }
 
 void SmartHome::setMode(SystemMode mode) {
+    TraceSpan span("SmartHome::setMode", "smarthome");
     m_modeManager.setMode(mode);
     m_modeManager.applyModeToDevices(m_devices);
+    m_ruleEngine.setMode(mode);
 }
 
 SystemMode SmartHome::getCurrentMode() const {
@@ -216,7 +240,37 @@ std::string SmartHome::getCurrentModeString() const {
     return m_modeManager.getCurrentModeString();
 }
 
+void SmartHome::defineScene(const Scene& scene) {
+    m_modeManager.defineScene(scene);
+}
+
+bool SmartHome::applyScene(const std::string& name) {
+    TraceSpan span("SmartHome::applyScene", "smarthome");
+    return m_modeManager.applyScene(name, m_devices);
+}
+
+const SceneApplyResult& SmartHome::getLastSceneResult() const {
+    return m_modeManager.getLastApplyResult();
+}
+
+RuleEngine& SmartHome::getRuleEngine() {
+    return m_ruleEngine;
+}
+
+size_t SmartHome::postEvent(const RuleEvent& event) {
+    return m_ruleEngine.post(event);
+}
+
+RuleEventBridge& SmartHome::getEventBridge() {
+    return m_eventBridge;
+}
+
+AutomationScheduler& SmartHome::getScheduler() {
+    return m_scheduler;
+}
+
 void SmartHome::setState(SystemState state) {
+    TraceSpan span("SmartHome::setState", "smarthome");
     m_stateManager.setState(state);
 }
 
@@ -237,6 +291,7 @@ bool SmartHome::goToNextState() {
 }
 
 void SmartHome::turnAllOff() {
+    TraceSpan span("SmartHome::turnAllOff", "smarthome");
     for (size_t i = 0; i < m_devices.size(); ++i) {
         if (!m_devices[i]->isCritical()) {
             m_devices[i]->turnOff();
@@ -246,6 +301,7 @@ void SmartHome::turnAllOff() {
 }
 
 void SmartHome::turnAllOn() {
+    TraceSpan span("SmartHome::turnAllOn", "smarthome");
     for (size_t i = 0; i < m_devices.size(); ++i) {
         m_devices[i]->turnOn();
     }
@@ -253,6 +309,7 @@ void SmartHome::turnAllOn() {
 }
 
 void SmartHome::turnOffByType(DeviceType type) {
+    TraceSpan span("SmartHome::turnOffByType", "smarthome");
     for (size_t i = 0; i < m_devices.size(); ++i) {
         if (m_devices[i]->getType() == type && !m_devices[i]->isCritical()) {
             m_devices[i]->turnOff();
@@ -261,6 +318,7 @@ void SmartHome::turnOffByType(DeviceType type) {
 }
 
 void SmartHome::turnOnByType(DeviceType type) {
+    TraceSpan span("SmartHome::turnOnByType", "smarthome");
     for (size_t i = 0; i < m_devices.size(); ++i) {
         if (m_devices[i]->getType() == type) {
             m_devices[i]->turnOn();
@@ -269,6 +327,7 @@ void SmartHome::turnOnByType(DeviceType type) {
 }
 
 void SmartHome::turnOffByLocation(const std::string& location) {
+    TraceSpan span("SmartHome::turnOffByLocation", "smarthome");
     for (size_t i = 0; i < m_devices.size(); ++i) {
         if (m_devices[i]->getLocation() == location && !m_devices[i]->isCritical()) {
             m_devices[i]->turnOff();
@@ -277,6 +336,7 @@ void SmartHome::turnOffByLocation(const std::string& location) {
 }
 
 void SmartHome::turnOnByLocation(const std::string& location) {
+    TraceSpan span("SmartHome::turnOnByLocation", "smarthome");
     for (size_t i = 0; i < m_devices.size(); ++i) {
         if (m_devices[i]->getLocation() == location) {
             m_devices[i]->turnOn();
@@ -285,18 +345,21 @@ void SmartHome::turnOnByLocation(const std::string& location) {
 }
 
 bool SmartHome::powerOnDevice(uint32_t id) {
+    TraceSpan span("SmartHome::powerOnDevice", "smarthome", id);
     Device* device = getDevice(id);
     if (device) {
         device->turnOn();
         std::ostringstream oss;
         oss << device->getName() << " powered on.";
         Logger::getInstance().info(oss.str());
+        m_ruleEngine.post(RuleEvent(RULE_EVENT_DEVICE_ON, device->getId(), device->getLocation()));
         return true;
     }
     return false;
 }
 
 bool SmartHome::powerOffDevice(uint32_t id) {
+    TraceSpan span("SmartHome::powerOffDevice", "smarthome", id);
     Device* device = getDevice(id);
     if (device) {
         if (device->isCritical()) {
@@ -307,6 +370,7 @@ bool SmartHome::powerOffDevice(uint32_t id) {
         std::ostringstream oss;
         oss << device->getName() << " powered off.";
         Logger::getInstance().info(oss.str());
+        m_ruleEngine.post(RuleEvent(RULE_EVENT_DEVICE_OFF, device->getId(), device->getLocation()));
         return true;
     }
     return false;
@@ -326,7 +390,19 @@ size_t SmartHome::getActiveDeviceCount() const {
     return count;
 }
 
+void SmartHome::setMaxDevices(size_t maxDevices) {
+    m_maxDevices = maxDevices;
+}
+
+size_t SmartHome::getMaxDevices() const {
+    return m_maxDevices;
+}
+
 void SmartHome::update() {
+    TraceSpan span("SmartHome::update", "smarthome");
+    AllocationScope allocations("smarthome", "update");
+    m_healthMonitor.sweepIfDue();
+    m_scheduler.tick(ClockProvider::getClock().wallTime());
 }
 
 SecurityManager* SmartHome::getSecurityManager() {
@@ -346,6 +422,20 @@ NotificationManager* SmartHome::getNotificationManager() {
     return m_notificationManager;
 }
 
+HealthMonitor& SmartHome::getHealthMonitor() {
+    return m_healthMonitor;
+}
+
+DeviceInfoCache& SmartHome::getInfoCache() {
+    return m_infoCache;
+}
+
+void SmartHome::trackDevice(const Device* device, int64_t delta) {
+    MetricsRegistry::getInstance().gauge("msh_devices", "Registered devices",
+        MetricLabels("type", MetricsRegistry::deviceTypeLabel(device->getType()))
+            .add("location", device->getLocation())).add(delta);
+}
+
 uint32_t SmartHome::generateDeviceId() {
     return m_nextDeviceId++;
 }
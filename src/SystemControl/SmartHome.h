@@ -6,7 +6,12 @@
 #include "Device.h"
 #include "StateManager.h"
 #include "ModeManager.h"
+#include "RuleEngine.h"
+#include "RuleEventBridge.h"
+#include "AutomationScheduler.h"
 #include "IObserver.h"
+#include "HealthMonitor.h"
+#include "DeviceInfoCache.h"
 #include "common_types.h"
 
 namespace MySweetHome {
@@ -36,6 +41,13 @@ public:
     void setMode(SystemMode mode);
     SystemMode getCurrentMode() const;
     std::string getCurrentModeString() const;
+    void defineScene(const Scene& scene);
+    bool applyScene(const std::string& name);
+    const SceneApplyResult& getLastSceneResult() const;
+    RuleEngine& getRuleEngine();
+    size_t postEvent(const RuleEvent& event);
+    RuleEventBridge& getEventBridge();
+    AutomationScheduler& getScheduler();
     void setState(SystemState state);
     SystemState getCurrentState() const;
     std::string getCurrentStateString() const;
@@ -51,22 +63,33 @@ public:
     bool powerOffDevice(uint32_t id);
     size_t getDeviceCount() const;
     size_t getActiveDeviceCount() const;
+    void setMaxDevices(size_t maxDevices);
+    size_t getMaxDevices() const;
     void update();
     SecurityManager* getSecurityManager();
     void setNotificationPreference(NotificationType type);
     NotificationManager* getNotificationManager();
+    HealthMonitor& getHealthMonitor();
+    DeviceInfoCache& getInfoCache();
 
 private:
     uint32_t generateDeviceId();
     void cleanupDevices();
+    void trackDevice(const Device* device, int64_t delta);
 
     std::vector<Device*> m_devices;
     StateManager m_stateManager;
     ModeManager m_modeManager;
+    RuleEngine m_ruleEngine;
+    RuleEventBridge m_eventBridge;
+    AutomationScheduler m_scheduler;
     IDetectorFactory* m_detectorFactory;
     SecurityManager* m_securityManager;
     NotificationManager* m_notificationManager;
+    HealthMonitor m_healthMonitor;
+    DeviceInfoCache m_infoCache;
     uint32_t m_nextDeviceId;
+    size_t m_maxDevices;
 };
 
 }
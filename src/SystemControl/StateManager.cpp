@@ -1,6 +1,9 @@
 #include "StateManager.h"
 #include "SmartHome.h"
 #include "Logger.h"
+#include "Metrics.h"
+#include "Tracer.h"
+#include "AllocationTracker.h"
 
 namespace MySweetHome {
 
@@ -23,9 +26,17 @@ void StateManager::setSmartHome(SmartHome* home) {
 }
 
 void StateManager::setState(SystemState state) {
+    TraceSpan span("StateManager::setState", "state");
+    AllocationScope allocations("state", "setState");
     if (state == m_currentStateEnum) {
         return;
     }
+    static const char* const labels[] = { "normal", "high_performance", "low_power", "sleep" };
+    MetricsRegistry& metrics = MetricsRegistry::getInstance();
+    metrics.counter("msh_state_transitions_total", "System state changes",
+        MetricLabels("subsystem", "state").add("state", labels[state])).increment();
+    ScopedLatency latency(metrics.histogram("msh_state_transition_micros", "Time spent in state exit and enter",
+        MetricLabels("subsystem", "state")));
     if (m_currentStateObject) {
         m_currentStateObject->exit(m_smartHome);
         StateFactory::destroyState(m_currentStateObject);
@@ -1,4 +1,6 @@
 #include "CommandInvoker.h"
+#include "Tracer.h"
+#include "AllocationTracker.h"
 #include <sstream>
 
 namespace MySweetHome {
@@ -54,6 +56,8 @@ void CommandInvoker::clearCommands()
 }
 bool CommandInvoker::executeCommand(int key)
 {
+    TraceSpan span("CommandInvoker::executeCommand", "ui", static_cast<uint32_t>(key));
+    AllocationScope allocations("ui", "executeCommand");
     std::map<int, ICommand*>::iterator it = m_commands.find(key);
     if (it != m_commands.end() && it->second) {
         ICommand* cmd = it->second;
@@ -73,6 +77,8 @@ bool CommandInvoker::hasCommand(int key) const
 }
 void CommandInvoker::undoLastCommand()
 {
+    TraceSpan span("CommandInvoker::undoLastCommand", "ui");
+    AllocationScope allocations("ui", "undoLastCommand");
     if (!m_history.empty()) {
         ICommand* cmd = m_history.back();
         m_history.pop_back();
@@ -6,19 +6,29 @@
 #include "Light.h"
 #include "Camera.h"
 #include "Logger.h"
+#include "TerminalRenderer.h"
 #include <iostream>
 #include <sstream>
 
 namespace MySweetHome {
 
+namespace {
+const size_t STATUS_HEADER_ROWS = 12;
+const size_t STATUS_FOOTER_ROWS = 2;
+}
+
 Menu::Menu(SmartHome* smartHome)
     : m_smartHome(smartHome)
     , m_running(false)
+    , m_renderer(new TerminalRenderer())
+    , m_deviceView(new DeviceListView(smartHome ? &smartHome->getInfoCache() : 0))
 {
 }
 
 Menu::~Menu()
 {
+    delete m_deviceView;
+    delete m_renderer;
 }
 
 void Menu::run() {
@@ -106,24 +116,73 @@ void Menu::printMenuOption(int number, const std::string& text) {
 }
 
 void Menu::getHomeStatus() {
-    ConsoleUtils::clearScreen();
-    ConsoleUtils::printHeader("EV DURUMU");
-
-    std::cout << std::endl;
-    std::cout << "  Sistem Modu    : " << m_smartHome->getCurrentModeString() << std::endl;
-    std::cout << "  Sistem Durumu  : " << m_smartHome->getCurrentStateString() << std::endl;
-    std::cout << "  Toplam Cihaz   : " << m_smartHome->getDeviceCount() << std::endl;
-    std::cout << "  Aktif Cihaz    : " << m_smartHome->getActiveDeviceCount() << std::endl;
-    std::cout << std::endl;
-
-    ConsoleUtils::printSeparator('-', 60);
-    std::cout << "  KAYITLI CIHAZLAR:" << std::endl;
-    ConsoleUtils::printSeparator('-', 60);
+    m_renderer->detectSize();
+    m_renderer->invalidate();
+    size_t rows = m_renderer->getRows();
+    size_t reserved = STATUS_HEADER_ROWS + STATUS_FOOTER_ROWS + 1;
+    m_deviceView->setDevices(m_smartHome->getAllDevices());
+    m_deviceView->setPageSize(rows > reserved ? rows - reserved : 1);
+    m_deviceView->firstPage();
+    size_t promptRow = STATUS_HEADER_ROWS + m_deviceView->getPageSize() + 1;
+
+    while (true) {
+        renderHomeStatus(promptRow);
+        std::string input = ConsoleUtils::getInput("");
+        m_renderer->invalidateRow(promptRow);
+        if (input.empty()) {
+            break;
+        }
+        switch (input[0]) {
+            case 'N': case 'n': m_deviceView->nextPage(); break;
+            case 'P': case 'p': m_deviceView->previousPage(); break;
+            case 'B': case 'b': m_deviceView->firstPage(); break;
+            case 'S': case 's': m_deviceView->lastPage(); break;
+            default: break;
+        }
+    }
+}
 
-    listDevices();
+void Menu::renderHomeStatus(size_t promptRow) {
+    std::string heavy(60, '=');
+    std::string light(60, '-');
+    std::ostringstream mode, state, total, active;
+    mode << "  Sistem Modu    : " << m_smartHome->getCurrentModeString();
+    state << "  Sistem Durumu  : " << m_smartHome->getCurrentStateString();
+    total << "  Toplam Cihaz   : " << m_smartHome->getDeviceCount();
+    active << "  Aktif Cihaz    : " << m_smartHome->getActiveDeviceCount();
+
+    m_renderer->clear();
+    m_renderer->setLine(0, heavy);
+    m_renderer->setLine(1, "  EV DURUMU");
+    m_renderer->setLine(2, heavy);
+    m_renderer->setLine(4, mode.str());
+    m_renderer->setLine(5, state.str());
+    m_renderer->setLine(6, total.str());
+    m_renderer->setLine(7, active.str());
+    m_renderer->setLine(8, light);
+    m_renderer->setLine(9, "  KAYITLI CIHAZLAR:");
+    m_renderer->setLine(10, DeviceListView::header());
+    m_renderer->setLine(11, std::string(75, '-'));
+    if (m_deviceView->getDeviceCount() == 0) {
+        m_renderer->setLine(STATUS_HEADER_ROWS, "[i] Kayitli cihaz yok.");
+    } else {
+        m_deviceView->render(*m_renderer, STATUS_HEADER_ROWS);
+    }
 
-    std::cout << std::endl;
-    ConsoleUtils::pause();
+    std::ostringstream footer;
+    size_t first = m_deviceView->getOffset();
+    size_t last = first + m_deviceView->getPageSize();
+    if (last > m_deviceView->getDeviceCount()) {
+        last = m_deviceView->getDeviceCount();
+    }
+    footer << "  Sayfa " << (m_deviceView->getPage() + 1) << "/" << m_deviceView->getPageCount()
+           << " (" << (last > first ? first + 1 : 0) << "-" << last << "/" << m_deviceView->getDeviceCount()
+           << ") | N:Sonraki P:Onceki B:Bas S:Son Enter:Cikis";
+    m_renderer->setLine(promptRow - 1, footer.str());
+    std::string prompt = "  Secim: ";
+    m_renderer->setLine(promptRow, prompt);
+    m_renderer->placeCursor(promptRow, prompt.length());
+    m_renderer->present();
 }
 
 void Menu::addDevice() {
@@ -668,54 +727,12 @@ void Menu::listDevices() {
         return;
     }
 
-    std::cout << std::endl;
-    std::cout << "  ID  | Tip         | Ad                  | Konum          | Durum" << std::endl;
-    ConsoleUtils::printSeparator('-', 75);
-
+    std::string frame = "\n" + DeviceListView::header() + "\n" + std::string(75, '-') + "\n";
     for (size_t i = 0; i < devices.size(); ++i) {
-        Device* d = devices[i];
-
-        std::ostringstream oss;
-        oss << "  ";
-        if (d->getId() < 10) oss << " ";
-        if (d->getId() < 100) oss << " ";
-        oss << d->getId() << " | ";
-        std::string typeStr;
-        switch (d->getType()) {
-            case DEVICE_LIGHT: typeStr = "Isik"; break;
-            case DEVICE_CAMERA: typeStr = "Kamera"; break;
-            case DEVICE_SMOKE_DETECTOR: typeStr = "Duman Ded."; break;
-            case DEVICE_GAS_DETECTOR: typeStr = "Gaz Ded."; break;
-            case DEVICE_TV: typeStr = "TV"; break;
-            case DEVICE_ALARM: typeStr = "Alarm"; break;
-            case DEVICE_SOUND_SYSTEM: typeStr = "Ses Sis."; break;
-            default: typeStr = "Bilinmiyor"; break;
-        }
-        oss << typeStr;
-        for (size_t j = typeStr.length(); j < 11; ++j) oss << " ";
-        oss << " | ";
-        std::string name = d->getName();
-        if (name.length() > 19) name = name.substr(0, 16) + "...";
-        oss << name;
-        for (size_t j = name.length(); j < 19; ++j) oss << " ";
-        oss << " | ";
-        std::string loc = d->getLocation();
-        if (loc.length() > 14) loc = loc.substr(0, 11) + "...";
-        oss << loc;
-        for (size_t j = loc.length(); j < 14; ++j) oss << " ";
-        oss << " | ";
-        if (d->isOn()) {
-            oss << "ACIK";
-        } else {
-            oss << "KAPALI";
-        }
-
-        if (d->isCritical()) {
-            oss << " [K]";
-        }
-
-        std::cout << oss.str() << std::endl;
+        frame += DeviceListView::formatRow(devices[i]);
+        frame += '\n';
     }
+    TerminalRenderer::writeBuffered(1, frame);
 }
 
 void Menu::listDevicesByType(DeviceType type) {
@@ -726,9 +743,11 @@ void Menu::listDevicesByType(DeviceType type) {
         return;
     }
 
+    std::string frame;
     for (size_t i = 0; i < devices.size(); ++i) {
-        std::cout << "  " << devices[i]->getInfo() << std::endl;
+        frame += "  " + m_smartHome->getInfoCache().getInfo(devices[i]) + "\n";
     }
+    TerminalRenderer::writeBuffered(1, frame);
 }
 
 char Menu::getCharInput(const std::string& prompt) {
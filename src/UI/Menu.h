@@ -7,6 +7,8 @@
 namespace MySweetHome {
 
 class SmartHome;
+class TerminalRenderer;
+class DeviceListView;
 class MenuCommand;
 class GetHomeStatusCommand;
 class AddDeviceCommand;
@@ -55,12 +57,15 @@ private:
     void shutdown();
     void simulateSecurityEvent();
     void simulateDeviceFailure();
+    void renderHomeStatus(size_t promptRow);
     void listDevices();
     void listDevicesByType(DeviceType type);
     char getCharInput(const std::string& prompt);
 
     SmartHome* m_smartHome;
     bool m_running;
+    TerminalRenderer* m_renderer;
+    DeviceListView* m_deviceView;
 };
 
 }
@@ -0,0 +1,470 @@
+#include "TerminalRenderer.h"
+#include "Device.h"
+#include "DeviceInfoCache.h"
+#include "ConsoleUtils.h"
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <windows.h>
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+#else
+#include <unistd.h>
+#include <sys/ioctl.h>
+#endif
+
+namespace MySweetHome {
+namespace {
+const std::string EMPTY_LINE;
+
+std::string fit(const std::string& text, size_t width)
+{
+    std::string result = text.length() > width ? text.substr(0, width) : text;
+    for (size_t j = result.length(); j < width; ++j) {
+        result += ' ';
+    }
+    return result;
+}
+
+#ifdef _WIN32
+bool enableVirtualTerminal()
+{
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    if (console == INVALID_HANDLE_VALUE || !GetConsoleMode(console, &mode)) {
+        return false;
+    }
+    if (mode & ENABLE_VIRTUAL_TERMINAL_PROCESSING) {
+        return true;
+    }
+    return SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0;
+}
+#endif
+
+std::string typeName(DeviceType type)
+{
+    switch (type) {
+        case DEVICE_LIGHT: return "Isik";
+        case DEVICE_CAMERA: return "Kamera";
+        case DEVICE_SMOKE_DETECTOR: return "Duman Ded.";
+        case DEVICE_GAS_DETECTOR: return "Gaz Ded.";
+        case DEVICE_TV: return "TV";
+        case DEVICE_ALARM: return "Alarm";
+        case DEVICE_SOUND_SYSTEM: return "Ses Sis.";
+        default: return "Bilinmiyor";
+    }
+}
+
+}
+
+TerminalRenderer::TerminalRenderer(int fd)
+    : m_fd(fd)
+    , m_ansi(true)
+    , m_rows(0)
+    , m_columns(DEFAULT_TERMINAL_COLUMNS)
+    , m_fullRedraw(true)
+    , m_cursorRow(0)
+    , m_cursorColumn(0)
+    , m_lastDirtyRows(0)
+    , m_frames(0)
+    , m_bytesWritten(0)
+{
+    resize(DEFAULT_TERMINAL_ROWS, DEFAULT_TERMINAL_COLUMNS);
+#ifdef _WIN32
+    // Consoles that cannot interpret escape sequences get full plain repaints.
+    if (m_fd >= 0) {
+        m_ansi = enableVirtualTerminal();
+    }
+#endif
+}
+
+TerminalRenderer::~TerminalRenderer()
+{
+}
+
+void TerminalRenderer::resize(size_t rows, size_t columns)
+{
+    if (rows == 0 || columns == 0) {
+        return;
+    }
+    m_rows = rows;
+    m_columns = columns;
+    m_front.assign(rows, EMPTY_LINE);
+    m_back.resize(rows);
+    m_forced.assign(rows, false);
+    for (size_t i = 0; i < rows; ++i) {
+        if (m_back[i].length() > columns) {
+            m_back[i].resize(columns);
+        }
+    }
+    if (m_cursorRow >= rows) {
+        m_cursorRow = rows - 1;
+    }
+    m_fullRedraw = true;
+}
+
+bool TerminalRenderer::detectSize()
+{
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+        return false;
+    }
+    size_t rows = static_cast<size_t>(info.srWindow.Bottom - info.srWindow.Top + 1);
+    size_t columns = static_cast<size_t>(info.srWindow.Right - info.srWindow.Left + 1);
+#else
+    struct winsize size;
+    if (m_fd < 0 || ioctl(m_fd, TIOCGWINSZ, &size) != 0 || size.ws_row == 0 || size.ws_col == 0) {
+        return false;
+    }
+    size_t rows = size.ws_row;
+    size_t columns = size.ws_col;
+#endif
+    if (rows != m_rows || columns != m_columns) {
+        resize(rows, columns);
+    }
+    return true;
+}
+
+size_t TerminalRenderer::getRows() const
+{
+    return m_rows;
+}
+
+size_t TerminalRenderer::getColumns() const
+{
+    return m_columns;
+}
+
+void TerminalRenderer::setAnsiEnabled(bool enabled)
+{
+    m_ansi = enabled;
+    m_fullRedraw = true;
+}
+
+bool TerminalRenderer::isAnsiEnabled() const
+{
+    return m_ansi;
+}
+
+void TerminalRenderer::clear()
+{
+    for (size_t i = 0; i < m_back.size(); ++i) {
+        m_back[i].clear();
+    }
+}
+
+void TerminalRenderer::setLine(size_t row, const std::string& text)
+{
+    if (row >= m_rows) {
+        return;
+    }
+    if (text.length() > m_columns) {
+        m_back[row].assign(text, 0, m_columns);
+    } else {
+        m_back[row] = text;
+    }
+}
+
+const std::string& TerminalRenderer::getLine(size_t row) const
+{
+    return row < m_rows ? m_back[row] : EMPTY_LINE;
+}
+
+void TerminalRenderer::invalidate()
+{
+    m_fullRedraw = true;
+}
+
+void TerminalRenderer::invalidateRow(size_t row)
+{
+    if (row < m_rows) {
+        m_forced[row] = true;
+    }
+}
+
+void TerminalRenderer::placeCursor(size_t row, size_t column)
+{
+    m_cursorRow = row < m_rows ? row : m_rows - 1;
+    m_cursorColumn = column < m_columns ? column : m_columns - 1;
+}
+
+void TerminalRenderer::appendCursorMove(size_t row, size_t column)
+{
+    char sequence[32];
+    std::sprintf(sequence, "\033[%lu;%luH", static_cast<unsigned long>(row + 1),
+                 static_cast<unsigned long>(column + 1));
+    m_output += sequence;
+}
+
+size_t TerminalRenderer::present()
+{
+    if (!m_ansi) {
+        return presentPlain();
+    }
+    m_output.clear();
+    size_t dirty = 0;
+    if (m_fullRedraw) {
+        m_output += "\033[H\033[2J";
+    }
+    for (size_t row = 0; row < m_rows; ++row) {
+        if (!m_fullRedraw && !m_forced[row] && m_back[row] == m_front[row]) {
+            continue;
+        }
+        if (m_fullRedraw && m_back[row].empty()) {
+            m_front[row].clear();
+            m_forced[row] = false;
+            continue;
+        }
+        appendCursorMove(row, 0);
+        m_output += m_back[row];
+        m_output += "\033[K";
+        m_front[row] = m_back[row];
+        m_forced[row] = false;
+        ++dirty;
+    }
+    if (m_fullRedraw || dirty > 0) {
+        appendCursorMove(m_cursorRow, m_cursorColumn);
+    }
+    m_fullRedraw = false;
+    m_lastDirtyRows = dirty;
+    ++m_frames;
+    if (!m_output.empty()) {
+        m_bytesWritten += m_output.size();
+        if (m_fd >= 0) {
+            writeBuffered(m_fd, m_output);
+        }
+    }
+    return dirty;
+}
+
+size_t TerminalRenderer::presentPlain()
+{
+    m_output.clear();
+    size_t dirty = 0;
+    size_t last = m_cursorRow;
+    for (size_t row = 0; row < m_rows; ++row) {
+        if (m_fullRedraw || m_forced[row] || m_back[row] != m_front[row]) {
+            ++dirty;
+        }
+        if (!m_back[row].empty() && row > last) {
+            last = row;
+        }
+    }
+    if (m_fullRedraw || dirty > 0) {
+        for (size_t row = 0; row <= last; ++row) {
+            if (row > 0) {
+                m_output += '\n';
+            }
+            m_output += m_back[row];
+            m_front[row] = m_back[row];
+            m_forced[row] = false;
+        }
+        for (size_t row = last + 1; row < m_rows; ++row) {
+            m_front[row].clear();
+            m_forced[row] = false;
+        }
+    }
+    m_fullRedraw = false;
+    m_lastDirtyRows = dirty;
+    ++m_frames;
+    if (!m_output.empty()) {
+        m_bytesWritten += m_output.size();
+        if (m_fd >= 0) {
+            ConsoleUtils::clearScreen();
+            writeBuffered(m_fd, m_output);
+        }
+    }
+    return dirty;
+}
+
+size_t TerminalRenderer::getLastDirtyRows() const
+{
+    return m_lastDirtyRows;
+}
+
+uint64_t TerminalRenderer::getFrameCount() const
+{
+    return m_frames;
+}
+
+uint64_t TerminalRenderer::getBytesWritten() const
+{
+    return m_bytesWritten;
+}
+
+const std::string& TerminalRenderer::getLastOutput() const
+{
+    return m_output;
+}
+
+bool TerminalRenderer::writeBuffered(int fd, const std::string& data)
+{
+    std::cout.flush();
+    std::fflush(stdout);
+#ifdef _WIN32
+    (void)fd;
+    return std::fwrite(data.data(), 1, data.size(), stdout) == data.size() && std::fflush(stdout) == 0;
+#else
+    const char* cursor = data.data();
+    size_t remaining = data.size();
+    while (remaining > 0) {
+        ssize_t written = ::write(fd, cursor, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        cursor += written;
+        remaining -= static_cast<size_t>(written);
+    }
+    return true;
+#endif
+}
+
+DeviceListView::DeviceListView(DeviceInfoCache* cache)
+    : m_cache(cache)
+    , m_offset(0)
+    , m_pageSize(DEFAULT_TERMINAL_ROWS)
+    , m_showInfo(false)
+{
+}
+
+DeviceListView::~DeviceListView()
+{
+}
+
+void DeviceListView::setDevices(const std::vector<Device*>& devices)
+{
+    m_devices = devices;
+    scrollTo(m_offset);
+}
+
+size_t DeviceListView::getDeviceCount() const
+{
+    return m_devices.size();
+}
+
+void DeviceListView::setPageSize(size_t rows)
+{
+    if (rows > 0) {
+        m_pageSize = rows;
+        scrollTo(m_offset);
+    }
+}
+
+size_t DeviceListView::getPageSize() const
+{
+    return m_pageSize;
+}
+
+void DeviceListView::setShowInfo(bool showInfo)
+{
+    m_showInfo = showInfo;
+}
+
+size_t DeviceListView::getOffset() const
+{
+    return m_offset;
+}
+
+size_t DeviceListView::getPage() const
+{
+    size_t page = (m_offset + m_pageSize - 1) / m_pageSize;
+    size_t pages = getPageCount();
+    return page < pages ? page : pages - 1;
+}
+
+size_t DeviceListView::getPageCount() const
+{
+    size_t pages = (m_devices.size() + m_pageSize - 1) / m_pageSize;
+    return pages > 0 ? pages : 1;
+}
+
+size_t DeviceListView::maxOffset() const
+{
+    return m_devices.size() > m_pageSize ? m_devices.size() - m_pageSize : 0;
+}
+
+void DeviceListView::scrollTo(size_t index)
+{
+    size_t limit = maxOffset();
+    m_offset = index < limit ? index : limit;
+}
+
+void DeviceListView::scrollBy(long rows)
+{
+    if (rows < 0 && static_cast<size_t>(-rows) > m_offset) {
+        m_offset = 0;
+        return;
+    }
+    scrollTo(m_offset + rows);
+}
+
+void DeviceListView::nextPage()
+{
+    scrollBy(static_cast<long>(m_pageSize));
+}
+
+void DeviceListView::previousPage()
+{
+    scrollBy(-static_cast<long>(m_pageSize));
+}
+
+void DeviceListView::firstPage()
+{
+    m_offset = 0;
+}
+
+void DeviceListView::lastPage()
+{
+    m_offset = maxOffset();
+}
+
+size_t DeviceListView::render(TerminalRenderer& renderer, size_t firstRow)
+{
+    for (size_t i = 0; i < m_pageSize; ++i) {
+        size_t index = m_offset + i;
+        if (index >= m_devices.size()) {
+            renderer.setLine(firstRow + i, EMPTY_LINE);
+        } else if (!m_showInfo) {
+            renderer.setLine(firstRow + i, formatRow(m_devices[index]));
+        } else if (m_cache) {
+            renderer.setLine(firstRow + i, "  " + m_cache->getInfo(m_devices[index]));
+        } else {
+            renderer.setLine(firstRow + i, "  " + m_devices[index]->getInfo());
+        }
+    }
+    return m_pageSize;
+}
+
+std::string DeviceListView::header()
+{
+    return "  ID  | Tip         | Ad                  | Konum          | Durum";
+}
+
+std::string DeviceListView::formatRow(const Device* device)
+{
+    std::ostringstream oss;
+    oss << "  ";
+    if (device->getId() < 10) oss << " ";
+    if (device->getId() < 100) oss << " ";
+    oss << device->getId() << " | " << fit(typeName(device->getType()), 11) << " | ";
+    std::string name = device->getName();
+    if (name.length() > 19) name = name.substr(0, 16) + "...";
+    oss << fit(name, 19) << " | ";
+    std::string location = device->getLocation();
+    if (location.length() > 14) location = location.substr(0, 11) + "...";
+    oss << fit(location, 14) << " | " << (device->isOn() ? "ACIK" : "KAPALI");
+    if (device->isCritical()) {
+        oss << " [K]";
+    }
+    return oss.str();
+}
+
+}
@@ -0,0 +1,96 @@
+#ifndef TERMINAL_RENDERER_H
+#define TERMINAL_RENDERER_H
+
+#include <string>
+#include <vector>
+#include "common_types.h"
+
+namespace MySweetHome {
+
+class Device;
+class DeviceInfoCache;
+const size_t DEFAULT_TERMINAL_ROWS = 24;
+const size_t DEFAULT_TERMINAL_COLUMNS = 80;
+class TerminalRenderer {
+public:
+    explicit TerminalRenderer(int fd = 1);
+    ~TerminalRenderer();
+    void resize(size_t rows, size_t columns);
+    bool detectSize();
+    size_t getRows() const;
+    size_t getColumns() const;
+    void setAnsiEnabled(bool enabled);
+    bool isAnsiEnabled() const;
+    void clear();
+    void setLine(size_t row, const std::string& text);
+    const std::string& getLine(size_t row) const;
+    void invalidate();
+    void invalidateRow(size_t row);
+    size_t present();
+    void placeCursor(size_t row, size_t column);
+    size_t getLastDirtyRows() const;
+    uint64_t getFrameCount() const;
+    uint64_t getBytesWritten() const;
+    const std::string& getLastOutput() const;
+    static bool writeBuffered(int fd, const std::string& data);
+
+private:
+    TerminalRenderer(const TerminalRenderer&);
+    TerminalRenderer& operator=(const TerminalRenderer&);
+
+    void appendCursorMove(size_t row, size_t column);
+    size_t presentPlain();
+
+    int m_fd;
+    bool m_ansi;
+    size_t m_rows;
+    size_t m_columns;
+    std::vector<std::string> m_front;
+    std::vector<std::string> m_back;
+    std::vector<bool> m_forced;
+    std::string m_output;
+    bool m_fullRedraw;
+    size_t m_cursorRow;
+    size_t m_cursorColumn;
+    size_t m_lastDirtyRows;
+    uint64_t m_frames;
+    uint64_t m_bytesWritten;
+};
+class DeviceListView {
+public:
+    explicit DeviceListView(DeviceInfoCache* cache = 0);
+    ~DeviceListView();
+    void setDevices(const std::vector<Device*>& devices);
+    size_t getDeviceCount() const;
+    void setPageSize(size_t rows);
+    size_t getPageSize() const;
+    void setShowInfo(bool showInfo);
+    size_t getOffset() const;
+    size_t getPage() const;
+    size_t getPageCount() const;
+    void scrollTo(size_t index);
+    void scrollBy(long rows);
+    void nextPage();
+    void previousPage();
+    void firstPage();
+    void lastPage();
+    size_t render(TerminalRenderer& renderer, size_t firstRow);
+    static std::string header();
+    static std::string formatRow(const Device* device);
+
+private:
+    DeviceListView(const DeviceListView&);
+    DeviceListView& operator=(const DeviceListView&);
+
+    size_t maxOffset() const;
+
+    std::vector<Device*> m_devices;
+    DeviceInfoCache* m_cache;
+    size_t m_offset;
+    size_t m_pageSize;
+    bool m_showInfo;
+};
+
+}
+
+#endif
@@ -0,0 +1,50 @@
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include "SmartHome.h"
+#include "FleetSpec.h"
+#include "FleetGenerator.h"
+#include "LoadHarness.h"
+#include "Logger.h"
+
+int main(int argc, char* argv[]) {
+    MySweetHome::Logger::getInstance().setLogLevel(MySweetHome::LOG_WARNING);
+    MySweetHome::FleetSpec spec = MySweetHome::FleetSpec::defaultSpec();
+    uint32_t duration = 0;
+    uint64_t seed = 0;
+    bool hasSeed = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--duration" && i + 1 < argc) {
+            duration = static_cast<uint32_t>(std::strtoul(argv[++i], 0, 10));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], 0, 10);
+            hasSeed = true;
+        } else if (arg == "--help" || arg == "-h") {
+            std::cout << "Usage: FleetGen [spec-file] [--duration seconds] [--seed n]" << std::endl;
+            return 0;
+        } else {
+            MySweetHome::FleetSpec fileSpec;
+            if (!fileSpec.loadFromFile(arg)) {
+                return 1;
+            }
+            spec = fileSpec;
+        }
+    }
+    if (duration > 0) {
+        spec.setDurationSeconds(duration);
+    }
+    if (hasSeed) {
+        spec.setSeed(seed);
+    }
+
+    std::cout << spec.describe() << std::endl;
+    MySweetHome::SmartHome smartHome;
+    MySweetHome::FleetGenerator generator(spec);
+    generator.populate(smartHome);
+    MySweetHome::LoadHarness harness(smartHome, spec);
+    MySweetHome::LoadReport report = harness.run();
+    std::cout << report.toString();
+    return 0;
+}
@@ -2,16 +2,22 @@
 #include "SmartHome.h"
 #include "Menu.h"
 #include "Logger.h"
+#include "Tracer.h"
 
 int main() {
     MySweetHome::Logger::getInstance().setLogToFile(true);
     MySweetHome::Logger::getInstance().setLogFile("mysweethome.log");
     MySweetHome::Logger::getInstance().openLogFile();
+    bool tracing = MySweetHome::Tracer::getInstance().configureFromEnvironment();
 
     MySweetHome::Logger::getInstance().info("MySweetHome sistemi baslatiliyor...");
     MySweetHome::SmartHome smartHome;
     MySweetHome::Menu menu(&smartHome);
     menu.run();
+    if (tracing) {
+        MySweetHome::Tracer& tracer = MySweetHome::Tracer::getInstance();
+        tracer.writeChromeJson(tracer.getOutputPath());
+    }
     MySweetHome::Logger::getInstance().info("MySweetHome sistemi kapatiliyor...");
     MySweetHome::Logger::getInstance().closeLogFile();
 
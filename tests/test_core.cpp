@@ -0,0 +1,1144 @@
+#include <iostream>
+#include <cassert>
+#include "common_types.h"
+#include "DeviceImpl.h"
+#include "ConnectionManager.h"
+#include "GatewayTransport.h"
+#include "Random.h"
+#include "HealthMonitor.h"
+#include "Light.h"
+#include "SimulationModels.h"
+#include "Thread.h"
+#include "Clock.h"
+#include "DeviceProxy.h"
+#include "MonotonicTime.h"
+#include "Atomic.h"
+#include "WorkerPool.h"
+#include "CronExpression.h"
+#include "Metrics.h"
+#include "DeviceInfoCache.h"
+#include "AllocationTracker.h"
+#include "Logger.h"
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace MySweetHome;
+
+void testBackoffPolicy() {
+    std::cout << "Testing BackoffPolicy..." << std::endl;
+
+    BackoffPolicy policy(100, 1000);
+    Random random(42);
+
+    for (int attempt = 0; attempt < 10; ++attempt) {
+        int cap = 100;
+        for (int i = 0; i < attempt && cap < 1000; ++i) {
+            cap *= 2;
+        }
+        if (cap > 1000) cap = 1000;
+        int delay = policy.nextDelay(attempt, random);
+        assert(delay >= cap / 2);
+        assert(delay <= cap);
+    }
+
+    std::cout << "BackoffPolicy tests passed!" << std::endl;
+}
+
+void testCircuitBreaker() {
+    std::cout << "Testing CircuitBreaker..." << std::endl;
+
+    CircuitBreaker breaker(3, 1000);
+    assert(breaker.getState() == CIRCUIT_CLOSED);
+
+    breaker.recordFailure(0);
+    breaker.recordFailure(10);
+    assert(breaker.allowRequest(20));
+    breaker.recordFailure(20);
+    assert(breaker.getState() == CIRCUIT_OPEN);
+    assert(!breaker.allowRequest(500));
+    assert(breaker.allowRequest(1020));
+    assert(breaker.getState() == CIRCUIT_HALF_OPEN);
+    assert(!breaker.allowRequest(1021));
+    breaker.recordFailure(1030);
+    assert(breaker.getState() == CIRCUIT_OPEN);
+    assert(breaker.allowRequest(2030));
+    breaker.recordSuccess();
+    assert(breaker.getState() == CIRCUIT_CLOSED);
+    assert(breaker.getOpenCount() == 2);
+
+    std::cout << "CircuitBreaker tests passed!" << std::endl;
+}
+
+class RacingGateway : public GatewayEmulator {
+public:
+    RacingGateway() : GatewayEmulator(19), m_racer(0) {}
+    void raceWith(NetworkDeviceImpl* racer) { m_racer = racer; }
+    virtual int open(const std::string& endpoint, int timeoutMs) {
+        int handle = GatewayEmulator::open(endpoint, timeoutMs);
+        NetworkDeviceImpl* racer = m_racer;
+        m_racer = 0;
+        if (racer) {
+            assert(racer->connect());
+        }
+        return handle;
+    }
+
+private:
+    NetworkDeviceImpl* m_racer;
+};
+
+void testConnectionPooling() {
+    std::cout << "Testing ConnectionManager pooling..." << std::endl;
+
+    GatewayEmulator emulator(7);
+    ConnectionManager manager(&emulator);
+    manager.setMaxLeasesPerConnection(2);
+    manager.setMaxConnectionsPerEndpoint(2);
+
+    NetworkDeviceImpl a("gw-1:8080");
+    NetworkDeviceImpl b("gw-1:8080");
+    NetworkDeviceImpl c("gw-1:8080");
+    NetworkDeviceImpl d("gw-1:8080");
+    NetworkDeviceImpl e("gw-1:8080");
+    a.setConnectionManager(&manager);
+    b.setConnectionManager(&manager);
+    c.setConnectionManager(&manager);
+    d.setConnectionManager(&manager);
+    e.setConnectionManager(&manager);
+
+    assert(a.connect() && b.connect() && c.connect() && d.connect() && e.connect());
+    ConnectionMetrics metrics = manager.getMetrics("gw-1:8080");
+    assert(metrics.openConnections == 2);
+    assert(metrics.leasedDevices == 5);
+    assert(emulator.getOpenAttempts("gw-1:8080") == 2);
+
+    e.disconnect();
+    assert(manager.getMetrics("gw-1:8080").leasedDevices == 4);
+
+    RacingGateway racing;
+    ConnectionManager capped(&racing);
+    capped.setMaxLeasesPerConnection(1);
+    capped.setMaxConnectionsPerEndpoint(1);
+    NetworkDeviceImpl slow("gw-race:8080");
+    NetworkDeviceImpl fast("gw-race:8080");
+    slow.setConnectionManager(&capped);
+    fast.setConnectionManager(&capped);
+    racing.raceWith(&fast);
+    assert(slow.connect());
+    assert(racing.getOpenAttempts("gw-race:8080") == 2);
+    metrics = capped.getMetrics("gw-race:8080");
+    assert(metrics.openConnections == 1 && metrics.leasedDevices == 2);
+    assert(racing.getOpenConnectionCount("gw-race:8080") == 1);
+
+    GatewayEmulator flaky(23);
+    ConnectionManager gated(&flaky);
+    gated.setMaxLeasesPerConnection(1);
+    gated.setMaxConnectionsPerEndpoint(4);
+    gated.setBackoffPolicy(BackoffPolicy(60000, 120000));
+    NetworkDeviceImpl first("gw-gate:8080");
+    NetworkDeviceImpl second("gw-gate:8080");
+    NetworkDeviceImpl third("gw-gate:8080");
+    first.setConnectionManager(&gated);
+    second.setConnectionManager(&gated);
+    third.setConnectionManager(&gated);
+    assert(first.connect());
+    flaky.setEndpointOnline("gw-gate:8080", false);
+    assert(!second.connect());
+    assert(third.connect());
+    metrics = gated.getMetrics("gw-gate:8080");
+    assert(metrics.rejectedByBackoff == 1);
+    assert(metrics.openConnections == 1 && metrics.leasedDevices == 2);
+
+    std::cout << "ConnectionManager pooling tests passed!" << std::endl;
+}
+
+void testDropAndReconnect() {
+    std::cout << "Testing ConnectionManager reconnect..." << std::endl;
+
+    GatewayEmulator emulator(11);
+    ConnectionManager manager(&emulator);
+    manager.setBackoffPolicy(BackoffPolicy(0, 0));
+
+    NetworkDeviceImpl device("gw-2:8080");
+    device.setConnectionManager(&manager);
+    assert(device.connect());
+
+    emulator.dropAllConnections("gw-2:8080");
+    device.powerOn();
+    assert(device.isPowered());
+    assert(device.isConnected());
+
+    ConnectionMetrics metrics = manager.getMetrics("gw-2:8080");
+    assert(metrics.drops == 1);
+    assert(metrics.reconnects == 1);
+    assert(metrics.openConnections == 1);
+
+    NetworkDeviceImpl first("gw-3:8080");
+    NetworkDeviceImpl second("gw-3:8080");
+    NetworkDeviceImpl third("gw-3:8080");
+    first.setConnectionManager(&manager);
+    second.setConnectionManager(&manager);
+    third.setConnectionManager(&manager);
+    assert(first.connect() && second.connect() && third.connect());
+    assert(manager.getMetrics("gw-3:8080").openConnections == 1);
+
+    emulator.dropAllConnections("gw-3:8080");
+    first.powerOn();
+    second.powerOn();
+    third.powerOn();
+    assert(first.isConnected() && second.isConnected() && third.isConnected());
+
+    metrics = manager.getMetrics("gw-3:8080");
+    assert(metrics.drops == 1);
+    assert(metrics.reconnects == 1);
+    assert(metrics.openConnections == 1);
+    assert(metrics.leasedDevices == 3);
+    assert(metrics.consecutiveFailures == 0);
+    assert(metrics.circuitState == CIRCUIT_CLOSED);
+
+    std::cout << "ConnectionManager reconnect tests passed!" << std::endl;
+}
+
+void testCircuitOpensOnDeadEndpoint() {
+    std::cout << "Testing ConnectionManager circuit breaking..." << std::endl;
+
+    GatewayEmulator emulator(13);
+    ConnectionManager manager(&emulator);
+    manager.setBackoffPolicy(BackoffPolicy(0, 0));
+    manager.setCircuitBreakerSettings(3, 60000);
+    emulator.setEndpointOnline("gw-dead:8080", false);
+
+    NetworkDeviceImpl device("gw-dead:8080");
+    device.setConnectionManager(&manager);
+    for (int i = 0; i < 10; ++i) {
+        assert(!device.connect());
+    }
+
+    assert(emulator.getOpenAttempts("gw-dead:8080") == 3);
+    assert(manager.getCircuitState("gw-dead:8080") == CIRCUIT_OPEN);
+    ConnectionMetrics metrics = manager.getMetrics("gw-dead:8080");
+    assert(metrics.connectFailures == 3);
+    assert(metrics.rejectedByCircuit == 7);
+    assert(!device.ping());
+
+    std::cout << "ConnectionManager circuit breaking tests passed!" << std::endl;
+}
+
+void testLatencyAndBackoff() {
+    std::cout << "Testing ConnectionManager latency and backoff..." << std::endl;
+
+    GatewayEmulator emulator(17);
+    ConnectionManager manager(&emulator);
+    manager.setBackoffPolicy(BackoffPolicy(60000, 120000));
+    emulator.setLatency("gw-slow:8080", 250, 50);
+
+    NetworkDeviceImpl device("gw-slow:8080");
+    device.setConnectionManager(&manager);
+    device.setTimeout(100);
+    assert(!device.connect());
+    assert(!device.connect());
+    assert(emulator.getOpenAttempts("gw-slow:8080") == 1);
+    assert(manager.getMetrics("gw-slow:8080").rejectedByBackoff == 1);
+    assert(emulator.getLastLatency() >= 250);
+
+    std::cout << "ConnectionManager latency and backoff tests passed!" << std::endl;
+}
+
+void testHealthMonitor() {
+    std::cout << "Testing HealthMonitor..." << std::endl;
+
+    GatewayEmulator emulator(19);
+    ConnectionManager manager(&emulator);
+    manager.setCircuitBreakerSettings(100, 0);
+
+    SimulatedDeviceImpl simulated;
+    simulated.connect();
+    HardwareDeviceImpl hardware;
+    hardware.connect();
+    NetworkDeviceImpl network("gw-health:8080");
+    network.setConnectionManager(&manager);
+    Light light(1, "Hall Light", "Hall");
+    light.turnOn();
+
+    HealthMonitor monitor;
+    monitor.setMaxMisses(2);
+    int simSlot = monitor.registerImpl(&simulated);
+    int hwSlot = monitor.registerImpl(&hardware);
+    int netSlot = monitor.registerImpl(&network, &light);
+    assert(monitor.size() == 3);
+    assert(monitor.registerImpl(&network, &light) == netSlot);
+
+    HealthSweepStats stats = monitor.sweep();
+    assert(stats.healthy == 3);
+
+    emulator.setEndpointOnline("gw-health:8080", false);
+    simulated.simulateFailure();
+    stats = monitor.sweep();
+    assert(stats.degraded == 2);
+    assert(monitor.getStatus(simSlot) == HEALTH_DEGRADED);
+    assert(light.getStatus() == STATUS_ON);
+
+    stats = monitor.sweep();
+    assert(stats.newlyFailed == 2);
+    assert(monitor.getStatus(netSlot) == HEALTH_FAILED);
+    assert(monitor.getStatus(hwSlot) == HEALTH_OK);
+    assert(light.getStatus() == STATUS_ERROR);
+
+    emulator.setEndpointOnline("gw-health:8080", true);
+    stats = monitor.sweep();
+    assert(stats.recovered == 1);
+    assert(monitor.getMissCount(netSlot) == 0);
+
+    assert(monitor.unregisterImpl(&hardware));
+    assert(monitor.size() == 2);
+    assert(monitor.findSlot(&network) == 1);
+
+    std::cout << "HealthMonitor tests passed!" << std::endl;
+}
+
+void testHealthSweepScale() {
+    std::cout << "Testing HealthMonitor at scale..." << std::endl;
+
+    const size_t deviceCount = 50000;
+    GatewayEmulator emulator(23);
+    ConnectionManager manager(&emulator);
+    std::vector<IDeviceImpl*> impls;
+    HealthMonitor monitor;
+    monitor.setConcurrency(4);
+
+    for (size_t i = 0; i < deviceCount; ++i) {
+        if (i % 2 == 0) {
+            SimulatedDeviceImpl* impl = new SimulatedDeviceImpl();
+            impl->connect();
+            impls.push_back(impl);
+        } else {
+            std::ostringstream endpoint;
+            endpoint << "gw-" << (i % 64) << ":8080";
+            NetworkDeviceImpl* impl = new NetworkDeviceImpl(endpoint.str());
+            impl->setConnectionManager(&manager);
+            impls.push_back(impl);
+        }
+        monitor.registerImpl(impls.back());
+    }
+
+    HealthSweepStats stats = monitor.sweep();
+    assert(stats.probed == deviceCount);
+    assert(stats.healthy == deviceCount);
+    std::cout << "  50k device sweep: " << stats.durationMicros << "us" << std::endl;
+
+    for (size_t i = 0; i < impls.size(); ++i) {
+        delete impls[i];
+    }
+
+    std::cout << "HealthMonitor scale tests passed!" << std::endl;
+}
+
+void testLatencyModels() {
+    std::cout << "Testing LatencyModel..." << std::endl;
+
+    Random random(29);
+    LatencyModel fixed = LatencyModel::fixed(5.0);
+    assert(fixed.sampleMillis(random) == 5.0);
+
+    LatencyModel uniform = LatencyModel::uniform(2.0, 4.0);
+    for (int i = 0; i < 1000; ++i) {
+        double sample = uniform.sampleMillis(random);
+        assert(sample >= 2.0 && sample <= 4.0);
+    }
+
+    std::vector<double> samples;
+    LatencyModel logNormal = LatencyModel::logNormal(10.0, 0.5);
+    for (int i = 0; i < 10001; ++i) {
+        samples.push_back(logNormal.sampleMillis(random));
+    }
+    std::sort(samples.begin(), samples.end());
+    assert(samples[5000] > 9.0 && samples[5000] < 11.0);
+    assert(samples[9900] > 25.0);
+
+    LatencyModel bimodal = LatencyModel::bimodal(2.0, 200.0, 0.05, 0.1);
+    int slow = 0;
+    for (int i = 0; i < 10000; ++i) {
+        if (bimodal.sampleMillis(random) > 50.0) {
+            ++slow;
+        }
+    }
+    assert(slow > 350 && slow < 650);
+
+    std::cout << "LatencyModel tests passed!" << std::endl;
+}
+
+void testSimulatedDeviceDeterminism() {
+    std::cout << "Testing SimulatedDeviceImpl determinism..." << std::endl;
+
+    SimulatedDeviceImpl first(1234);
+    SimulatedDeviceImpl second(1234);
+    first.setFailureRate(0.3f);
+    second.setFailureRate(0.3f);
+    first.setLatencyModel(LatencyModel::logNormal(20.0, 1.0));
+    second.setLatencyModel(LatencyModel::logNormal(20.0, 1.0));
+    first.setRealDelay(false);
+    second.setRealDelay(false);
+    first.connect();
+    second.connect();
+
+    for (int i = 0; i < 200; ++i) {
+        first.powerOn();
+        second.powerOn();
+        assert(first.isPowered() == second.isPowered());
+        first.powerOff();
+        second.powerOff();
+        assert(first.isPowered() == second.isPowered());
+    }
+    assert(first.getVirtualDelayMicros() == second.getVirtualDelayMicros());
+    assert(first.getVirtualDelayMicros() > 0);
+
+    std::cout << "SimulatedDeviceImpl determinism tests passed!" << std::endl;
+}
+
+void testFailureBursts() {
+    std::cout << "Testing FailureBurstModel..." << std::endl;
+
+    Random random(31);
+    FailureBurstModel model;
+    model.setBaseFailureRate(0.0);
+    model.setBurst(0.01, 0.1, 1.0);
+
+    int failures = 0;
+    int runs = 0;
+    bool previous = false;
+    for (int i = 0; i < 20000; ++i) {
+        bool failed = model.nextFailure(random);
+        if (failed) {
+            ++failures;
+            if (!previous) {
+                ++runs;
+            }
+        }
+        previous = failed;
+    }
+    assert(failures > 0);
+    assert(runs > 0);
+    assert(failures / runs >= 5);
+
+    std::cout << "FailureBurstModel tests passed!" << std::endl;
+}
+
+class PowerCycler : public IRunnable {
+public:
+    PowerCycler(SimulatedDeviceImpl* impl) : m_impl(impl) {}
+    virtual void run() {
+        for (int i = 0; i < 500; ++i) {
+            m_impl->powerOn();
+            m_impl->powerOff();
+        }
+    }
+
+private:
+    SimulatedDeviceImpl* m_impl;
+};
+
+void testSimulatedDeviceThreads() {
+    std::cout << "Testing SimulatedDeviceImpl from many threads..." << std::endl;
+
+    SimulatedDeviceImpl impl(77);
+    impl.setLatencyModel(LatencyModel::fixed(1.0));
+    impl.setRealDelay(false);
+    impl.setFailureRate(0.5f);
+
+    PowerCycler cycler(&impl);
+    Thread a(&cycler);
+    Thread b(&cycler);
+    Thread c(&cycler);
+    assert(a.start() && b.start() && c.start());
+    a.join();
+    b.join();
+    c.join();
+    assert(impl.getVirtualDelayMicros() == 3ULL * 1000ULL * 1000ULL);
+
+    std::cout << "SimulatedDeviceImpl thread tests passed!" << std::endl;
+}
+
+void testClocks() {
+    std::cout << "Testing clocks..." << std::endl;
+
+    ManualClock manual(5000, 1700000000);
+    assert(manual.nowMicros() == 5000);
+    manual.advanceSeconds(2);
+    assert(manual.nowMillis() == 2005);
+    assert(manual.wallTime() == 1700000002);
+    manual.sleepMillis(3000);
+    assert(manual.nowMillis() == 5005);
+    assert(manual.getSleepCount() == 1);
+    assert(manual.getSleptMicros() == 3000000ULL);
+    manual.setMicros(1000);
+    assert(manual.nowMillis() == 5005);
+
+    AcceleratedClock fast(1000.0);
+    uint64_t realStart = monotonicMicros();
+    uint64_t virtualStart = fast.nowMicros();
+    fast.sleepSeconds(2);
+    assert(fast.nowMicros() - virtualStart >= 2000000ULL);
+    assert(monotonicMicros() - realStart < 1000000ULL);
+
+    assert(&ClockProvider::getClock() == &ClockProvider::getRealClock());
+    ClockProvider::setClock(&manual);
+    assert(&ClockProvider::getClock() == &manual);
+    ClockProvider::setClock(0);
+    assert(ClockProvider::getClock().getClockName() == "Real");
+
+    std::cout << "Clock tests passed!" << std::endl;
+}
+
+void testVirtualTimeSubsystems() {
+    std::cout << "Testing subsystems on a manual clock..." << std::endl;
+
+    ManualClock clock;
+
+    Light light(1, "Cached Light", "Hall");
+    CachingDeviceProxy proxy(&light);
+    proxy.setClock(&clock);
+    proxy.setCacheDuration(60);
+    std::string cached = proxy.getStatusString();
+    clock.advanceSeconds(59);
+    assert(proxy.getStatusString() == cached);
+    assert(proxy.getRebuildCount() == 1);
+    clock.advanceSeconds(1);
+    assert(proxy.getStatusString() == cached);
+    assert(proxy.getRebuildCount() == 2);
+    light.turnOn();
+    assert(proxy.getStatusString() != cached);
+    assert(proxy.getRebuildCount() == 3);
+
+    HealthMonitor monitor;
+    monitor.setClock(&clock);
+    monitor.setSweepInterval(10000);
+    SimulatedDeviceImpl impl(3);
+    impl.powerOn();
+    monitor.registerImpl(&impl);
+    assert(monitor.sweepIfDue());
+    assert(!monitor.sweepIfDue());
+    int sweeps = 1;
+    for (int second = 0; second < 3600; ++second) {
+        clock.advanceSeconds(1);
+        if (monitor.sweepIfDue()) {
+            ++sweeps;
+        }
+    }
+    assert(sweeps == 361);
+
+    GatewayEmulator emulator(9);
+    emulator.setEndpointOnline("gw", false);
+    ConnectionManager manager(&emulator);
+    manager.setClock(&clock);
+    manager.setCircuitBreakerSettings(2, 30000);
+    manager.setBackoffPolicy(BackoffPolicy(1, 1));
+    for (int i = 0; i < 4 && manager.getCircuitState("gw") != CIRCUIT_OPEN; ++i) {
+        clock.advanceMillis(5);
+        manager.acquire("gw", 100);
+    }
+    assert(manager.getCircuitState("gw") == CIRCUIT_OPEN);
+    emulator.setEndpointOnline("gw", true);
+    assert(manager.acquire("gw", 100) == 0);
+    clock.advanceSeconds(31);
+    assert(manager.acquire("gw", 100) != 0);
+    assert(manager.getCircuitState("gw") == CIRCUIT_CLOSED);
+
+    SimulatedDeviceImpl delayed(11);
+    delayed.setClock(&clock);
+    delayed.setLatencyModel(LatencyModel::fixed(250.0));
+    uint64_t before = clock.nowMillis();
+    for (int i = 0; i < 14400; ++i) {
+        delayed.powerOn();
+    }
+    assert(clock.nowMillis() - before == 14400ULL * 250ULL);
+
+    std::cout << "Manual clock subsystem tests passed!" << std::endl;
+}
+
+class CounterHammer : public IRunnable {
+public:
+    CounterHammer(AtomicCounter* counter) : m_counter(counter) {}
+    virtual void run() {
+        for (int i = 0; i < 100000; ++i) {
+            m_counter->increment();
+            m_counter->add(2);
+            m_counter->decrement();
+        }
+    }
+
+private:
+    AtomicCounter* m_counter;
+};
+
+void testAtomicCounter() {
+    std::cout << "Testing AtomicCounter..." << std::endl;
+
+    AtomicCounter counter(5);
+    assert(counter.increment() == 6);
+    assert(counter.decrement() == 5);
+    assert(counter.add(-5) == 0);
+    CounterHammer hammer(&counter);
+    Thread a(&hammer);
+    Thread b(&hammer);
+    Thread c(&hammer);
+    assert(a.start() && b.start() && c.start());
+    a.join();
+    b.join();
+    c.join();
+    assert(counter.get() == 3L * 100000L * 2L);
+    counter.set(7);
+    assert(counter.get() == 7);
+
+    void* block = alignedAllocate(1000, 64);
+    assert(block != 0 && reinterpret_cast<size_t>(block) % 64 == 0);
+    alignedFree(block);
+
+    std::cout << "AtomicCounter tests passed!" << std::endl;
+}
+
+void testWorkerPool() {
+    std::cout << "Testing WorkerPool..." << std::endl;
+
+    assert(WorkerPool::hardwareConcurrency() >= 1);
+    AtomicCounter counter(0);
+    std::vector<CounterHammer*> tasks;
+    for (int i = 0; i < 16; ++i) {
+        tasks.push_back(new CounterHammer(&counter));
+    }
+    WorkerPool pool(4);
+    assert(pool.getThreadCount() == 4);
+    assert(!pool.submit(0));
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        assert(pool.submit(tasks[i]));
+    }
+    pool.waitIdle();
+    assert(pool.getPending() == 0);
+    assert(pool.getCompleted() == 16);
+    assert(counter.get() == 16L * 100000L * 2L);
+
+    pool.shutdown();
+    assert(pool.getThreadCount() == 0);
+    assert(pool.submit(tasks[0]));
+    assert(pool.getCompleted() == 17);
+    assert(counter.get() == 17L * 100000L * 2L);
+
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        delete tasks[i];
+    }
+    std::cout << "WorkerPool tests passed!" << std::endl;
+}
+
+void testCronExpression() {
+    std::cout << "Testing CronExpression..." << std::endl;
+
+    CivilTime leap = civilFromSeconds(secondsFromCivil(2024, 2, 29, 13, 45, 10));
+    assert(leap.year == 2024 && leap.month == 2 && leap.day == 29);
+    assert(leap.hour == 13 && leap.minute == 45 && leap.second == 10);
+    assert(leap.weekday == 4);
+    assert(civilFromSeconds(secondsFromCivil(2000, 1, 1)).weekday == 6);
+    assert(civilFromSeconds(-1).year == 1969 && civilFromSeconds(-1).hour == 23);
+    assert(daysFromCivil(1970, 1, 1) == 0);
+
+    assert(!CronExpression("").isValid());
+    assert(!CronExpression("* * * *").isValid());
+    assert(!CronExpression("60 * * * *").isValid());
+    assert(!CronExpression("* 24 * * *").isValid());
+    assert(!CronExpression("* * 0 * *").isValid());
+    assert(!CronExpression("*/0 * * * *").isValid());
+    assert(!CronExpression("5-1 * * * *").isValid());
+    assert(!CronExpression("* * * FOO *").isValid());
+    assert(!CronExpression("* * * * *").getExpression().empty());
+
+    int64_t result = 0;
+    CronExpression evening("0 19 * * MON-FRI");
+    assert(evening.isValid());
+    int64_t friday = secondsFromCivil(2026, 10, 16, 19, 0);
+    assert(evening.matches(friday));
+    assert(evening.next(friday, result));
+    assert(result == secondsFromCivil(2026, 10, 19, 19, 0));
+    assert(evening.next(secondsFromCivil(2026, 10, 19, 18, 59, 59), result));
+    assert(result == secondsFromCivil(2026, 10, 19, 19, 0));
+
+    CronExpression nightly("0 1 * * *");
+    assert(nightly.next(secondsFromCivil(2026, 12, 31, 2, 0), result));
+    assert(result == secondsFromCivil(2027, 1, 1, 1, 0));
+
+    CronExpression leapDay("30 6 29 2 *");
+    assert(leapDay.next(secondsFromCivil(2025, 1, 1), result));
+    assert(result == secondsFromCivil(2028, 2, 29, 6, 30));
+
+    CronExpression steps("*/15 8-9 * * *");
+    assert(steps.next(secondsFromCivil(2026, 5, 5, 8, 50), result));
+    assert(result == secondsFromCivil(2026, 5, 5, 9, 0));
+    assert(steps.next(secondsFromCivil(2026, 5, 5, 9, 45), result));
+    assert(result == secondsFromCivil(2026, 5, 6, 8, 0));
+
+    CronExpression either("0 12 13 * FRI");
+    assert(either.next(secondsFromCivil(2026, 10, 9, 12, 0), result));
+    assert(result == secondsFromCivil(2026, 10, 13, 12, 0));
+    assert(either.next(result, result));
+    assert(result == secondsFromCivil(2026, 10, 16, 12, 0));
+
+    CronExpression sunday("0 0 * * 7");
+    assert(sunday.matches(secondsFromCivil(2026, 10, 18)));
+    assert(CronExpression("@weekly").next(secondsFromCivil(2026, 10, 18), result));
+    assert(result == secondsFromCivil(2026, 10, 25));
+    assert(CronExpression("@monthly").next(secondsFromCivil(2026, 1, 31, 12, 0), result));
+    assert(result == secondsFromCivil(2026, 2, 1));
+    assert(!CronExpression("0 0 31 2 *").next(0, result));
+
+    std::cout << "CronExpression tests passed!" << std::endl;
+}
+
+class MetricHammer : public IRunnable {
+public:
+    MetricHammer(MetricCounter* counter, LatencyHistogram* histogram)
+        : m_counter(counter), m_histogram(histogram) {}
+    virtual void run() {
+        for (uint64_t i = 0; i < 100000; ++i) {
+            m_counter->increment();
+            m_histogram->record(i % 1000);
+        }
+    }
+
+private:
+    MetricCounter* m_counter;
+    LatencyHistogram* m_histogram;
+};
+
+#ifndef _WIN32
+class MetricsSink : public IRunnable {
+public:
+    explicit MetricsSink(int fd) : m_fd(fd) {}
+    virtual void run() {
+        int client = accept(m_fd, 0, 0);
+        if (client < 0) {
+            return;
+        }
+        char buffer[4096];
+        ssize_t received = 0;
+        while ((received = read(client, buffer, sizeof(buffer))) > 0) {
+            text.append(buffer, static_cast<size_t>(received));
+        }
+        close(client);
+    }
+
+    std::string text;
+
+private:
+    int m_fd;
+};
+#endif
+
+void testMetrics() {
+    std::cout << "Testing Metrics..." << std::endl;
+
+    for (uint64_t value = 0; value < 5000000; value = value * 5 / 4 + 1) {
+        size_t index = LatencyHistogram::bucketIndex(value);
+        assert(index < HISTOGRAM_BUCKETS);
+        assert(LatencyHistogram::bucketLowerBound(index) <= value);
+        assert(LatencyHistogram::bucketUpperBound(index) >= value);
+        assert(LatencyHistogram::bucketUpperBound(index) - LatencyHistogram::bucketLowerBound(index) <= value / 4);
+    }
+    assert(LatencyHistogram::bucketIndex(~static_cast<uint64_t>(0)) == HISTOGRAM_BUCKETS - 1);
+
+    MetricsRegistry& metrics = MetricsRegistry::getInstance();
+    MetricCounter& ops = metrics.counter("test_ops_total", "Test operations", MetricLabels("subsystem", "test"));
+    assert(&ops == &metrics.counter("test_ops_total", "Test operations", MetricLabels("subsystem", "test")));
+    assert(&ops != &metrics.counter("test_ops_total", "Test operations", MetricLabels("subsystem", "other")));
+    MetricGauge& depth = metrics.gauge("test_depth", "Test gauge");
+    LatencyHistogram& latency = metrics.histogram("test_latency_micros", "Test latency",
+                                                  MetricLabels("subsystem", "test"));
+    size_t registered = metrics.getMetricCount();
+    Logger::getInstance().setLogToConsole(false);
+    MetricCounter& conflicting = metrics.counter("test_depth", "Wrong kind");
+    Logger::getInstance().setLogToConsole(true);
+    assert(&conflicting != &ops);
+    assert(metrics.getMetricCount() == registered);
+
+    MetricHammer hammer(&ops, &latency);
+    Thread a(&hammer);
+    Thread b(&hammer);
+    Thread c(&hammer);
+    Thread d(&hammer);
+    assert(a.start() && b.start() && c.start() && d.start());
+    a.join();
+    b.join();
+    c.join();
+    d.join();
+    assert(ops.get() == 400000);
+    HistogramSnapshot snapshot = latency.snapshot();
+    assert(snapshot.count == 400000 && latency.getCount() == 400000);
+    assert(snapshot.max == 999);
+    assert(snapshot.sum == 4ULL * 100ULL * 499500ULL);
+    uint64_t median = snapshot.percentile(0.5);
+    assert(median >= 499 && median <= 499 + 499 / 4);
+    assert(snapshot.percentile(1.0) == 999);
+
+    depth.set(10);
+    depth.add(-3);
+    assert(depth.get() == 7);
+
+    Light light(1, "Metric Light", "Kitchen");
+    MetricCounter& lightOn = metrics.counter("msh_device_operations_total", "Device power operations",
+        MetricLabels("type", "light").add("operation", "on"));
+    uint64_t onBefore = lightOn.get();
+    light.turnOn();
+    light.turnOn();
+    assert(lightOn.get() == onBefore + 2);
+    MetricCounter& warnings = metrics.counter("msh_log_messages_total", "Log lines written",
+        MetricLabels("subsystem", "logger").add("level", "WARN"));
+    uint64_t warningsBefore = warnings.get();
+    Logger::getInstance().warning("metrics test warning");
+    assert(warnings.get() == warningsBefore + 1);
+
+    std::string text = metrics.exportPrometheus();
+    assert(text.find("# TYPE test_ops_total counter\n") != std::string::npos);
+    assert(text.find("test_ops_total{subsystem=\"test\"} 400000\n") != std::string::npos);
+    assert(text.find("test_depth 7\n") != std::string::npos);
+    assert(text.find("# TYPE test_latency_micros histogram\n") != std::string::npos);
+    assert(text.find("test_latency_micros_bucket{subsystem=\"test\",le=\"+Inf\"} 400000\n") != std::string::npos);
+    assert(text.find("test_latency_micros_count{subsystem=\"test\"} 400000\n") != std::string::npos);
+    assert(text.find("msh_device_operations_total{type=\"light\",operation=\"on\"}") != std::string::npos);
+
+    const char* path = "test_metrics.prom";
+    assert(metrics.writePrometheusFile(path));
+    std::ifstream file(path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    file.close();
+    assert(contents.str().find("test_depth 7\n") != std::string::npos);
+    std::remove(path);
+
+#ifndef _WIN32
+    const char* socketPath = "test_metrics.sock";
+    unlink(socketPath);
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+    assert(bind(listener, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == 0);
+    assert(listen(listener, 1) == 0);
+    MetricsSink sink(listener);
+    Thread sinkThread(&sink);
+    assert(sinkThread.start());
+    assert(metrics.writePrometheusSocket(socketPath));
+    sinkThread.join();
+    close(listener);
+    unlink(socketPath);
+    assert(sink.text.find("test_depth 7\n") != std::string::npos);
+    Logger::getInstance().setLogToConsole(false);
+    assert(!metrics.writePrometheusSocket(socketPath));
+    Logger::getInstance().setLogToConsole(true);
+#endif
+
+    const uint64_t iterations = 10000000;
+    MetricCounter& hot = metrics.counter("test_hot_total", "Hot path benchmark");
+    uint64_t start = monotonicMicros();
+    for (uint64_t i = 0; i < iterations; ++i) {
+        hot.increment();
+    }
+    double counterNanos = (monotonicMicros() - start) * 1000.0 / iterations;
+    LatencyHistogram& hotLatency = metrics.histogram("test_hot_micros", "Hot path benchmark");
+    start = monotonicMicros();
+    for (uint64_t i = 0; i < iterations; ++i) {
+        hotLatency.record(i & 4095);
+    }
+    double histogramNanos = (monotonicMicros() - start) * 1000.0 / iterations;
+    assert(hot.get() == iterations && hotLatency.getCount() == iterations);
+    std::cout << "  counter increment " << counterNanos << " ns, histogram record "
+              << histogramNanos << " ns" << std::endl;
+
+    metrics.reset();
+    assert(ops.get() == 0 && depth.get() == 0 && latency.getCount() == 0);
+    std::cout << "Metrics tests passed!" << std::endl;
+}
+
+void testAllocationTracker() {
+    std::cout << "Testing AllocationTracker..." << std::endl;
+
+    assert(AllocationTracker::isAvailable());
+    AllocationTracker::reset();
+    AllocationTracker::enable(true);
+    assert(AllocationTracker::currentTag() == 0);
+    {
+        AllocationScope scope("test", "vector");
+        uint32_t tag = AllocationTracker::currentTag();
+        assert(tag != 0);
+        assert(AllocationTracker::findOrRegisterTag("test", "vector") == tag);
+        AllocationMeter meter;
+        int* values = new int[256];
+        std::vector<char>* buffer = new std::vector<char>(1000);
+        assert(meter.getAllocations() == 3);
+        assert(meter.getBytes() >= 256 * sizeof(int) + 1000);
+        assert(meter.withinBudget(3) && !meter.withinBudget(2));
+        {
+            AllocationScope nested("test", "nested");
+            assert(AllocationTracker::currentTag() != tag);
+            delete[] new char[64];
+        }
+        assert(AllocationTracker::currentTag() == tag);
+        delete buffer;
+        delete[] values;
+    }
+    assert(AllocationTracker::currentTag() == 0);
+
+    AllocationStats vectorStats = AllocationTracker::getOperation("test", "vector");
+    assert(vectorStats.allocations == 3 && vectorStats.frees == 3);
+    assert(vectorStats.allocatedBytes == vectorStats.freedBytes);
+    assert(vectorStats.liveBytes == 0);
+    assert(vectorStats.peakBytes == vectorStats.allocatedBytes);
+    AllocationStats nestedStats = AllocationTracker::getOperation("test", "nested");
+    assert(nestedStats.allocations == 1 && nestedStats.allocatedBytes == 64 && nestedStats.peakBytes == 64);
+    AllocationStats subsystem = AllocationTracker::getSubsystem("test");
+    assert(subsystem.allocations == 4 && subsystem.liveBytes == 0);
+    assert(AllocationTracker::getTotals().allocations >= subsystem.allocations);
+    assert(AllocationTracker::getOperation("test", "missing").allocations == 0);
+
+    char* crossScope = 0;
+    {
+        AllocationScope scope("test", "handoff");
+        crossScope = new char[128];
+    }
+    assert(AllocationTracker::getOperation("test", "handoff").liveBytes == 128);
+    delete[] crossScope;
+    assert(AllocationTracker::getOperation("test", "handoff").liveBytes == 0);
+
+    {
+        AllocationScope scope("logger", "test");
+        Logger::getInstance().debug("allocation tracking");
+    }
+    std::string report = AllocationTracker::report();
+    assert(report.find("test/vector") != std::string::npos);
+    assert(report.find("peak RSS") != std::string::npos);
+
+    AllocationTracker::enable(false);
+    {
+        AllocationScope scope("test", "disabled");
+        AllocationMeter meter;
+        delete new int(1);
+        assert(meter.getAllocations() == 1);
+    }
+    assert(AllocationTracker::getOperation("test", "disabled").allocations == 0);
+
+    const uint64_t iterations = 1000000;
+    AllocationTracker::enable(true);
+    AllocationScope hot("test", "hot");
+    uint64_t start = monotonicMicros();
+    for (uint64_t i = 0; i < iterations; ++i) {
+        delete new int(static_cast<int>(i));
+    }
+    double pairNanos = (monotonicMicros() - start) * 1000.0 / iterations;
+    assert(AllocationTracker::getOperation("test", "hot").allocations == iterations);
+    AllocationTracker::enable(false);
+    std::cout << "  tracked new/delete pair " << pairNanos << " ns" << std::endl;
+
+    std::cout << "AllocationTracker tests passed!" << std::endl;
+}
+
+void testDeviceInfoCache() {
+    std::cout << "Testing DeviceInfoCache..." << std::endl;
+
+    Light light(1, "Versioned Light", "Hall");
+    uint64_t version = light.getVersion();
+    light.getInfo();
+    light.isOn();
+    assert(light.getVersion() == version);
+    light.setBrightness(40);
+    assert(light.getVersion() > version);
+    version = light.getVersion();
+    light.turnOn();
+    assert(light.getVersion() > version);
+
+    CachingDeviceProxy proxy(&light);
+    std::string info = proxy.getInfo();
+    for (int i = 0; i < 100; ++i) {
+        assert(proxy.getInfo() == info);
+    }
+    assert(proxy.getRebuildCount() == 1);
+    light.setColor(1, 2, 3);
+    assert(proxy.getInfo() != info);
+    assert(proxy.getInfo().find("RGB(1,2,3)") != std::string::npos);
+    assert(proxy.getRebuildCount() == 2);
+    proxy.turnOff();
+    assert(proxy.getStatusString() == "Off");
+
+    const size_t deviceCount = 10000;
+    std::vector<Device*> devices;
+    for (size_t i = 0; i < deviceCount; ++i) {
+        std::ostringstream name;
+        name << "Light " << i;
+        devices.push_back(new Light(static_cast<uint32_t>(i + 1), name.str(), "Room"));
+    }
+    DeviceInfoCache cache;
+    uint64_t start = monotonicMicros();
+    assert(cache.refreshAll(devices) == deviceCount);
+    uint64_t coldMicros = monotonicMicros() - start;
+    assert(cache.size() == deviceCount);
+    assert(cache.getInfo(devices[5]) == devices[5]->getInfo());
+
+    for (size_t i = 0; i < deviceCount; i += 1000) {
+        devices[i]->turnOn();
+    }
+    std::vector<size_t> changed;
+    start = monotonicMicros();
+    assert(cache.refreshAll(devices, &changed) == 10);
+    uint64_t warmMicros = monotonicMicros() - start;
+    assert(changed.size() == 10 && changed[0] == 0 && changed[9] == 9000);
+    assert(cache.getStatusString(devices[1000]) == "On");
+    assert(cache.refreshAll(devices) == 0);
+    assert(cache.getRenderCount() == deviceCount + 10);
+
+    cache.forget(devices[0]);
+    assert(cache.size() == deviceCount - 1);
+    assert(cache.refresh(devices[0]));
+    cache.clear();
+    assert(cache.size() == 0);
+    for (size_t i = 0; i < devices.size(); ++i) {
+        delete devices[i];
+    }
+    std::cout << "  10k devices: cold render " << coldMicros << " us, 10 changed " << warmMicros << " us"
+              << std::endl;
+
+    std::cout << "DeviceInfoCache tests passed!" << std::endl;
+}
+
+class SlowLight : public Light {
+public:
+    SlowLight(uint32_t id, const std::string& name, const std::string& location, ManualClock& clock,
+              uint64_t delayMicros)
+        : Light(id, name, location), m_clock(clock), m_delayMicros(delayMicros) {}
+    virtual void turnOn() {
+        m_clock.advanceMicros(m_delayMicros);
+        Light::turnOn();
+    }
+
+private:
+    ManualClock& m_clock;
+    uint64_t m_delayMicros;
+};
+
+void testInstrumentingProxy() {
+    std::cout << "Testing InstrumentingDeviceProxy..." << std::endl;
+
+    DeviceLatencyTracker tracker;
+    ManualClock clock;
+    std::vector<Device*> devices;
+    std::vector<InstrumentingDeviceProxy*> proxies;
+    for (uint32_t id = 1; id <= 60; ++id) {
+        std::ostringstream name;
+        name << "Light " << id;
+        Device* device = 0;
+        if (id == 7 || id == 23 || id == 42) {
+            device = new SlowLight(id, name.str(), "Garden", clock, id == 7 ? 1000 : (id == 23 ? 4000 : 16000));
+        } else {
+            device = new Light(id, name.str(), "House");
+        }
+        devices.push_back(device);
+        proxies.push_back(new InstrumentingDeviceProxy(device, &tracker));
+        proxies.back()->setClock(&clock);
+    }
+    assert(tracker.getDeviceCount() == 60);
+    assert(proxies[0]->getLatencyRecord() == tracker.getRecord(1));
+
+    for (int round = 0; round < 10; ++round) {
+        for (size_t i = 0; i < proxies.size(); ++i) {
+            proxies[i]->turnOn();
+            assert(proxies[i]->isOn() && devices[i]->isOn());
+            assert(!proxies[i]->getInfo().empty());
+            proxies[i]->getStatusString();
+            proxies[i]->turnOff();
+        }
+    }
+    DeviceLatencySummary first = tracker.getRecord(1)->summarize(DEVICE_OP_TURN_ON);
+    assert(first.operations == 10 && first.name == "Light 1");
+    assert(tracker.getRecord(1)->summarize(DEVICE_OP_ALL).operations == 40);
+
+    std::vector<DeviceLatencySummary> slowest = tracker.getSlowest(3, DEVICE_OP_TURN_ON);
+    assert(slowest.size() == 3);
+    assert(slowest[0].deviceId == 42 && slowest[1].deviceId == 23 && slowest[2].deviceId == 7);
+    assert(slowest[2].p50Nanos >= 1000000 && slowest[2].p99Nanos >= slowest[2].p50Nanos);
+    assert(slowest[0].p50Nanos >= 16000000 && slowest[1].p50Nanos >= 4000000);
+    assert(slowest[2].maxNanos < slowest[1].p50Nanos);
+    assert(slowest[0].maxNanos >= slowest[0].p50Nanos);
+    std::vector<DeviceLatencySummary> overall = tracker.getSlowest(3);
+    assert(overall.size() == 3 && overall[0].deviceId == 42);
+    assert(tracker.getSlowest(100, DEVICE_OP_TURN_OFF).size() == 60);
+    std::vector<DeviceLatencySummary> offSlowest = tracker.getSlowest(3, DEVICE_OP_TURN_OFF);
+    assert(offSlowest[0].p99Nanos < slowest[2].p50Nanos);
+    std::string report = tracker.formatSlowest(3, DEVICE_OP_TURN_ON);
+    assert(report.find("1. #42 Light 42 [Garden]") != std::string::npos);
+    std::cout << "  " << report << std::endl;
+
+    Device* clone = proxies[6]->clone();
+    clone->turnOn();
+    assert(tracker.getRecord(7)->summarize(DEVICE_OP_TURN_ON).operations == 11);
+    delete static_cast<DeviceProxy*>(clone)->getRealDevice();
+    delete clone;
+    assert(tracker.getRecord(7) != 0 && tracker.getDeviceCount() == 60);
+
+    tracker.reset();
+    assert(tracker.getSlowest(3).empty());
+    assert(tracker.getDeviceCount() == 60);
+
+    Light factoryLight(900, "Factory Light", "Hall");
+    DeviceProxy* proxy = DeviceProxyFactory::createProxy(&factoryLight, DeviceProxyFactory::PROXY_INSTRUMENTING);
+    InstrumentingDeviceProxy* instrumented = dynamic_cast<InstrumentingDeviceProxy*>(proxy);
+    assert(instrumented != 0);
+    assert(instrumented->getLatencyRecord() == DeviceLatencyTracker::getInstance().getRecord(900));
+    LatencyHistogram& houseWide = MetricsRegistry::getInstance().histogram("msh_device_operation_nanos",
+        "Device operation latency through instrumenting proxies",
+        MetricLabels("type", "light").add("operation", "turn_on"));
+    uint64_t before = houseWide.getCount();
+    proxy->turnOn();
+    assert(factoryLight.isOn());
+    assert(houseWide.getCount() == before + 1);
+    delete proxy;
+    assert(DeviceLatencyTracker::getInstance().getRecord(900) == 0);
+
+    for (size_t i = 0; i < proxies.size(); ++i) {
+        delete proxies[i];
+        delete devices[i];
+    }
+    assert(tracker.getDeviceCount() == 0);
+    std::cout << "InstrumentingDeviceProxy tests passed!" << std::endl;
+}
+
+int main() {
+    std::cout << "=== MySweetHome Core Tests ===" << std::endl << std::endl;
+
+    testBackoffPolicy();
+    testCircuitBreaker();
+    testConnectionPooling();
+    testDropAndReconnect();
+    testCircuitOpensOnDeadEndpoint();
+    testLatencyAndBackoff();
+    testHealthMonitor();
+    testHealthSweepScale();
+    testLatencyModels();
+    testSimulatedDeviceDeterminism();
+    testFailureBursts();
+    testSimulatedDeviceThreads();
+    testClocks();
+    testVirtualTimeSubsystems();
+    testAtomicCounter();
+    testWorkerPool();
+    testCronExpression();
+    testMetrics();
+    testAllocationTracker();
+    testDeviceInfoCache();
+    testInstrumentingProxy();
+
+    std::cout << std::endl << "All tests passed!" << std::endl;
+    return 0;
+}
@@ -6,9 +6,65 @@
 #include "Detector.h"
 #include "TV.h"
 #include "Alarm.h"
+#include "SensorPipeline.h"
+#include "Random.h"
+#include "MonotonicTime.h"
+#include "DetectionStrategy.h"
+#include "Thread.h"
+#include "TimeSeriesStore.h"
+#include "SamplingScheduler.h"
+#include "StaticDetectionStrategy.h"
+#include "FleetAnomalyDetector.h"
+#include "FramePipeline.h"
+#include "MotionEngine.h"
+#include "CameraRecorder.h"
+#include "StreamingHub.h"
+#include "WorkerPool.h"
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#ifndef _WIN32
+#include <dirent.h>
+#endif
 
 using namespace MySweetHome;
 
+std::string makeTempDirectory(const std::string& name) {
+#ifdef _WIN32
+    std::system(("mkdir " + name).c_str());
+    return name;
+#else
+    const char* tempRoot = std::getenv("TMPDIR");
+    std::string pattern = std::string(tempRoot && *tempRoot ? tempRoot : "/tmp") + "/" + name + "_XXXXXX";
+    std::vector<char> pathBuffer(pattern.begin(), pattern.end());
+    pathBuffer.push_back('\0');
+    assert(mkdtemp(&pathBuffer[0]) != 0);
+    return std::string(&pathBuffer[0]);
+#endif
+}
+
+bool removeTempDirectory(const std::string& directory) {
+#ifdef _WIN32
+    return std::system(("rmdir /s /q " + directory).c_str()) == 0;
+#else
+    DIR* dir = opendir(directory.c_str());
+    if (dir) {
+        while (struct dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name != "." && name != "..") {
+                std::remove((directory + "/" + name).c_str());
+            }
+        }
+        closedir(dir);
+    }
+    return std::remove(directory.c_str()) == 0;
+#endif
+}
+
 void testLight() {
     std::cout << "Testing Light..." << std::endl;
 
@@ -143,6 +199,1322 @@ void testAlarm() {
     std::cout << "Alarm tests passed!" << std::endl;
 }
 
+class CountingSensorListener : public ISensorEventListener {
+public:
+    CountingSensorListener() : rising(0), falling(0) {}
+    virtual void onSensorEvent(const SensorEvent& event) {
+        if (event.rising) {
+            ++rising;
+        } else {
+            ++falling;
+        }
+    }
+    int rising;
+    int falling;
+};
+
+void testThresholdKernel() {
+    std::cout << "Testing ThresholdKernel (" << ThresholdKernel::getName() << ")..." << std::endl;
+
+    Random random(5);
+    const size_t count = 1000;
+    std::vector<float> values(count);
+    std::vector<float> thresholds(count);
+    std::vector<uint32_t> vectorBits((count + 31) / 32, 0);
+    std::vector<uint32_t> scalarBits((count + 31) / 32, 0);
+    for (int round = 0; round < 20; ++round) {
+        for (size_t i = 0; i < count; ++i) {
+            values[i] = random.nextFloat() * 100.0f;
+            thresholds[i] = (i % 7 == 0) ? values[i] : 50.0f;
+        }
+        std::vector<uint32_t> vectorChanged;
+        std::vector<uint32_t> scalarChanged;
+        ThresholdKernel::scan(&values[0], &thresholds[0], &vectorBits[0], count, vectorChanged);
+        ThresholdKernel::scanScalar(&values[0], &thresholds[0], &scalarBits[0], count, scalarChanged);
+        assert(vectorChanged == scalarChanged);
+        assert(vectorBits == scalarBits);
+    }
+
+    std::cout << "ThresholdKernel tests passed!" << std::endl;
+}
+
+void testSensorPipeline() {
+    std::cout << "Testing SensorPipeline..." << std::endl;
+
+    std::vector<Detector*> detectors;
+    for (uint32_t id = 1; id <= 100; ++id) {
+        Detector* detector = (id % 2) ? static_cast<Detector*>(new SmokeDetector(id, "Smoke", "Hall"))
+                                      : static_cast<Detector*>(new GasDetector(id, "Gas", "Kitchen"));
+        detector->turnOn();
+        detectors.push_back(detector);
+    }
+
+    SensorPipeline pipeline;
+    CountingSensorListener listener;
+    pipeline.addListener(&listener);
+    for (size_t i = 0; i < detectors.size(); ++i) {
+        assert(pipeline.registerDetector(detectors[i]));
+    }
+    assert(!pipeline.registerDetector(detectors[0]));
+    assert(pipeline.size() == 100);
+    assert(pipeline.size(DETECTOR_SMOKE) == 50);
+    assert(pipeline.size(DETECTOR_GAS) == 50);
+
+    std::vector<SensorReading> batch;
+    SensorReading reading;
+    reading.detectorId = 3;
+    reading.value = 35.0f;
+    reading.timestamp = 1000;
+    batch.push_back(reading);
+    reading.detectorId = 4;
+    reading.value = 99.0f;
+    batch.push_back(reading);
+    reading.detectorId = 999;
+    batch.push_back(reading);
+    assert(pipeline.ingest(batch) == 2);
+    assert(pipeline.process() == 1);
+    assert(pipeline.getLastEvents()[0].detectorId == 3);
+    assert(pipeline.getLastEvents()[0].rising);
+    assert(pipeline.getLastEvents()[0].timestamp == 1000);
+    assert(detectors[2]->isAlarmTriggered());
+    assert(!detectors[3]->isAlarmTriggered());
+    assert(pipeline.isAboveThreshold(3));
+    assert(listener.rising == 1);
+
+    assert(pipeline.process() == 0);
+    batch.clear();
+    reading.detectorId = 3;
+    reading.value = 36.0f;
+    batch.push_back(reading);
+    assert(pipeline.ingestAndProcess(batch) == 0);
+    batch[0].value = 5.0f;
+    assert(pipeline.ingestAndProcess(batch) == 1);
+    assert(!pipeline.getLastEvents()[0].rising);
+    assert(listener.falling == 1);
+
+    batch.clear();
+    reading.detectorId = 5;
+    reading.value = 1.0f;
+    reading.timestamp = 2000;
+    batch.push_back(reading);
+    reading.value = 80.0f;
+    reading.timestamp = 2001;
+    batch.push_back(reading);
+    reading.value = 2.0f;
+    reading.timestamp = 2002;
+    batch.push_back(reading);
+    assert(pipeline.ingestAndProcess(batch) == 2);
+    assert(pipeline.getLastEvents()[0].detectorId == 5 && pipeline.getLastEvents()[0].rising);
+    assert(pipeline.getLastEvents()[0].value == 80.0f && pipeline.getLastEvents()[0].timestamp == 2001);
+    assert(!pipeline.getLastEvents()[1].rising && pipeline.getLastEvents()[1].timestamp == 2002);
+    assert(detectors[4]->isAlarmTriggered());
+    assert(!pipeline.isAboveThreshold(5));
+    assert(pipeline.process() == 0);
+    batch.resize(1);
+    batch[0].value = 3.0f;
+    assert(pipeline.ingestAndProcess(batch) == 0);
+
+    batch[0].detectorId = 99;
+    batch[0].value = 40.0f;
+    pipeline.ingestAndProcess(batch);
+    assert(pipeline.unregisterDetector(1));
+    assert(!pipeline.isRegistered(1));
+    assert(pipeline.isAboveThreshold(99));
+    assert(pipeline.getValue(99) == 40.0f);
+    assert(pipeline.size() == 99);
+
+    SensorPipelineStats stats = pipeline.getStats();
+    assert(stats.unknownReadings == 1);
+    assert(stats.risingEvents == 3);
+    assert(stats.fallingEvents == 2);
+
+    for (size_t i = 0; i < detectors.size(); ++i) {
+        delete detectors[i];
+    }
+    std::cout << "SensorPipeline tests passed!" << std::endl;
+}
+
+void testSensorPipelineThroughput() {
+    std::cout << "Testing SensorPipeline throughput..." << std::endl;
+
+    const uint32_t detectorCount = 10000;
+    std::vector<Detector*> detectors;
+    SensorPipeline pipeline;
+    for (uint32_t id = 1; id <= detectorCount; ++id) {
+        Detector* detector = new SmokeDetector(id, "Smoke", "Hall");
+        detector->turnOn();
+        detectors.push_back(detector);
+        pipeline.registerDetector(detector);
+    }
+
+    Random random(17);
+    std::vector<SensorReading> batch(detectorCount);
+    for (uint32_t i = 0; i < detectorCount; ++i) {
+        batch[i].detectorId = i + 1;
+        batch[i].timestamp = 0;
+    }
+
+    uint64_t start = monotonicMicros();
+    size_t events = 0;
+    for (int round = 0; round < 100; ++round) {
+        for (uint32_t i = 0; i < detectorCount; ++i) {
+            batch[i].value = (i % 1000 == static_cast<uint32_t>(round)) ? 45.0f : 10.0f;
+        }
+        events += pipeline.ingestAndProcess(batch);
+    }
+    uint64_t elapsed = monotonicMicros() - start;
+    assert(pipeline.getStats().readings == 100ULL * detectorCount);
+    assert(events == 199 * 10);
+    std::cout << "  1M readings in " << elapsed << " us" << std::endl;
+    assert(elapsed < 1000000ULL);
+
+    for (size_t i = 0; i < detectors.size(); ++i) {
+        delete detectors[i];
+    }
+    std::cout << "SensorPipeline throughput tests passed!" << std::endl;
+}
+
+void testSlidingWindow() {
+    std::cout << "Testing SlidingWindow..." << std::endl;
+
+    const size_t capacity = 64;
+    SlidingWindow window(capacity);
+    std::vector<float> history;
+    Random random(23);
+    for (int i = 0; i < 1000; ++i) {
+        float value = static_cast<float>(random.nextGaussian() * 10.0 + 50.0);
+        window.add(value);
+        history.push_back(value);
+
+        size_t begin = history.size() > capacity ? history.size() - capacity : 0;
+        double sum = 0.0;
+        float lo = history[begin];
+        float hi = history[begin];
+        for (size_t j = begin; j < history.size(); ++j) {
+            sum += history[j];
+            lo = std::min(lo, history[j]);
+            hi = std::max(hi, history[j]);
+        }
+        double mean = sum / (history.size() - begin);
+        double sq = 0.0;
+        for (size_t j = begin; j < history.size(); ++j) {
+            sq += (history[j] - mean) * (history[j] - mean);
+        }
+        double variance = history.size() - begin > 1 ? sq / (history.size() - begin) : 0.0;
+        assert(window.size() == history.size() - begin);
+        assert(std::fabs(window.mean() - mean) < 1e-3);
+        assert(std::fabs(window.variance() - variance) < 1e-2);
+        assert(window.minimum() == lo);
+        assert(window.maximum() == hi);
+        assert(window.last() == value);
+        assert(window.oldest() == history[begin]);
+    }
+    assert(window.isFull());
+
+    SlidingWindow smoothing(4, 0.5);
+    smoothing.add(10.0f);
+    smoothing.add(20.0f);
+    assert(smoothing.ewma() == 15.0f);
+    smoothing.clear();
+    assert(smoothing.empty());
+    assert(smoothing.mean() == 0.0f);
+
+    std::cout << "SlidingWindow tests passed!" << std::endl;
+}
+
+class StrategyReader : public IRunnable {
+public:
+    StrategyReader(const AveragingDetectionStrategy& strategy) : m_strategy(strategy), reads(0) {}
+    virtual void run() {
+        for (int i = 0; i < 20000; ++i) {
+            float mean = m_strategy.getAverage();
+            float lo = m_strategy.getMinimum();
+            float hi = m_strategy.getMaximum();
+            assert(mean >= 0.0f && lo <= hi + 1e-3f);
+            ++reads;
+        }
+    }
+    const AveragingDetectionStrategy& m_strategy;
+    int reads;
+};
+
+void testAveragingStrategy() {
+    std::cout << "Testing AveragingDetectionStrategy..." << std::endl;
+
+    AveragingDetectionStrategy small(3);
+    assert(!small.detect(10.0f, 45.0f));
+    assert(!small.detect(50.0f, 45.0f));
+    assert(small.detect(80.0f, 45.0f));
+    assert(small.getAverage() > 46.0f && small.getAverage() < 47.0f);
+    assert(small.getMaximum() == 80.0f);
+    assert(small.getMinimum() == 10.0f);
+    small.detect(90.0f, 45.0f);
+    assert(small.getMinimum() == 50.0f);
+    assert(small.getReadingCount() == 3);
+    small.clearReadings();
+    assert(small.getReadingCount() == 0);
+
+    AveragingDetectionStrategy large(100000);
+    StrategyReader readerA(large);
+    StrategyReader readerB(large);
+    Thread a(&readerA);
+    Thread b(&readerB);
+    assert(a.start() && b.start());
+    uint64_t start = monotonicMicros();
+    for (int i = 0; i < 500000; ++i) {
+        large.detect(static_cast<float>(i % 100), 45.0f);
+    }
+    uint64_t elapsed = monotonicMicros() - start;
+    a.join();
+    b.join();
+    assert(readerA.reads == 20000 && readerB.reads == 20000);
+    assert(large.getReadingCount() == 100000);
+    assert(std::fabs(large.getAverage() - 49.5f) < 1e-3f);
+    assert(large.getMinimum() == 0.0f && large.getMaximum() == 99.0f);
+    std::cout << "  500k readings over a 100k window in " << elapsed << " us" << std::endl;
+    assert(elapsed < 2000000ULL);
+
+    std::cout << "AveragingDetectionStrategy tests passed!" << std::endl;
+}
+
+void testTimeSeriesRoundTrip() {
+    std::cout << "Testing TimeSeriesStore round trip..." << std::endl;
+
+    TimeSeriesStore store(128);
+    Random random(31);
+    std::vector<TimeSeriesSample> expected;
+    uint64_t timestamp = 1700000000000ULL;
+    float value = 12.5f;
+    for (int i = 0; i < 1000; ++i) {
+        int pattern = i / 100;
+        if (pattern % 3 == 0) {
+            timestamp += 1000;
+        } else if (pattern % 3 == 1) {
+            timestamp += 1000 + random.nextInt(-40, 40);
+            value = static_cast<float>(random.nextGaussian() * 100.0);
+        } else {
+            timestamp += static_cast<uint64_t>(random.nextInt(0, 5000000));
+            value += 0.25f;
+        }
+        assert(store.append(7, timestamp, value));
+        TimeSeriesSample sample;
+        sample.timestamp = timestamp;
+        sample.value = value;
+        expected.push_back(sample);
+    }
+    assert(!store.append(7, timestamp - 1, 0.0f));
+
+    std::vector<TimeSeriesSample> actual;
+    assert(store.query(7, 0, ~0ULL, actual) == expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        assert(actual[i].timestamp == expected[i].timestamp);
+        assert(std::memcmp(&actual[i].value, &expected[i].value, sizeof(float)) == 0);
+    }
+
+    actual.clear();
+    store.query(7, expected[250].timestamp, expected[260].timestamp, actual);
+    assert(actual.size() == 11);
+    assert(actual[0].timestamp == expected[250].timestamp);
+
+    TimeSeriesSample latest;
+    assert(store.getLatest(7, latest));
+    assert(latest.timestamp == timestamp);
+    assert(!store.getLatest(8, latest));
+
+    std::vector<TimeSeriesBucket> buckets;
+    uint64_t from = expected[0].timestamp;
+    store.downsample(7, from, expected[99].timestamp, 10000, buckets);
+    assert(buckets.size() == 10);
+    assert(buckets[0].count == 10);
+    assert(buckets[0].minimum == 12.5f && buckets[0].maximum == 12.5f);
+    assert(buckets[0].average() == 12.5f);
+
+    std::cout << "TimeSeriesStore round trip tests passed!" << std::endl;
+}
+
+void testTimeSeriesRetentionAndSpill() {
+    std::cout << "Testing TimeSeriesStore retention and spill..." << std::endl;
+
+    TimeSeriesStore retained(60);
+    retained.setRetention(3600ULL * 1000ULL);
+    for (uint64_t second = 0; second < 3 * 3600; ++second) {
+        retained.append(1, second * 1000ULL, static_cast<float>(second % 17));
+    }
+    std::vector<TimeSeriesSample> samples;
+    retained.query(1, 0, ~0ULL, samples);
+    assert(!samples.empty());
+    assert(samples.front().timestamp >= 2 * 3600ULL * 1000ULL - 60000ULL);
+    assert(samples.back().timestamp == (3 * 3600ULL - 1) * 1000ULL);
+
+    TimeSeriesStore bounded(64);
+    bounded.setMemoryBudget(16 * 1024);
+    for (uint64_t second = 0; second < 20000; ++second) {
+        for (uint32_t id = 1; id <= 4; ++id) {
+            bounded.append(id, second * 1000ULL, static_cast<float>((second * id) % 1000) * 0.37f);
+        }
+    }
+    TimeSeriesStats boundedStats = bounded.getStats();
+    assert(boundedStats.evictedBlocks > 0);
+    assert(boundedStats.memoryBytes <= 16 * 1024 + 4 * 2048);
+
+    std::string directory = makeTempDirectory("timeseries_spill");
+    {
+        TimeSeriesStore spilled(64);
+        TimeSeriesStore neighbour(64);
+        assert(spilled.enableSpill(directory));
+        assert(neighbour.enableSpill(directory));
+        spilled.setMemoryBudget(16 * 1024);
+        neighbour.setMemoryBudget(16 * 1024);
+        for (uint64_t second = 0; second < 20000; ++second) {
+            for (uint32_t id = 1; id <= 4; ++id) {
+                spilled.append(id, second * 1000ULL, static_cast<float>((second * id) % 1000) * 0.37f);
+                neighbour.append(id, second * 1000ULL, -static_cast<float>(id));
+            }
+        }
+        TimeSeriesStats spilledStats = spilled.getStats();
+        assert(spilledStats.spilledBlocks > 0);
+        assert(spilledStats.evictedBlocks == 0);
+        assert(spilledStats.samples == 80000);
+        assert(neighbour.getStats().spilledBlocks > 0);
+        samples.clear();
+        assert(spilled.query(3, 0, ~0ULL, samples) == 20000);
+        for (size_t i = 0; i < samples.size(); i += 997) {
+            assert(samples[i].timestamp == i * 1000ULL);
+            assert(samples[i].value == static_cast<float>((i * 3) % 1000) * 0.37f);
+        }
+        samples.clear();
+        assert(neighbour.query(2, 0, ~0ULL, samples) == 20000);
+        assert(samples.front().value == -2.0f && samples.back().value == -2.0f);
+
+        size_t spilledBlocks = spilledStats.spilledBlocks;
+        spilled.disableSpill();
+        for (uint64_t second = 20000; second < 30000; ++second) {
+            for (uint32_t id = 1; id <= 4; ++id) {
+                spilled.append(id, second * 1000ULL, 1.0f);
+            }
+        }
+        spilledStats = spilled.getStats();
+        assert(spilledStats.evictedBlocks > 0);
+        assert(spilledStats.memoryBytes <= 16 * 1024 + 4 * 2048);
+        assert(spilledStats.spilledBlocks == spilledBlocks);
+        size_t kept = 0;
+        for (uint32_t id = 1; id <= 4; ++id) {
+            samples.clear();
+            kept += spilled.query(id, 0, ~0ULL, samples);
+        }
+        assert(kept == spilledStats.samples);
+        samples.clear();
+        spilled.query(3, 0, ~0ULL, samples);
+        assert(samples.front().timestamp == 0 && samples.back().timestamp == 29999000ULL);
+    }
+    assert(removeTempDirectory(directory));
+
+    std::cout << "TimeSeriesStore retention and spill tests passed!" << std::endl;
+}
+
+void testTimeSeriesFootprint() {
+    std::cout << "Testing TimeSeriesStore footprint..." << std::endl;
+
+    const uint32_t detectors = 20;
+    const uint64_t seconds = 24ULL * 3600ULL;
+    TimeSeriesStore store;
+    store.setResolution(0.5f);
+    SensorPipeline pipeline;
+    pipeline.setHistory(&store);
+    std::vector<Detector*> devices;
+    for (uint32_t id = 1; id <= detectors; ++id) {
+        devices.push_back(new SmokeDetector(id, "Smoke", "Hall"));
+        devices.back()->turnOn();
+        pipeline.registerDetector(devices.back());
+    }
+
+    Random random(41);
+    std::vector<float> level(detectors, 8.0f);
+    std::vector<SensorReading> batch(detectors);
+    for (uint64_t second = 0; second < seconds; ++second) {
+        for (uint32_t i = 0; i < detectors; ++i) {
+            level[i] += static_cast<float>(0.02 * random.nextGaussian());
+            batch[i].detectorId = i + 1;
+            batch[i].value = level[i] + static_cast<float>(0.1 * random.nextGaussian());
+            batch[i].timestamp = second * 1000ULL;
+        }
+        pipeline.ingestAndProcess(batch);
+    }
+
+    TimeSeriesStats stats = store.getStats();
+    assert(stats.samples == detectors * seconds);
+    double bytesPerSample = static_cast<double>(stats.memoryBytes) / stats.samples;
+    double weekFleetMB = bytesPerSample * 10000.0 * 7.0 * seconds / (1024.0 * 1024.0);
+    std::cout << "  " << stats.bitsPerSample() << " bits/sample, projected week for 10k detectors: "
+              << weekFleetMB << " MB" << std::endl;
+    assert(weekFleetMB < 500.0);
+
+    for (size_t i = 0; i < devices.size(); ++i) {
+        delete devices[i];
+    }
+    std::cout << "TimeSeriesStore footprint tests passed!" << std::endl;
+}
+
+class RampSampler : public ISensorSampler {
+public:
+    RampSampler(size_t count)
+        : base(count, 5.0f)
+        , ramp(count, 0.0f)
+        , detectedAt(count, 0)
+    {
+    }
+    float valueAt(size_t index, uint64_t nowMillis) const {
+        return base[index] + ramp[index] * static_cast<float>(nowMillis / 1000.0);
+    }
+    virtual bool sample(Detector* detector, uint64_t nowMillis, float& value) {
+        size_t index = detector->getId() - 1;
+        value = valueAt(index, nowMillis);
+        if (value >= detector->getThreshold() && detectedAt[index] == 0) {
+            detectedAt[index] = nowMillis;
+        }
+        return true;
+    }
+    std::vector<float> base;
+    std::vector<float> ramp;
+    std::vector<uint64_t> detectedAt;
+};
+
+void testSamplingScheduler() {
+    std::cout << "Testing SamplingScheduler..." << std::endl;
+
+    const size_t detectors = 1000;
+    const uint64_t duration = 3600ULL * 1000ULL;
+    SamplingScheduler scheduler;
+    scheduler.setIntervalRange(250, 60000);
+    scheduler.setBudget(200.0);
+    RampSampler sampler(detectors);
+    std::vector<Detector*> devices;
+    for (size_t i = 0; i < detectors; ++i) {
+        devices.push_back(new SmokeDetector(static_cast<uint32_t>(i + 1), "Smoke", "Hall"));
+        if (i % 100 == 0) {
+            sampler.ramp[i] = 0.02f + 0.01f * static_cast<float>(i / 100);
+        }
+        assert(scheduler.registerDetector(devices.back(), 1));
+    }
+    assert(scheduler.size() == detectors);
+    assert(!scheduler.registerDetector(devices[0]));
+
+    std::vector<SensorReading> readings;
+    uint64_t maxPollsPerSecond = 0;
+    uint64_t polledThisSecond = 0;
+    for (uint64_t now = 1; now <= duration; now += 50) {
+        readings.clear();
+        polledThisSecond += scheduler.runDue(now, sampler, &readings);
+        assert(readings.size() <= polledThisSecond);
+        if (now % 1000 == 1) {
+            maxPollsPerSecond = std::max(maxPollsPerSecond, polledThisSecond);
+            polledThisSecond = 0;
+        }
+    }
+
+    SamplingStats stats = scheduler.getStats();
+    uint64_t fixedPolls = detectors * (duration / 1000ULL);
+    std::cout << "  " << stats.polls << " polls vs " << fixedPolls << " at fixed 1s, peak "
+              << maxPollsPerSecond << "/s, deferred " << stats.deferredByBudget << std::endl;
+    assert(stats.polls * 10 < fixedPolls);
+    assert(maxPollsPerSecond <= 220);
+
+    for (size_t i = 0; i < detectors; i += 100) {
+        float threshold = devices[i]->getThreshold();
+        uint64_t crossing = static_cast<uint64_t>((threshold - sampler.base[i]) / sampler.ramp[i] * 1000.0f);
+        if (crossing >= duration) {
+            continue;
+        }
+        assert(sampler.detectedAt[i] > 0);
+        assert(sampler.detectedAt[i] - crossing <= 1000);
+    }
+    assert(scheduler.getInterval(2) > scheduler.getInterval(101));
+    assert(scheduler.getInterval(101) == scheduler.getMinInterval());
+
+    assert(scheduler.unregisterDetector(2));
+    assert(!scheduler.unregisterDetector(2));
+    assert(scheduler.getInterval(2) == 0);
+    assert(scheduler.size() == detectors - 1);
+
+    for (size_t i = 0; i < devices.size(); ++i) {
+        delete devices[i];
+    }
+    std::cout << "SamplingScheduler tests passed!" << std::endl;
+}
+
+void testStaticStrategies() {
+    std::cout << "Testing static detection strategies..." << std::endl;
+
+    SmokeDetectionStrategy smoke;
+    smoke.setSensitivity(3);
+    StaticStrategyAdapter<SmokePolicy<3> > staticSmoke;
+    MotionDetectionStrategy motion(8);
+    StaticStrategyAdapter<MotionPolicy<8> > staticMotion;
+    GasDetectionStrategy co("CO");
+    StaticStrategyAdapter<GasPolicy<GAS_CO> > staticCo;
+    SimpleThresholdStrategy simple;
+    StaticStrategyAdapter<ThresholdPolicy> staticSimple;
+    for (int i = 0; i < 2000; ++i) {
+        float value = static_cast<float>(i) * 0.1f;
+        assert(smoke.detect(value, 40.0f) == staticSmoke.detect(value, 40.0f));
+        assert(motion.detect(value, 30.0f) == staticMotion.detect(value, 30.0f));
+        assert(co.detect(value, 0.0f) == staticCo.detect(value, 0.0f));
+        assert(simple.detect(value, 50.0f) == staticSimple.detect(value, 50.0f));
+    }
+    assert(co.getName() == staticCo.getName());
+    assert(co.getDescription() == staticCo.getDescription());
+    assert(smoke.getName() == staticSmoke.getName());
+    assert(staticCo.getRecommendedThreshold() == 50.0f);
+
+    assert(parseGasKind("Methane") == GAS_METHANE);
+    assert(parseGasKind("Propane") == GAS_LPG);
+    assert(std::string(gasKindToString(GAS_NATURAL)) == "Natural");
+    assert(GasDetectionStrategy::getDefaultThresholdForGas("Natural") == 2500.0f);
+    GasDetectionStrategy gas;
+    gas.setGasType("Methane");
+    assert(gas.getGasKind() == GAS_METHANE);
+    assert(!gas.detect(4000.0f, 0.0f) && gas.detect(6000.0f, 0.0f));
+    assert(smokeSensitivityFactor(0) == smokeSensitivityFactor(1));
+    assert(motionSensitivityFactor(10) == 1.0f);
+
+    RateOfChangeStrategy rate(5.0f);
+    const IDetectionStrategy& rateView = rate;
+    assert(rateView.detect(60.0f, 50.0f));
+    assert(!rateView.detect(61.0f, 50.0f));
+    assert(rate.getRateOfChange() == 1.0f);
+    rate.addReading(70.0f);
+    assert(rate.getRateOfChange() == 9.0f);
+    RateOfChangeStrategy copied(rate);
+    assert(copied.getRateOfChange() == 9.0f);
+    assert(!copied.detect(72.0f, 50.0f) && copied.detect(80.0f, 50.0f));
+    rate.reset();
+    assert(rate.getRateOfChange() == 0.0f);
+
+    const size_t count = 1 << 20;
+    std::vector<float> values(count);
+    std::vector<uint8_t> results(count);
+    Random random(17);
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = random.nextFloat() * 100.0f;
+    }
+    IDetectionStrategy* dynamicSmoke = DetectionStrategyFactory::createSmokeStrategy(3);
+    uint64_t start = monotonicMicros();
+    size_t dynamicHits = 0;
+    for (size_t i = 0; i < count; ++i) {
+        dynamicHits += dynamicSmoke->detect(values[i], 40.0f) ? 1 : 0;
+    }
+    uint64_t dynamicMicros = monotonicMicros() - start;
+    start = monotonicMicros();
+    size_t staticHits = detectBatch<SmokePolicy<3> >(&values[0], 40.0f, &results[0], count);
+    uint64_t staticMicros = monotonicMicros() - start;
+    assert(staticHits == dynamicHits);
+    std::cout << "  " << count << " samples: virtual " << dynamicMicros << " us, static batch "
+              << staticMicros << " us" << std::endl;
+    delete dynamicSmoke;
+
+    SensorPipeline pipeline;
+    SmokeDetector detector(1, "Smoke", "Hall");
+    detector.setThreshold(40.0f);
+    pipeline.registerDetector(&detector);
+    pipeline.setSyncDevices(false);
+    pipeline.setThresholdTransform(DETECTOR_SMOKE, StaticStrategyAdapter<SmokePolicy<3> >::getThresholdTransform());
+    float effective = SmokePolicy<3>::effectiveThreshold(40.0f);
+    std::vector<SensorReading> batch(1);
+    batch[0].detectorId = 1;
+    batch[0].value = 45.0f;
+    batch[0].timestamp = 1;
+    pipeline.ingestAndProcess(batch);
+    assert(pipeline.isAboveThreshold(1) == (45.0f >= effective));
+    batch[0].value = effective + 1.0f;
+    pipeline.ingestAndProcess(batch);
+    assert(pipeline.isAboveThreshold(1));
+    pipeline.syncThresholds();
+    assert(pipeline.getThresholdTransform(DETECTOR_SMOKE) != 0);
+    assert(pipeline.getLastEvents().size() <= 1);
+
+    std::cout << "Static detection strategy tests passed!" << std::endl;
+}
+
+void testFleetAnomalyDetector() {
+    std::cout << "Testing FleetAnomalyDetector..." << std::endl;
+
+    AnomalyConfig config;
+    config.warmupSamples = 10;
+    FleetAnomalyDetector detector(config);
+    const uint32_t rooms = 3;
+    const uint32_t perRoom = 6;
+    for (uint32_t r = 0; r < rooms; ++r) {
+        for (uint32_t d = 0; d < perRoom; ++d) {
+            assert(detector.registerDetector(r * perRoom + d + 1, r == 0 ? "Kitchen" : (r == 1 ? "Hall" : "Garage")));
+        }
+    }
+    assert(!detector.registerDetector(1, "Kitchen"));
+    assert(detector.size() == rooms * perRoom);
+
+    Random random(3);
+    const uint64_t hour = 3600ULL * 1000ULL;
+    std::vector<SensorReading> frame(rooms * perRoom);
+    size_t normalAnomalies = 0;
+    uint64_t now = 0;
+    for (int h = 0; h < 24 * 14; ++h) {
+        now = static_cast<uint64_t>(h) * hour;
+        float season = 20.0f + 5.0f * static_cast<float>(std::sin(2.0 * 3.14159265 * (h % 24) / 24.0));
+        for (size_t i = 0; i < frame.size(); ++i) {
+            frame[i].detectorId = static_cast<uint32_t>(i + 1);
+            frame[i].value = season + static_cast<float>(i / perRoom) + 0.2f * static_cast<float>(random.nextGaussian());
+            frame[i].timestamp = now;
+        }
+        detector.ingestAndProcess(frame, now);
+        if (h >= 24 * 7) {
+            normalAnomalies += detector.getLastAnomalies().size();
+        }
+    }
+    assert(normalAnomalies == 0);
+    assert(detector.getSampleCount(1) == 24 * 14);
+    assert(std::fabs(detector.getMean(1) - 20.0f) < 0.5f);
+    assert(detector.getStandardDeviation(1) > 3.0f);
+    assert(std::fabs(detector.getSeasonalBaseline(1, 6 * hour) - 25.0f) < 0.5f);
+
+    now += hour;
+    float trough = 20.0f + 5.0f * static_cast<float>(std::sin(2.0 * 3.14159265 * 18 / 24.0));
+    assert(detector.getSeasonSlot(now) == 0);
+    now += 18 * hour;
+    for (size_t i = 0; i < frame.size(); ++i) {
+        frame[i].value = trough + static_cast<float>(i / perRoom);
+        frame[i].timestamp = now;
+    }
+    frame[2].value += 4.0f;
+    for (size_t i = perRoom; i < 2 * perRoom; ++i) {
+        frame[i].value += 4.0f;
+    }
+    detector.ingestAndProcess(frame, now);
+    const std::vector<AnomalyEvent>& anomalies = detector.getLastAnomalies();
+    bool singleFlagged = false;
+    size_t roomFlagged = 0;
+    for (size_t a = 0; a < anomalies.size(); ++a) {
+        if (anomalies[a].detectorId == 3) {
+            singleFlagged = (anomalies[a].reasons & ANOMALY_HISTORY) && (anomalies[a].reasons & ANOMALY_PEERS);
+        } else {
+            assert(anomalies[a].detectorId > perRoom && anomalies[a].detectorId <= 2 * perRoom);
+            assert(anomalies[a].reasons == ANOMALY_HISTORY);
+            ++roomFlagged;
+        }
+    }
+    assert(singleFlagged);
+    assert(roomFlagged == perRoom);
+    assert(detector.getHistoryScore(3) > config.historyThreshold);
+    assert(detector.getPeerScore(8) < config.peerThreshold);
+
+    assert(detector.unregisterDetector(3));
+    assert(!detector.isRegistered(3));
+    assert(detector.getSampleCount(18) == 24 * 14 + 1);
+    assert(detector.ingest(frame) == frame.size() - 1);
+    assert(detector.getStats().unknownReadings == 1);
+
+    const uint32_t fleet = 100000;
+    FleetAnomalyDetector large;
+    std::vector<SensorReading> readings(fleet);
+    for (uint32_t id = 1; id <= fleet; ++id) {
+        char room[32];
+        std::sprintf(room, "Room %u", (id - 1) / 100);
+        large.registerDetector(id, room);
+        readings[id - 1].detectorId = id;
+    }
+    const int passes = 20;
+    uint64_t start = monotonicMicros();
+    for (int p = 0; p < passes; ++p) {
+        for (uint32_t i = 0; i < fleet; ++i) {
+            readings[i].value = 10.0f + random.nextFloat();
+            readings[i].timestamp = p * 1000ULL;
+        }
+        large.ingest(readings);
+        large.process(p * 1000ULL);
+    }
+    uint64_t elapsed = monotonicMicros() - start;
+    AnomalyStats stats = large.getStats();
+    assert(stats.updates == static_cast<uint64_t>(fleet) * passes);
+    assert(stats.groups == fleet / 100);
+    std::cout << "  " << FleetAnomalyDetector::getKernelName() << " kernel: " << fleet << " detectors, last pass "
+              << stats.lastPassMicros << " us, " << elapsed / passes << " us per frame incl. ingest, "
+              << large.getMemoryBytes() / (1024 * 1024) << " MB" << std::endl;
+
+    std::cout << "FleetAnomalyDetector tests passed!" << std::endl;
+}
+
+class FrameProbeStage : public IFrameStage {
+public:
+    FrameProbeStage(const std::string& name) : m_name(name), misaligned(0), maxUseCount(0) {}
+    virtual std::string getStageName() const { return m_name; }
+    virtual bool processFrame(const FrameHandle& frame, Camera* camera) {
+        assert(camera != 0 && camera->getId() == frame->cameraId);
+        if (reinterpret_cast<size_t>(frame.data()) % 64 != 0) {
+            ++misaligned;
+        }
+        maxUseCount = std::max(maxUseCount, frame.useCount());
+        pointers.push_back(frame.data());
+        return true;
+    }
+    std::string m_name;
+    size_t misaligned;
+    long maxUseCount;
+    std::vector<const uint8_t*> pointers;
+};
+
+void testFramePipeline() {
+    std::cout << "Testing FramePipeline..." << std::endl;
+
+    FramePool small(2, 33, 4);
+    assert(small.getStride() == 64);
+    {
+        FrameHandle a = small.acquire();
+        FrameHandle b = small.acquire();
+        assert(a.isValid() && b.isValid() && a.data() != b.data());
+        assert(!small.acquire().isValid());
+        FrameHandle copy = a;
+        assert(a.useCount() == 2);
+        a.reset();
+        assert(small.available() == 0);
+        copy.reset();
+        assert(small.available() == 1);
+        FrameQueue queue(1, FrameQueue::DROP_OLDEST);
+        FrameHandle c = small.acquire();
+        assert(queue.push(b) && queue.push(c));
+        assert(queue.getDropped() == 1 && queue.size() == 1);
+    }
+    assert(small.available() == 2);
+    assert(small.getStats().exhausted == 1);
+
+    FrameHandle survivor;
+    FrameHandle sibling;
+    {
+        FramePool shortLived(3, 16, 8);
+        survivor = shortLived.acquire();
+        sibling = shortLived.acquire();
+        FrameHandle dropped = shortLived.acquire();
+        survivor.mutableData()[0] = 42;
+    }
+    assert(survivor.isValid() && survivor->pool == 0);
+    assert(survivor.data()[0] == 42);
+    sibling.mutableData()[sibling->size - 1] = 7;
+    survivor.reset();
+    assert(sibling.data()[sibling->size - 1] == 7);
+    sibling.reset();
+
+    std::string frameDirectory = makeTempDirectory("frame_source");
+    std::string framePath = frameDirectory + "/test_frames.raw";
+    const char* path = framePath.c_str();
+    std::FILE* file = std::fopen(path, "wb");
+    assert(file);
+    for (int frame = 0; frame < 2; ++frame) {
+        for (int i = 0; i < 16 * 8; ++i) {
+            std::fputc(frame * 100 + (i % 50), file);
+        }
+    }
+    std::fclose(file);
+    FileFrameSource fileSource(path);
+    assert(fileSource.isOpen());
+    FramePool filePool(1, 16, 8);
+    for (int i = 0; i < 3; ++i) {
+        FrameHandle frame = filePool.acquire();
+        assert(fileSource.fill(*frame.get(), 0));
+        assert(frame.data()[0] == (i % 2) * 100);
+    }
+    assert(fileSource.getFramesRead() == 3);
+    assert(removeTempDirectory(frameDirectory));
+
+    const size_t cameraCount = 64;
+    FramePool pool(128, 320, 240);
+    FramePipeline pipeline(&pool);
+    std::vector<Camera*> cameras;
+    std::vector<SyntheticFrameSource*> sources;
+    for (size_t i = 0; i < cameraCount; ++i) {
+        cameras.push_back(new Camera(static_cast<uint32_t>(i + 1), "Camera", "Hall"));
+        cameras.back()->turnOn();
+        cameras.back()->setFPS(30);
+        if (i % 2 == 0) {
+            cameras.back()->startRecording();
+        } else if (i % 4 == 1) {
+            cameras.back()->startStreaming();
+        }
+        sources.push_back(new SyntheticFrameSource(static_cast<uint32_t>(i + 1)));
+        assert(pipeline.addCamera(cameras.back(), sources.back()));
+    }
+    assert(!pipeline.addCamera(cameras[0], sources[0]));
+
+    FrameProbeStage analysis("Analysis");
+    FrameProbeStage monitor("Monitor");
+    RecordingStage record;
+    StreamingStage stream;
+    pipeline.addStage(&record, FRAME_STAGE_OUTPUT, 64);
+    pipeline.addStage(&stream, FRAME_STAGE_OUTPUT, 4, 2);
+    pipeline.addStage(&monitor, FRAME_STAGE_OUTPUT, 64);
+    pipeline.addStage(&analysis, FRAME_STAGE_ANALYSIS, 64);
+
+    FramePoolStats before = pool.getStats();
+    for (uint64_t now = 0; now < 10000; now += 5) {
+        pipeline.tick(now);
+    }
+    FramePipelineStats stats = pipeline.getStats();
+    FramePoolStats poolStats = pool.getStats();
+    assert(stats.cameras == cameraCount);
+    assert(stats.captured == cameraCount * 300);
+    assert(stats.poolExhausted == 0);
+    assert(poolStats.acquired - before.acquired == stats.captured);
+    assert(poolStats.highWater <= pool.capacity());
+    assert(stats.stages.size() == 4);
+    assert(stats.stages[0].name == "Analysis");
+    for (size_t i = 0; i < stats.stages.size(); ++i) {
+        const FrameStageStats& stage = stats.stages[i];
+        assert(stage.received == stage.processed + stage.rejected + stage.dropped + stage.queued);
+        assert(stage.highWater <= 64);
+    }
+    assert(stats.stages[0].processed == stats.captured);
+    assert(stats.stages[2].dropped > 0);
+    assert(record.getFrames() == stats.captured / 2);
+    assert(stream.getFrames() > 0 && stream.getFrames() < stats.captured / 4);
+    assert(analysis.misaligned == 0);
+    assert(analysis.pointers == monitor.pointers);
+    assert(monitor.maxUseCount >= 2);
+    std::cout << "  " << stats.captured << " frames from " << cameraCount << " cameras, pool high water "
+              << poolStats.highWater << "/" << pool.capacity() << ", stream drops " << stats.stages[2].dropped
+              << std::endl;
+
+    pipeline.drain();
+    assert(pool.getStats().inUse == 0);
+    assert(pool.available() == pool.capacity());
+
+    for (size_t i = 0; i < cameraCount; ++i) {
+        delete cameras[i];
+        delete sources[i];
+    }
+    std::cout << "FramePipeline tests passed!" << std::endl;
+}
+
+class MotionCollector : public IMotionListener {
+public:
+    MotionCollector() : results(0), motion(65, 0) {}
+    virtual void onMotion(const MotionResult& result) {
+        ++results;
+        if (result.motion) {
+            ++motion[result.cameraId];
+        }
+    }
+    size_t results;
+    std::vector<size_t> motion;
+};
+
+void testMotionEngine() {
+    std::cout << "Testing MotionEngine..." << std::endl;
+
+    const int width = 100;
+    const int height = 70;
+    const int stride = 128;
+    std::vector<uint8_t> a(stride * height);
+    std::vector<uint8_t> b(stride * height);
+    Random random(9);
+    for (size_t i = 0; i < a.size(); ++i) {
+        a[i] = static_cast<uint8_t>(random.nextUInt());
+        b[i] = static_cast<uint8_t>(random.nextUInt());
+    }
+    for (int blockSize = 16; blockSize <= 32; blockSize += 16) {
+        size_t blocks = static_cast<size_t>(width / blockSize) * (height / blockSize);
+        std::vector<uint32_t> fast(blocks);
+        std::vector<uint32_t> slow(blocks);
+        MotionKernel::blockSad(&a[0], &b[0], width, height, stride, blockSize, &fast[0]);
+        MotionKernel::blockSadScalar(&a[0], &b[0], width, height, stride, blockSize, &slow[0]);
+        assert(fast == slow);
+    }
+    assert(MotionEngine::blockThresholdForSensitivity(10) < MotionEngine::blockThresholdForSensitivity(1));
+    assert(MotionEngine::blockThresholdForSensitivity(0) == MotionEngine::blockThresholdForSensitivity(1));
+
+    WorkerPool workers(4);
+    const size_t cameraCount = 8;
+    FramePool pool(64, 320, 240);
+    FramePipeline pipeline(&pool);
+    MotionEngine engine(&workers);
+    MotionCollector collector;
+    engine.addListener(&collector);
+    std::vector<Camera*> cameras;
+    std::vector<SyntheticFrameSource*> sources;
+    std::vector<MotionDetectionStrategy*> strategies;
+    for (size_t i = 0; i < cameraCount; ++i) {
+        cameras.push_back(new Camera(static_cast<uint32_t>(i + 1), "Camera", "Hall"));
+        cameras.back()->turnOn();
+        cameras.back()->enableMotionDetection(true);
+        sources.push_back(new SyntheticFrameSource(static_cast<uint32_t>(i + 1), 48, 4));
+        sources.back()->setMoving(i % 2 == 0);
+        sources.back()->setNoise(3);
+        strategies.push_back(new MotionDetectionStrategy(8));
+        pipeline.addCamera(cameras.back(), sources.back());
+        assert(engine.addCamera(cameras.back(), strategies.back()));
+    }
+    assert(!engine.addCamera(cameras[0]));
+    pipeline.addStage(&engine, FRAME_STAGE_ANALYSIS, 16);
+    for (uint64_t now = 0; now < 2000; now += 10) {
+        pipeline.tick(now);
+        engine.dispatch();
+    }
+    engine.waitIdle();
+    engine.dispatch();
+    MotionEngineStats stats = engine.getStats();
+    assert(stats.submitted == pipeline.getStats().captured);
+    assert(stats.analyzed + stats.superseded + cameraCount == stats.submitted);
+    assert(collector.results == stats.analyzed);
+    for (size_t i = 0; i < cameraCount; ++i) {
+        if (i % 2 == 0) {
+            assert(collector.motion[i + 1] > 0);
+            assert(engine.isMotionActive(static_cast<uint32_t>(i + 1)));
+        } else {
+            assert(collector.motion[i + 1] == 0);
+        }
+    }
+
+    const size_t hdCameras = 16;
+    const int framesPerCamera = 24;
+    FramePool hdPool(hdCameras * 3 + 8, 1920, 1080);
+    MotionEngine hdEngine(&workers);
+    std::vector<Camera*> hdCams;
+    std::vector<SyntheticFrameSource*> hdSources;
+    for (size_t i = 0; i < hdCameras; ++i) {
+        hdCams.push_back(new Camera(static_cast<uint32_t>(100 + i), "HD", "Yard"));
+        hdSources.push_back(new SyntheticFrameSource(static_cast<uint32_t>(i + 1), 200, 8));
+        hdEngine.addCamera(hdCams.back());
+    }
+    uint64_t start = monotonicMicros();
+    for (int f = 0; f < framesPerCamera; ++f) {
+        for (size_t i = 0; i < hdCameras; ++i) {
+            FrameHandle frame = hdPool.acquire();
+            while (!frame.isValid()) {
+                hdEngine.waitIdle();
+                frame = hdPool.acquire();
+            }
+            frame->cameraId = hdCams[i]->getId();
+            frame->sequence = f;
+            hdSources[i]->fill(*frame.get(), 0);
+            hdEngine.submit(frame);
+        }
+    }
+    hdEngine.waitIdle();
+    uint64_t elapsed = monotonicMicros() - start;
+    MotionEngineStats hdStats = hdEngine.getStats();
+    assert(hdStats.submitted == hdCameras * framesPerCamera);
+    double seconds = elapsed / 1000000.0;
+    double kernelPixelsPerSecond = hdStats.kernelMicros > 0 ? hdStats.pixels / (hdStats.kernelMicros / 1000000.0) : 0.0;
+    std::cout << "  " << MotionKernel::getName() << " kernel, " << workers.getThreadCount() << " workers: "
+              << hdCameras << "x1080p x " << framesPerCamera << " frames in " << seconds * 1000.0 << " ms ("
+              << (hdCameras * framesPerCamera) / seconds << " fps incl. synthesis), kernel "
+              << kernelPixelsPerSecond / (1920.0 * 1080.0) << " frames/s per core" << std::endl;
+    assert(hdEngine.dispatch() == hdStats.analyzed);
+
+    for (size_t i = 0; i < cameraCount; ++i) {
+        delete cameras[i];
+        delete sources[i];
+        delete strategies[i];
+    }
+    for (size_t i = 0; i < hdCameras; ++i) {
+        delete hdCams[i];
+        delete hdSources[i];
+    }
+    std::cout << "MotionEngine tests passed!" << std::endl;
+}
+
+void testCameraRecorder() {
+    std::cout << "Testing CameraRecorder..." << std::endl;
+
+    FramePool smallPool(32, 16, 8);
+    PreRollBuffer preRoll(500, 8);
+    for (uint64_t t = 0; t < 3000; t += 100) {
+        FrameHandle frame = smallPool.acquire();
+        frame->timestamp = t;
+        preRoll.push(frame);
+    }
+    assert(preRoll.size() == 6);
+    assert(preRoll.getSpanMillis() == 500);
+    PreRollBuffer shortRoll(10000, 4);
+    for (uint64_t t = 0; t < 1000; t += 100) {
+        FrameHandle frame = smallPool.acquire();
+        frame->timestamp = t;
+        shortRoll.push(frame);
+    }
+    assert(shortRoll.size() == 4);
+    std::vector<FrameHandle> drained;
+    assert(preRoll.drain(drained) == 6);
+    assert(drained.front()->timestamp == 2400 && drained.back()->timestamp == 2900);
+    assert(preRoll.size() == 0);
+    drained.clear();
+    shortRoll.clear();
+    assert(smallPool.available() == smallPool.capacity());
+
+    const size_t cameraCount = 16;
+    const uint32_t firstId = 7001;
+    FramePool pool(cameraCount * 40 + 1024, 160, 120);
+    std::string directory = makeTempDirectory("camera_recorder");
+    SegmentConfig config;
+    config.directory = directory;
+    config.segmentMillis = 3000;
+    config.writeBlockBytes = 256 * 1024;
+    config.retention.maxSegmentsPerCamera = 3;
+    SegmentWriter writer(config);
+    assert(writer.isRunning());
+    CameraRecorder recorder(&writer, 2000, 32);
+    FramePipeline pipeline(&pool);
+    std::vector<Camera*> cameras;
+    std::vector<SyntheticFrameSource*> sources;
+    for (size_t i = 0; i < cameraCount; ++i) {
+        cameras.push_back(new Camera(firstId + static_cast<uint32_t>(i), "Camera", "Garage"));
+        cameras.back()->turnOn();
+        cameras.back()->setFPS(10);
+        sources.push_back(new SyntheticFrameSource(static_cast<uint32_t>(i + 1)));
+        pipeline.addCamera(cameras.back(), sources.back());
+        assert(recorder.addCamera(cameras.back()));
+    }
+    assert(!recorder.addCamera(cameras[0]));
+    pipeline.addStage(&recorder, FRAME_STAGE_OUTPUT, 64);
+
+    uint64_t now = 0;
+    for (; now < 5000; now += 10) {
+        pipeline.tick(now);
+    }
+    assert(recorder.getPreRollFrames(firstId) == 21);
+    assert(writer.getStats().queued == 0);
+
+    for (size_t i = 0; i < cameraCount; ++i) {
+        cameras[i]->startRecording();
+    }
+    for (; now < 5500; now += 10) {
+        pipeline.tick(now);
+    }
+    writer.flush();
+    CameraRecorderStats stats = recorder.getStats();
+    assert(stats.recordings == cameraCount);
+    assert(stats.preRollFlushed == cameraCount * 21);
+    assert(recorder.isRecording(firstId));
+    assert(recorder.getPreRollFrames(firstId) == 0);
+    std::vector<SegmentInfo> segments = writer.getSegments(firstId);
+    assert(segments.size() == 1 && segments[0].open);
+    assert(segments[0].firstTimestamp == 2900);
+
+    for (; now < 13000; now += 10) {
+        pipeline.tick(now);
+        if (now % 100 == 0) {
+            writer.flush();
+        }
+    }
+    for (size_t i = 0; i < cameraCount; ++i) {
+        cameras[i]->stopRecording();
+    }
+    for (; now < 13200; now += 10) {
+        pipeline.tick(now);
+    }
+    pipeline.drain();
+    writer.flush();
+
+    stats = recorder.getStats();
+    SegmentWriterStats writerStats = writer.getStats();
+    assert(stats.dropped == 0 && writerStats.dropped == 0);
+    assert(writerStats.written == stats.preRollFlushed + stats.liveFrames);
+    assert(writerStats.written == cameraCount * 101);
+    assert(writerStats.writeErrors == 0);
+    assert(writerStats.segmentsOpened == cameraCount * 4);
+    assert(writerStats.segmentsPruned == cameraCount);
+    assert(writerStats.writes <= writerStats.bytes / config.writeBlockBytes + writerStats.segmentsOpened);
+    assert(!recorder.isRecording(firstId));
+    assert(recorder.getPreRollFrames(firstId) > 0);
+    std::cout << "  " << writerStats.written << " frames, " << writerStats.bytes / 1024 << " KiB in "
+              << writerStats.writes << " writes, capture path "
+              << static_cast<double>(stats.processMicros) / (stats.buffered + stats.liveFrames + stats.recordings)
+              << " us/frame (max " << stats.maxProcessMicros << " us)" << std::endl;
+
+    for (size_t i = 0; i < cameraCount; ++i) {
+        segments = writer.getSegments(firstId + static_cast<uint32_t>(i));
+        assert(segments.size() == 3);
+        assert(segments[0].index == 1);
+        uint64_t expectedSequence = 0;
+        for (size_t s = 0; s < segments.size(); ++s) {
+            assert(!segments[s].open);
+            std::vector<SegmentFrameHeader> frames;
+            assert(SegmentWriter::readSegment(segments[s].path, frames));
+            assert(frames.size() == segments[s].frames);
+            for (size_t f = 0; f < frames.size(); ++f) {
+                assert(frames[f].cameraId == firstId + i);
+                assert(frames[f].width == 160 && frames[f].height == 120);
+                if (s > 0 || f > 0) {
+                    assert(frames[f].sequence == expectedSequence + 1);
+                }
+                expectedSequence = frames[f].sequence;
+            }
+        }
+    }
+
+    assert(recorder.removeCamera(firstId));
+    assert(!recorder.removeCamera(firstId));
+    writer.stop();
+    assert(!writer.isRunning());
+    assert(!writer.write(pool.acquire()));
+
+    std::vector<SegmentInfo> previous = writer.getSegments(firstId);
+    {
+        SegmentWriter restarted(config);
+        FrameHandle frame = pool.acquire();
+        frame->cameraId = firstId;
+        frame->timestamp = 20000;
+        assert(restarted.write(frame));
+        restarted.flush();
+        segments = restarted.getSegments(firstId);
+        assert(segments.size() == 4);
+        assert(segments[0].index == 1 && segments[0].frames == previous[0].frames);
+        assert(segments[2].lastTimestamp == previous[2].lastTimestamp);
+        assert(segments[3].index == 4 && segments[3].open);
+        std::vector<SegmentFrameHeader> frames;
+        assert(SegmentWriter::readSegment(previous[2].path, frames));
+        assert(frames.size() == previous[2].frames);
+    }
+    std::vector<SegmentFrameHeader> pruned;
+    assert(!SegmentWriter::readSegment(previous[0].path, pruned));
+    assert(removeTempDirectory(directory));
+    for (size_t i = 0; i < cameraCount; ++i) {
+        delete cameras[i];
+        delete sources[i];
+    }
+    std::cout << "CameraRecorder tests passed!" << std::endl;
+}
+
+class StreamViewer : public IRunnable {
+public:
+    StreamViewer(StreamSubscription* subscription, AtomicCounter* stop)
+        : m_subscription(subscription), m_stop(stop), m_frames(0) {}
+    virtual void run() {
+        FrameHandle frame;
+        while (m_stop->get() == 0 || m_subscription->pending() > 0) {
+            if (m_subscription->poll(frame)) {
+                ++m_frames;
+            }
+        }
+    }
+    uint64_t getFrames() const { return m_frames; }
+
+private:
+    StreamSubscription* m_subscription;
+    AtomicCounter* m_stop;
+    uint64_t m_frames;
+};
+
+void testStreamingHub() {
+    std::cout << "Testing StreamingHub..." << std::endl;
+
+    const size_t subscriberCount = 50;
+    const size_t depth = 4;
+    Camera camera(8001, "Porch Camera", "Porch");
+    camera.turnOn();
+    camera.setFPS(30);
+    camera.startStreaming();
+    SyntheticFrameSource source(3);
+    FramePool pool(16, 320, 240);
+    FramePipeline pipeline(&pool);
+    StreamingHub hub(depth);
+    pipeline.addCamera(&camera, &source);
+    pipeline.addStage(&hub, FRAME_STAGE_OUTPUT, 2);
+
+    const char* kinds[] = { "ui", "recorder", "analytics", "socket", "thumbnail" };
+    std::vector<StreamSubscription*> subscriptions;
+    std::vector<uint64_t> periods;
+    for (size_t i = 0; i < subscriberCount; ++i) {
+        std::ostringstream name;
+        name << kinds[i % 5] << "-" << i;
+        subscriptions.push_back(hub.subscribe(camera.getId(), name.str()));
+        periods.push_back(10 * (1 + i % 5));
+    }
+    assert(hub.getSubscriberCount(camera.getId()) == subscriberCount);
+    assert(hub.getSubscriberCount(9999) == 0);
+
+    for (uint64_t now = 0; now < 10000; now += 10) {
+        pipeline.tick(now);
+        for (size_t i = 0; i < subscriberCount; ++i) {
+            if (now % periods[i] == 0) {
+                FrameHandle frame;
+                subscriptions[i]->poll(frame);
+            }
+        }
+    }
+    pipeline.drain();
+
+    StreamingHubStats hubStats = hub.getStats();
+    assert(hubStats.published == pipeline.getStats().captured);
+    assert(hubStats.published == 300);
+    assert(hubStats.deliveries == hubStats.published * subscriberCount);
+    assert(pool.getStats().exhausted == 0);
+    assert(pool.getStats().highWater <= depth + 4);
+
+    std::vector<StreamSubscriberStats> stats = hub.getSubscriberStats();
+    assert(stats.size() == subscriberCount);
+    for (size_t i = 0; i < subscriberCount; ++i) {
+        const StreamSubscriberStats& s = stats[i];
+        assert(s.delivered == hubStats.published);
+        assert(s.consumed + s.skipped + s.queued == s.delivered);
+        assert(s.maxLagFrames < depth);
+        if (periods[i] <= 30) {
+            assert(s.skipped == 0);
+        } else {
+            assert(s.skipped > 0);
+            assert(s.maxLagFrames > 0);
+        }
+    }
+
+    FrameHandle shared = pool.acquire();
+    shared->cameraId = camera.getId();
+    shared->sequence = 1000;
+    assert(hub.publish(shared) == subscriberCount);
+    assert(shared.useCount() == static_cast<long>(subscriberCount) + 1);
+    for (size_t i = 0; i < subscriberCount; ++i) {
+        FrameHandle frame;
+        while (subscriptions[i]->poll(frame)) {
+        }
+        assert(frame.get() == shared.get());
+    }
+    assert(shared.useCount() == 1);
+    shared.reset();
+
+    assert(hub.unsubscribe(subscriptions[0]));
+    assert(!hub.unsubscribe(subscriptions[0]));
+    subscriptions.erase(subscriptions.begin());
+    assert(hub.getSubscriberCount() == subscriberCount - 1);
+
+    AtomicCounter stop(0);
+    std::vector<StreamViewer*> viewers;
+    std::vector<Thread*> threads;
+    for (size_t i = 0; i < 8; ++i) {
+        viewers.push_back(new StreamViewer(subscriptions[i], &stop));
+        threads.push_back(new Thread(viewers.back()));
+        assert(threads.back()->start());
+    }
+    std::vector<StreamSubscriberStats> before = hub.getSubscriberStats();
+    for (uint64_t sequence = 2000; sequence < 4000; ++sequence) {
+        FrameHandle frame = pool.acquire();
+        assert(frame.isValid());
+        frame->cameraId = camera.getId();
+        frame->sequence = sequence;
+        hub.publish(frame);
+        if (sequence % 8 == 0) {
+            for (size_t i = 8; i < subscriptions.size(); ++i) {
+                FrameHandle drained;
+                while (subscriptions[i]->poll(drained)) {
+                }
+            }
+        }
+    }
+    stop.set(1);
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->join();
+        StreamSubscriberStats s = subscriptions[i]->getStats();
+        assert(s.delivered - before[i].delivered == 2000);
+        assert(viewers[i]->getFrames() == s.consumed - before[i].consumed);
+        assert(s.consumed + s.skipped == s.delivered);
+        delete threads[i];
+        delete viewers[i];
+    }
+    std::cout << "StreamingHub tests passed!" << std::endl;
+}
+
 int main() {
     std::cout << "=== MySweetHome Device Tests ===" << std::endl << std::endl;
 
@@ -151,6 +1523,21 @@ int main() {
     testDetector();
     testTV();
     testAlarm();
+    testThresholdKernel();
+    testSensorPipeline();
+    testSensorPipelineThroughput();
+    testSlidingWindow();
+    testAveragingStrategy();
+    testTimeSeriesRoundTrip();
+    testTimeSeriesRetentionAndSpill();
+    testTimeSeriesFootprint();
+    testSamplingScheduler();
+    testStaticStrategies();
+    testFleetAnomalyDetector();
+    testFramePipeline();
+    testMotionEngine();
+    testCameraRecorder();
+    testStreamingHub();
 
     std::cout << std::endl << "All tests passed!" << std::endl;
     return 0;
@@ -2,6 +2,31 @@
 #include <cassert>
 #include "common_types.h"
 #include "SmartHome.h"
+#include "SecurityManager.h"
+#include "Clock.h"
+#include "Light.h"
+#include "Camera.h"
+#include "DetectorFactory.h"
+#include "FusionEngine.h"
+#include "SecurityColleague.h"
+#include "SceneEngine.h"
+#include "RuleEngine.h"
+#include "AutomationScheduler.h"
+#include "CommandInvoker.h"
+#include "TerminalRenderer.h"
+#include "Logger.h"
+#include "DeviceProxy.h"
+#include "DeviceImpl.h"
+#include "Tracer.h"
+#include "TV.h"
+#include "SoundSystem.h"
+#include "Alarm.h"
+#include "Random.h"
+#include "MonotonicTime.h"
+#include <sstream>
+#include <vector>
+#include <fstream>
+#include <cstdio>
 
 using namespace MySweetHome;
 
@@ -80,12 +105,940 @@ void testStateManagement() {
     std::cout << "State Management tests passed!" << std::endl;
 }
 
+void testHealthMonitorDeviceRemoval() {
+    std::cout << "Testing HealthMonitor device removal..." << std::endl;
+
+    SmartHome smartHome;
+    Device* light = smartHome.addLight("Monitored Light", "Hall");
+    Device* kept = smartHome.addLight("Kept Light", "Hall");
+    kept->turnOn();
+    SimulatedDeviceImpl removedImpl;
+    SimulatedDeviceImpl keptImpl;
+    removedImpl.connect();
+    keptImpl.connect();
+    HealthMonitor& monitor = smartHome.getHealthMonitor();
+    monitor.setMaxMisses(2);
+    monitor.registerImpl(&removedImpl, light);
+    monitor.registerImpl(&keptImpl, kept);
+
+    assert(smartHome.removeDevice(light->getId()));
+    assert(monitor.unregisterDevice(light) == 0);
+    removedImpl.simulateFailure();
+    keptImpl.simulateFailure();
+    assert(monitor.sweep().degraded == 2);
+    HealthSweepStats stats = monitor.sweep();
+    assert(stats.newlyFailed == 2);
+    assert(kept->getStatus() == STATUS_ERROR);
+    assert(monitor.size() == 2);
+
+    std::cout << "HealthMonitor device removal tests passed!" << std::endl;
+}
+
+class ScriptedKeyInput : public IKeyInput {
+public:
+    explicit ScriptedKeyInput(int pressAfter = -1) : polls(0), m_pressAfter(pressAfter) {}
+    virtual bool keyPressed() {
+        ++polls;
+        return m_pressAfter >= 0 && polls > m_pressAfter;
+    }
+    int polls;
+
+private:
+    int m_pressAfter;
+};
+
+void testSecuritySequenceVirtualClock() {
+    std::cout << "Testing SecurityManager with virtual clock..." << std::endl;
+
+    SmartHome smartHome;
+    smartHome.addLight("Light 1", "Living Room");
+    smartHome.addAlarm("Alarm 1", "Main Entry");
+    SecurityManager* security = smartHome.getSecurityManager();
+    ManualClock clock;
+    ScriptedKeyInput silent;
+    security->setClock(&clock);
+    security->setKeyInput(&silent);
+    assert(&security->getClock() == &clock);
+
+    security->handleSmokeDetected();
+    assert(!security->isSequenceActive());
+    assert(clock.getSleptMicros() >= 1000000ULL);
+    assert(clock.getSleptMicros() <= 20000000ULL);
+
+    uint64_t before = clock.nowMillis();
+    int polls = silent.polls;
+    assert(!security->waitForAcknowledgment(3600));
+    assert(clock.nowMillis() - before >= 3600ULL * 1000ULL);
+    assert(silent.polls - polls == 36000);
+    assert(!security->isAlarmAcknowledged());
+
+    ScriptedKeyInput pressed(5);
+    security->setKeyInput(&pressed);
+    before = clock.nowMillis();
+    assert(security->waitForAcknowledgment(3600));
+    assert(clock.nowMillis() - before == 500);
+    assert(security->isAlarmAcknowledged());
+    security->setKeyInput(0);
+
+    std::cout << "SecurityManager virtual clock tests passed!" << std::endl;
+}
+
+class IncidentCollector : public IFusionListener {
+public:
+    virtual void onIncident(const FusionIncident& incident) {
+        incidents.push_back(incident);
+    }
+    std::vector<FusionIncident> incidents;
+};
+
+void testFusionEngine() {
+    std::cout << "Testing FusionEngine..." << std::endl;
+
+    const uint32_t rooms = 50;
+    StandardDetectorFactory factory;
+    std::vector<IDetectorFactory::DetectorPair> pairs;
+    std::vector<Camera*> cameras;
+    FusionEngine fusion;
+    IncidentCollector collector;
+    fusion.addListener(&collector);
+    for (uint32_t r = 0; r < rooms; ++r) {
+        std::ostringstream room;
+        room << "Room " << r;
+        pairs.push_back(factory.createDetectorPair(r * 3 + 1, "Detector", room.str()));
+        cameras.push_back(new Camera(r * 3 + 3, "Camera", room.str()));
+        fusion.registerDetectorPair(pairs.back());
+        assert(fusion.registerCamera(cameras.back()));
+    }
+    assert(!fusion.registerDetector(pairs[0].smoke));
+    assert(fusion.getStats().locations == rooms);
+
+    Random random(5);
+    uint64_t now = 1000;
+    for (int second = 0; second < 600; ++second, now += 1000) {
+        for (uint32_t r = 0; r < rooms; ++r) {
+            float smokeValue = random.nextBool(0.003) ? pairs[r].smoke->getThreshold() * 2.0f : 5.0f;
+            fusion.addReading(pairs[r].smoke->getId(), smokeValue, now);
+            fusion.addReading(pairs[r].gas->getId(), 5.0f, now);
+            if (random.nextBool(0.05)) {
+                fusion.reportMotion(cameras[r]->getId(), now);
+            }
+        }
+        fusion.evaluate(now);
+    }
+    FusionStats stats = fusion.getStats();
+    assert(stats.incidents == 0);
+    assert(collector.incidents.empty());
+    assert(stats.triggeringReadings > 0);
+    assert(stats.readings == 600ULL * rooms * 2);
+
+    for (int second = 0; second < 180; ++second) {
+        now += 1000;
+        fusion.evaluate(now);
+    }
+    assert(fusion.getStats().activeLocations == 0);
+
+    uint64_t fireStart = now;
+    while (collector.incidents.empty() && now - fireStart < 60000) {
+        now += 1000;
+        fusion.addReading(pairs[7].smoke->getId(), pairs[7].smoke->getThreshold() * 1.2f, now);
+        fusion.addReading(pairs[7].gas->getId(), pairs[7].gas->getThreshold() * 1.2f, now);
+        fusion.evaluate(now);
+    }
+    assert(collector.incidents.size() == 1);
+    assert(collector.incidents[0].location == "Room 7");
+    assert(collector.incidents[0].type == ALARM_FIRE);
+    assert(now - fireStart <= 5000);
+    assert(fusion.isIncidentActive("Room 7"));
+    assert(fusion.getStats().activeLocations == 1);
+
+    uint64_t gasStart = now;
+    while (collector.incidents.size() == 1 && now - gasStart < 60000) {
+        now += 1000;
+        fusion.addReading(pairs[9].gas->getId(), pairs[9].gas->getThreshold() * 1.5f, now);
+        fusion.evaluate(now);
+    }
+    assert(collector.incidents.size() == 2);
+    assert(collector.incidents[1].type == ALARM_GAS_LEAK);
+    assert(now - gasStart > 2000);
+
+    for (int second = 0; second < 300; ++second) {
+        now += 1000;
+        fusion.evaluate(now);
+    }
+    assert(!fusion.isIncidentActive("Room 7"));
+    assert(fusion.getStats().activeLocations == 0);
+
+    SmartHome smartHome;
+    smartHome.addLight("Light 1", "Living Room");
+    smartHome.addAlarm("Alarm 1", "Main Entry");
+    SecurityManager* security = smartHome.getSecurityManager();
+    ManualClock clock;
+    security->setClock(&clock);
+    fusion.setSecurityManager(security);
+    for (int second = 0; second < 10; ++second) {
+        now += 1000;
+        fusion.addReading(pairs[11].smoke->getId(), pairs[11].smoke->getThreshold() * 3.0f, now);
+    }
+    assert(fusion.getStats().incidents == 3);
+    assert(clock.getSleptMicros() > 0);
+    fusion.setSecurityManager(0);
+
+    for (uint32_t r = 0; r < rooms; ++r) {
+        delete pairs[r].smoke;
+        delete pairs[r].gas;
+        delete cameras[r];
+    }
+    std::cout << "FusionEngine tests passed!" << std::endl;
+}
+
+void testCameraMotionReports() {
+    std::cout << "Testing camera motion reports..." << std::endl;
+
+    Camera hall(501, "Hall Camera", "Hall");
+    Camera yard(502, "Yard Camera", "Yard");
+    hall.enableMotionDetection(true);
+    CameraColleague colleague;
+    colleague.addCamera(&hall);
+    colleague.addCamera(&yard);
+
+    MotionResult result = MotionResult();
+    result.cameraId = 501;
+    result.motion = true;
+    colleague.onMotion(result);
+    colleague.onMotion(result);
+    assert(colleague.getMotionReports() == 1);
+    result.motion = false;
+    colleague.onMotion(result);
+    result.motion = true;
+    colleague.onMotion(result);
+    assert(colleague.getMotionReports() == 2);
+
+    result.cameraId = 502;
+    colleague.onMotion(result);
+    assert(colleague.getMotionReports() == 2);
+    result.cameraId = 999;
+    colleague.onMotion(result);
+    assert(colleague.getMotionReports() == 2);
+
+    std::cout << "Camera motion report tests passed!" << std::endl;
+}
+
+void testSceneEngine() {
+    std::cout << "Testing SceneEngine..." << std::endl;
+
+    SmartHome smartHome;
+    Device* light = smartHome.addLight("Light 1", "Living Room");
+    Device* tv = smartHome.addSamsungTV("Living Room");
+    Device* sound = smartHome.addSoundSystem("Speaker", "Living Room");
+    Device* alarm = smartHome.addAlarm("Alarm 1", "Main Entry");
+    alarm->turnOff();
+    smartHome.setMode(MODE_CINEMA);
+    assert(!light->isOn() && tv->isOn() && !sound->isOn() && alarm->isOn());
+    smartHome.setMode(MODE_PARTY);
+    assert(light->isOn() && !tv->isOn() && sound->isOn());
+    assert(smartHome.getLastSceneResult().commands == 3);
+    smartHome.setMode(MODE_PARTY);
+    assert(smartHome.getLastSceneResult().commands == 0);
+
+    ModeManager modes;
+    const bool lights[] = { true, false, true, false };
+    const bool tvs[] = { false, false, false, true };
+    const bool music[] = { false, false, true, false };
+    for (int mode = MODE_NORMAL; mode <= MODE_CINEMA; ++mode) {
+        modes.setMode(static_cast<SystemMode>(mode));
+        assert(modes.shouldLightBeOn() == lights[mode]);
+        assert(modes.shouldTVBeOn() == tvs[mode]);
+        assert(modes.shouldMusicBeOn() == music[mode]);
+    }
+    Scene dimCinema(ModeManager::getModeName(MODE_CINEMA));
+    dimCinema.forType(DEVICE_LIGHT, DeviceTarget().setPower(true).setBrightness(10))
+        .forType(DEVICE_TV, DeviceTarget().setPower(true).setVolume(35));
+    modes.defineScene(dimCinema);
+    assert(modes.shouldLightBeOn() && modes.shouldTVBeOn());
+    smartHome.defineScene(dimCinema);
+    smartHome.setMode(MODE_CINEMA);
+    assert(light->isOn() && static_cast<Light*>(light)->getBrightness() == 10);
+    assert(static_cast<TV*>(tv)->getVolume() == 35);
+    assert(!smartHome.applyScene("Missing"));
+
+    const int rooms = 50;
+    std::vector<Device*> devices;
+    uint32_t nextId = 1;
+    for (int room = 0; room < rooms; ++room) {
+        std::ostringstream location;
+        location << "Room " << room;
+        for (int i = 0; i < 90; ++i) {
+            devices.push_back(new Light(nextId++, "Light", location.str()));
+        }
+        for (int i = 0; i < 5; ++i) {
+            devices.push_back(new TV(nextId++, "TV", location.str()));
+            devices.push_back(new SoundSystem(nextId++, "Speaker", location.str()));
+        }
+    }
+    devices.push_back(new Alarm(nextId++, "Alarm", "Hall"));
+
+    SceneEngine engine;
+    Scene relax("Relax");
+    relax.forType(DEVICE_LIGHT, DeviceTarget().setPower(true).setBrightness(60).setColor(255, 180, 120))
+        .forType(DEVICE_TV, DeviceTarget().setPower(false))
+        .forType(DEVICE_SOUND_SYSTEM, DeviceTarget().setPower(true).setVolume(20).setSource("Radio"));
+    Scene reading("Reading");
+    reading.forType(DEVICE_LIGHT, DeviceTarget().setPower(true).setBrightness(60).setColor(255, 180, 120))
+        .forType(DEVICE_TV, DeviceTarget().setPower(false))
+        .forType(DEVICE_SOUND_SYSTEM, DeviceTarget().setPower(true).setVolume(20).setSource("Radio"))
+        .forTypeInLocation(DEVICE_LIGHT, "Room 7", DeviceTarget().setBrightness(100).setColor(255, 255, 255))
+        .forDevice(devices[0]->getId(), DeviceTarget().setPower(false));
+    engine.defineScene(relax);
+    engine.defineScene(reading);
+    assert(engine.getSceneNames().size() == 2);
+
+    SceneApplyResult result;
+    assert(engine.apply("Relax", devices, &result));
+    assert(result.compiled && result.devices == devices.size());
+    assert(result.devicesChanged == static_cast<size_t>(rooms * 95 + 1));
+    assert(engine.apply("Relax", devices, &result));
+    assert(!result.compiled && result.devicesChanged == 0 && result.commands == 0);
+
+    uint64_t start = monotonicMicros();
+    assert(engine.apply("Reading", devices, &result));
+    assert(result.devicesChanged == 91 && result.commands == 181);
+    assert(engine.apply("Relax", devices, &result));
+    uint64_t elapsed = monotonicMicros() - start;
+    assert(result.devicesChanged == 91 && result.commands == 181);
+    assert(engine.getCompileCount() == 2);
+    std::cout << "  " << devices.size() << " devices, similar scene switch touched " << result.devicesChanged
+              << " devices (" << elapsed / 2 << " us per switch incl. compile)" << std::endl;
+
+    devices.push_back(new Light(nextId++, "Light", "Room 7"));
+    assert(engine.apply("Reading", devices, &result));
+    assert(result.compiled && result.devicesChanged == 92);
+    assert(engine.getCompileCount() == 3);
+
+    for (size_t i = 0; i < devices.size(); ++i) {
+        delete devices[i];
+    }
+    std::cout << "SceneEngine tests passed!" << std::endl;
+}
+
+bool ruleMatchesNaively(const RuleDefinition& rule, const RuleEvent& event, SystemMode mode) {
+    bool triggered = false;
+    for (size_t i = 0; i < rule.triggers.size() && !triggered; ++i) {
+        const RuleTrigger& trigger = rule.triggers[i];
+        if (trigger.eventType != event.type) {
+            continue;
+        }
+        if (trigger.deviceId != 0) {
+            triggered = trigger.deviceId == event.deviceId;
+        } else if (!trigger.location.empty()) {
+            triggered = trigger.location == event.location;
+        } else {
+            triggered = true;
+        }
+    }
+    if (!triggered) {
+        return false;
+    }
+    for (size_t i = 0; i < rule.conditions.size(); ++i) {
+        const RuleCondition& condition = rule.conditions[i];
+        if (condition.kind == CONDITION_MODE_IS && condition.mode != mode) {
+            return false;
+        }
+        if (condition.kind == CONDITION_VALUE_ABOVE && !(event.value > condition.threshold)) {
+            return false;
+        }
+        if (condition.kind == CONDITION_VALUE_BELOW && !(event.value < condition.threshold)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void testRuleEngine() {
+    std::cout << "Testing RuleEngine..." << std::endl;
+
+    SmartHome smartHome;
+    Light* hallLight = static_cast<Light*>(smartHome.addLight("Hall Light", "Hallway"));
+    Device* tv = smartHome.addSamsungTV("Living Room");
+    Device* speaker = smartHome.addSoundSystem("Speaker", "Living Room");
+    RuleEngine& rules = smartHome.getRuleEngine();
+    uint32_t hallRule = rules.addRule(RuleDefinition("Hallway night light")
+        .when(RuleTrigger(RULE_EVENT_MOTION, 0, "Hallway"))
+        .onlyIf(RuleCondition::modeIs(MODE_EVENING))
+        .then(RuleAction::forLocation("Hallway", DEVICE_LIGHT, DeviceTarget().setPower(true).setBrightness(30))));
+    uint32_t cinemaRule = rules.addRule(RuleDefinition("TV starts cinema")
+        .when(RuleTrigger(RULE_EVENT_DEVICE_ON, tv->getId()))
+        .then(RuleAction::applyScene("Sinema")));
+    uint32_t loudRule = rules.addRule(RuleDefinition("Noise lowers music")
+        .when(RuleTrigger(RULE_EVENT_SENSOR_VALUE, 900))
+        .onlyIf(RuleCondition::valueAbove(70.0f))
+        .onlyIf(RuleCondition::deviceOn(speaker->getId()))
+        .then(RuleAction::forDevice(speaker->getId(), DeviceTarget().setVolume(10)))
+        .cooldown(1000));
+    assert(hallRule != 0 && cinemaRule != 0 && loudRule != 0);
+    assert(rules.addRule(RuleDefinition("Empty")) == 0);
+
+    RuleEvent hallMotion(RULE_EVENT_MOTION, 0, "Hallway");
+    assert(smartHome.postEvent(hallMotion) == 0);
+    smartHome.setMode(MODE_EVENING);
+    assert(!hallLight->isOn());
+    assert(smartHome.postEvent(hallMotion) == 1);
+    assert(hallLight->isOn() && hallLight->getBrightness() == 30);
+    assert(smartHome.postEvent(RuleEvent(RULE_EVENT_MOTION, 0, "Kitchen")) == 0);
+
+    smartHome.powerOnDevice(tv->getId());
+    assert(rules.getFireCount(cinemaRule) == 1);
+    assert(!hallLight->isOn());
+
+    speaker->turnOn();
+    static_cast<SoundSystem*>(speaker)->setVolume(80);
+    assert(smartHome.postEvent(RuleEvent(RULE_EVENT_SENSOR_VALUE, 900, "", 50.0f, 0)) == 0);
+    assert(smartHome.postEvent(RuleEvent(RULE_EVENT_SENSOR_VALUE, 900, "", 85.0f, 100)) == 1);
+    assert(static_cast<SoundSystem*>(speaker)->getVolume() == 10);
+    assert(smartHome.postEvent(RuleEvent(RULE_EVENT_SENSOR_VALUE, 900, "", 85.0f, 600)) == 0);
+    assert(rules.getStats().suppressed == 1);
+    assert(smartHome.postEvent(RuleEvent(RULE_EVENT_SENSOR_VALUE, 900, "", 85.0f, 1200)) == 1);
+    speaker->turnOff();
+    assert(smartHome.postEvent(RuleEvent(RULE_EVENT_SENSOR_VALUE, 900, "", 85.0f, 5000)) == 0);
+
+    RuleEventBridge& bridge = smartHome.getEventBridge();
+    SensorEvent reading = SensorEvent();
+    reading.detectorId = 900;
+    reading.detectorType = DETECTOR_SMOKE;
+    reading.value = 90.0f;
+    reading.timestamp = 7000;
+    speaker->turnOn();
+    static_cast<SoundSystem*>(speaker)->setVolume(80);
+    bridge.onSensorEvent(reading);
+    assert(static_cast<SoundSystem*>(speaker)->getVolume() == 10);
+
+    Device* hallCamera = smartHome.addCamera("Hall Camera", "Hallway");
+    hallLight->turnOff();
+    MotionResult motion = MotionResult();
+    motion.cameraId = hallCamera->getId();
+    motion.motion = true;
+    motion.changedPercent = 12.0f;
+    motion.timestamp = 8000;
+    bridge.onMotion(motion);
+    assert(hallLight->isOn() && hallLight->getBrightness() == 30);
+    hallLight->turnOff();
+    bridge.onMotion(motion);
+    assert(!hallLight->isOn());
+    motion.motion = false;
+    bridge.onMotion(motion);
+    motion.motion = true;
+    bridge.onMotion(motion);
+    assert(hallLight->isOn());
+
+    CameraColleague colleague;
+    colleague.setEventBridge(&bridge);
+    static_cast<Camera*>(hallCamera)->enableMotionDetection(true);
+    colleague.addCamera(static_cast<Camera*>(hallCamera));
+    hallLight->turnOff();
+    colleague.onMotion(motion);
+    assert(colleague.getMotionReports() == 1 && hallLight->isOn());
+
+    SecurityManager* security = smartHome.getSecurityManager();
+    ManualClock clock;
+    ScriptedKeyInput silent;
+    security->setClock(&clock);
+    security->setKeyInput(&silent);
+    uint64_t hallFires = rules.getFireCount(hallRule);
+    security->handleMotionDetected("Hallway");
+    assert(rules.getFireCount(hallRule) == hallFires + 1);
+    security->setClock(0);
+    security->setKeyInput(0);
+    assert(bridge.getPostedCount() == 4);
+
+    assert(rules.setRuleEnabled(hallRule, false));
+    assert(smartHome.postEvent(hallMotion) == 0);
+    assert(rules.removeRule(hallRule));
+    assert(!rules.removeRule(hallRule));
+    assert(rules.getRuleCount() == 2);
+
+    const int locations = 100;
+    const int lightsPerLocation = 10;
+    const int ruleCount = 5000;
+    std::vector<Device*> devices;
+    std::vector<std::string> names;
+    for (int l = 0; l < locations; ++l) {
+        std::ostringstream name;
+        name << "Zone " << l;
+        names.push_back(name.str());
+        for (int i = 0; i < lightsPerLocation; ++i) {
+            devices.push_back(new Light(static_cast<uint32_t>(devices.size() + 1), "Light", name.str()));
+        }
+    }
+    RuleEngine engine;
+    engine.attachDevices(&devices);
+    Random random(43);
+    std::vector<RuleDefinition> definitions;
+    for (int r = 0; r < ruleCount; ++r) {
+        RuleDefinition definition;
+        if (random.nextInt(0, 9) < 6) {
+            definition.when(RuleTrigger(RULE_EVENT_MOTION, 0, names[random.nextInt(0, locations - 1)]))
+                .onlyIf(RuleCondition::modeIs(static_cast<SystemMode>(random.nextInt(MODE_NORMAL, MODE_CINEMA))))
+                .then(RuleAction::forLocation(names[random.nextInt(0, locations - 1)], DEVICE_LIGHT,
+                    DeviceTarget().setPower(true).setBrightness(static_cast<uint8_t>(random.nextInt(10, 100)))));
+        } else {
+            uint32_t sensor = static_cast<uint32_t>(random.nextInt(1, static_cast<int>(devices.size())));
+            uint32_t target = static_cast<uint32_t>(random.nextInt(1, static_cast<int>(devices.size())));
+            definition.when(RuleTrigger(RULE_EVENT_SENSOR_VALUE, sensor))
+                .onlyIf(RuleCondition::valueAbove(static_cast<float>(random.nextInt(0, 100))))
+                .then(RuleAction::forDevice(target, DeviceTarget().setPower(random.nextBool(0.5))));
+        }
+        definitions.push_back(definition);
+        assert(engine.addRule(definition) == static_cast<uint32_t>(r + 1));
+    }
+
+    const int eventCount = 100000;
+    uint64_t expectedFires = 0;
+    uint64_t actualFires = 0;
+    uint64_t start = monotonicMicros();
+    for (int e = 0; e < eventCount; ++e) {
+        if (e % 10000 == 0) {
+            engine.setMode(static_cast<SystemMode>((e / 10000) % 4));
+            engine.resetStats();
+        }
+        RuleEvent event;
+        if (random.nextBool(0.5)) {
+            event = RuleEvent(RULE_EVENT_MOTION, 0, names[random.nextInt(0, locations - 1)]);
+        } else {
+            event = RuleEvent(RULE_EVENT_SENSOR_VALUE, static_cast<uint32_t>(random.nextInt(1, 1000)), "",
+                              random.nextFloat() * 100.0f);
+        }
+        if (e % 50 == 0) {
+            for (size_t r = 0; r < definitions.size(); ++r) {
+                if (ruleMatchesNaively(definitions[r], event, engine.getMode())) {
+                    ++expectedFires;
+                }
+            }
+            actualFires += engine.post(event);
+        } else {
+            engine.post(event);
+        }
+    }
+    uint64_t elapsed = monotonicMicros() - start;
+    RuleEngineStats stats = engine.getStats();
+    assert(actualFires == expectedFires);
+    assert(expectedFires > 0);
+    double candidatesPerEvent = static_cast<double>(stats.candidates) / stats.events;
+    double averageMicros = static_cast<double>(stats.totalMicros) / stats.events;
+    assert(candidatesPerEvent < ruleCount / 100.0);
+    std::cout << "  " << ruleCount << " rules: " << candidatesPerEvent << " candidate rules/event, "
+              << averageMicros << " us avg, " << stats.maxMicros << " us max, "
+              << (eventCount * 1000000.0) / elapsed << " events/s incl. naive cross-check" << std::endl;
+
+    for (size_t i = 0; i < devices.size(); ++i) {
+        delete devices[i];
+    }
+    std::cout << "RuleEngine tests passed!" << std::endl;
+}
+
+class FiringRecorder : public IScheduleListener {
+public:
+    virtual void onScheduleFired(const ScheduleFiring& firing) {
+        firings.push_back(firing);
+    }
+
+    std::vector<ScheduleFiring> firings;
+};
+
+void testAutomationScheduler() {
+    std::cout << "Testing AutomationScheduler..." << std::endl;
+
+    const int offset = 3 * 3600;
+    SmartHome smartHome;
+    Light* livingLight = static_cast<Light*>(smartHome.addLight("Living Light", "Living Room"));
+    Light* bedLight = static_cast<Light*>(smartHome.addLight("Bed Light", "Bedroom"));
+    AutomationScheduler& scheduler = smartHome.getScheduler();
+    int hostOffset = AutomationScheduler::hostUtcOffset(ClockProvider::getClock().wallTime());
+    assert(scheduler.getUtcOffset() == hostOffset);
+    assert(hostOffset >= -14 * 3600 && hostOffset <= 14 * 3600);
+    FiringRecorder recorder;
+    scheduler.setListener(&recorder);
+    scheduler.setUtcOffset(offset);
+    scheduler.addHoliday(2026, 10, 29);
+
+    time_t now = static_cast<time_t>(secondsFromCivil(2026, 10, 16, 12, 0) - offset);
+    std::vector<uint32_t> lights;
+    lights.push_back(livingLight->getId());
+    lights.push_back(bedLight->getId());
+    uint32_t evening = scheduler.addSchedule(ScheduleDefinition("Evening", "0 19 * * MON-FRI",
+        ScheduleAction::setMode(MODE_EVENING)).withHolidays(true).withCatchUp(CATCH_UP_ONCE, 3600), now);
+    uint32_t lightsOff = scheduler.addSchedule(ScheduleDefinition("Lights off", "0 1 * * *",
+        ScheduleAction::devices(lights, DeviceTarget().setPower(false))), now);
+    uint32_t bedroom = scheduler.addSchedule(ScheduleDefinition("Bedroom wake", "30 7 * * *",
+        ScheduleAction::typeInLocation(DEVICE_LIGHT, "Bedroom", DeviceTarget().setPower(true).setBrightness(40)))
+        .withCatchUp(CATCH_UP_SKIP).exclude(2026, 10, 18), now);
+    uint32_t hourly = scheduler.addSchedule(ScheduleDefinition("Hourly scene", "@hourly",
+        ScheduleAction::applyScene("Normal")).withCatchUp(CATCH_UP_ALL), now);
+    assert(evening != 0 && lightsOff != 0 && bedroom != 0 && hourly != 0);
+    assert(scheduler.addSchedule(ScheduleDefinition("Broken", "61 * * * *"), now) == 0);
+    assert(scheduler.getScheduleCount() == 4);
+    assert(scheduler.getNextFireTime(evening) == secondsFromCivil(2026, 10, 16, 19, 0) - offset);
+    assert(scheduler.getNextFireTime(lightsOff) == secondsFromCivil(2026, 10, 17, 1, 0) - offset);
+    assert(scheduler.getNextFireTime(bedroom) == secondsFromCivil(2026, 10, 17, 7, 30) - offset);
+    assert(scheduler.getNextDue() == secondsFromCivil(2026, 10, 16, 13, 0) - offset);
+    assert(scheduler.removeSchedule(hourly));
+    assert(!scheduler.removeSchedule(hourly));
+    assert(scheduler.getNextDue() == secondsFromCivil(2026, 10, 16, 13, 0) - offset);
+    assert(scheduler.tick(secondsFromCivil(2026, 10, 16, 13, 0) - offset) == 0);
+
+    smartHome.powerOnDevice(livingLight->getId());
+    smartHome.powerOnDevice(bedLight->getId());
+    assert(scheduler.tick(secondsFromCivil(2026, 10, 16, 18, 59) - offset) == 0);
+    assert(scheduler.tick(secondsFromCivil(2026, 10, 16, 19, 0, 5) - offset) == 1);
+    assert(smartHome.getCurrentMode() == MODE_EVENING);
+    assert(recorder.firings.back().scheduleId == evening && !recorder.firings.back().catchUp);
+    assert(scheduler.getNextFireTime(evening) == secondsFromCivil(2026, 10, 19, 19, 0) - offset);
+
+    assert(scheduler.tick(secondsFromCivil(2026, 10, 17, 1, 0, 30) - offset) == 1);
+    assert(!livingLight->isOn() && !bedLight->isOn());
+    assert(scheduler.tick(secondsFromCivil(2026, 10, 17, 7, 30) - offset) == 1);
+    assert(bedLight->isOn() && bedLight->getBrightness() == 40 && !livingLight->isOn());
+    assert(scheduler.getNextFireTime(bedroom) == secondsFromCivil(2026, 10, 19, 7, 30) - offset);
+
+    smartHome.setMode(MODE_NORMAL);
+    size_t before = recorder.firings.size();
+    SchedulerStats beforeStats = scheduler.getStats();
+    assert(scheduler.tick(secondsFromCivil(2026, 10, 19, 19, 30) - offset) == 2);
+    SchedulerStats afterStats = scheduler.getStats();
+    assert(recorder.firings.size() == before + 2);
+    assert(recorder.firings[before].scheduleId == lightsOff || recorder.firings[before + 1].scheduleId == lightsOff);
+    for (size_t i = before; i < recorder.firings.size(); ++i) {
+        assert(recorder.firings[i].catchUp);
+        if (recorder.firings[i].scheduleId == lightsOff) {
+            assert(recorder.firings[i].dueTime == secondsFromCivil(2026, 10, 19, 1, 0) - offset);
+        } else {
+            assert(recorder.firings[i].scheduleId == evening);
+            assert(recorder.firings[i].dueTime == secondsFromCivil(2026, 10, 19, 19, 0) - offset);
+        }
+    }
+    assert(smartHome.getCurrentMode() == MODE_EVENING);
+    assert(afterStats.caughtUp == beforeStats.caughtUp + 2);
+    assert(afterStats.skippedMissed == beforeStats.skippedMissed + 2);
+
+    smartHome.setMode(MODE_NORMAL);
+    assert(scheduler.tick(secondsFromCivil(2026, 10, 20, 21, 0) - offset) == 1);
+    assert(smartHome.getCurrentMode() == MODE_NORMAL);
+    assert(scheduler.getStats().skippedMissed == afterStats.skippedMissed + 2);
+
+    assert(scheduler.tick(secondsFromCivil(2026, 10, 28, 19, 0) - offset) > 0);
+    assert(scheduler.getNextFireTime(evening) == secondsFromCivil(2026, 10, 30, 19, 0) - offset);
+    assert(scheduler.setScheduleEnabled(evening, false, now));
+    assert(scheduler.getNextFireTime(evening) == 0);
+    assert(scheduler.setScheduleEnabled(evening, true, secondsFromCivil(2026, 10, 30, 20, 0) - offset));
+    assert(scheduler.getNextFireTime(evening) == secondsFromCivil(2026, 11, 2, 19, 0) - offset);
+    scheduler.setListener(0);
+
+    AutomationScheduler dormant;
+    FiringRecorder dormantRecorder;
+    dormant.setListener(&dormantRecorder);
+    time_t asleep = static_cast<time_t>(secondsFromCivil(2026, 1, 1));
+    ScheduleDefinition minutely("Every minute", "* * * * *");
+    minutely.withCatchUp(CATCH_UP_SKIP).graceSeconds = 0;
+    uint32_t everyMinute = dormant.addSchedule(minutely, asleep);
+    time_t awake = asleep + 100 * 86400 + 30;
+    assert(dormant.tick(awake) == 0);
+    assert(dormantRecorder.firings.empty());
+    assert(dormant.getStats().skippedMissed == 100000);
+    assert(dormant.getNextFireTime(everyMinute) == asleep + 100 * 86400 + 60);
+    assert(dormant.tick(awake + 30) == 1);
+    assert(dormantRecorder.firings.back().dueTime == awake + 30);
+    assert(!dormantRecorder.firings.back().catchUp);
+    dormant.setListener(0);
+
+    AutomationScheduler bulk;
+    Random random(44);
+    const size_t scheduleCount = 5000;
+    time_t start = static_cast<time_t>(secondsFromCivil(2026, 1, 1));
+    for (size_t i = 0; i < scheduleCount; ++i) {
+        std::ostringstream expression;
+        expression << random.nextInt(0, 59) << " " << random.nextInt(0, 23) << " * * *";
+        assert(bulk.addSchedule(ScheduleDefinition("bulk", expression.str()), start) != 0);
+    }
+    SchedulerStats initial = bulk.getStats();
+    uint64_t begin = monotonicMicros();
+    size_t fired = 0;
+    const int days = 3;
+    for (int minute = 1; minute <= days * 24 * 60; ++minute) {
+        fired += bulk.tick(start + minute * 60);
+    }
+    uint64_t elapsed = monotonicMicros() - begin;
+    SchedulerStats stats = bulk.getStats();
+    assert(fired == scheduleCount * days);
+    assert(stats.nextComputations - initial.nextComputations == fired);
+    assert(stats.heapEntries == scheduleCount);
+    std::cout << "  " << scheduleCount << " schedules over " << days << " days: " << stats.ticks << " ticks, "
+              << static_cast<double>(elapsed) / stats.ticks << " us/tick avg, "
+              << stats.nextComputations - initial.nextComputations << " next-time computations" << std::endl;
+
+    std::cout << "AutomationScheduler tests passed!" << std::endl;
+}
+
+class ImplBackedLight : public Light {
+public:
+    ImplBackedLight(uint32_t id, const std::string& name, const std::string& location)
+        : Light(id, name, location), m_impl(11) {}
+    virtual void turnOn() {
+        m_impl.powerOn();
+        Light::turnOn();
+    }
+
+private:
+    SimulatedDeviceImpl m_impl;
+};
+
+class ToggleModeCommand : public ICommand {
+public:
+    explicit ToggleModeCommand(SmartHome* home) : m_home(home) {}
+    virtual void execute() {
+        m_home->setMode(m_home->getCurrentMode() == MODE_PARTY ? MODE_EVENING : MODE_PARTY);
+    }
+    virtual std::string getName() const { return "Toggle mode"; }
+    virtual std::string getDescription() const { return "Switches between party and evening"; }
+    virtual int getMenuKey() const { return 42; }
+
+private:
+    SmartHome* m_home;
+};
+
+const TraceEvent* findSpan(const std::vector<TraceEvent>& events, const std::string& name) {
+    for (size_t i = 0; i < events.size(); ++i) {
+        if (name == events[i].name) {
+            return &events[i];
+        }
+    }
+    return 0;
+}
+
+bool spanContains(const TraceEvent* parent, const TraceEvent* child) {
+    return parent && child && child->depth > parent->depth && child->threadId == parent->threadId &&
+           child->startNanos >= parent->startNanos &&
+           child->startNanos + child->durationNanos <= parent->startNanos + parent->durationNanos;
+}
+
+void testSpanTracing() {
+    std::cout << "Testing span tracing..." << std::endl;
+
+    ImplBackedLight realLight(500, "Traced Light", "Salon");
+    SmartHome smartHome;
+    Device* proxy = new DeviceProxy(&realLight);
+    assert(smartHome.addDevice(proxy));
+    CommandInvoker invoker;
+    invoker.registerCommand(42, new ToggleModeCommand(&smartHome));
+    Tracer& tracer = Tracer::getInstance();
+    tracer.clear();
+
+    assert(!Tracer::isEnabled());
+    assert(invoker.executeCommand(42));
+    assert(tracer.getEventCount() == 0);
+    assert(invoker.executeCommand(42));
+
+    tracer.setSampleInterval(1);
+    tracer.enable(true);
+    assert(invoker.executeCommand(42));
+    assert(smartHome.getCurrentMode() == MODE_PARTY && realLight.isOn());
+    std::vector<TraceEvent> events = tracer.getEvents();
+    const TraceEvent* command = findSpan(events, "CommandInvoker::executeCommand");
+    const TraceEvent* homeMode = findSpan(events, "SmartHome::setMode");
+    const TraceEvent* modeManager = findSpan(events, "ModeManager::setMode");
+    const TraceEvent* scene = findSpan(events, "SceneEngine::apply");
+    const TraceEvent* proxySpan = findSpan(events, "DeviceProxy::turnOn");
+    const TraceEvent* impl = findSpan(events, "SimulatedDeviceImpl::powerOn");
+    assert(command && command->depth == 0 && command->id == 42);
+    assert(spanContains(command, homeMode));
+    assert(spanContains(homeMode, modeManager));
+    assert(spanContains(homeMode, scene));
+    assert(spanContains(scene, proxySpan) && proxySpan->id == 500);
+    assert(spanContains(proxySpan, impl));
+
+    std::string json = tracer.exportChromeJson();
+    assert(json.find("\"traceEvents\":[") != std::string::npos);
+    assert(json.find("\"name\":\"SimulatedDeviceImpl::powerOn\",\"cat\":\"impl\",\"ph\":\"X\"") != std::string::npos);
+    assert(json.find("\"name\":\"thread_name\",\"ph\":\"M\"") != std::string::npos);
+    assert(tracer.writeChromeJson("test_trace.json"));
+    std::ifstream file("test_trace.json");
+    std::string firstLine;
+    std::getline(file, firstLine);
+    file.close();
+    assert(firstLine.find("{\"displayTimeUnit\"") == 0);
+    std::remove("test_trace.json");
+
+    tracer.clear();
+    tracer.setSampleRate(0.25);
+    assert(tracer.getSampleInterval() == 4);
+    for (int i = 0; i < 8; ++i) {
+        assert(invoker.executeCommand(42));
+    }
+    events = tracer.getEvents();
+    size_t roots = 0;
+    for (size_t i = 0; i < events.size(); ++i) {
+        if (events[i].depth == 0) {
+            assert(std::string(events[i].name) == "CommandInvoker::executeCommand");
+            ++roots;
+        }
+    }
+    assert(roots == 2);
+    assert(findSpan(events, "SmartHome::setMode") != 0);
+
+    tracer.setBufferCapacity(3);
+    tracer.setSampleInterval(1);
+    tracer.clear();
+    assert(invoker.executeCommand(42));
+    assert(tracer.getEventCount() == 3 && tracer.getDroppedCount() > 0);
+    tracer.setBufferCapacity(65536);
+
+    tracer.enable(false);
+    tracer.clear();
+    uint64_t droppedBefore = tracer.getDroppedCount();
+    const int iterations = 1000000;
+    uint64_t start = monotonicMicros();
+    for (int i = 0; i < iterations; ++i) {
+        TraceSpan span("disabled", "bench");
+    }
+    double disabledNanos = (monotonicMicros() - start) * 1000.0 / iterations;
+    assert(tracer.getEventCount() == 0);
+    assert(tracer.getDroppedCount() == droppedBefore);
+    tracer.enable(true);
+    start = monotonicMicros();
+    for (int i = 0; i < 10000; ++i) {
+        TraceSpan span("enabled", "bench");
+    }
+    double enabledNanos = (monotonicMicros() - start) * 1000.0 / 10000;
+    assert(tracer.getEventCount() == 10000);
+    tracer.enable(false);
+    tracer.clear();
+    std::cout << "  span cost: " << disabledNanos << " ns disabled, " << enabledNanos << " ns recording" << std::endl;
+
+    std::cout << "Span tracing tests passed!" << std::endl;
+}
+
+void testTerminalRenderer() {
+    std::cout << "Testing TerminalRenderer..." << std::endl;
+
+    TerminalRenderer renderer(-1);
+    renderer.resize(6, 20);
+    renderer.setLine(0, "Header");
+    renderer.setLine(1, "a line that is far too long for the screen");
+    assert(renderer.getLine(1).length() == 20);
+    renderer.placeCursor(5, 2);
+    assert(renderer.present() == 2);
+    assert(renderer.getLastOutput().find("\033[2J") != std::string::npos);
+    assert(renderer.getLastOutput().find("Header") != std::string::npos);
+
+    renderer.setLine(0, "Header");
+    renderer.setLine(1, "a line that is far too long for the screen");
+    assert(renderer.present() == 0);
+    assert(renderer.getLastOutput().empty());
+
+    renderer.setLine(3, "changed");
+    assert(renderer.present() == 1);
+    const std::string& output = renderer.getLastOutput();
+    assert(output.find("\033[4;1Hchanged\033[K") != std::string::npos);
+    assert(output.find("Header") == std::string::npos);
+    assert(output.find("\033[6;3H") != std::string::npos);
+    renderer.invalidateRow(0);
+    assert(renderer.present() == 1);
+    renderer.clear();
+    assert(renderer.present() == 3);
+    assert(renderer.getFrameCount() == 5);
+
+    TerminalRenderer plain(-1);
+    plain.resize(4, 20);
+    plain.setAnsiEnabled(false);
+    assert(!plain.isAnsiEnabled());
+    plain.setLine(0, "Header");
+    plain.setLine(2, "Prompt:");
+    plain.placeCursor(2, 7);
+    assert(plain.present() == 4);
+    assert(plain.getLastOutput() == "Header\n\nPrompt:");
+    assert(plain.present() == 0 && plain.getLastOutput().empty());
+    plain.setLine(1, "changed");
+    assert(plain.present() == 1);
+    assert(plain.getLastOutput() == "Header\nchanged\nPrompt:");
+    assert(plain.getLastOutput().find('\033') == std::string::npos);
+
+    LogLevel level = Logger::getInstance().getLogLevel();
+    Logger::getInstance().setLogLevel(LOG_WARNING);
+    SmartHome home;
+    home.setMaxDevices(10000);
+    for (int i = 0; i < 10000; ++i) {
+        std::ostringstream name;
+        name << "Lamba " << i;
+        home.addLight(name.str(), i % 2 ? "Salon" : "Mutfak");
+    }
+    DeviceListView view(&home.getInfoCache());
+    view.setDevices(home.getAllDevices());
+    view.setPageSize(20);
+    assert(view.getPageCount() == 500);
+    assert(view.getPage() == 0);
+    view.nextPage();
+    assert(view.getOffset() == 20 && view.getPage() == 1);
+    view.scrollBy(-5);
+    assert(view.getOffset() == 15);
+    view.scrollBy(-100);
+    assert(view.getOffset() == 0);
+    view.lastPage();
+    assert(view.getOffset() == 9980 && view.getPage() == 499);
+    view.nextPage();
+    assert(view.getOffset() == 9980);
+    view.scrollTo(5000);
+    assert(view.getOffset() == 5000);
+
+    TerminalRenderer screen(-1);
+    screen.resize(24, 120);
+    uint64_t start = monotonicMicros();
+    assert(view.render(screen, 2) == 20);
+    screen.present();
+    uint64_t firstMicros = monotonicMicros() - start;
+    assert(screen.getLine(2) == DeviceListView::formatRow(home.getDevice(5001)));
+    assert(screen.getLine(2).find("Lamba 5000") != std::string::npos);
+
+    home.powerOnDevice(5003);
+    start = monotonicMicros();
+    view.render(screen, 2);
+    assert(screen.present() == 1);
+    uint64_t diffMicros = monotonicMicros() - start;
+    assert(screen.getLastOutput().find("ACIK") != std::string::npos);
+    view.render(screen, 2);
+    assert(screen.present() == 0);
+
+    view.setShowInfo(true);
+    uint64_t renders = home.getInfoCache().getRenderCount();
+    view.render(screen, 2);
+    assert(screen.present() == 20);
+    assert(home.getInfoCache().getRenderCount() == renders + 20);
+    view.render(screen, 2);
+    assert(home.getInfoCache().getRenderCount() == renders + 20);
+    assert(screen.present() == 0);
+
+    view.setDevices(std::vector<Device*>());
+    assert(view.getPageCount() == 1 && view.getOffset() == 0);
+    view.render(screen, 2);
+    assert(screen.getLine(2).empty());
+    Logger::getInstance().setLogLevel(level);
+    std::cout << "  10k devices: page render " << firstMicros << " us, one-row update " << diffMicros
+              << " us (" << screen.getBytesWritten() << " bytes total)" << std::endl;
+
+    std::cout << "TerminalRenderer tests passed!" << std::endl;
+}
+
 int main() {
     std::cout << "=== MySweetHome Menu/System Tests ===" << std::endl << std::endl;
 
     testSmartHome();
     testDeviceControl();
     testStateManagement();
+    testHealthMonitorDeviceRemoval();
+    testSecuritySequenceVirtualClock();
+    testFusionEngine();
+    testCameraMotionReports();
+    testSceneEngine();
+    testRuleEngine();
+    testAutomationScheduler();
+    testSpanTracing();
+    testTerminalRenderer();
 
     std::cout << std::endl << "All tests passed!" << std::endl;
     return 0;
@@ -0,0 +1,142 @@
+#include <iostream>
+#include <cassert>
+#include "common_types.h"
+#include "SmartHome.h"
+#include "FleetSpec.h"
+#include "FleetGenerator.h"
+#include "LoadHarness.h"
+#include "Logger.h"
+#include <vector>
+
+using namespace MySweetHome;
+
+void testFleetSpecParse() {
+    std::cout << "Testing FleetSpec parsing..." << std::endl;
+
+    FleetSpec spec;
+    bool ok = spec.parse(
+        "# test fleet\n"
+        "rooms = 8\n"
+        "seed = 99\n"
+        "duration = 120\n"
+        "tick = 500\n"
+        "incidents_per_hour = 12.5\n"
+        "light:Philips = 30\n"
+        "light = 10\n"
+        "camera:Sony = 4\n"
+        "smoke = 16\n"
+        "gas = 8\n"
+        "alarm = 8\n");
+    assert(ok);
+    assert(spec.getRooms() == 8);
+    assert(spec.getSeed() == 99);
+    assert(spec.getDurationSeconds() == 120);
+    assert(spec.getTickMillis() == 500);
+    assert(spec.getIncidentsPerHour() == 12.5);
+    assert(spec.getCount(DEVICE_LIGHT) == 40);
+    assert(spec.getTotalDevices() == 76);
+
+    FleetSpec bad;
+    assert(!bad.parse("toaster = 3\nrooms = many\n"));
+    assert(bad.getTotalDevices() == 0);
+
+    std::cout << "FleetSpec parsing tests passed!" << std::endl;
+}
+
+void testFleetGenerator() {
+    std::cout << "Testing FleetGenerator..." << std::endl;
+
+    assert(FleetGenerator::isSupported(DEVICE_CAMERA, "Logitech"));
+    assert(!FleetGenerator::isSupported(DEVICE_TV, "Philips"));
+
+    FleetSpec spec;
+    spec.setRooms(10);
+    spec.addDevices(DEVICE_LIGHT, "IKEA", 150);
+    spec.addDevices(DEVICE_CAMERA, "Samsung", 20);
+    spec.addDevices(DEVICE_SMOKE_DETECTOR, "Generic", 40);
+    spec.addDevices(DEVICE_TV, "Philips", 5);
+
+    SmartHome home;
+    FleetGenerator generator(spec);
+    size_t added = generator.populate(home);
+    assert(added == 210);
+    assert(home.getDeviceCount() == 210);
+    assert(home.getMaxDevices() >= 210);
+    assert(home.getDevicesByLocation("Room 1").size() == 21);
+    assert(home.getDevicesByType(DEVICE_CAMERA).size() == 20);
+    assert(home.getDevice(210) != 0);
+
+    std::cout << "FleetGenerator tests passed!" << std::endl;
+}
+
+void testLoadHarness() {
+    std::cout << "Testing LoadHarness..." << std::endl;
+
+    FleetSpec spec;
+    spec.setRooms(20);
+    spec.setSeed(7);
+    spec.setDurationSeconds(3600);
+    spec.setIncidentsPerHour(60.0);
+    spec.setMotionPerHour(10.0);
+    spec.addDevices(DEVICE_LIGHT, "Generic", 200);
+    spec.addDevices(DEVICE_SMOKE_DETECTOR, "Generic", 100);
+    spec.addDevices(DEVICE_GAS_DETECTOR, "Generic", 50);
+    spec.addDevices(DEVICE_CAMERA, "Sony", 20);
+    spec.addDevices(DEVICE_ALARM, "Generic", 20);
+
+    SmartHome home;
+    FleetGenerator(spec).populate(home);
+    LoadHarness harness(home, spec);
+    LoadReport report = harness.run();
+
+    assert(report.deviceCount == 390);
+    assert(report.detectorCount == 150);
+    assert(report.cameraCount == 20);
+    assert(report.alarmCount == 20);
+    assert(report.ticks == 3600);
+    assert(report.sensorReadings == 3600ULL * 150ULL);
+    assert(report.incidents > 20);
+    assert(report.motionEvents > 100);
+    assert(report.alarmEvents >= report.motionEvents);
+    assert(report.latencySamples > 0);
+    assert(report.latencyP50Micros <= report.latencyP90Micros);
+    assert(report.latencyP90Micros <= report.latencyP99Micros);
+    assert(report.latencyP99Micros <= report.latencyMaxMicros);
+    assert(report.subsystems.size() == SUBSYSTEM_COUNT);
+    assert(report.subsystems[SUBSYSTEM_DETECTORS].operations == report.sensorReadings);
+    assert(!report.toString().empty());
+    assert(report.allocationsTracked);
+    assert(report.subsystems[SUBSYSTEM_SENSORS].allocations == 0);
+    assert(report.subsystems[SUBSYSTEM_DETECTORS].allocations < 64);
+    assert(report.subsystems[SUBSYSTEM_CAMERAS].allocations <= report.motionEvents);
+    assert(report.toString().find("alloc") != std::string::npos);
+
+    SmartHome replayHome;
+    FleetGenerator(spec).populate(replayHome);
+    LoadReport replay = LoadHarness(replayHome, spec).run();
+    assert(replay.incidents == report.incidents);
+    assert(replay.motionEvents == report.motionEvents);
+    assert(replay.alarmEvents == report.alarmEvents);
+
+    std::vector<uint64_t> samples;
+    for (uint64_t i = 1; i <= 100; ++i) {
+        samples.push_back(i);
+    }
+    assert(LoadHarness::percentile(samples, 0.5) == 50);
+    assert(LoadHarness::percentile(samples, 0.99) == 99);
+    assert(LoadHarness::percentile(samples, 1.0) == 100);
+
+    std::cout << "LoadHarness tests passed!" << std::endl;
+}
+
+int main() {
+    std::cout << "=== MySweetHome Simulation Tests ===" << std::endl << std::endl;
+    Logger::getInstance().setLogLevel(LOG_WARNING);
+
+    testFleetSpecParse();
+    testFleetGenerator();
+    testLoadHarness();
+
+    std::cout << std::endl << "All tests passed!" << std::endl;
+    return 0;
+}